@@ -0,0 +1,317 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#include "backupstore.h"
+
+#include <set>
+#include <vector>
+#include <wx/dir.h>
+#include <wx/ffile.h>
+#include <wx/filename.h>
+#include <wx/log.h>
+#include <wx/longlong.h>
+#include <wx/textfile.h>
+#include <wx/wxsqlite3.h>
+
+namespace
+{
+
+const char MANIFEST_HEADER[] = "MMEXSTORE 2";
+
+// SHA3-256 of blocks of memory as 64 lowercase hex digits, computed by the
+// sha3() function of SQLite on an in-memory connection of its own
+class Sha3
+{
+public:
+    Sha3()
+    {
+        try
+        {
+            m_db.Open(":memory:");
+            m_stmt = m_db.PrepareStatement("SELECT sha3(?, 256)");
+        }
+        catch (const wxSQLite3Exception& e)
+        {
+            m_error = e.GetMessage();
+        }
+    }
+
+    /** Empty on error, e.g. with an SQLite built without the function */
+    wxString hash(const unsigned char* data, size_t size)
+    {
+        if (!m_error.empty())
+            return wxEmptyString;
+
+        wxString result;
+        try
+        {
+            m_stmt.Bind(1, data, static_cast<int>(size));
+            {
+                wxSQLite3ResultSet q = m_stmt.ExecuteQuery();
+                int length = 0;
+                const unsigned char* digest = q.GetBlob(0, length);
+                for (int i = 0; i < length; i++)
+                    result += wxString::Format("%02x", digest[i]);
+            }
+            m_stmt.Reset();
+        }
+        catch (const wxSQLite3Exception& e)
+        {
+            m_error = e.GetMessage();
+            return wxEmptyString;
+        }
+        return result;
+    }
+
+    const wxString& error() const { return m_error; }
+
+private:
+    wxSQLite3Database m_db;
+    wxSQLite3Statement m_stmt;
+    wxString m_error;
+};
+
+// Writes the data to a temporary file renamed to path once complete
+bool writeFile(const wxString& path, const void* data, size_t size)
+{
+    const wxString temp = path + ".tmp";
+    wxFFile file(temp, "wb");
+    if (!file.IsOpened())
+        return false;
+    const bool ok = file.Write(data, size) == size && file.Close();
+    if (!ok || !wxRenameFile(temp, path, true))
+    {
+        wxRemoveFile(temp);
+        return false;
+    }
+    return true;
+}
+
+}
+
+mmBackupStore::mmBackupStore(const wxString& dbFileName)
+    : m_path(dbFileName + ".store")
+{
+}
+
+bool mmBackupStore::exists() const
+{
+    return wxDirExists(m_path);
+}
+
+wxString mmBackupStore::chunkPath(const wxString& hash) const
+{
+    const wxString sep = wxFileName::GetPathSeparator();
+    return m_path + sep + "chunks" + sep + hash.Left(2) + sep + hash;
+}
+
+wxString mmBackupStore::manifestPath(const wxString& name) const
+{
+    const wxString sep = wxFileName::GetPathSeparator();
+    return m_path + sep + "snapshots" + sep + name + ".manifest";
+}
+
+bool mmBackupStore::add(const wxString& fileName, const wxString& name)
+{
+    wxFFile file(fileName, "rb");
+    if (!file.IsOpened())
+    {
+        m_error = wxString::Format("Unable to read %s", fileName);
+        return false;
+    }
+
+    wxString manifest = wxString::Format("%s\n%s\n", MANIFEST_HEADER, wxLongLong(file.Length()).ToString());
+    Sha3 sha;
+    std::vector<unsigned char> chunk(CHUNK_SIZE);
+    int written = 0;
+    for (;;)
+    {
+        const size_t size = file.Read(chunk.data(), CHUNK_SIZE);
+        if (size == 0)
+            break;
+
+        const wxString hash = sha.hash(chunk.data(), size);
+        if (hash.empty())
+        {
+            m_error = wxString::Format("Unable to hash %s: %s", fileName, sha.error());
+            return false;
+        }
+        manifest << hash << "\n";
+
+        // a chunk already stored is never written again
+        const wxString path = chunkPath(hash);
+        if (wxFileExists(path))
+            continue;
+        if (!wxFileName::Mkdir(wxFileName(path).GetPath(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)
+            || !writeFile(path, chunk.data(), size))
+        {
+            m_error = wxString::Format("Unable to write %s", path);
+            return false;
+        }
+        written++;
+    }
+    if (file.Error())
+    {
+        m_error = wxString::Format("Unable to read %s", fileName);
+        return false;
+    }
+    const wxString path = manifestPath(name);
+    const wxScopedCharBuffer utf8 = manifest.utf8_str();
+    if (!wxFileName::Mkdir(wxFileName(path).GetPath(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)
+        || !writeFile(path, utf8.data(), utf8.length()))
+    {
+        m_error = wxString::Format("Unable to write %s", path);
+        return false;
+    }
+
+    wxLogDebug("Backup store %s: %i new chunks", name, written);
+    return true;
+}
+
+bool mmBackupStore::readManifest(const wxString& name, wxFileOffset& size, wxArrayString& hashes)
+{
+    wxTextFile manifest;
+    if (!wxFileExists(manifestPath(name)) || !manifest.Open(manifestPath(name), wxConvUTF8)
+        || manifest.GetLineCount() < 2 || manifest[0] != MANIFEST_HEADER)
+    {
+        m_error = wxString::Format("Snapshot %s is missing or damaged", name);
+        return false;
+    }
+
+    wxLongLong_t value = 0;
+    if (!manifest[1].ToLongLong(&value))
+    {
+        m_error = wxString::Format("Snapshot %s is missing or damaged", name);
+        return false;
+    }
+    size = value;
+
+    hashes.clear();
+    for (size_t i = 2; i < manifest.GetLineCount(); i++)
+    {
+        if (!manifest[i].empty())
+            hashes.Add(manifest[i]);
+    }
+    return true;
+}
+
+bool mmBackupStore::restore(const wxString& name, const wxString& fileName)
+{
+    wxFileOffset size = 0;
+    wxArrayString hashes;
+    if (!readManifest(name, size, hashes))
+        return false;
+
+    const wxString temp = fileName + ".tmp";
+    wxFFile file(temp, "wb");
+    if (!file.IsOpened())
+    {
+        m_error = wxString::Format("Unable to write %s", fileName);
+        return false;
+    }
+
+    bool ok = true;
+    wxFileOffset total = 0;
+    Sha3 sha;
+    std::vector<unsigned char> chunk(CHUNK_SIZE + 1);
+    for (const auto& hash : hashes)
+    {
+        wxFFile in(chunkPath(hash), "rb");
+        const size_t read = in.IsOpened() ? in.Read(chunk.data(), chunk.size()) : 0;
+        const wxString check = read > 0 && read <= CHUNK_SIZE ? sha.hash(chunk.data(), read) : wxString();
+        if (read > 0 && read <= CHUNK_SIZE && check.empty())
+        {
+            m_error = wxString::Format("Unable to check snapshot %s: %s", name, sha.error());
+            ok = false;
+            break;
+        }
+        if (check != hash)
+        {
+            m_error = wxString::Format("Chunk %s of snapshot %s is missing or damaged", hash, name);
+            ok = false;
+            break;
+        }
+        if (file.Write(chunk.data(), read) != read)
+        {
+            m_error = wxString::Format("Unable to write %s", fileName);
+            ok = false;
+            break;
+        }
+        total += read;
+    }
+
+    if (ok && total != size)
+    {
+        m_error = wxString::Format("Snapshot %s is missing or damaged", name);
+        ok = false;
+    }
+    ok = file.Close() && ok;
+    if (!ok || !wxRenameFile(temp, fileName, true))
+    {
+        wxRemoveFile(temp);
+        return false;
+    }
+    return true;
+}
+
+wxArrayString mmBackupStore::snapshots(const wxString& pattern) const
+{
+    wxArrayString names;
+    const wxString dir = wxFileName(manifestPath("")).GetPath();
+    if (!wxDirExists(dir))
+        return names;
+
+    wxArrayString files;
+    wxDir::GetAllFiles(dir, &files, pattern + ".manifest", wxDIR_FILES);
+    for (const auto& file : files)
+        names.Add(wxFileName(file).GetName());
+    names.Sort();
+    return names;
+}
+
+void mmBackupStore::remove(const wxArrayString& names)
+{
+    if (names.empty())
+        return;
+
+    for (const auto& name : names)
+        wxRemoveFile(manifestPath(name));
+
+    // chunks are shared, only those no snapshot uses anymore go
+    std::set<wxString> used;
+    for (const auto& name : snapshots())
+    {
+        wxFileOffset size = 0;
+        wxArrayString hashes;
+        if (!readManifest(name, size, hashes))
+        {
+            // an unreadable manifest may still use any chunk, keep them all
+            wxLogDebug("Backup store: %s", m_error);
+            return;
+        }
+        used.insert(hashes.begin(), hashes.end());
+    }
+
+    wxArrayString files;
+    const wxString sep = wxFileName::GetPathSeparator();
+    if (wxDirExists(m_path + sep + "chunks"))
+        wxDir::GetAllFiles(m_path + sep + "chunks", &files, wxEmptyString, wxDIR_FILES | wxDIR_DIRS);
+    for (const auto& file : files)
+    {
+        if (used.find(wxFileName(file).GetFullName()) == used.end())
+            wxRemoveFile(file);
+    }
+}
@@ -0,0 +1,76 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#ifndef MM_EX_BACKUPSTORE_H_
+#define MM_EX_BACKUPSTORE_H_
+
+#include <wx/arrstr.h>
+#include <wx/filefn.h>
+#include <wx/string.h>
+
+/**
+* Keeps backups of a database as snapshots sharing their unchanged parts.
+*
+* A snapshot is cut into chunks of CHUNK_SIZE bytes, a multiple of every
+* SQLite page size, so a page change touches a single chunk. Each chunk is
+* written once, under the SHA3-256 hash of its content computed by the
+* sha3() function of SQLite. A snapshot is a small text manifest: a header
+* line, the size of the file, then the hashes of its chunks in order.
+*
+* Chunks only repeat between snapshots when the unchanged pages are stored
+* with the same bytes. Encrypted databases are therefore added as their
+* file is, not through a copy encrypted again.
+*
+*   dbFile.store/chunks/ab/abcdef...        chunk content
+*   dbFile.store/snapshots/NAME.manifest    manifest
+*
+* Files are written under a temporary name and renamed once complete, so an
+* interrupted backup leaves the previous snapshots usable.
+*/
+class mmBackupStore
+{
+public:
+    enum { CHUNK_SIZE = 64 * 1024 };
+
+    /** The store of the database file, in dbFile.store next to it */
+    explicit mmBackupStore(const wxString& dbFileName);
+
+    /**
+    * Adds the file as the snapshot name, replacing one of the same name.
+    * A database in use is read as it is, the caller holds a read
+    * transaction on it meanwhile so no connection commits to the file.
+    */
+    bool add(const wxString& fileName, const wxString& name);
+    /** Writes the snapshot name to fileName, checking every chunk */
+    bool restore(const wxString& name, const wxString& fileName);
+    /** Names of the snapshots matching the wildcard pattern, sorted */
+    wxArrayString snapshots(const wxString& pattern = "*") const;
+    /** Removes the snapshots, then the chunks no snapshot uses anymore */
+    void remove(const wxArrayString& names);
+
+    bool exists() const;
+    const wxString& error() const { return m_error; }
+
+private:
+    wxString chunkPath(const wxString& hash) const;
+    wxString manifestPath(const wxString& name) const;
+    bool readManifest(const wxString& name, wxFileOffset& size, wxArrayString& hashes);
+
+    wxString m_path;
+    wxString m_error;
+};
+
+#endif // MM_EX_BACKUPSTORE_H_
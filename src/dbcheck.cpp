@@ -21,91 +21,323 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include "model/Model_Account.h"
 #include "model/Model_Attachment.h"
-#include "model/Model_Billsdeposits.h"
-#include "model/Model_Category.h"
-#include "model/Model_Payee.h"
-#include "model/Model_Stock.h"
+#include "model/Model_Checking.h"
 
-bool dbCheck::checkDB()
+#include <map>
+
+namespace
 {
-    bool result = true;
-    result = checkAccounts();
-    
-    return result;
-}
 
-bool dbCheck::checkAccounts()
+// Most ids of the rows at fault listed with a problem
+const int MAX_IDS = 10;
+
+// A check run on a worker of mmReportPool, with the problems it found
+class ProblemsTask : public mmReportTask
 {
-    bool result = true;
+public:
+    wxArrayString problems;
+};
 
-    // Transactions
-    const auto &transactions = Model_Checking::instance().all();
-    for (const auto& trx : transactions)
-        if (!Model_Account::instance().get(trx.ACCOUNTID) || (Model_Checking::type_id(trx) == Model_Checking::TYPE_ID_TRANSFER && !Model_Account::instance().get(trx.TOACCOUNTID)))
-        {
-            result = false;
-        }
+class CheckTask : public ProblemsTask
+{
+public:
+    // without a message sql is a pragma returning "ok" or the problems found
+    CheckTask(const wxString& message, const wxString& sql) : m_message(message), m_sql(sql) {}
+    virtual void Run(wxSQLite3Database* db);
 
-    // BillsDeposits
-    const auto &bills = Model_Billsdeposits::instance().all();
-    for (const auto& bill : bills)
-        if (!Model_Account::instance().get(bill.ACCOUNTID) || (Model_Billsdeposits::type_id(bill) == Model_Checking::TYPE_ID_TRANSFER && !Model_Account::instance().get(bill.TOACCOUNTID)))
+private:
+    wxString m_message, m_sql;
+};
+
+void CheckTask::Run(wxSQLite3Database* db)
+{
+    problems.clear();
+    if (cancelled())
+        return;
+
+    if (m_message.empty())
+    {
+        wxSQLite3ResultSet rs = db->ExecuteQuery(m_sql);
+        while (rs.NextRow())
         {
-            result = false;
+            const wxString row = rs.GetAsString(0);
+            if (row != "ok")
+                problems.Add(row);
         }
+        return;
+    }
+
+    const int count = db->ExecuteScalar("SELECT COUNT(*) FROM (" + m_sql + ")");
+    if (count == 0 || cancelled())
+        return;
+
+    wxString ids;
+    wxSQLite3ResultSet rs = db->ExecuteQuery(wxString::Format("SELECT * FROM (%s) LIMIT %i", m_sql, MAX_IDS));
+    while (rs.NextRow())
+        ids << (ids.empty() ? "" : ", ") << rs.GetAsString(0);
+    if (count > MAX_IDS)
+        ids << ", ...";
+    problems.Add(wxString::Format("%s: %i (%s)", m_message, count, ids));
+}
+
+// PRAGMA foreign_key_check, one problem per row without its parent row
+class ForeignKeyTask : public ProblemsTask
+{
+public:
+    virtual void Run(wxSQLite3Database* db);
+};
+
+void ForeignKeyTask::Run(wxSQLite3Database* db)
+{
+    problems.clear();
+    if (cancelled())
+        return;
 
-    // Stocks
-    const auto &stocks = Model_Stock::instance().all();
-    for (const auto& stock : stocks)
-        if (!Model_Account::instance().get(stock.HELDAT) || (Model_Account::type_id(Model_Account::instance().get(stock.HELDAT)) != Model_Account::TYPE_ID_INVESTMENT))
+    // table, rowid (NULL for a WITHOUT ROWID table), parent table, index of the foreign key
+    wxSQLite3ResultSet rs = db->ExecuteQuery("PRAGMA foreign_key_check");
+    while (rs.NextRow())
+    {
+        problems.Add(wxString::Format(_("%s row %s: missing row of %s (foreign key %s)")
+            , rs.GetAsString(0), rs.IsNull(1) ? "?" : rs.GetAsString(1)
+            , rs.GetAsString(2), rs.GetAsString(3)));
+    }
+}
+
+/*
+Rows of table, keyed by id, whose type and ref columns point to nothing.
+Attachments, tag links and transaction links refer to records of several
+tables this way, with the Model_Attachment::REFTYPE_STR names as types.
+*/
+wxString missing_refs(const wxString& table, const wxString& id
+    , const wxString& type, const wxString& ref, const std::vector<int>& reftypes)
+{
+    static const std::map<int, std::pair<wxString, wxString>> targets = {
+        { Model_Attachment::REFTYPE_ID_TRANSACTION, { "CHECKINGACCOUNT_V1", "TRANSID" } },
+        { Model_Attachment::REFTYPE_ID_STOCK, { "STOCK_V1", "STOCKID" } },
+        { Model_Attachment::REFTYPE_ID_ASSET, { "ASSETS_V1", "ASSETID" } },
+        { Model_Attachment::REFTYPE_ID_BANKACCOUNT, { "ACCOUNTLIST_V1", "ACCOUNTID" } },
+        { Model_Attachment::REFTYPE_ID_BILLSDEPOSIT, { "BILLSDEPOSITS_V1", "BDID" } },
+        { Model_Attachment::REFTYPE_ID_PAYEE, { "PAYEE_V1", "PAYEEID" } },
+        { Model_Attachment::REFTYPE_ID_TRANSACTIONSPLIT, { "SPLITTRANSACTIONS_V1", "SPLITTRANSID" } },
+        { Model_Attachment::REFTYPE_ID_BILLSDEPOSITSPLIT, { "BUDGETSPLITTRANSACTIONS_V1", "SPLITTRANSID" } }
+    };
+
+    wxString sql, known;
+    for (const int reftype : reftypes)
+    {
+        const auto& target = targets.at(reftype);
+        const wxString& name = Model_Attachment::REFTYPE_STR[reftype];
+        sql << wxString::Format("SELECT x.%1$s FROM %2$s x LEFT JOIN %3$s r ON r.%4$s = x.%5$s"
+            " WHERE x.%6$s = '%7$s' AND r.%4$s IS NULL UNION ALL "
+            , id, table, target.first, target.second, ref, type, name);
+        known << (known.empty() ? "'" : ", '") << name << "'";
+    }
+    return sql + wxString::Format("SELECT %s FROM %s WHERE %s NOT IN (%s)", id, table, type, known);
+}
+
+}
+
+mmReportPool::RESULT dbCheck::checkDB(wxSQLite3Database* db, MODE mode, wxArrayString& problems)
+{
+    std::vector<wxSharedPtr<mmReportTask>> tasks;
+
+    // storage: the whole file, the checks of a single table skip the free pages and the page usage
+    if (mode == FULL)
+    {
+        tasks.push_back(wxSharedPtr<mmReportTask>(new CheckTask("", "PRAGMA integrity_check")));
+        tasks.push_back(wxSharedPtr<mmReportTask>(new ForeignKeyTask));
+    }
+    else
+        tasks.push_back(wxSharedPtr<mmReportTask>(new CheckTask("", "PRAGMA quick_check")));
+
+    Checks checks;
+    checkAccounts(checks);
+    checkAttachments(checks);
+    checkBudgets(checks);
+    checkBudgetYears(checks);
+    checkCategories(checks);
+    checkCurrencies(checks);
+    checkPayees(checks);
+    checkStocks(checks);
+    checkSubcategories(checks);
+    checkTransactions(checks);
+    for (const auto& check : checks)
+        tasks.push_back(wxSharedPtr<mmReportTask>(new CheckTask(check.message, check.sql)));
+
+    problems.clear();
+    mmReportPool::RESULT result = mmReportPool::instance().run(tasks, _("Database Check"), _("Checking database"));
+    if (result == mmReportPool::FAILED)
+    {
+        // no workers, or a check failed: run them here and report the errors
+        for (const auto& task : tasks)
         {
-            result = false;
+            try
+            {
+                task->Run(db);
+            }
+            catch (const wxSQLite3Exception& e)
+            {
+                problems.Add(e.GetMessage());
+            }
         }
+        result = mmReportPool::DONE;
+    }
 
+    for (const auto& task : tasks)
+    {
+        for (const auto& problem : static_cast<ProblemsTask*>(task.get())->problems)
+            problems.Add(problem);
+    }
     return result;
 }
 
-bool dbCheck::checkAttachments()
+void dbCheck::checkAccounts(Checks& checks)
 {
-    return true;
+    const wxString transfer = Model_Checking::TYPE_STR_TRANSFER;
+    checks.push_back({ _("Transactions of a missing account"),
+        "SELECT t.TRANSID FROM CHECKINGACCOUNT_V1 t LEFT JOIN ACCOUNTLIST_V1 a ON a.ACCOUNTID = t.ACCOUNTID"
+        " WHERE a.ACCOUNTID IS NULL" });
+    checks.push_back({ _("Transfers to a missing account"),
+        "SELECT t.TRANSID FROM CHECKINGACCOUNT_V1 t LEFT JOIN ACCOUNTLIST_V1 a ON a.ACCOUNTID = t.TOACCOUNTID"
+        " WHERE t.TRANSCODE = '" + transfer + "' AND a.ACCOUNTID IS NULL" });
+    checks.push_back({ _("Scheduled transactions of a missing account"),
+        "SELECT b.BDID FROM BILLSDEPOSITS_V1 b LEFT JOIN ACCOUNTLIST_V1 a ON a.ACCOUNTID = b.ACCOUNTID"
+        " WHERE a.ACCOUNTID IS NULL" });
+    checks.push_back({ _("Scheduled transfers to a missing account"),
+        "SELECT b.BDID FROM BILLSDEPOSITS_V1 b LEFT JOIN ACCOUNTLIST_V1 a ON a.ACCOUNTID = b.TOACCOUNTID"
+        " WHERE b.TRANSCODE = '" + transfer + "' AND a.ACCOUNTID IS NULL" });
+    checks.push_back({ _("Stocks not held in an investment account"),
+        "SELECT s.STOCKID FROM STOCK_V1 s LEFT JOIN ACCOUNTLIST_V1 a ON a.ACCOUNTID = s.HELDAT"
+        " WHERE a.ACCOUNTID IS NULL OR a.ACCOUNTTYPE <> '" + Model_Account::TYPE_STR_INVESTMENT + "'" });
 }
 
-bool dbCheck::checkBudgets()
+void dbCheck::checkAttachments(Checks& checks)
 {
-    return true;
+    checks.push_back({ _("Attachments of missing records"), missing_refs("ATTACHMENT_V1", "ATTACHMENTID", "REFTYPE", "REFID", {
+        Model_Attachment::REFTYPE_ID_TRANSACTION, Model_Attachment::REFTYPE_ID_STOCK,
+        Model_Attachment::REFTYPE_ID_ASSET, Model_Attachment::REFTYPE_ID_BANKACCOUNT,
+        Model_Attachment::REFTYPE_ID_BILLSDEPOSIT, Model_Attachment::REFTYPE_ID_PAYEE,
+        Model_Attachment::REFTYPE_ID_TRANSACTIONSPLIT, Model_Attachment::REFTYPE_ID_BILLSDEPOSITSPLIT }) });
 }
 
-bool dbCheck::checkBudgetYears()
+void dbCheck::checkBudgets(Checks& checks)
 {
-    return true;
+    checks.push_back({ _("Budget entries of a missing budget year"),
+        "SELECT b.BUDGETENTRYID FROM BUDGETTABLE_V1 b LEFT JOIN BUDGETYEAR_V1 y ON y.BUDGETYEARID = b.BUDGETYEARID"
+        " WHERE y.BUDGETYEARID IS NULL" });
+    checks.push_back({ _("Budget entries of a missing category"),
+        "SELECT b.BUDGETENTRYID FROM BUDGETTABLE_V1 b LEFT JOIN CATEGORY_V1 c ON c.CATEGID = b.CATEGID"
+        " WHERE c.CATEGID IS NULL" });
 }
 
-bool dbCheck::checkCategories()
+void dbCheck::checkBudgetYears(Checks& checks)
 {
-    return true;
+    // a year, or a year and a month for monthly budgets
+    checks.push_back({ _("Budget years with an invalid name"),
+        "SELECT BUDGETYEARID FROM BUDGETYEAR_V1"
+        " WHERE BUDGETYEARNAME NOT GLOB '[0-9][0-9][0-9][0-9]' AND BUDGETYEARNAME NOT GLOB '[0-9][0-9][0-9][0-9]-[0-9][0-9]'" });
 }
 
-bool dbCheck::checkCurrencies()
+void dbCheck::checkCategories(Checks& checks)
 {
-    return true;
+    checks.push_back({ _("Transactions of a missing category"),
+        "SELECT t.TRANSID FROM CHECKINGACCOUNT_V1 t LEFT JOIN CATEGORY_V1 c ON c.CATEGID = t.CATEGID"
+        " WHERE t.CATEGID > 0 AND c.CATEGID IS NULL" });
+    checks.push_back({ _("Splits of a missing category"),
+        "SELECT s.SPLITTRANSID FROM SPLITTRANSACTIONS_V1 s LEFT JOIN CATEGORY_V1 c ON c.CATEGID = s.CATEGID"
+        " WHERE c.CATEGID IS NULL" });
+    checks.push_back({ _("Scheduled transactions of a missing category"),
+        "SELECT b.BDID FROM BILLSDEPOSITS_V1 b LEFT JOIN CATEGORY_V1 c ON c.CATEGID = b.CATEGID"
+        " WHERE b.CATEGID > 0 AND c.CATEGID IS NULL" });
+    checks.push_back({ _("Scheduled splits of a missing category"),
+        "SELECT s.SPLITTRANSID FROM BUDGETSPLITTRANSACTIONS_V1 s LEFT JOIN CATEGORY_V1 c ON c.CATEGID = s.CATEGID"
+        " WHERE c.CATEGID IS NULL" });
+    checks.push_back({ _("Payees with a missing default category"),
+        "SELECT p.PAYEEID FROM PAYEE_V1 p LEFT JOIN CATEGORY_V1 c ON c.CATEGID = p.CATEGID"
+        " WHERE p.CATEGID > 0 AND c.CATEGID IS NULL" });
 }
 
-bool dbCheck::checkPayees()
+void dbCheck::checkCurrencies(Checks& checks)
 {
-    return true;
+    checks.push_back({ _("Accounts of a missing currency"),
+        "SELECT a.ACCOUNTID FROM ACCOUNTLIST_V1 a LEFT JOIN CURRENCYFORMATS_V1 c ON c.CURRENCYID = a.CURRENCYID"
+        " WHERE c.CURRENCYID IS NULL" });
+    checks.push_back({ _("Assets of a missing currency"),
+        "SELECT a.ASSETID FROM ASSETS_V1 a LEFT JOIN CURRENCYFORMATS_V1 c ON c.CURRENCYID = a.CURRENCYID"
+        " WHERE a.CURRENCYID > 0 AND c.CURRENCYID IS NULL" });
+    checks.push_back({ _("Rates of a missing currency"),
+        "SELECT h.CURRHISTID FROM CURRENCYHISTORY_V1 h LEFT JOIN CURRENCYFORMATS_V1 c ON c.CURRENCYID = h.CURRENCYID"
+        " WHERE c.CURRENCYID IS NULL" });
+    checks.push_back({ _("Missing base currency"),
+        "SELECT i.INFOID FROM INFOTABLE_V1 i LEFT JOIN CURRENCYFORMATS_V1 c ON c.CURRENCYID = CAST(i.INFOVALUE AS INTEGER)"
+        " WHERE i.INFONAME = 'BASECURRENCYID' AND c.CURRENCYID IS NULL" });
 }
 
-bool dbCheck::checkStocks()
+void dbCheck::checkPayees(Checks& checks)
 {
-    return true;
+    const wxString transfer = Model_Checking::TYPE_STR_TRANSFER;
+    checks.push_back({ _("Transactions of a missing payee"),
+        "SELECT t.TRANSID FROM CHECKINGACCOUNT_V1 t LEFT JOIN PAYEE_V1 p ON p.PAYEEID = t.PAYEEID"
+        " WHERE t.TRANSCODE <> '" + transfer + "' AND p.PAYEEID IS NULL" });
+    checks.push_back({ _("Scheduled transactions of a missing payee"),
+        "SELECT b.BDID FROM BILLSDEPOSITS_V1 b LEFT JOIN PAYEE_V1 p ON p.PAYEEID = b.PAYEEID"
+        " WHERE b.TRANSCODE <> '" + transfer + "' AND p.PAYEEID IS NULL" });
 }
 
-bool dbCheck::checkSubcategories()
+void dbCheck::checkStocks(Checks& checks)
 {
-    return true;
+    checks.push_back({ _("Share details of a missing transaction"),
+        "SELECT s.SHAREINFOID FROM SHAREINFO_V1 s LEFT JOIN CHECKINGACCOUNT_V1 t ON t.TRANSID = s.CHECKINGACCOUNTID"
+        " WHERE t.TRANSID IS NULL" });
+    checks.push_back({ _("Asset and stock links of a missing transaction"),
+        "SELECT l.TRANSLINKID FROM TRANSLINK_V1 l LEFT JOIN CHECKINGACCOUNT_V1 t ON t.TRANSID = l.CHECKINGACCOUNTID"
+        " WHERE t.TRANSID IS NULL" });
+    checks.push_back({ _("Transactions linked to a missing asset or stock"),
+        missing_refs("TRANSLINK_V1", "TRANSLINKID", "LINKTYPE", "LINKRECORDID", {
+            Model_Attachment::REFTYPE_ID_STOCK, Model_Attachment::REFTYPE_ID_ASSET }) });
 }
 
-bool dbCheck::checkTransactions()
+void dbCheck::checkSubcategories(Checks& checks)
 {
-    return true;
+    checks.push_back({ _("Subcategories of a missing category"),
+        "SELECT c.CATEGID FROM CATEGORY_V1 c LEFT JOIN CATEGORY_V1 p ON p.CATEGID = c.PARENTID"
+        " WHERE c.PARENTID > 0 AND p.CATEGID IS NULL" });
+    // a chain of parents longer than any real tree is a loop
+    checks.push_back({ _("Categories in a loop of parents"),
+        "WITH RECURSIVE chain(CATEGID, PARENTID, DEPTH) AS ("
+        " SELECT CATEGID, PARENTID, 0 FROM CATEGORY_V1 WHERE PARENTID > 0"
+        " UNION ALL SELECT chain.CATEGID, c.PARENTID, chain.DEPTH + 1 FROM chain"
+        " JOIN CATEGORY_V1 c ON c.CATEGID = chain.PARENTID WHERE c.PARENTID > 0 AND chain.DEPTH < 64)"
+        " SELECT DISTINCT CATEGID FROM chain WHERE DEPTH = 64" });
+}
+
+void dbCheck::checkTransactions(Checks& checks)
+{
+    const wxString types = wxString::Format("'%s', '%s', '%s'", Model_Checking::TYPE_STR_WITHDRAWAL
+        , Model_Checking::TYPE_STR_DEPOSIT, Model_Checking::TYPE_STR_TRANSFER);
+    const wxString transfer = Model_Checking::TYPE_STR_TRANSFER;
+
+    checks.push_back({ _("Transactions of an unknown type"),
+        "SELECT TRANSID FROM CHECKINGACCOUNT_V1 WHERE TRANSCODE NOT IN (" + types + ")" });
+    checks.push_back({ _("Scheduled transactions of an unknown type"),
+        "SELECT BDID FROM BILLSDEPOSITS_V1 WHERE TRANSCODE NOT IN (" + types + ")" });
+    checks.push_back({ _("Transfers to the same account"),
+        "SELECT TRANSID FROM CHECKINGACCOUNT_V1 WHERE TRANSCODE = '" + transfer + "' AND ACCOUNTID = TOACCOUNTID" });
+    checks.push_back({ _("Transactions without a category or splits"),
+        "SELECT t.TRANSID FROM CHECKINGACCOUNT_V1 t LEFT JOIN SPLITTRANSACTIONS_V1 s ON s.TRANSID = t.TRANSID"
+        " WHERE (t.CATEGID IS NULL OR t.CATEGID <= 0) AND s.SPLITTRANSID IS NULL" });
+    checks.push_back({ _("Scheduled transactions without a category or splits"),
+        "SELECT b.BDID FROM BILLSDEPOSITS_V1 b LEFT JOIN BUDGETSPLITTRANSACTIONS_V1 s ON s.TRANSID = b.BDID"
+        " WHERE (b.CATEGID IS NULL OR b.CATEGID <= 0) AND s.SPLITTRANSID IS NULL" });
+    checks.push_back({ _("Splits of a missing transaction"),
+        "SELECT s.SPLITTRANSID FROM SPLITTRANSACTIONS_V1 s LEFT JOIN CHECKINGACCOUNT_V1 t ON t.TRANSID = s.TRANSID"
+        " WHERE t.TRANSID IS NULL" });
+    checks.push_back({ _("Splits of a missing scheduled transaction"),
+        "SELECT s.SPLITTRANSID FROM BUDGETSPLITTRANSACTIONS_V1 s LEFT JOIN BILLSDEPOSITS_V1 b ON b.BDID = s.TRANSID"
+        " WHERE b.BDID IS NULL" });
+    checks.push_back({ _("Tags of missing records"), missing_refs("TAGLINK_V1", "TAGLINKID", "REFTYPE", "REFID", {
+        Model_Attachment::REFTYPE_ID_TRANSACTION, Model_Attachment::REFTYPE_ID_BILLSDEPOSIT,
+        Model_Attachment::REFTYPE_ID_TRANSACTIONSPLIT, Model_Attachment::REFTYPE_ID_BILLSDEPOSITSPLIT }) });
+    checks.push_back({ _("Links to a missing tag"),
+        "SELECT l.TAGLINKID FROM TAGLINK_V1 l LEFT JOIN TAG_V1 t ON t.TAGID = l.TAGID WHERE t.TAGID IS NULL" });
 }
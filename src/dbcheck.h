@@ -19,21 +19,46 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #ifndef MM_EX_DBCHECK_H_
 #define MM_EX_DBCHECK_H_
 
+#include <vector>
+#include <wx/arrstr.h>
+#include "reports/reportpool.h"
+
+class wxSQLite3Database;
+
 class dbCheck
 {
-    static bool  checkAccounts();
-    static bool  checkAttachments();
-    static bool  checkBudgets();
-    static bool  checkBudgetYears();
-    static bool  checkCategories();
-    static bool  checkCurrencies();
-    static bool  checkPayees();
-    static bool  checkStocks();
-    static bool  checkSubcategories();
-    static bool  checkTransactions();
+    /**
+    A referential check: sql returns the ids of the rows at fault,
+    found with anti-joins so each check is a single pass over its table.
+    */
+    struct Check
+    {
+        wxString message;
+        wxString sql;
+    };
+    typedef std::vector<Check> Checks;
+
+    static void checkAccounts(Checks& checks);
+    static void checkAttachments(Checks& checks);
+    static void checkBudgets(Checks& checks);
+    static void checkBudgetYears(Checks& checks);
+    static void checkCategories(Checks& checks);
+    static void checkCurrencies(Checks& checks);
+    static void checkPayees(Checks& checks);
+    static void checkStocks(Checks& checks);
+    static void checkSubcategories(Checks& checks);
+    static void checkTransactions(Checks& checks);
 
 public:
-    static bool checkDB();
+    /** QUICK runs PRAGMA quick_check, FULL integrity_check of the whole database and foreign_key_check */
+    enum MODE { QUICK = 0, FULL };
+
+    /**
+    Runs the storage and referential checks on the workers of mmReportPool,
+    with a progress dialog allowing to cancel. Each problem found adds a line
+    to problems. Without workers the checks run on db, on this thread.
+    */
+    static mmReportPool::RESULT checkDB(wxSQLite3Database* db, MODE mode, wxArrayString& problems);
 };
 
-#endif // MM_EX_DBCHECK_H_
\ No newline at end of file
+#endif // MM_EX_DBCHECK_H_
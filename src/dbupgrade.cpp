@@ -19,9 +19,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 
 #include "dbupgrade.h"
+#include "backupstore.h"
 #include "constants.h"
+#include "dbwrapper.h"
 #include "util.h"
+#include "model/Model_Setting.h"
 
+#include <wx/dir.h>
 #include <wx/filedlg.h>
 #include <wx/filename.h>
 #include <wx/msgdlg.h>
@@ -29,6 +33,190 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <wx/textfile.h>
 #include <wx/tokenzr.h>
 
+namespace
+{
+
+// Pages copied by each step of an online backup
+const int BACKUP_STEP_PAGES = 256;
+
+// Lets the writers of the database in between two steps of a backup
+class BackupProgress : public wxSQLite3BackupProgress
+{
+public:
+    virtual bool Progress(int /*totalPages*/, int remainingPages)
+    {
+        if (remainingPages > 0)
+            wxThread::Sleep(1);
+        return true;
+    }
+};
+
+// Removes the oldest backups matching the pattern until only keep are left
+void removeOldBackups(const wxFileName& fn, const wxString& pattern, size_t keep)
+{
+    wxArrayString files;
+    wxDir::GetAllFiles(fn.GetPath(), &files, pattern, wxDIR_FILES);
+    files.Sort();
+
+    for (size_t i = 0; i + keep < files.GetCount(); i++)
+    {
+        wxLogDebug("%s", files[i]);
+        // ensure file is not read only before deleting file.
+        if (wxFileName(files[i]).IsFileWritable())
+            wxRemoveFile(files[i]);
+    }
+}
+
+/*
+Writes a backup with the SQLite online backup API, a few pages at a time,
+through a read only connection of its own. Writes made to the database by
+other connections restart the copy, so the result is always a consistent
+snapshot. The backup goes to a temporary file renamed once complete.
+
+With the backup store, the database file is added as it is instead, so only
+the chunks changed since the previous snapshot are written. Unchanged pages
+of an encrypted database keep their bytes there, whereas a copy is encrypted
+again with a new salt and would share nothing. The file is read inside a read
+transaction of the backup connection: its shared lock keeps the other
+connections from committing to the file until the read is done, they wait up
+to their busy timeout. In WAL mode the file lacks the recent pages, so the
+store gets a copy, and only for unencrypted databases; the others keep plain
+backup files then.
+*/
+class BackupThread : public wxThread
+{
+public:
+    BackupThread(const wxString& source, const wxString& target, const wxString& password
+        , const wxString& pattern = "", size_t keep = 0, bool store = false)
+        : wxThread(wxTHREAD_JOINABLE)
+        , m_source(source), m_target(target), m_password(password)
+        , m_pattern(pattern), m_keep(keep), m_store(store)
+    {}
+
+protected:
+    virtual ExitCode Entry()
+    {
+        if (m_store && storeFile())
+            return nullptr;
+
+        const wxString temp = m_target + ".tmp";
+        if (!backup(temp) && !wxCopyFile(m_source, temp, true))
+        {
+            wxRemoveFile(temp);
+            return nullptr;
+        }
+
+        if (m_store && m_password.empty())
+        {
+            mmBackupStore store(m_source);
+            if (store.add(temp, wxFileName(m_target).GetName()))
+            {
+                wxRemoveFile(temp);
+                removeOldSnapshots(store);
+                return nullptr;
+            }
+            // keep the backup as a plain file rather than lose it
+            wxLogDebug("Backup store: %s", store.error());
+        }
+
+        if (!wxRenameFile(temp, m_target, true))
+            return nullptr;
+
+        if (!m_pattern.empty())
+            removeOldBackups(wxFileName(m_source), m_pattern + ".bak", m_keep);
+        return nullptr;
+    }
+
+private:
+    // Adds the database file as it is to the store
+    bool storeFile()
+    {
+        wxSharedPtr<wxSQLite3Database> db = mmDBWrapper::OpenReadOnly(m_source, m_password);
+        if (!db)
+            return false;
+
+        mmBackupStore store(m_source);
+        bool ok = false;
+        try
+        {
+            wxSQLite3ResultSet mode = db->ExecuteQuery("PRAGMA journal_mode");
+            const bool wal = mode.GetString(0).Lower() == "wal";
+            mode.Finalize();
+
+            if (!wal)
+            {
+                // the first read takes the shared lock, held to the commit
+                db->Begin();
+                db->ExecuteScalar("SELECT COUNT(*) FROM sqlite_master");
+                ok = store.add(m_source, wxFileName(m_target).GetName());
+                db->Commit();
+                if (!ok)
+                    wxLogDebug("Backup store: %s", store.error());
+            }
+        }
+        catch (const wxSQLite3Exception& e)
+        {
+            wxLogDebug("Backup store %s: %s", m_source, e.GetMessage());
+            ok = false;
+        }
+        db->Close();
+
+        if (ok)
+            removeOldSnapshots(store);
+        return ok;
+    }
+
+    void removeOldSnapshots(mmBackupStore& store)
+    {
+        if (m_pattern.empty())
+            return;
+        wxArrayString old = store.snapshots(m_pattern);
+        old.resize(old.size() > m_keep ? old.size() - m_keep : 0);
+        store.remove(old);
+    }
+
+    bool backup(const wxString& temp)
+    {
+        wxSharedPtr<wxSQLite3Database> db = mmDBWrapper::OpenReadOnly(m_source, m_password);
+        if (!db)
+            return false;
+
+        try
+        {
+            BackupProgress progress;
+            db->SetBackupRestorePageCount(BACKUP_STEP_PAGES);
+            if (m_password.empty())
+                db->Backup(&progress, temp);
+            else
+            {
+                // same cipher as the one mmDBWrapper::Open keeps the databases in
+                wxSQLite3CipherSQLCipher cipher;
+                cipher.InitializeVersionDefault(4);
+                cipher.SetLegacy(true);
+                db->Backup(&progress, temp, cipher, m_password);
+            }
+            db->Close();
+            return true;
+        }
+        catch (const wxSQLite3Exception& e)
+        {
+            wxLogDebug("Backup %s: %s", m_source, e.GetMessage());
+            db->Close();
+            return false;
+        }
+    }
+
+    const wxString m_source, m_target, m_password;
+    const wxString m_pattern;
+    const size_t m_keep;
+    const bool m_store;
+};
+
+// The backup in progress, BackupDB and WaitForBackup are only called from the GUI thread
+BackupThread* g_backup = nullptr;
+
+}
+
 int dbUpgrade::GetCurrentVersion(wxSQLite3Database * db)
 {
     try
@@ -98,7 +286,7 @@ bool dbUpgrade::InitializeVersion(wxSQLite3Database* db, int version)
     }
 }
 
-bool dbUpgrade::UpgradeDB(wxSQLite3Database * db, const wxString& DbFileName)
+bool dbUpgrade::UpgradeDB(wxSQLite3Database * db, const wxString& DbFileName, const wxString& Password)
 {
     int ver = GetCurrentVersion(db);
 
@@ -112,7 +300,7 @@ bool dbUpgrade::UpgradeDB(wxSQLite3Database * db, const wxString& DbFileName)
 
     for (; ver < dbLatestVersion; ver++)
     {
-        BackupDB(DbFileName, dbUpgrade::BACKUPTYPE::VERSION_UPGRADE, 999, ver);
+        BackupDB(DbFileName, dbUpgrade::BACKUPTYPE::VERSION_UPGRADE, 999, ver, Password);
         if (!UpgradeToVersion(db, ver + 1))
             return false;
     }
@@ -124,58 +312,56 @@ bool dbUpgrade::UpgradeDB(wxSQLite3Database * db, const wxString& DbFileName)
     return true;
 }
 
-void dbUpgrade::BackupDB(const wxString& FileName, int BackupType, int FilesToKeep, int UpgradeVersion)
+void dbUpgrade::BackupDB(const wxString& FileName, int BackupType, int FilesToKeep, int UpgradeVersion, const wxString& Password)
 {
     wxFileName fn(FileName);
     if (!fn.IsOk()) return;
 
+    // one backup at a time, a previous one may still write the same file
+    WaitForBackup();
+
     const wxString BackupName[3] = { "_start_", "_update_", wxString::Format("_upgrade_v%i_", UpgradeVersion) };
     const auto backupFileName = wxString::Format("%s%s%s.bak", FileName, BackupName[BackupType], wxDateTime().Today().FormatISODate());
     wxFileName fnBak(backupFileName);
 
-    // process backup
-    switch (BackupType)
+    // upgrade backups are always kept as full copies
+    const bool store = BackupType != BACKUPTYPE::VERSION_UPGRADE
+        && Model_Setting::instance().getBool("BACKUPDB_STORE", false);
+
+    if (BackupType != BACKUPTYPE::CLOSE)
     {
-    case BACKUPTYPE::START:
-        if (!fnBak.FileExists()) {
-            wxCopyFile(FileName, backupFileName, true);
-        }
-        break;
-    case BACKUPTYPE::CLOSE:
-        wxCopyFile(FileName, backupFileName, true);
-        break;
-    case BACKUPTYPE::VERSION_UPGRADE:
-        if (!fnBak.FileExists()) {
-            wxCopyFile(FileName, backupFileName, true);
-        }
-        break;
-    default:
-        break;
+        if (fnBak.FileExists())
+            return;
+        if (store && !mmBackupStore(FileName).snapshots(fnBak.GetName()).empty())
+            return;
     }
 
-    // Cleanup old backups
-    if (BackupType != BACKUPTYPE::VERSION_UPGRADE)
+    // Old backups are removed once the new one is written
+    const wxString pattern = BackupType == BACKUPTYPE::VERSION_UPGRADE ? ""
+        : fn.GetFullName() + BackupName[BackupType] + "????-??-??";
+
+    g_backup = new BackupThread(FileName, backupFileName, Password, pattern, static_cast<size_t>(FilesToKeep), store);
+    if (g_backup->Run() != wxTHREAD_NO_ERROR)
     {
-        wxSortedArrayString backupFileArray;
-        const auto fileSearch = wxString::Format(R"(%s%s????-??-??.bak)", FileName, BackupName[BackupType]);
-        wxString backupFile = wxFindFirstFile(fileSearch);
-        while (!backupFile.empty())
-        {
-            backupFileArray.Add(backupFile);
-            backupFile = wxFindNextFile();
-        }
+        delete g_backup;
+        g_backup = nullptr;
+        wxCopyFile(FileName, backupFileName, true);
+        return;
+    }
 
-        while (backupFileArray.GetCount() > static_cast<size_t>(FilesToKeep))
-        {
-            wxFileName fnLastFile(backupFileArray.Item(0));
-            wxLogDebug("%s", backupFileArray.Item(0));
-            // ensure file is not read only before deleting file.
-            if (fnLastFile.IsFileWritable())
-                wxRemoveFile(backupFileArray.Item(0));
+    // the upgrade must not start before the backup is complete
+    if (BackupType == BACKUPTYPE::VERSION_UPGRADE)
+        WaitForBackup();
+}
 
-            backupFileArray.erase(backupFileArray.begin());
-        }
-    }
+void dbUpgrade::WaitForBackup()
+{
+    if (!g_backup)
+        return;
+
+    g_backup->Wait();
+    delete g_backup;
+    g_backup = nullptr;
 }
 
 void dbUpgrade::SqlFileDebug(wxSQLite3Database * db)
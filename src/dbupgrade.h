@@ -30,8 +30,11 @@ class dbUpgrade
 public:
     static bool InitializeVersion(wxSQLite3Database* db, int version = dbLatestVersion);
     static bool isUpgradeDBrequired(wxSQLite3Database* db);
-    static bool UpgradeDB(wxSQLite3Database* db, const wxString& DbFileName);
-    static void BackupDB(const wxString& Filename, int BackupType, int FilesToKeep, int UpgradeVersion = 0);
+    static bool UpgradeDB(wxSQLite3Database* db, const wxString& DbFileName, const wxString& Password = "");
+    /** Starts a backup of the database on a worker thread, upgrade backups are waited for */
+    static void BackupDB(const wxString& Filename, int BackupType, int FilesToKeep, int UpgradeVersion = 0, const wxString& Password = "");
+    /** Blocks until the backup started by BackupDB is written */
+    static void WaitForBackup();
     enum BACKUPTYPE { START = 0, CLOSE, VERSION_UPGRADE };
     static void SqlFileDebug(wxSQLite3Database * db);
 };
@@ -20,6 +20,7 @@
 #include "util.h"
 #include "paths.h"
 #include "constants.h"
+#include "model/Model_Setting.h"
 //----------------------------------------------------------------------------
 #include "sqlite3mc_amalgamation.h"
 //----------------------------------------------------------------------------
@@ -82,12 +83,12 @@ wxSharedPtr<wxSQLite3Database> mmDBWrapper::Open(const wxString &dbpath, const w
             {
                 if (db->ExecuteQuery("PRAGMA page_size;").GetInt(0) < 4096)
                 {
-                    db->ReKey("");
+                    ReKey(db.get(), cipherAes128, "");
                     db->ExecuteUpdate("PRAGMA page_size = 4096;");
                     db->ExecuteUpdate("VACUUM;");
                 }
                 // ReKey with new cipher.
-                db->ReKey(cipher, password);
+                ReKey(db.get(), cipher, password);
             }
         }
         catch (const wxSQLite3Exception& e)
@@ -101,6 +102,7 @@ wxSharedPtr<wxSQLite3Database> mmDBWrapper::Open(const wxString &dbpath, const w
     {
         //timeout 2 sec
         db->SetBusyTimeout(2000);
+        SetProfile(db.get(), Model_Setting::instance().getInt("DB_PROFILE", PROFILE_SAFE));
 
         return (db);
     }
@@ -130,3 +132,82 @@ wxSharedPtr<wxSQLite3Database> mmDBWrapper::Open(const wxString &dbpath, const w
 
 //----------------------------------------------------------------------------
 
+/* SAFE stays the default until the profiles are measured on the platforms
+   MMEX runs on: tests/bench_db_profile times both of them on plain and
+   encrypted files for a bulk import, the reports and single edits. */
+void mmDBWrapper::SetProfile(wxSQLite3Database* db, int profile)
+{
+    const bool performance = (profile == PROFILE_PERFORMANCE);
+    const bool encrypted = db->IsEncrypted();
+
+    // each pragma on its own, one failing (e.g. WAL on a file system without
+    // shared memory) leaves the others applied
+    auto pragma = [db](const char* sql)
+    {
+        try
+        {
+            wxSQLite3ResultSet rs = db->ExecuteQuery(sql);
+            wxLogDebug("%s %s", sql, rs.Eof() ? "" : rs.GetAsString(0));
+        }
+        catch (const wxSQLite3Exception& e)
+        {
+            wxLogDebug("%s %s", sql, e.GetMessage());
+        }
+    };
+
+    // the journal mode is kept in the file, the safe profile and encrypted files have to undo WAL
+    pragma(performance && !encrypted ? "PRAGMA journal_mode = WAL;" : "PRAGMA journal_mode = DELETE;");
+    pragma(performance ? "PRAGMA synchronous = NORMAL;" : "PRAGMA synchronous = FULL;");
+    // negative sizes are in KiB
+    pragma(performance ? "PRAGMA cache_size = -65536;" : "PRAGMA cache_size = -8192;");
+    pragma("PRAGMA temp_store = MEMORY;");
+    // pages of an encrypted file must be decrypted, they are never mapped
+    if (performance && !encrypted)
+        pragma("PRAGMA mmap_size = 268435456;");
+}
+
+void mmDBWrapper::ReKey(wxSQLite3Database* db, const wxSQLite3Cipher& cipher, const wxString& key)
+{
+    // SQLite3MC refuses to rekey a database in WAL mode
+    if (db->ExecuteQuery("PRAGMA journal_mode;").GetAsString(0).CmpNoCase("wal") == 0)
+        db->ExecuteQuery("PRAGMA journal_mode = DELETE;");
+    db->ReKey(cipher, key);
+}
+
+//----------------------------------------------------------------------------
+
+wxSharedPtr<wxSQLite3Database> mmDBWrapper::OpenReadOnly(const wxString &dbpath, const wxString &password)
+{
+    wxSharedPtr<wxSQLite3Database> db(new wxSQLite3Database);
+
+    wxSQLite3CipherSQLCipher cipher;
+    cipher.InitializeVersionDefault(4);
+    cipher.SetLegacy(true);
+    wxSQLite3CipherAes128 cipherAes128;
+    cipherAes128.InitializeFromGlobalDefault();
+
+    for (int i = 0; i < 2; i++)
+    {
+        try
+        {
+            if (i == 0)
+                db->Open(dbpath, cipher, password, WXSQLITE_OPEN_READONLY);
+            else
+                db->Open(dbpath, cipherAes128, password, WXSQLITE_OPEN_READONLY);
+            db->ExecuteQuery("select * from INFOTABLE_V1;");
+            db->SetBusyTimeout(2000);
+            return db;
+        }
+        catch (const wxSQLite3Exception& e)
+        {
+            wxLogDebug("OpenReadOnly: %s", e.GetMessage());
+            if (db->IsOpen())
+                db->Close();
+        }
+    }
+
+    db.reset();
+    return db;
+}
+
+//----------------------------------------------------------------------------
@@ -23,12 +23,37 @@
 #include <wx/arrstr.h>
 #include <wx/sharedptr.h>
 
+class wxSQLite3Cipher;
 class wxSQLite3Database;
 
 namespace mmDBWrapper
 {
+    /**
+    * Connection settings applied when a database is opened, kept in the
+    * DB_PROFILE setting.
+    * SAFE keeps the rollback journal with full syncs, a database file can be
+    * copied or shared through a cloud folder at any time.
+    * PERFORMANCE uses a write ahead log with normal syncs, a larger page
+    * cache and memory mapped reads of unencrypted files. The log lives next
+    * to the database until it is closed. Encrypted files keep the rollback
+    * journal, they could not be rekeyed in WAL mode.
+    */
+    enum PROFILE { PROFILE_SAFE = 0, PROFILE_PERFORMANCE };
 
     wxSharedPtr<wxSQLite3Database> Open(const wxString &dbpath, const wxString &key = "", const bool debug = false);
+    /**
+    * Open an additional read only connection to an already opened database,
+    * e.g. for a worker thread. No message is shown; a nullptr is returned on error.
+    */
+    wxSharedPtr<wxSQLite3Database> OpenReadOnly(const wxString &dbpath, const wxString &key = "");
+    /** Apply a PROFILE to an open read/write connection */
+    void SetProfile(wxSQLite3Database* db, int profile);
+    /**
+    * Change the key of db, an empty key removes the encryption. A WAL
+    * database is switched to the rollback journal first and stays in it,
+    * apply the profile again to keep using the connection.
+    */
+    void ReKey(wxSQLite3Database* db, const wxSQLite3Cipher& cipher, const wxString& key);
 
 } // namespace mmDBWrapper
 
@@ -24,6 +24,7 @@ Copyright (C) 2021 Mark Whalley (mark@ipx.co.uk)
 #include "util.h"
 #include "model/Model_Setting.h"
 #include "reports/htmlbuilder.h"
+#include "reports/reportbase.h"
 #include <wx/display.h>
 
 wxIMPLEMENT_DYNAMIC_CLASS(mmDiagnosticsDialog, wxDialog);
@@ -141,6 +142,16 @@ void mmDiagnosticsDialog::RefreshView()
         , m_is_max ? "true" : "false");
     html << "</p>";
 
+    const mmReportCache& cache = mmReportCache::instance();
+    const size_t lookups = cache.hits() + cache.misses();
+    html << "<p>";
+    html << "Report cache";
+    html << "<br>";
+    html << wxString::Format("pages:%zu, size:%zu KB, hits:%zu, misses:%zu, hit rate:%.1f%%"
+        , cache.count(), cache.size() / 1024, cache.hits(), cache.misses()
+        , lookups ? 100.0 * cache.hits() / lookups : 0.0);
+    html << "</p>";
+
     mmHTMLBuilder hb;
     hb.init(true);
     const wxString displayHtml = wxString::Format(HTMLPANEL, html);
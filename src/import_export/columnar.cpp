@@ -0,0 +1,579 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#include "columnar.h"
+#include "model/Model_Account.h"
+#include "model/Model_Attachment.h"
+#include "model/Model_Category.h"
+#include "model/Model_Payee.h"
+#include "model/Model_Tag.h"
+#include "primitive.h"
+#include <cstring>
+#include <string>
+#include <wx/file.h>
+
+namespace
+{
+    const char MAGIC[8] = { 'M', 'M', 'E', 'X', 'C', 'O', 'L', '\0' };
+
+    class Output
+    {
+    public:
+        void u8(uint8_t v) { m_data += static_cast<char>(v); }
+        void u32(uint32_t v) { put(v, 4); }
+        void u64(uint64_t v) { put(v, 8); }
+        void f64(double v)
+        {
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            put(bits, 8);
+        }
+        void bytes(const char* data, size_t size) { m_data.append(data, size); }
+        void string(const wxString& s)
+        {
+            const wxScopedCharBuffer utf8 = s.utf8_str();
+            u32(static_cast<uint32_t>(utf8.length()));
+            m_data.append(utf8.data(), utf8.length());
+        }
+        void dictionary(const std::vector<wxString>& values)
+        {
+            u32(static_cast<uint32_t>(values.size()));
+            for (const auto& v : values)
+                string(v);
+        }
+        void strings(const std::vector<wxString>& column)
+        {
+            std::string block;
+            u32(0);
+            for (const auto& v : column)
+            {
+                const wxScopedCharBuffer utf8 = v.utf8_str();
+                block.append(utf8.data(), utf8.length());
+                u32(static_cast<uint32_t>(block.size()));
+            }
+            m_data += block;
+        }
+        void u32s(const std::vector<uint32_t>& column)
+        {
+            for (const auto v : column)
+                u32(v);
+        }
+        void f64s(const std::vector<double>& column)
+        {
+            for (const auto v : column)
+                f64(v);
+        }
+        const std::string& data() const { return m_data; }
+
+    private:
+        void put(uint64_t v, int size)
+        {
+            for (int i = 0; i < size; i++)
+                m_data += static_cast<char>((v >> (8 * i)) & 0xFF);
+        }
+        std::string m_data;
+    };
+}
+
+//----------------------------------------------------------------------------
+
+uint32_t mmColumnarExport::account(int64 id)
+{
+    if (id <= 0)
+        return mmColumnar::NONE;
+    const auto it = m_account_index.find(id);
+    if (it != m_account_index.end())
+        return it->second;
+
+    const uint32_t index = static_cast<uint32_t>(m_accounts.size());
+    m_accounts.push_back(Model_Account::get_account_name(id));
+    m_account_index[id] = index;
+    return index;
+}
+
+uint32_t mmColumnarExport::payee(int64 id)
+{
+    if (id <= 0)
+        return mmColumnar::NONE;
+    const auto it = m_payee_index.find(id);
+    if (it != m_payee_index.end())
+        return it->second;
+
+    const uint32_t index = static_cast<uint32_t>(m_payees.size());
+    m_payees.push_back(Model_Payee::get_payee_name(id));
+    m_payee_index[id] = index;
+    return index;
+}
+
+// The parents are added before their subcategories
+uint32_t mmColumnarExport::category(int64 id)
+{
+    if (id <= 0)
+        return mmColumnar::NONE;
+    const auto it = m_category_index.find(id);
+    if (it != m_category_index.end())
+        return it->second;
+
+    const Model_Category::Data* c = Model_Category::instance().get(id);
+    if (!c)
+        return mmColumnar::NONE;
+    const wxString name = c->CATEGNAME;
+    const uint32_t parent = category(c->PARENTID);
+
+    const uint32_t index = static_cast<uint32_t>(m_categories.size());
+    m_categories.push_back(std::make_pair(parent, name));
+    m_category_index[id] = index;
+    return index;
+}
+
+uint32_t mmColumnarExport::tag(int64 id)
+{
+    const auto it = m_tag_index.find(id);
+    if (it != m_tag_index.end())
+        return it->second;
+
+    const Model_Tag::Data* t = Model_Tag::instance().get(id);
+    if (!t)
+        return mmColumnar::NONE;
+    const uint32_t index = static_cast<uint32_t>(m_tags.size());
+    m_tags.push_back(t->TAGNAME);
+    m_tag_index[id] = index;
+    return index;
+}
+
+void mmColumnarExport::add(const Model_Checking::Data& r
+    , const Model_Checking::Split_Data_Set& splits
+    , const Model_Checking::Taglink_Data_Set& tags)
+{
+    const bool transfer = Model_Checking::is_transfer(&r);
+    m_id.push_back(r.TRANSID.GetValue());
+    m_account.push_back(account(r.ACCOUNTID));
+    m_to_account.push_back(transfer ? account(r.TOACCOUNTID) : mmColumnar::NONE);
+    m_payee.push_back(transfer ? mmColumnar::NONE : payee(r.PAYEEID));
+    m_category.push_back(category(r.CATEGID));
+    m_type.push_back(static_cast<uint8_t>(Model_Checking::type_id(r)));
+    m_status.push_back(static_cast<uint8_t>(Model_Checking::status_id(r)));
+    m_date.push_back(mmDayNumber(r.TRANSDATE));
+    m_amount.push_back(r.TRANSAMOUNT);
+    m_to_amount.push_back(transfer ? r.TOTRANSAMOUNT : r.TRANSAMOUNT);
+    m_number.push_back(r.TRANSACTIONNUMBER);
+    m_notes.push_back(r.NOTES);
+
+    for (const auto& link : tags)
+    {
+        const uint32_t t = tag(link.TAGID);
+        if (t != mmColumnar::NONE)
+            m_tag.push_back(t);
+    }
+    m_tag_offsets.push_back(static_cast<uint32_t>(m_tag.size()));
+
+    for (const auto& split : splits)
+    {
+        m_split_category.push_back(category(split.CATEGID));
+        m_split_amount.push_back(split.SPLITTRANSAMOUNT);
+        m_split_notes.push_back(split.NOTES);
+        for (const auto& link : Model_Taglink::instance().get(Model_Attachment::REFTYPE_STR_TRANSACTIONSPLIT, split.SPLITTRANSID))
+        {
+            const uint32_t t = tag(link.second);
+            if (t != mmColumnar::NONE)
+                m_split_tag.push_back(t);
+        }
+        m_split_tag_offsets.push_back(static_cast<uint32_t>(m_split_tag.size()));
+    }
+    m_split_offsets.push_back(static_cast<uint32_t>(m_split_amount.size()));
+}
+
+bool mmColumnarExport::save(const wxString& path) const
+{
+    Output out;
+    out.bytes(MAGIC, sizeof(MAGIC));
+    out.u32(mmColumnar::VERSION);
+    out.u32(static_cast<uint32_t>(rows()));
+
+    out.dictionary(m_accounts);
+    out.dictionary(m_payees);
+    out.u32(static_cast<uint32_t>(m_categories.size()));
+    for (const auto& c : m_categories)
+    {
+        out.u32(c.first);
+        out.string(c.second);
+    }
+    out.dictionary(m_tags);
+
+    for (const auto id : m_id)
+        out.u64(static_cast<uint64_t>(id));
+    out.u32s(m_account);
+    out.u32s(m_to_account);
+    out.u32s(m_payee);
+    out.u32s(m_category);
+    for (const auto type : m_type)
+        out.u8(type);
+    for (const auto status : m_status)
+        out.u8(status);
+    for (const auto date : m_date)
+        out.u32(static_cast<uint32_t>(date));
+    out.f64s(m_amount);
+    out.f64s(m_to_amount);
+    out.strings(m_number);
+    out.strings(m_notes);
+    out.u32s(m_tag_offsets);
+    out.u32s(m_tag);
+    out.u32s(m_split_offsets);
+
+    out.u32s(m_split_category);
+    out.f64s(m_split_amount);
+    out.strings(m_split_notes);
+    out.u32s(m_split_tag_offsets);
+    out.u32s(m_split_tag);
+
+    wxFile file;
+    if (!file.Create(path, true))
+        return false;
+    const std::string& data = out.data();
+    return file.Write(data.data(), data.size()) == data.size() && file.Close();
+}
+
+//----------------------------------------------------------------------------
+
+/** Reads the file back. Sizes come from the file, so they are checked
+* against the bytes left before anything is allocated. After the first
+* error every read returns zero and ok() stays false. */
+class mmColumnarImport::Input
+{
+public:
+    Input(const unsigned char* data, size_t size) : m_p(data), m_end(data + size) {}
+
+    bool ok() const { return m_ok; }
+    bool at_end() const { return m_p == m_end; }
+    void fail() { m_ok = false; }
+
+    bool has(uint64_t size)
+    {
+        if (m_ok && size <= static_cast<uint64_t>(m_end - m_p))
+            return true;
+        m_ok = false;
+        return false;
+    }
+    uint32_t u32() { return static_cast<uint32_t>(get(4)); }
+    wxString string()
+    {
+        const uint32_t size = u32();
+        if (!has(size))
+            return wxEmptyString;
+        const wxString s = wxString::FromUTF8(reinterpret_cast<const char*>(m_p), size);
+        m_p += size;
+        return s;
+    }
+    void dictionary(std::vector<wxString>& values)
+    {
+        const uint32_t count = u32();
+        if (!has(static_cast<uint64_t>(count) * 4))
+            return;
+        values.reserve(count);
+        for (uint32_t i = 0; i < count && m_ok; i++)
+            values.push_back(string());
+    }
+    template<typename T> void column(std::vector<T>& values, size_t count, int size)
+    {
+        if (!has(static_cast<uint64_t>(count) * size))
+            return;
+        values.resize(count);
+        for (auto& v : values)
+            v = static_cast<T>(get(size));
+    }
+    void f64s(std::vector<double>& values, size_t count)
+    {
+        if (!has(static_cast<uint64_t>(count) * 8))
+            return;
+        values.resize(count);
+        for (auto& v : values)
+        {
+            const uint64_t bits = get(8);
+            memcpy(&v, &bits, sizeof(v));
+        }
+    }
+    // count + 1 offsets starting at zero and never decreasing, at least { 0 } on error
+    void offsets(std::vector<uint32_t>& values, size_t count)
+    {
+        column(values, count + 1, 4);
+        for (size_t i = 1; i < values.size() && m_ok; i++)
+            m_ok = values[i - 1] <= values[i];
+        if (!m_ok || values[0] != 0)
+        {
+            m_ok = false;
+            values.assign(1, 0);
+        }
+    }
+    void strings(std::vector<wxString>& values, size_t count)
+    {
+        std::vector<uint32_t> bounds;
+        offsets(bounds, count);
+        if (!has(bounds.back()))
+            return;
+        values.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            values[i] = wxString::FromUTF8(reinterpret_cast<const char*>(m_p) + bounds[i]
+                , bounds[i + 1] - bounds[i]);
+        }
+        m_p += bounds.back();
+    }
+
+private:
+    uint64_t get(int size)
+    {
+        if (!has(size))
+            return 0;
+        uint64_t v = 0;
+        for (int i = 0; i < size; i++)
+            v |= static_cast<uint64_t>(m_p[i]) << (8 * i);
+        m_p += size;
+        return v;
+    }
+
+    const unsigned char* m_p;
+    const unsigned char* m_end;
+    bool m_ok = true;
+};
+
+bool mmColumnarImport::load(const wxString& path)
+{
+    m_error.clear();
+    wxFile file;
+    if (!wxFileExists(path) || !file.Open(path))
+    {
+        m_error = _("Unable to open file");
+        return false;
+    }
+
+    const wxFileOffset length = file.Length();
+    std::vector<unsigned char> data(length > 0 ? static_cast<size_t>(length) : 0);
+    const ssize_t got = data.empty() ? 0 : file.Read(data.data(), data.size());
+    if (got < 0 || static_cast<size_t>(got) != data.size())
+    {
+        m_error = _("Unable to read file");
+        return false;
+    }
+
+    Input in(data.data(), data.size());
+    return read(in);
+}
+
+bool mmColumnarImport::read(Input& in)
+{
+    std::vector<unsigned char> magic;
+    in.column(magic, sizeof(MAGIC), 1);
+    if (!in.ok() || memcmp(magic.data(), MAGIC, sizeof(MAGIC)) != 0)
+    {
+        m_error = _("This is not an MMEX columnar file");
+        return false;
+    }
+    const uint32_t version = in.u32();
+    if (version != mmColumnar::VERSION)
+    {
+        m_error = wxString::Format(_("Unsupported file version %u"), version);
+        return false;
+    }
+    const size_t rows = in.u32();
+
+    in.dictionary(m_accounts);
+    in.dictionary(m_payees);
+    const uint32_t categories = in.u32();
+    if (in.has(static_cast<uint64_t>(categories) * 8))
+    {
+        m_categories.reserve(categories);
+        for (uint32_t i = 0; i < categories && in.ok(); i++)
+        {
+            const uint32_t parent = in.u32();
+            const wxString name = in.string();
+            // a parent comes first, so it is never its own ancestor
+            if (parent != mmColumnar::NONE && parent >= i)
+                in.fail();
+            m_categories.push_back(std::make_pair(parent, name));
+        }
+    }
+    in.dictionary(m_tags);
+
+    in.column(m_id, rows, 8);
+    in.column(m_account, rows, 4);
+    in.column(m_to_account, rows, 4);
+    in.column(m_payee, rows, 4);
+    in.column(m_category, rows, 4);
+    in.column(m_type, rows, 1);
+    in.column(m_status, rows, 1);
+    in.column(m_date, rows, 4);
+    in.f64s(m_amount, rows);
+    in.f64s(m_to_amount, rows);
+    in.strings(m_number, rows);
+    in.strings(m_notes, rows);
+    in.offsets(m_tag_offsets, rows);
+    in.column(m_tag, m_tag_offsets.back(), 4);
+    in.offsets(m_split_offsets, rows);
+
+    const size_t splits = m_split_offsets.back();
+    in.column(m_split_category, splits, 4);
+    in.f64s(m_split_amount, splits);
+    in.strings(m_split_notes, splits);
+    in.offsets(m_split_tag_offsets, splits);
+    in.column(m_split_tag, m_split_tag_offsets.back(), 4);
+
+    if (!in.ok() || !in.at_end())
+    {
+        m_error = _("The file is damaged");
+        m_id.clear();
+        return false;
+    }
+    return true;
+}
+
+int64 mmColumnarImport::account_id(uint32_t i)
+{
+    if (i >= m_accounts.size())
+        return -1;
+    if (m_account_ids[i] == 0)
+        m_account_ids[i] = Model_Account::instance().find_id_by_name(m_accounts[i]);
+    return m_account_ids[i];
+}
+
+int64 mmColumnarImport::payee_id(uint32_t i)
+{
+    if (i >= m_payees.size())
+        return -1;
+    if (m_payee_ids[i] != 0)
+        return m_payee_ids[i];
+
+    int64 id = Model_Payee::instance().find_id_by_name(m_payees[i]);
+    if (id == -1)
+    {
+        Model_Payee::Data* payee = Model_Payee::instance().create();
+        payee->PAYEENAME = m_payees[i];
+        payee->ACTIVE = 1;
+        id = Model_Payee::instance().save(payee);
+    }
+    return m_payee_ids[i] = id;
+}
+
+int64 mmColumnarImport::category_id(uint32_t i)
+{
+    if (i >= m_categories.size())
+        return -1;
+    if (m_category_ids[i] != 0)
+        return m_category_ids[i];
+
+    const int64 parent_id = m_categories[i].first == mmColumnar::NONE ? int64(-1) : category_id(m_categories[i].first);
+    int64 id = Model_Category::instance().find_id_by_name(m_categories[i].second, parent_id);
+    if (id == -1)
+    {
+        Model_Category::Data* category = Model_Category::instance().create();
+        category->CATEGNAME = m_categories[i].second;
+        category->PARENTID = parent_id;
+        category->ACTIVE = 1;
+        id = Model_Category::instance().save(category);
+    }
+    return m_category_ids[i] = id;
+}
+
+int64 mmColumnarImport::tag_id(uint32_t i)
+{
+    if (i >= m_tags.size())
+        return -1;
+    if (m_tag_ids[i] != 0)
+        return m_tag_ids[i];
+
+    int64 id = Model_Tag::instance().find_id_by_name(m_tags[i]);
+    if (id == -1)
+    {
+        Model_Tag::Data* tag = Model_Tag::instance().create();
+        tag->TAGNAME = m_tags[i];
+        tag->ACTIVE = 1;
+        id = Model_Tag::instance().save(tag);
+    }
+    return m_tag_ids[i] = id;
+}
+
+size_t mmColumnarImport::import(size_t& skipped)
+{
+    // zero is not an id, it marks the names not looked up yet
+    m_account_ids.assign(m_accounts.size(), 0);
+    m_payee_ids.assign(m_payees.size(), 0);
+    m_category_ids.assign(m_categories.size(), 0);
+    m_tag_ids.assign(m_tags.size(), 0);
+
+    skipped = 0;
+    size_t imported = 0;
+    mmDuplicateIndex duplicates;
+    Model_Checking::instance().Savepoint("COLUMNAR_IMPORT");
+    for (size_t i = 0; i < rows(); i++)
+    {
+        const bool transfer = m_type[i] == Model_Checking::TYPE_ID_TRANSFER;
+        const int64 account = account_id(m_account[i]);
+        const int64 to_account = transfer ? account_id(m_to_account[i]) : int64(-1);
+        if (m_type[i] > Model_Checking::TYPE_ID_TRANSFER || account == -1 || (transfer && to_account == -1))
+        {
+            skipped++;
+            continue;
+        }
+
+        Model_Checking::Data* trx = Model_Checking::instance().create();
+        trx->TRANSDATE = mmDayNumberISODate(m_date[i]);
+        trx->ACCOUNTID = account;
+        trx->TOACCOUNTID = to_account;
+        trx->PAYEEID = transfer ? int64(-1) : payee_id(m_payee[i]);
+        trx->TRANSCODE = Model_Checking::TYPE_STR[m_type[i]];
+        trx->TRANSAMOUNT = m_amount[i];
+        trx->TOTRANSAMOUNT = transfer ? m_to_amount[i] : m_amount[i];
+        trx->STATUS = static_cast<size_t>(m_status[i]) < Model_Checking::STATUS_KEY.size()
+            ? Model_Checking::STATUS_KEY[m_status[i]] : Model_Checking::STATUS_KEY_NONE;
+        trx->CATEGID = category_id(m_category[i]);
+        trx->TRANSACTIONNUMBER = m_number[i];
+        trx->NOTES = m_notes[i];
+        if (duplicates.take(*trx))
+            trx->STATUS = Model_Checking::STATUS_KEY_DUPLICATE;
+        const int64 trx_id = Model_Checking::instance().save(trx);
+
+        Model_Taglink::Cache taglinks;
+        auto link = [&taglinks, this](const wxString& reftype, int64 ref_id, uint32_t tag)
+        {
+            const int64 id = tag_id(tag);
+            if (id == -1)
+                return;
+            Model_Taglink::Data* taglink = Model_Taglink::instance().create();
+            taglink->REFTYPE = reftype;
+            taglink->REFID = ref_id;
+            taglink->TAGID = id;
+            taglinks.push_back(taglink);
+        };
+        for (uint32_t t = m_tag_offsets[i]; t < m_tag_offsets[i + 1]; t++)
+            link(Model_Attachment::REFTYPE_STR_TRANSACTION, trx_id, m_tag[t]);
+
+        for (uint32_t s = m_split_offsets[i]; s < m_split_offsets[i + 1]; s++)
+        {
+            Model_Splittransaction::Data* split = Model_Splittransaction::instance().create();
+            split->TRANSID = trx_id;
+            split->CATEGID = category_id(m_split_category[s]);
+            split->SPLITTRANSAMOUNT = m_split_amount[s];
+            split->NOTES = m_split_notes[s];
+            const int64 split_id = Model_Splittransaction::instance().save(split);
+            for (uint32_t t = m_split_tag_offsets[s]; t < m_split_tag_offsets[s + 1]; t++)
+                link(Model_Attachment::REFTYPE_STR_TRANSACTIONSPLIT, split_id, m_split_tag[t]);
+        }
+        if (!taglinks.empty())
+            Model_Taglink::instance().save(taglinks);
+        imported++;
+    }
+    Model_Checking::instance().ReleaseSavepoint("COLUMNAR_IMPORT");
+    return imported;
+}
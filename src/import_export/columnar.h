@@ -0,0 +1,145 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#ifndef MM_EX_COLUMNAR_H_
+#define MM_EX_COLUMNAR_H_
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "model/Model_Checking.h"
+
+/**
+* MMEX columnar transaction file (*.mmcol), version 1.
+*
+* A compact binary form of the transactions meant to be read by analysis
+* tools. All numbers are little endian, there is no padding.
+*
+*   header      8 bytes "MMEXCOL" and a zero byte, u32 version, u32 rows
+*   accounts    dictionary of account names
+*   payees      dictionary of payee names
+*   categories  u32 count, then for each one the u32 index of its parent
+*               category (NONE for a top level one) and its name as a string.
+*               A parent always comes before its subcategories.
+*   tags        dictionary of tag names
+*   columns     rows values each, one column after the other:
+*               i64 id, u32 account, u32 to account, u32 payee, u32 category,
+*               u8 type, u8 status, i32 date, f64 amount, f64 to amount,
+*               number (strings), notes (strings),
+*               tags (offsets, then u32 tag indexes),
+*               splits (offsets)
+*   splits      split values each: u32 category, f64 amount, notes (strings),
+*               tags (offsets, then u32 tag indexes)
+*
+* A string is a u32 byte length followed by the UTF-8 bytes, a dictionary is
+* a u32 count followed by that many strings. A strings column is n + 1 u32
+* offsets followed by a block of UTF-8 bytes as long as the last offset; value
+* i is the bytes from offset i to offset i + 1. An offsets column works the
+* same way for the values of the list that follows it: tags of row i are the
+* indexes from tag offset i to tag offset i + 1, its splits are those from
+* split offset i to split offset i + 1.
+*
+* Indexes refer to the dictionaries and are NONE (0xFFFFFFFF) when not set.
+* Type and status are the Model_Checking TYPE_ID and STATUS_ID values. Dates
+* are days since 1970-01-01; the time of day is not kept.
+*/
+namespace mmColumnar
+{
+    enum { VERSION = 1 };
+    const uint32_t NONE = 0xFFFFFFFF;
+}
+
+/** Collects transactions and writes them as a columnar file */
+class mmColumnarExport
+{
+public:
+    void add(const Model_Checking::Data& r
+        , const Model_Checking::Split_Data_Set& splits
+        , const Model_Checking::Taglink_Data_Set& tags);
+    size_t rows() const { return m_id.size(); }
+    bool save(const wxString& path) const;
+
+private:
+    uint32_t account(int64 id);
+    uint32_t payee(int64 id);
+    uint32_t category(int64 id);
+    uint32_t tag(int64 id);
+
+    std::vector<wxString> m_accounts, m_payees, m_tags;
+    std::vector<std::pair<uint32_t, wxString>> m_categories;
+    std::map<int64, uint32_t> m_account_index, m_payee_index, m_category_index, m_tag_index;
+
+    std::vector<int64_t> m_id;
+    std::vector<uint32_t> m_account, m_to_account, m_payee, m_category;
+    std::vector<uint8_t> m_type, m_status;
+    std::vector<int32_t> m_date;
+    std::vector<double> m_amount, m_to_amount;
+    std::vector<wxString> m_number, m_notes;
+    std::vector<uint32_t> m_tag_offsets{ 0 }, m_tag;
+    std::vector<uint32_t> m_split_offsets{ 0 };
+
+    std::vector<uint32_t> m_split_category;
+    std::vector<double> m_split_amount;
+    std::vector<wxString> m_split_notes;
+    std::vector<uint32_t> m_split_tag_offsets{ 0 }, m_split_tag;
+};
+
+/**
+* Reads a columnar file and adds its transactions to the database.
+* Accounts must exist already; payees, categories and tags are created when
+* missing. Transactions that are already in the database get the duplicate
+* status, the same way as CSV and QIF imports.
+*/
+class mmColumnarImport
+{
+public:
+    /** Read and check the whole file, error() tells why it failed */
+    bool load(const wxString& path);
+    const wxString& error() const { return m_error; }
+    size_t rows() const { return m_id.size(); }
+
+    /** Save the transactions, skipped is the number of rows whose accounts do not exist */
+    size_t import(size_t& skipped);
+
+private:
+    class Input;
+    bool read(Input& in);
+    int64 account_id(uint32_t i);
+    int64 payee_id(uint32_t i);
+    int64 category_id(uint32_t i);
+    int64 tag_id(uint32_t i);
+
+    wxString m_error;
+    std::vector<wxString> m_accounts, m_payees, m_tags;
+    std::vector<std::pair<uint32_t, wxString>> m_categories;
+    std::vector<int64> m_account_ids, m_payee_ids, m_category_ids, m_tag_ids;
+
+    std::vector<int64_t> m_id;
+    std::vector<uint32_t> m_account, m_to_account, m_payee, m_category;
+    std::vector<uint8_t> m_type, m_status;
+    std::vector<int32_t> m_date;
+    std::vector<double> m_amount, m_to_amount;
+    std::vector<wxString> m_number, m_notes;
+    std::vector<uint32_t> m_tag_offsets, m_tag;
+    std::vector<uint32_t> m_split_offsets;
+
+    std::vector<uint32_t> m_split_category;
+    std::vector<double> m_split_amount;
+    std::vector<wxString> m_split_notes;
+    std::vector<uint32_t> m_split_tag_offsets, m_split_tag;
+};
+
+#endif // MM_EX_COLUMNAR_H_
@@ -0,0 +1,615 @@
+/*******************************************************
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+********************************************************/
+
+#include "csv_import.h"
+#include "parsers.h"
+#include "payeematcher.h"
+#include "phasetimer.h"
+#include "util.h"
+#include "model/Model_Account.h"
+#include "model/Model_Attachment.h"
+#include "model/Model_Category.h"
+#include "model/Model_CustomField.h"
+#include "model/Model_CustomFieldData.h"
+#include "model/Model_Payee.h"
+#include "model/Model_Tag.h"
+#include <algorithm>
+#include <deque>
+#include <wx/regex.h>
+#include <wx/tokenzr.h>
+
+void mmCSVImporter::normalizeCategoryDelimiter(wxString& name)
+{
+    if (name.Find(':') == wxNOT_FOUND)
+        return;
+
+    wxString out;
+    out.reserve(name.length());
+    for (auto it = name.begin(); it != name.end(); ++it)
+    {
+        const auto next = it + 1;
+        if (*it == ' ' && next != name.end() && *next == ':')
+            continue;
+        out += *it;
+        if (*it == ':' && next != name.end() && *next == ' ')
+            ++it;
+    }
+    name = out;
+}
+
+void mmCSVImporter::matchPayees(const wxArrayString& names, const mmPayeeMatcher* matcher)
+{
+    for (const auto& payee_name : names)
+    {
+        // initialize
+        m_CSVpayeeNames[payee_name] = std::make_tuple(-1, "", "");
+        // perform pattern match
+        const mmPayeeMatcher::Rule* rule = matcher ? matcher->match(payee_name) : nullptr;
+        if (rule)
+        {
+            // save the target payee ID, name, and match details
+            m_CSVpayeeNames[payee_name] = std::make_tuple(rule->payee_id, rule->payee_name, rule->pattern);
+        }
+        else
+        {
+            Model_Payee::Data* payee = Model_Payee::instance().get(payee_name);
+            if (payee) {
+                m_CSVpayeeNames[payee_name] = std::make_tuple(payee->PAYEEID, payee->PAYEENAME, "");
+            }
+        }
+    }
+}
+
+mmCSVImporter::Totals mmCSVImporter::importRows(ITransactionsFile& parser, long firstRow, long ignoreLastRows, mmPhaseTimer& timer)
+{
+    Totals totals;
+    // Rows already in the account are imported with the duplicate status
+    mmDuplicateIndex duplicates;
+    const wxString reftype = Model_Attachment::REFTYPE_STR_TRANSACTION;
+    const Model_Account::Data* account = Model_Account::instance().get(accountID_);
+    if (!account)
+        return totals;
+
+    // Whether a line is one of the ignored last ones is known once that many lines follow it
+    std::deque<std::vector<wxString>> tailLines;
+    std::vector<wxString> tokens;
+    for (;;)
+    {
+        timer.start("read");
+        if (!parser.NextLine())
+            break;
+        if (totals.lines++ < firstRow)
+            continue;
+        tailLines.push_back(std::vector<wxString>(parser.GetItemsCount()));
+        for (unsigned int i = 0; i < tailLines.back().size(); i++)
+            tailLines.back()[i] = parser.GetItem(i);
+        if (static_cast<long>(tailLines.size()) <= ignoreLastRows)
+            continue;
+        tokens.swap(tailLines.front());
+        tailLines.pop_front();
+        const long nLines = totals.lines - 1 - ignoreLastRows;
+
+        timer.start("progress");
+        if (!importProgress(nLines - firstRow, totals.imported))
+        {
+            totals.canceled = true;
+            break; // abort processing
+        }
+
+        timer.start("parse");
+
+        unsigned int numTokens = tokens.size();
+        unsigned int blankTokenCount = 0;
+        tran_holder holder;
+        wxString rowString;
+        if (numTokens != 0)
+        {
+            for (size_t i = 0; i < csvFieldOrder_.size() && i < numTokens; ++i) {
+                wxString token = tokens[i].Trim(false /*from left*/);
+                // Store the CSV row to display in case the row is rejected
+                rowString << inQuotes(token,",") << ((i < numTokens - 1) ? "," : "");
+                if (!token.IsEmpty())
+                    parseToken(csvFieldOrder_[i].first, token, holder);
+                else blankTokenCount++; // keep track of blank fields
+            }
+        }
+        // if the line had no field separators or all fields were blank (",,,,,")
+        if (numTokens == 0 || blankTokenCount == numTokens)
+        {
+            log(wxString::Format(_("Line %ld: Empty"), nLines + 1));
+            totals.empty++;
+            continue;
+        }
+
+        wxString message;
+        // validate data and store any error messages
+        if (!validateData(holder, message))
+        {
+            wxString msg = wxString::Format(_("Line %ld: Error:"), nLines + 1);
+            msg << " " << message;
+            log(msg);
+            // row was rejected so save it to rejectedRows
+            totals.rejectedRows << rowString << "\n";
+            continue;
+        }
+
+        wxString trxDate = holder.Date.FormatISOCombined();
+        const Model_Account::Data* toAccount = Model_Account::instance().get(holder.ToAccountID);
+        if ((trxDate < account->INITIALDATE) ||
+            (toAccount && (trxDate < toAccount->INITIALDATE)))
+        {
+            log(wxString::Format(_("Line %ld: %s"), nLines + 1,
+                _("The opening date for the account is later than the date of this transaction")));
+            // row was rejected so save it to rejectedRows
+            totals.rejectedRows << rowString << "\n";
+            continue;
+        }
+
+        timer.start("insert");
+        Model_Checking::Data *pTransaction = Model_Checking::instance().create();
+        pTransaction->TRANSDATE = trxDate;
+        pTransaction->ACCOUNTID = accountID_;
+        pTransaction->TOACCOUNTID = holder.ToAccountID;
+        pTransaction->PAYEEID = holder.PayeeID;
+        pTransaction->TRANSCODE = holder.Type;
+        pTransaction->TRANSAMOUNT = holder.Amount;
+        pTransaction->TOTRANSAMOUNT = holder.ToAmount;
+        pTransaction->CATEGID = holder.CategoryID;
+        pTransaction->STATUS = holder.Status;
+        pTransaction->TRANSACTIONNUMBER = holder.Number;
+        pTransaction->NOTES = holder.Notes;
+        if (m_matchAddNotes && !holder.PayeeMatchNotes.IsEmpty())
+            pTransaction->NOTES.Append((pTransaction->NOTES.IsEmpty() ? "" : "\n" ) + holder.PayeeMatchNotes);
+        pTransaction->COLOR = m_colorId;
+        if (duplicates.take(*pTransaction))
+            pTransaction->STATUS = Model_Checking::STATUS_KEY_DUPLICATE;
+
+        Model_Checking::instance().save(pTransaction);
+
+        // save custom field data
+        if (!holder.customFieldData.empty())
+        {
+            for (const auto& field : holder.customFieldData)
+            {
+                Model_CustomFieldData::Data* cfdata = Model_CustomFieldData::instance().create();
+                cfdata->FIELDID = field.first;
+                cfdata->REFID = pTransaction->TRANSID;
+                cfdata->CONTENT = field.second;
+                Model_CustomFieldData::instance().save(cfdata);
+            }
+        }
+
+        // save tags
+        if (!holder.tagIDs.empty())
+        {
+            for (const auto& tag : holder.tagIDs)
+            {
+                Model_Taglink::Data* taglink = Model_Taglink::instance().create();
+                taglink->REFTYPE = reftype;
+                taglink->REFID = pTransaction->TRANSID;
+                taglink->TAGID = tag;
+                Model_Taglink::instance().save(taglink);
+            }
+        }
+
+        totals.imported++;
+        log(wxString::Format(_("Line %ld: OK, imported."), nLines + 1));
+    }
+    timer.stop();
+    timer.add_rows(totals.imported);
+    return totals;
+}
+
+bool mmCSVImporter::validateData(tran_holder & holder, wxString& message)
+{
+    bool is_valid = true;
+    if (!holder.valid) {
+        is_valid = false;
+        if (!holder.Date.IsValid()) message << " " << _("Invalid Date.");
+        if (!holder.Amount) message << " " << _("Invalid Amount.");
+        if (holder.Type.Trim().IsEmpty()) message << " " << _("Type (withdrawal/deposit) unknown.");
+    }
+
+    // If we are importing any custom field data test for validity
+    if (!holder.customFieldData.empty())
+        for (auto& cfdata : holder.customFieldData)
+            is_valid &= validateCustomFieldData(cfdata.first, cfdata.second, message);
+
+    Model_Payee::Data* payee = Model_Payee::instance().get(holder.PayeeID);
+    if (!payee)
+    {
+        Model_Payee::Data* u = Model_Payee::instance().get(_("Unknown"));
+        if (!u) {
+            Model_Payee::Data *p = Model_Payee::instance().create();
+            p->PAYEENAME = _("Unknown");
+            p->ACTIVE = 1;
+            p->CATEGID = -1;
+            holder.PayeeID = Model_Payee::instance().save(p);
+            log(wxString::Format(_("Added payee: %s"), p->PAYEENAME));
+        }
+        else {
+            holder.PayeeID = u->PAYEEID;
+        }
+    }
+    else
+    {
+        if (holder.CategoryID < 0) {
+            holder.CategoryID = payee->CATEGID;
+        }
+    }
+
+    if (holder.CategoryID == -1) //The category name is missing in SCV file and not assigned for the payee
+    {
+        Model_Category::Data* categ = Model_Category::instance().get(_("Unknown"), int64(-1));
+        if (categ) {
+            holder.CategoryID = categ->CATEGID;
+        }
+        else
+        {
+            Model_Category::Data *c = Model_Category::instance().create();
+            c->CATEGNAME = _("Unknown");
+            c->ACTIVE = 1;
+            c->PARENTID = -1;
+            holder.CategoryID = Model_Category::instance().save(c);
+        }
+    }
+
+    return is_valid;
+}
+
+void mmCSVImporter::parseToken(int index, const wxString& orig_token, tran_holder& holder)
+{
+    if (orig_token.IsEmpty()) return;
+    wxString token = orig_token.Strip(wxString::leading).Strip(wxString::trailing);
+
+    double amount;
+
+    switch (index)
+    {
+    case UNIV_CSV_DATE:
+    {
+        wxDateTime dtdt;
+        if (mmParseDisplayStringToDate(dtdt, token, date_format_))
+            holder.Date = dtdt;
+        else
+            holder.valid = false;
+        break;
+    }
+    case UNIV_CSV_PAYEE:
+        if (m_CSVpayeeNames.find(token) != m_CSVpayeeNames.end() && std::get<0>(m_CSVpayeeNames[token]) != -1)
+        {
+            holder.PayeeID = std::get<0>(m_CSVpayeeNames[token]);
+            if (m_matchAddNotes && !std::get<2>(m_CSVpayeeNames[token]).IsEmpty())
+            {
+                holder.PayeeMatchNotes = wxString::Format(_("%1$s matched by %2$s"), token, std::get<2>(m_CSVpayeeNames[token]));
+            }
+        }
+        else
+        {
+            Model_Payee::Data* payee = Model_Payee::instance().create();
+            payee->PAYEENAME = token;
+            payee->ACTIVE = 1;
+            holder.PayeeID = Model_Payee::instance().save(payee);
+            m_CSVpayeeNames[token] = std::make_tuple(holder.PayeeID, token, wxEmptyString);
+        }
+        break;
+
+    case UNIV_CSV_AMOUNT:
+        mmTrimAmount(token, decimal_, ".").ToCDouble(&amount);
+
+        if (find_if(csvFieldOrder_.begin(), csvFieldOrder_.end(), [](const std::pair<int, int>& element) {return element.first == UNIV_CSV_TYPE; }) == csvFieldOrder_.end()) {
+            const bool reverse_sign = m_amountFieldSign == PositiveIsWithdrawal;
+            if ((amount > 0.0 && !reverse_sign) || (amount <= 0.0 && reverse_sign)) {
+                holder.Type = Model_Checking::TYPE_STR_DEPOSIT;
+            }
+        }
+
+        holder.Amount = fabs(amount);
+        break;
+
+    case UNIV_CSV_CATEGORY:
+    {
+        // Convert to standard delimiter for consistency
+        normalizeCategoryDelimiter(token);
+        // check if we already have this category
+        if (m_CSVcategoryNames.find(token) != m_CSVcategoryNames.end() && m_CSVcategoryNames[token] != -1)
+            holder.CategoryID = m_CSVcategoryNames[token];
+        else // create category and any missing parent categories
+        {
+            Model_Category::Data* category = nullptr;
+            int64 parentID = -1;
+            wxStringTokenizer tokenizer = wxStringTokenizer(token, ":");
+            while (tokenizer.HasMoreTokens())
+            {
+                wxString categname = tokenizer.GetNextToken().Trim().Trim(false);
+                category = Model_Category::instance().get(categname, parentID);
+                if (!category)
+                {
+                    category = Model_Category::instance().create();
+                    category->CATEGNAME = categname;
+                    category->PARENTID = parentID;
+                    category->ACTIVE = 1;
+                    Model_Category::instance().save(category);
+                }
+                parentID = category->CATEGID;
+            }
+
+            if (category)
+            {
+                holder.CategoryID = category->CATEGID;
+                m_CSVcategoryNames[token] = category->CATEGID;
+            }
+        }
+        break;
+    }
+    case UNIV_CSV_SUBCATEGORY:
+    {
+        if (holder.CategoryID == -1)
+            return;
+
+        token.Replace(":", "|");
+        wxString categname = Model_Category::full_name(holder.CategoryID);
+        categname.Append(":" + token);
+        if (m_CSVcategoryNames.find(categname) != m_CSVcategoryNames.end() && m_CSVcategoryNames[categname] != -1)
+            holder.CategoryID = m_CSVcategoryNames[categname];
+        else
+        {
+            Model_Category::Data* category = Model_Category::instance().create();
+            category->PARENTID = holder.CategoryID;
+            category->CATEGNAME = token;
+            category->ACTIVE = 1;
+            Model_Category::instance().save(category);
+
+            holder.CategoryID = category->CATEGID;
+            m_CSVcategoryNames[categname] = category->CATEGID;
+        }
+        break;
+    }
+    case UNIV_CSV_TAGS:
+    {
+        // split the tag string at space characters
+        wxStringTokenizer tokenizer = wxStringTokenizer(token, " ");
+        while (tokenizer.HasMoreTokens())
+        {
+            wxString tagname = tokenizer.GetNextToken();
+            // check for an existing tag
+            Model_Tag::Data* tag = Model_Tag::instance().get(tagname);
+            if (!tag)
+            {
+                // create a new tag if we didn't find one
+                tag = Model_Tag::instance().create();
+                tag->TAGNAME = tagname;
+                tag->ACTIVE = 1;
+                Model_Tag::instance().save(tag);
+            }
+            // add the tagID to the transaction if it isn't already there
+            if (std::find(holder.tagIDs.begin(), holder.tagIDs.end(), tag->TAGID) == holder.tagIDs.end())
+                holder.tagIDs.push_back(tag->TAGID);
+        }
+        break;
+    }
+    case UNIV_CSV_TRANSNUM:
+        holder.Number = token;
+        break;
+
+    case UNIV_CSV_NOTES:
+        token.Replace("\\n", "\n");
+        holder.Notes += (holder.Notes.IsEmpty() ? "" : "\n") + token;
+        break;
+
+    case UNIV_CSV_WITHDRAWAL:
+        if (token.IsEmpty())
+            return;
+
+        // do nothing if an amount has already been stored by a previous call #3168
+        if (holder.Amount != 0.0)
+            break;
+
+        if (!mmTrimAmount(token, decimal_, ".").ToCDouble(&amount))
+            break;
+
+        if (amount == 0.0)
+            break;
+
+        holder.Amount = fabs(amount);
+        holder.Type = Model_Checking::TYPE_STR_WITHDRAWAL;
+        break;
+
+    case UNIV_CSV_DEPOSIT:
+        if (token.IsEmpty())
+            return;
+
+        // do nothing if an amount has already been stored by a previous call #3168
+        if (holder.Amount != 0.0)
+            break;
+
+        if (!mmTrimAmount(token, decimal_, ".").ToCDouble(&amount))
+            break;
+
+        if (amount == 0.0)
+            break;
+
+        holder.Amount = fabs(amount);
+        holder.Type = Model_Checking::TYPE_STR_DEPOSIT;
+        break;
+
+        // A number of type options are supported to make amount positive 
+        // ('debit' seems odd but is there for backwards compatability!)
+    case UNIV_CSV_TYPE:
+        if (m_amountFieldSign == DefindByType)
+        {
+            if (depositType_.CmpNoCase(token) == 0)
+            {
+                holder.Type = Model_Checking::TYPE_STR_DEPOSIT;
+                break;
+            }
+        }
+        else
+        {
+            for (const wxString entry : { "debit", "deposit", "+" }) {
+                if (entry.CmpNoCase(token) == 0) {
+                    holder.Type = Model_Checking::TYPE_STR_DEPOSIT;
+                    break;
+                }
+            }
+        }
+        break;
+    default:
+        if (index > UNIV_CSV_LAST) // custom fields
+            holder.customFieldData[index - UNIV_CSV_LAST] = token;
+        break;
+    }
+}
+
+/* Validates the specified string matches the parameters of the target Custom Field.
+Cleanses the value and reformats as needed for DB storage
+*/
+bool mmCSVImporter::validateCustomFieldData(int64 fieldId, wxString& value, wxString& message)
+{
+    bool is_valid = true;
+    long int_val;
+    int index;
+    double double_val;
+    wxDate date;
+    wxDateTime time;
+    wxArrayString choices;
+    wxStringTokenizer tokenizer;
+
+    // Set up valid boolean values
+    const wxString bool_true[] = { "True", "T", "1", "Y" };
+    const wxArrayString bool_true_array(4, bool_true);
+    const wxString bool_false[] = { "False", "F", "0", "N", ""};
+    const wxArrayString bool_false_array(4, bool_false);
+
+    if (!value.IsEmpty())
+    {
+        const Model_CustomField::Data* data = Model_CustomField::instance().get(fieldId);
+        wxString type_string = Model_CustomField::TYPE_STR[Model_CustomField::type_id(data)];
+        switch (Model_CustomField::type_id(data))
+        {
+            // Check if string can be read as an integer. Will fail if passed a double.
+        case Model_CustomField::TYPE_ID_INTEGER:
+            value = cleanseNumberString(value, true);
+            if (!value.ToCLong(&int_val))
+            {
+                message << " " << wxString::Format(_("Value %1$s for custom field '%2$s' is not type %3$s."), value, data->DESCRIPTION, type_string);
+                is_valid = false;
+            }
+            else value = wxString::Format("%i", int_val);
+            break;
+
+            // Check if string can be read as a double
+        case Model_CustomField::TYPE_ID_DECIMAL:
+            value = cleanseNumberString(value, true);
+            if (!value.ToCDouble(&double_val))
+            {
+                message << " " << wxString::Format(_("Value %1$s for custom field '%2$s' is not type %3$s."), value, data->DESCRIPTION, type_string);
+                is_valid = false;
+            }
+            else
+            {
+                // round to required precision
+                int precision = Model_CustomField::getDigitScale(data->PROPERTIES);
+                value = wxString::Format("%.*f", precision, double_val);
+            }
+            break;
+
+            // Check if string can be interpreted as "True" or "False" (case insensitive)    
+        case Model_CustomField::TYPE_ID_BOOLEAN:
+            if (bool_true_array.Index(value, false) == wxNOT_FOUND)
+                if (bool_false_array.Index(value, false) == wxNOT_FOUND)
+                {
+                    message << " " << wxString::Format(_("Value %1$s for custom field '%2$s' is not type %3$s."), value, data->DESCRIPTION, type_string);
+                    is_valid = false;
+                }
+                else value = "FALSE";
+            else value = "TRUE";
+            break;
+
+            // Check if string is a valid choice (case insensitive)
+        case Model_CustomField::TYPE_ID_SINGLECHOICE:
+            choices = Model_CustomField::getChoices(data->PROPERTIES);
+            index = choices.Index(value, false);
+            if (index == wxNOT_FOUND)
+            {
+                message << " " << wxString::Format(_("Value %1$s for %2$s custom field '%3$s' is not a valid selection."), value, type_string, data->DESCRIPTION);
+                is_valid = false;
+            }
+            else value = choices[index];
+            break;
+
+            // Check if all of the ';' delimited strings are valid choices (case insensitive)
+        case Model_CustomField::TYPE_ID_MULTICHOICE:
+            choices = Model_CustomField::getChoices(data->PROPERTIES);
+            tokenizer = wxStringTokenizer(value, ";");
+            value.Clear();
+            while (tokenizer.HasMoreTokens())
+            {
+                wxString token = tokenizer.GetNextToken();
+                index = choices.Index(token, false);
+                if (index != wxNOT_FOUND)
+                {
+                    value.Append(choices[index]);
+                    if (tokenizer.HasMoreTokens()) value.Append(";");
+                }
+                else {
+                    message << " " << wxString::Format(_("Value %1$s for %2$s custom field '%3$s' is not a valid selection."), token, type_string, data->DESCRIPTION);
+                    is_valid = false;
+                }
+            }
+            break;
+
+            // Parse the date using the user specified format. Convert to ISO date
+        case Model_CustomField::TYPE_ID_DATE:
+            if (!mmParseDisplayStringToDate(date, value, date_format_))
+            {
+                message << " " << wxString::Format(_("Value %1$s for custom field '%2$s' is not type %3$s."), value, data->DESCRIPTION, type_string) <<
+                    " " << wxString::Format(_("Confirm format matches selection %s."), date_format_);
+                is_valid = false;
+            }
+            else value = date.FormatISODate();
+            break;
+
+            // Parse the time. Convert to ISO Format
+        case Model_CustomField::TYPE_ID_TIME:
+            if (!time.ParseTime(value))
+            {
+                message << " " << wxString::Format(_("Value %1$s for custom field '%2$s' is not type %3$s."), value, data->DESCRIPTION, type_string);
+                is_valid = false;
+            }
+            else value = time.FormatISOTime();
+            break;
+
+        default: break;
+        }
+
+        // if regex check is enabled, perform regex validation
+        const wxString regExStr = Model_CustomField::getRegEx(data->PROPERTIES);
+        if (!regExStr.empty())
+        {
+            wxRegEx regEx(regExStr, wxRE_EXTENDED);
+
+            if (!regEx.Matches(value))
+            {
+                message << " " << wxString::Format(_("Value %1$s does not match regex %2$s for custom field '%3$s'."), value, regExStr, data->DESCRIPTION);
+                is_valid = false;
+            }
+        }
+
+    }
+
+    return is_valid;
+}
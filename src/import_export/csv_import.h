@@ -0,0 +1,123 @@
+/*******************************************************
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+********************************************************/
+
+#ifndef MM_EX_CSV_IMPORT_H_
+#define MM_EX_CSV_IMPORT_H_
+
+#include "model/Model_Checking.h"
+#include <map>
+#include <tuple>
+#include <vector>
+
+class ITransactionsFile;
+class mmPayeeMatcher;
+class mmPhaseTimer;
+
+/**
+* The CSV and XML import without the dialog: the lines of an opened file are
+* parsed with the field order, checked and saved as transactions of one
+* account. mmUnivCSVDialog sets the field order and the options from its
+* controls and wraps the import in the database transaction the user confirms;
+* the log and the progress go to the virtual functions, which do nothing here.
+*/
+class mmCSVImporter
+{
+public:
+    enum EUnivCvs
+    {
+        UNIV_CSV_ID = 0,
+        UNIV_CSV_DATE,
+        UNIV_CSV_STATUS,
+        UNIV_CSV_TYPE,
+        UNIV_CSV_ACCOUNT,
+        UNIV_CSV_PAYEE,
+        UNIV_CSV_AMOUNT,
+        UNIV_CSV_CURRENCY,
+        UNIV_CSV_CATEGORY,
+        UNIV_CSV_SUBCATEGORY,
+        UNIV_CSV_TAGS,
+        UNIV_CSV_TRANSNUM,
+        UNIV_CSV_NOTES,
+        UNIV_CSV_DONTCARE,
+        UNIV_CSV_WITHDRAWAL,
+        UNIV_CSV_DEPOSIT,
+        UNIV_CSV_BALANCE,
+        UNIV_CSV_LAST
+    };
+    enum amountFieldSignValues { PositiveIsDeposit, PositiveIsWithdrawal, DefindByType };
+
+    struct Totals
+    {
+        long lines = 0;         // lines of the file, the ignored ones included
+        long empty = 0;
+        long imported = 0;
+        bool canceled = false;
+        wxString rejectedRows;  // the rejected lines as CSV, to be imported again once fixed
+    };
+
+    mmCSVImporter() {}
+    virtual ~mmCSVImporter() {}
+
+    /** Match the payee names with the patterns of the payees or the payees of the same name */
+    void matchPayees(const wxArrayString& names, const mmPayeeMatcher* matcher);
+    /** Import the lines of the opened file past the first and before the last ones to ignore */
+    Totals importRows(ITransactionsFile& parser, long firstRow, long ignoreLastRows, mmPhaseTimer& timer);
+
+    // Replaces " ?: ?" with ":" to put all imported category names in a consistent format
+    static void normalizeCategoryDelimiter(wxString& name);
+
+protected:
+    virtual void log(const wxString& WXUNUSED(msg)) {}
+    /** Called for each line to import with its number past the ignored ones, false stops the import */
+    virtual bool importProgress(long WXUNUSED(line), long WXUNUSED(imported)) { return true; }
+
+    struct tran_holder
+    {
+        wxDateTime Date;
+        wxString Type = Model_Checking::TYPE_STR_WITHDRAWAL;
+        wxString Status = "";
+        int64 ToAccountID = -1;
+        double ToAmount = 0.0;
+        int64 PayeeID = -1;
+        int64 CategoryID = -1;
+        wxArrayInt64 tagIDs;
+        double Amount = 0.0;
+        wxString Number;
+        wxString Notes;
+        bool valid = true;
+        wxString PayeeMatchNotes;
+        std::map<int, wxString> customFieldData;
+    };
+
+    bool validateData(tran_holder & holder, wxString& message);
+    void parseToken(int index, const wxString& token, tran_holder& holder);
+    bool validateCustomFieldData(int64 fieldId, wxString& value, wxString& log_message);
+
+    // The options of the import
+    std::vector < std::pair <int, int>> csvFieldOrder_; // field, width of the preview column
+    wxString decimal_ = ".";
+    wxString date_format_;
+    int64 accountID_ = -1;
+    int m_amountFieldSign = PositiveIsDeposit;
+    wxString depositType_ = Model_Checking::TYPE_STR_DEPOSIT;
+    bool m_matchAddNotes = false;   // add the matched payee pattern to the notes
+    int m_colorId = -1;
+
+    std::map <wxString, std::tuple<int64, wxString, wxString>, caseInsensitiveComparator> m_CSVpayeeNames;
+    std::map <wxString, int64, caseInsensitiveComparator> m_CSVcategoryNames;
+};
+
+#endif
@@ -30,6 +30,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "model/Model_CustomFieldData.h"
 #include "model/Model_CustomField.h"
 #include "model/Model_Tag.h"
+#include "phasetimer.h"
+#include <wx/txtstrm.h>
 
 mmExportTransaction::mmExportTransaction()
 {}
@@ -306,13 +308,13 @@ const wxString mmExportTransaction::mm_acc_type(const wxString& qif_type)
 // JSON Export ----------------------------------------------------------------------------
 
 void mmExportTransaction::getAccountsJSON(PrettyWriter<StringBuffer>& json_writer
-    , std::map <int64 /*account ID*/, wxString>& allAccounts4Export)
+    , const std::set<int64>& allAccounts4Export)
 {
     json_writer.Key("ACCOUNTS");
     json_writer.StartArray();
-    for (const auto &entry : allAccounts4Export)
+    for (const auto account_id : allAccounts4Export)
     {
-        Model_Account::Data* a = Model_Account::instance().get(entry.first);
+        Model_Account::Data* a = Model_Account::instance().get(account_id);
         const auto c = Model_Currency::instance().get(a->CURRENCYID);
         json_writer.StartObject();
         json_writer.Key("ID");
@@ -584,3 +586,267 @@ void mmExportTransaction::getCustomFieldsJSON(PrettyWriter<StringBuffer>& json_w
         }
     }
 }
+
+//----------------------------------------------------------------------------
+
+mmTransactionsExport::mmTransactionsExport(int format, const wxArrayInt64& accounts
+    , const wxString& date_mask, const wxString& delimiter, wxTextOutputStream* out)
+    : m_format(format)
+    , m_selected(accounts)
+    , m_date_mask(date_mask)
+    , m_delimiter(delimiter)
+    , m_out(out)
+{
+}
+
+void mmTransactionsExport::setDates(const wxDateTime& from, const wxDateTime& to)
+{
+    m_from = from;
+    m_to = to;
+}
+
+void mmTransactionsExport::setProgress(const std::function<bool(size_t)>& progress)
+{
+    m_progress = progress;
+}
+
+// The filters are applied by the query. With by_account the rows come grouped
+// by the account they are written under, so each account is written once.
+std::unique_ptr<Model_Checking::Cursor> mmTransactionsExport::selected(bool by_account) const
+{
+    wxString accounts;
+    for (const auto& id : m_selected)
+        accounts << (accounts.empty() ? "" : ", ") << wxString::Format("%lld", id);
+
+    wxString where = wxString::Format("STATUS <> '%s' AND (DELETEDTIME IS NULL OR DELETEDTIME = '')"
+        " AND (ACCOUNTID IN (%s) OR (TRANSCODE = '%s' AND TOACCOUNTID IN (%s)))"
+        , Model_Checking::STATUS_KEY_VOID, accounts, Model_Checking::TYPE_STR_TRANSFER, accounts);
+    if (m_from.IsValid())
+        where << " AND SUBSTR(TRANSDATE, 1, 10) >= '" << m_from.FormatISODate() << "'";
+    if (m_to.IsValid())
+        where << " AND SUBSTR(TRANSDATE, 1, 10) <= '" << m_to.FormatISODate() << "'";
+
+    const wxString order_by = !by_account ? wxString("TRANSID")
+        : wxString::Format("CASE WHEN ACCOUNTID IN (%s) THEN ACCOUNTID ELSE TOACCOUNTID END, TRANSID", accounts);
+    return std::unique_ptr<Model_Checking::Cursor>(new Model_Checking::Cursor(where, order_by));
+}
+
+void mmTransactionsExport::flush(bool force, mmPhaseTimer& timer)
+{
+    if (!m_out || (!force && m_buffer.length() < FLUSH_SIZE))
+        return;
+    timer.start("write");
+    *m_out << m_buffer;
+    m_buffer.clear();
+    timer.start("format");
+}
+
+// The writer keeps its state by itself, what it has written can be taken
+// out of the string buffer between any two values
+void mmTransactionsExport::flush_json(bool force, mmPhaseTimer& timer)
+{
+    if (m_format != JSON || (!force && m_json_buffer.GetSize() < FLUSH_SIZE))
+        return;
+    m_buffer << wxString::FromUTF8(m_json_buffer.GetString());
+    m_json_buffer.Clear();
+    flush(force, timer);
+}
+
+void mmTransactionsExport::write_csv_header()
+{
+    m_buffer
+        << _("ID") << m_delimiter
+        << _("Date") << m_delimiter
+        << _("Status") << m_delimiter
+        << _("Type") << m_delimiter
+        << _("Account") << m_delimiter
+        << _("Payee") << m_delimiter
+        << _("Category") << m_delimiter
+        << _("Amount") << m_delimiter
+        << _("Currency") << m_delimiter
+        << _("Number") << m_delimiter
+        << _("Notes")
+        << "\n";
+}
+
+bool mmTransactionsExport::write(bool categories, bool transactions, mmPhaseTimer& timer)
+{
+    timer.start("format");
+    PrettyWriter<StringBuffer> json_writer(m_json_buffer);
+    json_writer.StartObject();
+
+    //Export categories
+    if (m_format == QIF && categories)
+    {
+        m_buffer << mmExportTransaction::getCategoriesQIF();
+        m_categories = Model_Category::instance().all().size();
+    }
+    else if (m_format == JSON)
+    {
+        if (categories) {
+            mmExportTransaction::getCategoriesJSON(json_writer);
+            m_categories = Model_Category::instance().all().size();
+        }
+        else {
+            mmExportTransaction::getUsedCategoriesJSON(json_writer);
+        }
+    }
+    flush(false, timer);
+    flush_json(false, timer);
+
+    bool completed = true;
+    if (transactions)
+    {
+        wxArrayInt64 allPayees4Export;
+        const wxString RefType = Model_Attachment::REFTYPE_STR_TRANSACTION;
+        wxArrayInt64 allAttachments4Export;
+        wxArrayInt64 allCustomFields4Export;
+        wxArrayInt64 allTags4Export;
+
+        // The list and the header tell a reader an empty selection from a broken file
+        json_writer.Key("transactions");
+        json_writer.StartArray();
+        if (m_format == CSV)
+            write_csv_header();
+
+        /* Array to store QIF tarts for selected accounts */
+        std::map<int64 /*account ID*/, wxString> extraTransfers;
+        int64 current_account = -1;
+
+        const auto splits = Model_Splittransaction::instance().get_all();
+        const auto tags = Model_Taglink::instance().get_all(Model_Attachment::REFTYPE_STR_TRANSACTION);
+
+        std::unique_ptr<Model_Checking::Cursor> cursor;
+        if (!m_selected.empty())
+            cursor = selected(m_format != JSON);
+        Model_Checking::Data transaction;
+        while (cursor && cursor->next(transaction))
+        {
+            ++m_transactions;
+            if (m_progress && !m_progress(m_transactions))
+            {
+                completed = false;
+                break;
+            }
+
+            bool is_reverce = false;
+            Model_Checking::Full_Data full_tran(transaction, splits, tags);
+            int64 account_id = transaction.ACCOUNTID;
+
+            switch (m_format)
+            {
+            case JSON:
+                mmExportTransaction::getTransactionJSON(json_writer, full_tran);
+                m_accounts.insert(account_id);
+                if (std::find(allPayees4Export.begin(), allPayees4Export.begin(), full_tran.PAYEEID) == allPayees4Export.end()
+                    && full_tran.TRANSCODE != Model_Checking::TYPE_STR_TRANSFER) {
+                    allPayees4Export.push_back(full_tran.PAYEEID);
+                }
+
+                if (!Model_Attachment::instance().FilterAttachments(RefType, full_tran.id()).empty()
+                    && std::find(allAttachments4Export.begin(), allAttachments4Export.end(), full_tran.TRANSID) == allAttachments4Export.end()) {
+                    allAttachments4Export.push_back(full_tran.TRANSID);
+                }
+
+                for (const auto & entry : Model_CustomFieldData::instance().find(Model_CustomFieldData::REFID(full_tran.id())))
+                {
+                    if (std::find(allCustomFields4Export.begin(), allCustomFields4Export.end(), entry.FIELDATADID) == allCustomFields4Export.end()) {
+                        allCustomFields4Export.push_back(entry.FIELDATADID);
+                    }
+                }
+
+                // store tags from the transaction
+                for (const auto& tag : full_tran.m_tags)
+                {
+                    if (std::find(allTags4Export.begin(), allTags4Export.end(), tag.TAGID) == allTags4Export.end())
+                        allTags4Export.push_back(tag.TAGID);
+                }
+                // store tags from the splits
+                for (const auto& split : full_tran.m_splits)
+                {
+                    for (const auto& taglink : Model_Taglink::instance().get(Model_Attachment::REFTYPE_STR_TRANSACTIONSPLIT, split.SPLITTRANSID))
+                    {
+                        if (std::find(allTags4Export.begin(), allTags4Export.end(), taglink.second) == allTags4Export.end())
+                            allTags4Export.push_back(taglink.second);
+                    }
+                }
+                flush_json(false, timer);
+                break;
+
+            case QIF:
+
+                if (Model_Checking::is_transfer(transaction.TRANSCODE))
+                {
+                    if (std::find(m_selected.begin(), m_selected.end(), transaction.ACCOUNTID) == m_selected.end()) {
+                        is_reverce = true;
+                        account_id = transaction.TOACCOUNTID;
+                    }
+
+                    if (transaction.TRANSAMOUNT != transaction.TOTRANSAMOUNT) {
+                        const auto trx2_str = mmExportTransaction::getTransactionQIF(full_tran, m_date_mask, !is_reverce);
+                        extraTransfers[is_reverce ? transaction.ACCOUNTID : transaction.TOACCOUNTID] += trx2_str;
+                    }
+                }
+
+                if (account_id != current_account) {
+                    m_buffer << mmExportTransaction::getAccountHeaderQIF(account_id);
+                    current_account = account_id;
+                }
+                m_accounts.insert(account_id);
+                m_buffer << mmExportTransaction::getTransactionQIF(full_tran, m_date_mask, is_reverce);
+                flush(false, timer);
+                break;
+
+            case CSV:
+
+                if (Model_Checking::is_transfer(transaction.TRANSCODE))
+                {
+                    if (std::find(m_selected.begin(), m_selected.end(), transaction.ACCOUNTID) == m_selected.end()) {
+                        is_reverce = true;
+                        account_id = transaction.TOACCOUNTID;
+                    }
+                    const auto trx2_str = mmExportTransaction::getTransactionCSV(full_tran, m_date_mask, !is_reverce);
+                    extraTransfers[is_reverce ? transaction.ACCOUNTID : transaction.TOACCOUNTID] += trx2_str;
+                }
+
+                m_accounts.insert(account_id);
+                m_buffer << mmExportTransaction::getTransactionCSV(full_tran, m_date_mask, is_reverce);
+                flush(false, timer);
+                break;
+            }
+            timer.add_rows();
+        }
+        json_writer.EndArray();
+
+        switch (m_format)
+        {
+        case QIF:
+            //Append extra transters
+            for (const auto &entry : extraTransfers) {
+                m_buffer << mmExportTransaction::getAccountHeaderQIF(entry.first);
+                m_buffer << entry.second;
+            }
+            break;
+
+        case JSON:
+            mmExportTransaction::getAccountsJSON(json_writer, m_accounts);
+            mmExportTransaction::getPayeesJSON(json_writer, allPayees4Export);
+            mmExportTransaction::getAttachmentsJSON(json_writer, allAttachments4Export);
+            mmExportTransaction::getCustomFieldsJSON(json_writer, allCustomFields4Export);
+            mmExportTransaction::getTagsJSON(json_writer, allTags4Export);
+            break;
+
+        case CSV:
+            //Append extra transters
+            for (const auto &entry : extraTransfers) {
+                m_buffer << entry.second;
+            }
+            break;
+        }
+    }
+    json_writer.EndObject();
+    flush_json(true, timer);
+    flush(true, timer);
+    timer.stop();
+    return completed;
+}
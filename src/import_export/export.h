@@ -20,6 +20,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define MM_EX_EXPORT_H_
 
 #include "model/Model_Checking.h"
+#include <functional>
+#include <memory>
+
+class mmPhaseTimer;
+class wxTextOutputStream;
 
 class mmExportTransaction
 {
@@ -39,11 +44,68 @@ public:
     static void getTransactionJSON(PrettyWriter<StringBuffer>& json_writer, const Model_Checking::Full_Data & tran);
     static void getCategoriesJSON(PrettyWriter<StringBuffer>& json_writer);
     static void getUsedCategoriesJSON(PrettyWriter<StringBuffer>& json_writer);
-    static void getAccountsJSON(PrettyWriter<StringBuffer>& json_writer, std::map <int64 /*account ID*/, wxString>& allAccounts4Export);
+    static void getAccountsJSON(PrettyWriter<StringBuffer>& json_writer, const std::set<int64>& allAccounts4Export);
     static void getPayeesJSON(PrettyWriter<StringBuffer>& json_writer, wxArrayInt64& allPayeess4Export);
     static void getAttachmentsJSON(PrettyWriter<StringBuffer>& json_writer, wxArrayInt64& allAttachment4Export);
     static void getCustomFieldsJSON(PrettyWriter<StringBuffer>& json_writer, wxArrayInt64& allCustomFields4Export);
     static void getTagsJSON(PrettyWriter<StringBuffer>& json_writer, wxArrayInt64& allTags4Export);
 };
 
+/**
+* The CSV, JSON and QIF export of the transactions of some accounts without
+* the dialog. The output is written to the stream in pieces of FLUSH_SIZE
+* characters as it is produced, so the whole export is never held in memory;
+* without a stream it is kept for text().
+*/
+class mmTransactionsExport
+{
+public:
+    enum format { CSV = 0, JSON, QIF }; // the values of mmQIFExportDialog::type
+
+    mmTransactionsExport(int format, const wxArrayInt64& accounts
+        , const wxString& date_mask, const wxString& delimiter, wxTextOutputStream* out = nullptr);
+
+    /** Only export the transactions of the dates, an invalid date leaves that end open */
+    void setDates(const wxDateTime& from, const wxDateTime& to);
+    /** Called for each transaction with the number written so far, false stops the export */
+    void setProgress(const std::function<bool(size_t)>& progress);
+
+    /**
+    * Write the categories and the transactions of the accounts, the transaction
+    * list and the CSV header are there even when no transaction is selected.
+    * Return false when the progress stopped the export.
+    */
+    bool write(bool categories, bool transactions, mmPhaseTimer& timer);
+
+    /** The transactions of the accounts and dates, with by_account grouped by the account they are written under */
+    std::unique_ptr<Model_Checking::Cursor> selected(bool by_account) const;
+
+    size_t categories() const { return m_categories; }
+    size_t transactions() const { return m_transactions; }
+    size_t accounts() const { return m_accounts.size(); }
+    /** The output when there is no stream */
+    const wxString& text() const { return m_buffer; }
+
+    enum { FLUSH_SIZE = 64 * 1024 }; // characters of output kept before writing them
+
+private:
+    void flush(bool force, mmPhaseTimer& timer);
+    void flush_json(bool force, mmPhaseTimer& timer);
+    void write_csv_header();
+
+    int m_format;
+    wxArrayInt64 m_selected;
+    wxString m_date_mask;
+    wxString m_delimiter;
+    wxTextOutputStream* m_out;
+    wxDateTime m_from, m_to;
+    std::function<bool(size_t)> m_progress;
+
+    wxString m_buffer;
+    StringBuffer m_json_buffer;
+    size_t m_categories = 0;
+    size_t m_transactions = 0;
+    std::set<int64> m_accounts;
+};
+
 #endif
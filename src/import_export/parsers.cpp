@@ -23,6 +23,665 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <wx/filename.h>
 #include <wx/textfile.h>
 #include <wx/tokenzr.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+// ---------------------------- Record Reader --------------------------------
+mmRecordReader::mmRecordReader()
+    : pos_(0)
+    , end_(0)
+    , eof_(false)
+{
+}
+
+bool mmRecordReader::Open(const wxString& fileName)
+{
+    if (!file_.Open(fileName, "rb"))
+        return false;
+
+    eof_ = false;
+    pos_ = end_ = 0;
+    error_.clear();
+    if (!Fill())
+        return true; // empty file
+
+    const unsigned char* bom = reinterpret_cast<const unsigned char*>(buffer_.data());
+    if (end_ >= 3 && bom[0] == 0xEF && bom[1] == 0xBB && bom[2] == 0xBF)
+        pos_ = 3;
+    // UTF-16 and UTF-32 are not ASCII compatible
+    else if (end_ >= 2 && ((bom[0] == 0xFF && bom[1] == 0xFE) || (bom[0] == 0xFE && bom[1] == 0xFF)))
+        return false;
+    else if (end_ >= 4 && bom[0] == 0 && bom[1] == 0 && bom[2] == 0xFE && bom[3] == 0xFF)
+        return false;
+    return true;
+}
+
+bool mmRecordReader::Fill()
+{
+    if (eof_ || !file_.IsOpened())
+        return false;
+
+    buffer_.resize(BLOCK_SIZE);
+    const size_t read = file_.Read(buffer_.data(), BLOCK_SIZE);
+    if (read == 0)
+    {
+        eof_ = true;
+        return false;
+    }
+    pos_ = 0;
+    end_ = read;
+    return true;
+}
+
+// ---------------------------- CSV Reader --------------------------------
+mmCSVReader::mmCSVReader(const wxString& delimiter, const wxConvAuto& encoding)
+    : encoding_(encoding)
+    , delimiter_(0)
+    , skipLF_(false)
+{
+    // Only a single ASCII character can be found in the bytes of any of the encodings
+    if (delimiter.length() == 1 && delimiter[0].IsAscii() && delimiter[0] != '"')
+        delimiter_ = static_cast<char>(delimiter[0].GetValue());
+
+    memset(special_, 0, sizeof(special_));
+    special_[static_cast<unsigned char>(delimiter_)] = true;
+    special_[static_cast<unsigned char>('"')] = true;
+    special_[static_cast<unsigned char>('\r')] = true;
+    special_[static_cast<unsigned char>('\n')] = true;
+}
+
+bool mmCSVReader::Open(const wxString& fileName)
+{
+    if (delimiter_ == 0)
+        return false;
+
+    skipLF_ = false;
+    return mmRecordReader::Open(fileName);
+}
+
+bool mmCSVReader::NextRecord()
+{
+    record_.clear();
+    fields_.clear();
+
+    enum { FIELD_START, UNQUOTED, QUOTED, QUOTE_IN_QUOTED } state = FIELD_START;
+    size_t field_start = 0;
+    bool quoted = false;
+    bool any = false;
+
+    // Closes the current field, line breaks in quotes are stored as "\n"
+    auto endField = [&]()
+    {
+        if (quoted)
+        {
+            size_t out = field_start;
+            for (size_t in = field_start; in < record_.size(); in++)
+            {
+                if (record_[in] == '\r' && in + 1 < record_.size() && record_[in + 1] == '\n')
+                    continue;
+                record_[out++] = record_[in];
+            }
+            record_.resize(out);
+        }
+        fields_.push_back(std::make_pair(field_start, record_.size() - field_start));
+        field_start = record_.size();
+        quoted = false;
+        state = FIELD_START;
+    };
+
+    for (;;)
+    {
+        if (pos_ == end_ && !Fill())
+        {
+            if (!any)
+                return false;
+            if (state != FIELD_START || !fields_.empty())
+                endField();
+            return true;
+        }
+
+        const char* data = buffer_.data();
+        if (skipLF_)
+        {
+            skipLF_ = false;
+            if (data[pos_] == '\n')
+            {
+                pos_++;
+                continue;
+            }
+        }
+        any = true;
+
+        switch (state)
+        {
+        case FIELD_START:
+            if (data[pos_] == '"')
+            {
+                pos_++;
+                quoted = true;
+                state = QUOTED;
+                break;
+            }
+            state = UNQUOTED;
+            // fall through
+        case UNQUOTED:
+        {
+            size_t i = pos_;
+            while (i < end_ && !special_[static_cast<unsigned char>(data[i])])
+                i++;
+            record_.append(data + pos_, i - pos_);
+            pos_ = i;
+            if (pos_ == end_)
+                break;
+
+            const char c = data[pos_++];
+            if (c == delimiter_)
+                endField();
+            else if (c == '\r' || c == '\n')
+            {
+                skipLF_ = (c == '\r');
+                // An empty line has no fields at all
+                if (!fields_.empty() || !record_.empty())
+                    endField();
+                return true;
+            }
+            else
+                record_ += c; // a quote inside of an unquoted field is taken as is
+            break;
+        }
+        case QUOTED:
+        {
+            const char* quote = static_cast<const char*>(memchr(data + pos_, '"', end_ - pos_));
+            const size_t i = quote ? static_cast<size_t>(quote - data) : end_;
+            record_.append(data + pos_, i - pos_);
+            pos_ = i;
+            if (quote)
+            {
+                pos_++;
+                state = QUOTE_IN_QUOTED;
+            }
+            break;
+        }
+        case QUOTE_IN_QUOTED:
+        {
+            const char c = data[pos_];
+            if (c == '"')
+            {
+                pos_++;
+                record_ += c;
+                state = QUOTED;
+            }
+            else if (c == delimiter_)
+            {
+                pos_++;
+                endField();
+            }
+            else if (c == '\r' || c == '\n')
+            {
+                pos_++;
+                skipLF_ = (c == '\r');
+                endField();
+                return true;
+            }
+            else
+                state = UNQUOTED; // text after the closing quote is appended
+            break;
+        }
+        }
+    }
+}
+
+wxString mmCSVReader::GetField(size_t field) const
+{
+    const char* data = GetFieldData(field);
+    const size_t length = GetFieldLength(field);
+
+    size_t i = 0;
+    while (i < length && static_cast<unsigned char>(data[i]) < 0x80)
+        i++;
+    if (i == length)
+        return wxString::FromAscii(data, length);
+    return wxString(data, encoding_, length);
+}
+
+// ---------------------------- XML Sheet Reader --------------------------------
+namespace
+{
+    const char SPREADSHEET_NS[] = "urn:schemas-microsoft-com:office:spreadsheet";
+
+    // Replaces the predefined entities and the character references
+    void decodeEntities(wxString& text)
+    {
+        size_t amp = text.find('&');
+        if (amp == wxString::npos)
+            return;
+
+        wxString out = text.substr(0, amp);
+        while (amp != wxString::npos)
+        {
+            const size_t semi = text.find(';', amp);
+            const wxString entity = semi == wxString::npos ? "" : text.substr(amp + 1, semi - amp - 1);
+            wxString value, number;
+            unsigned long code = 0;
+            if (entity == "lt") value = "<";
+            else if (entity == "gt") value = ">";
+            else if (entity == "amp") value = "&";
+            else if (entity == "quot") value = "\"";
+            else if (entity == "apos") value = "'";
+            else if ((entity.StartsWith("#x", &number) && number.ToULong(&code, 16))
+                || (entity.StartsWith("#", &number) && number.ToULong(&code, 10)))
+            {
+                if (code > 0 && code <= 0x10FFFF)
+                    value = wxString(wxUniChar(code));
+            }
+
+            size_t next = amp + 1;
+            if (value.empty())
+                out += '&';
+            else
+            {
+                out += value;
+                next = semi + 1;
+            }
+            amp = text.find('&', next);
+            out += text.substr(next, amp == wxString::npos ? wxString::npos : amp - next);
+        }
+        text = out;
+    }
+}
+
+mmXMLSheetReader::mmXMLSheetReader()
+    : state_(STATE_START)
+    , empty_element_(false)
+{
+}
+
+// An empty file opens, NextRecord() tells it is not a spreadsheet
+bool mmXMLSheetReader::Open(const wxString& fileName)
+{
+    state_ = STATE_START;
+    encoding_.reset();
+    return mmRecordReader::Open(fileName);
+}
+
+int mmXMLSheetReader::Get()
+{
+    if (pos_ == end_ && !Fill())
+        return -1;
+    return static_cast<unsigned char>(buffer_[pos_++]);
+}
+
+// Reads up to and including the end sequence, what is before it goes to out
+bool mmXMLSheetReader::ReadUntil(const char* end, std::string* out)
+{
+    const size_t length = strlen(end);
+    std::string skipped;
+    std::string& s = out ? *out : skipped;
+    s.clear();
+    for (;;)
+    {
+        const int c = Get();
+        if (c < 0)
+            return false;
+        s += static_cast<char>(c);
+        if (s.size() >= length && s.compare(s.size() - length, length, end) == 0)
+        {
+            s.resize(s.size() - length);
+            return true;
+        }
+    }
+}
+
+// Tags, text and CDATA sections. The declaration, processing instructions,
+// comments and DOCTYPE are skipped.
+mmXMLSheetReader::Token mmXMLSheetReader::NextToken()
+{
+    for (;;)
+    {
+        text_.clear();
+        if (pos_ == end_ && !Fill())
+            return TOKEN_EOF;
+
+        if (buffer_[pos_] != '<')
+        {
+            for (;;)
+            {
+                const char* data = buffer_.data();
+                const char* lt = static_cast<const char*>(memchr(data + pos_, '<', end_ - pos_));
+                const size_t i = lt ? static_cast<size_t>(lt - data) : end_;
+                text_.append(data + pos_, i - pos_);
+                pos_ = i;
+                if (lt || !Fill())
+                    return TOKEN_TEXT;
+            }
+        }
+
+        pos_++;
+        int c = Get();
+        if (c == '/')
+        {
+            if (!ReadUntil(">", &name_))
+                return TOKEN_EOF;
+            while (!name_.empty() && isspace(static_cast<unsigned char>(name_.back())))
+                name_.pop_back();
+            return TOKEN_END;
+        }
+        if (c == '?')
+        {
+            std::string instruction;
+            if (!ReadUntil("?>", &instruction))
+                return TOKEN_EOF;
+            if (instruction.compare(0, 4, "xml ") == 0)
+                SetEncoding(instruction);
+            continue;
+        }
+        if (c == '!')
+        {
+            c = Get();
+            if (c == '-')
+            {
+                if (Get() != '-' || !ReadUntil("-->", nullptr))
+                    return TOKEN_EOF;
+                continue;
+            }
+            if (c == '[')
+            {
+                std::string cdata;
+                if (!ReadUntil("[", nullptr) || !ReadUntil("]]>", &cdata))
+                    return TOKEN_EOF;
+                // The entities of the fields are replaced later, not the ones of CDATA
+                for (const char ch : cdata)
+                {
+                    if (ch == '&')
+                        text_ += "&amp;";
+                    else
+                        text_ += ch;
+                }
+                return TOKEN_TEXT;
+            }
+            if (!ReadUntil(">", nullptr))
+                return TOKEN_EOF;
+            continue;
+        }
+        if (c < 0)
+            return TOKEN_EOF;
+
+        name_.assign(1, static_cast<char>(c));
+        attributes_.clear();
+        c = Get();
+        while (c >= 0 && c != '>' && c != '/' && !isspace(c))
+        {
+            name_ += static_cast<char>(c);
+            c = Get();
+        }
+        char quote = 0;
+        while (c >= 0 && (quote || c != '>'))
+        {
+            if (quote)
+            {
+                if (c == quote)
+                    quote = 0;
+            }
+            else if (c == '"' || c == '\'')
+                quote = static_cast<char>(c);
+            attributes_ += static_cast<char>(c);
+            c = Get();
+        }
+        if (c < 0)
+            return TOKEN_EOF;
+        empty_element_ = !attributes_.empty() && attributes_.back() == '/';
+        return TOKEN_START;
+    }
+}
+
+bool mmXMLSheetReader::IsName(const std::string& name, const char* local)
+{
+    const size_t colon = name.find(':');
+    return name.compare(colon == std::string::npos ? 0 : colon + 1, std::string::npos, local) == 0;
+}
+
+// A name without a prefix matches the attribute with any prefix but xmlns
+bool mmXMLSheetReader::Attribute(const char* name, std::string& value) const
+{
+    const bool any_prefix = strchr(name, ':') == nullptr;
+    const std::string& a = attributes_;
+    size_t i = 0;
+    auto skipSpace = [&]()
+    {
+        while (i < a.size() && isspace(static_cast<unsigned char>(a[i])))
+            i++;
+    };
+
+    while (i < a.size())
+    {
+        skipSpace();
+        const size_t key_start = i;
+        while (i < a.size() && a[i] != '=' && !isspace(static_cast<unsigned char>(a[i])))
+            i++;
+        const std::string key = a.substr(key_start, i - key_start);
+        skipSpace();
+        if (i >= a.size() || a[i] != '=')
+        {
+            if (key.empty())
+                i++;
+            continue;
+        }
+        i++;
+        skipSpace();
+        if (i >= a.size() || (a[i] != '"' && a[i] != '\''))
+            return false;
+        const size_t end = a.find(a[i], i + 1);
+        if (end == std::string::npos)
+            return false;
+
+        const size_t colon = key.find(':');
+        if (key == name || (any_prefix && colon != std::string::npos
+            && key.compare(0, colon, "xmlns") != 0 && key.compare(colon + 1, std::string::npos, name) == 0))
+        {
+            value = a.substr(i + 1, end - i - 1);
+            return true;
+        }
+        i = end + 1;
+    }
+    return false;
+}
+
+void mmXMLSheetReader::SetEncoding(const std::string& declaration)
+{
+    const size_t at = declaration.find("encoding");
+    const size_t open = at == std::string::npos ? at : declaration.find_first_of("\"'", at);
+    const size_t close = open == std::string::npos ? open : declaration.find(declaration[open], open + 1);
+    if (close == std::string::npos)
+        return;
+
+    const wxString name = wxString::FromAscii(declaration.substr(open + 1, close - open - 1).c_str());
+    if (name.CmpNoCase("UTF-8") == 0 || name.CmpNoCase("UTF8") == 0)
+        return;
+    std::unique_ptr<wxCSConv> conv(new wxCSConv(name));
+    if (conv->IsOk())
+        encoding_ = std::move(conv);
+}
+
+// Moves to the start tag of the element, false when the parent ends before it
+bool mmXMLSheetReader::FindStart(const char* name, const char* parent)
+{
+    for (;;)
+    {
+        const Token token = NextToken();
+        if (token == TOKEN_EOF)
+            return false;
+        if (token == TOKEN_START && IsName(name_, name))
+            return true;
+        if (token == TOKEN_END && parent && IsName(name_, parent))
+            return false;
+    }
+}
+
+// Reads the cells up to the end of the row whose start tag was just read
+bool mmXMLSheetReader::ReadRow()
+{
+    if (empty_element_)
+        return true;
+
+    bool in_cell = false;
+    int data_depth = 0;
+    for (;;)
+    {
+        switch (NextToken())
+        {
+        case TOKEN_EOF:
+            return !fields_.empty(); // a truncated file ends with the cells read
+        case TOKEN_START:
+            if (IsName(name_, "Cell"))
+            {
+                // ss:Index is the column, counted from 1, of a cell after skipped ones
+                std::string index;
+                if (Attribute("Index", index))
+                {
+                    const unsigned long column = strtoul(index.c_str(), nullptr, 10);
+                    if (column > fields_.size() + 1 && column <= MAX_COLUMNS)
+                        fields_.resize(column - 1);
+                }
+                fields_.push_back(std::string());
+                in_cell = !empty_element_;
+                data_depth = 0;
+            }
+            else if (data_depth > 0)
+                data_depth += empty_element_ ? 0 : 1;
+            else if (in_cell && IsName(name_, "Data") && !empty_element_)
+                data_depth = 1;
+            break;
+        case TOKEN_END:
+            if (IsName(name_, "Row"))
+                return true;
+            if (IsName(name_, "Cell"))
+            {
+                in_cell = false;
+                data_depth = 0;
+            }
+            else if (data_depth > 0)
+                data_depth--;
+            break;
+        case TOKEN_TEXT:
+            if (data_depth > 0)
+                fields_.back() += text_;
+            break;
+        }
+    }
+}
+
+bool mmXMLSheetReader::NextRecord()
+{
+    fields_.clear();
+    if (state_ == STATE_START)
+    {
+        state_ = STATE_DONE;
+        Token token = NextToken();
+        while (token == TOKEN_TEXT)
+            token = NextToken();
+
+        const size_t colon = name_.find(':');
+        const std::string xmlns = colon == std::string::npos ? "xmlns" : "xmlns:" + name_.substr(0, colon);
+        std::string ns;
+        if (token != TOKEN_START || !IsName(name_, "Workbook")
+            || !Attribute(xmlns.c_str(), ns) || ns != SPREADSHEET_NS)
+        {
+            error_ = _("File is not in Excel XML Spreadsheet 2003 format.");
+            return false;
+        }
+        // TODO: Allow the user to choose the worksheet. This just uses the first.
+        if (!FindStart("Worksheet", "Workbook"))
+        {
+            error_ = _("Unable to find Worksheet.");
+            return false;
+        }
+        if (!FindStart("Table", "Worksheet"))
+        {
+            error_ = _("Unable to find Table.");
+            return false;
+        }
+        if (!empty_element_)
+            state_ = STATE_TABLE;
+    }
+
+    if (state_ == STATE_TABLE && FindStart("Row", "Table") && ReadRow())
+        return true;
+    state_ = STATE_DONE;
+    return false;
+}
+
+wxString mmXMLSheetReader::Convert(const std::string& bytes) const
+{
+    if (encoding_)
+        return wxString(bytes.data(), *encoding_, bytes.size());
+    return wxString::FromUTF8(bytes.data(), bytes.size());
+}
+
+wxString mmXMLSheetReader::GetField(size_t field) const
+{
+    wxString value = Convert(fields_[field]);
+    // the line ends are normalized before the references, so "&#13;" stays
+    if (value.Find('\r') != wxNOT_FOUND)
+    {
+        value.Replace("\r\n", "\n");
+        value.Replace("\r", "\n");
+    }
+    decodeEntities(value);
+    return value;
+}
+
+// ---------------------------- Table Based File --------------------------------
+bool TableBasedFile::OpenReader(mmRecordReader* reader, const wxString& fileName, unsigned int itemsInLine)
+{
+    std::unique_ptr<mmRecordReader> owned(reader);
+    itemsTable_.clear();
+    nextLine_ = 0;
+    itemsInLine_ = itemsInLine;
+    reader_.reset();
+    if (!owned->Open(fileName))
+        return false;
+
+    // the errors of the format come with the first record
+    pending_ = owned->NextRecord();
+    reader_ = std::move(owned);
+    return true;
+}
+
+bool TableBasedFile::NextLine()
+{
+    if (reader_)
+    {
+        if (!pending_)
+            return reader_->NextRecord();
+        pending_ = false;
+        return true;
+    }
+
+    if (nextLine_ >= itemsTable_.size())
+        return false;
+    nextLine_++;
+    return true;
+}
+
+unsigned int TableBasedFile::GetItemsCount() const
+{
+    if (reader_)
+        return std::min<size_t>(reader_->GetFieldCount(), itemsInLine_);
+    if (nextLine_ == 0)
+        return 0;
+    return itemsTable_[nextLine_ - 1].size();
+}
+
+wxString TableBasedFile::GetItem(unsigned int itemInLine) const
+{
+    if (itemInLine >= GetItemsCount())
+        return wxEmptyString;
+    if (reader_)
+        return reader_->GetField(itemInLine);
+    return itemsTable_[nextLine_ - 1][itemInLine].value;
+}
 
 // ---------------------------- CSV Parser --------------------------------
 FileCSV::FileCSV(wxWindow *pParentWindow, wxConvAuto encoding, wxString delimiter):
@@ -30,7 +689,7 @@ FileCSV::FileCSV(wxWindow *pParentWindow, wxConvAuto encoding, wxString delimite
 {
 }
 
-bool FileCSV::Load(const wxString& fileName, unsigned int itemsInLine)
+bool FileCSV::Open(const wxString& fileName, unsigned int itemsInLine)
 {
     // Make sure file exists
     if (fileName.IsEmpty() || !wxFileName::FileExists(fileName))
@@ -39,6 +698,13 @@ bool FileCSV::Load(const wxString& fileName, unsigned int itemsInLine)
         return false;
     }
 
+    if (OpenReader(new mmCSVReader(delimiter_, encoding_), fileName, itemsInLine))
+        return true;
+    return LoadText(fileName, itemsInLine);
+}
+
+bool FileCSV::LoadText(const wxString& fileName, unsigned int itemsInLine)
+{
     // Open file
     wxTextFile txtFile(fileName);
     if (!txtFile.Open(encoding_))
@@ -129,7 +795,7 @@ FileXML::FileXML(wxWindow *pParentWindow, wxString encoding):
 {
 }
 
-bool FileXML::Load(const wxString& fileName, unsigned int itemsInLine)
+bool FileXML::Open(const wxString& fileName, unsigned int itemsInLine)
 {
     // Make sure file exists
     if (fileName.IsEmpty() || !wxFileName::FileExists(fileName))
@@ -138,6 +804,19 @@ bool FileXML::Load(const wxString& fileName, unsigned int itemsInLine)
         return false;
     }
 
+    if (!OpenReader(new mmXMLSheetReader, fileName, itemsInLine))
+        return LoadDocument(fileName, itemsInLine);
+
+    if (!reader_->GetError().empty())
+    {
+        mmErrorDialogs::MessageError(pParentWindow_, reader_->GetError(), _("Parsing error"));
+        return false;
+    }
+    return true;
+}
+
+bool FileXML::LoadDocument(const wxString& fileName, unsigned int itemsInLine)
+{
     // Open file
     wxXmlDocument xmlFile;
     if (!xmlFile.Load(fileName, encoding_))
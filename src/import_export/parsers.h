@@ -22,10 +22,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <wx/string.h>
 #include <wx/window.h>
 #include <wx/convauto.h>
+#include <wx/ffile.h>
+#include <memory>
+#include <string>
 #include <vector>
 
 // Generic interface for importing data from a file.
-// Get functions should be called after Parse() was called.
+// The lines are read one at a time, get functions are for the line NextLine() moved to.
 class ITransactionsFile
 {
 public:
@@ -34,18 +37,18 @@ public:
     virtual ~ITransactionsFile() {}
 
  // *********************** Import related methods ***********************
-    // Opens and parses the input file in to an internal structure that allows calling the getter functions below.
-    virtual bool Load(const wxString& fileName, unsigned int itemsInLine) = 0;
+    // Opens the input file, NextLine() then moves to its first line.
+    virtual bool Open(const wxString& fileName, unsigned int itemsInLine) = 0;
 
-    // Gets the number of lines that can be parsed.
+    // Moves to the next line, false after the last one.
     // Depending on type of file there may be lines that are not transactions.
-    virtual unsigned int GetLinesCount() const = 0;
+    virtual bool NextLine() = 0;
 
-    // Gets the number of items in the specified line.
-    virtual unsigned int GetItemsCount(unsigned int line) const = 0;
+    // Gets the number of items in the current line.
+    virtual unsigned int GetItemsCount() const = 0;
 
-    // Gets the item or wxEmptyString if there is none.
-    virtual wxString GetItem(unsigned int line, unsigned int itemInLine) const = 0;
+    // Gets the item of the current line or wxEmptyString if there is none.
+    virtual wxString GetItem(unsigned int itemInLine) const = 0;
 
 // *********************** Export related methods ***********************
     // Adds a new empty line to the output file. Use NewItem() to add items to this line.
@@ -60,33 +63,122 @@ public:
     virtual bool Save(const wxString& fileName) = 0;
 };
 
-// A base class for a parser that reads the file in to a string table in memory.
+// Base of the streaming readers. The file is read in blocks and the records are
+// handed out one at a time, so the memory used does not depend on the file size.
+// Works on the bytes of any ASCII compatible encoding, the fields are converted
+// only when asked for.
+class mmRecordReader
+{
+public:
+    virtual ~mmRecordReader() {}
+
+    // Fails when the file can not be read or is not in an ASCII compatible encoding
+    virtual bool Open(const wxString& fileName);
+    // Moves to the next record, false at the end of the file
+    virtual bool NextRecord() = 0;
+    // Why the records could not be read, empty when they all were
+    const wxString& GetError() const { return error_; }
+
+    virtual size_t GetFieldCount() const = 0;
+    virtual wxString GetField(size_t field) const = 0;
+
+protected:
+    mmRecordReader();
+    // Reads the next block in to buffer_, false at the end of the file
+    bool Fill();
+
+    enum { BLOCK_SIZE = 256 * 1024 };
+    wxFFile file_;
+    std::vector<char> buffer_;
+    size_t pos_;
+    size_t end_;
+    bool eof_;
+    wxString error_;
+};
+
+// Streaming RFC 4180 reader
+class mmCSVReader : public mmRecordReader
+{
+public:
+    mmCSVReader(const wxString& delimiter, const wxConvAuto& encoding);
+
+    virtual bool Open(const wxString& fileName);
+    virtual bool NextRecord();
+
+    virtual size_t GetFieldCount() const;
+    // The unquoted bytes of a field, valid until the next call of NextRecord()
+    const char* GetFieldData(size_t field) const;
+    size_t GetFieldLength(size_t field) const;
+    virtual wxString GetField(size_t field) const;
+
+private:
+    wxConvAuto encoding_;
+    char delimiter_;
+    bool special_[256];
+    bool skipLF_;
+    std::string record_;
+    std::vector<std::pair<size_t, size_t>> fields_; // offset and length in record_
+};
+
+inline size_t mmCSVReader::GetFieldCount() const { return fields_.size(); }
+inline const char* mmCSVReader::GetFieldData(size_t field) const { return record_.data() + fields_[field].first; }
+inline size_t mmCSVReader::GetFieldLength(size_t field) const { return fields_[field].second; }
+
+// Streaming reader of the rows of the first worksheet of an Excel XML
+// Spreadsheet 2003 file. The encoding is the one of the XML declaration,
+// UTF-8 when there is none.
+class mmXMLSheetReader : public mmRecordReader
+{
+public:
+    mmXMLSheetReader();
+
+    virtual bool Open(const wxString& fileName);
+    // Moves to the next row, false after the last one or when the file is not a spreadsheet
+    virtual bool NextRecord();
+
+    virtual size_t GetFieldCount() const { return fields_.size(); }
+    virtual wxString GetField(size_t field) const;
+
+private:
+    enum Token { TOKEN_EOF, TOKEN_START, TOKEN_END, TOKEN_TEXT };
+    Token NextToken();
+    int Get();
+    bool ReadUntil(const char* end, std::string* out);
+    bool FindStart(const char* name, const char* parent);
+    bool ReadRow();
+    bool Attribute(const char* name, std::string& value) const;
+    void SetEncoding(const std::string& declaration);
+    wxString Convert(const std::string& bytes) const;
+    static bool IsName(const std::string& name, const char* local);
+
+    enum { MAX_COLUMNS = 16384 };
+    std::unique_ptr<wxMBConv> encoding_; // nullptr for UTF-8
+    enum { STATE_START, STATE_TABLE, STATE_DONE } state_;
+
+    // the last token
+    std::string name_;
+    std::string attributes_;
+    std::string text_;
+    bool empty_element_;
+
+    std::vector<std::string> fields_; // bytes in the file encoding, entities not replaced yet
+};
+
+// A base class for a parser that reads the file through a streaming reader,
+// or in to a string table in memory for the files the reader can not read.
 class TableBasedFile : public ITransactionsFile
 {
 public:
-    TableBasedFile(wxWindow *pParentWindow) : pParentWindow_(pParentWindow) {}
+    TableBasedFile(wxWindow *pParentWindow) : pParentWindow_(pParentWindow), nextLine_(0), itemsInLine_(0), pending_(false) {}
     virtual ~TableBasedFile()
     {
         for (auto line : itemsTable_)
             line.clear();
         itemsTable_.clear();
     }
-    virtual unsigned int GetLinesCount() const
-    {
-        return itemsTable_.size();
-    }
-    virtual unsigned int GetItemsCount(unsigned int line) const
-    {
-        if (line >= GetLinesCount())
-            return 0;
-        return itemsTable_[line].size();
-    }
-    virtual wxString GetItem(unsigned int line, unsigned int itemInLine) const
-    {
-        if (line >= GetLinesCount() || itemInLine >= itemsTable_[line].size())
-            return wxEmptyString;
-        return itemsTable_[line][itemInLine].value;
-    }
+    virtual bool NextLine();
+    virtual unsigned int GetItemsCount() const;
+    virtual wxString GetItem(unsigned int itemInLine) const;
     virtual void AddNewLine()
     {
         itemsTable_.push_back(std::vector<ValueAndType>());
@@ -114,6 +206,13 @@ protected:
     };
     typedef std::vector<ValueAndType> RowItemsT;
     std::vector<RowItemsT> itemsTable_;
+    size_t nextLine_; // the current line is the one before it
+
+    // Starts reading through the reader, false when it can not read the file
+    bool OpenReader(mmRecordReader* reader, const wxString& fileName, unsigned int itemsInLine);
+    std::unique_ptr<mmRecordReader> reader_; // nullptr when the lines are in itemsTable_
+    unsigned int itemsInLine_;
+    bool pending_; // the first record was read by OpenReader()
 };
 
 // CSV parser
@@ -121,9 +220,11 @@ class FileCSV : public TableBasedFile
 {
 public:
     FileCSV(wxWindow *pParentWindow, wxConvAuto encoding, wxString delimiter);
-    virtual bool Load(const wxString& fileName, unsigned int itemsInLine);
+    virtual bool Open(const wxString& fileName, unsigned int itemsInLine);
     virtual bool Save(const wxString& fileName);
 protected:
+    // Line based parser for the files mmCSVReader can not read, loads them in to itemsTable_
+    bool LoadText(const wxString& fileName, unsigned int itemsInLine);
     wxConvAuto encoding_;
     wxString delimiter_;
 };
@@ -133,9 +234,11 @@ class FileXML : public TableBasedFile
 {
 public:
     FileXML(wxWindow *pParentWindow, wxString encoding);
-    virtual bool Load(const wxString& fileName, unsigned int itemsInLine);
+    virtual bool Open(const wxString& fileName, unsigned int itemsInLine);
     virtual bool Save(const wxString& fileName);
 protected:
+    // DOM based parser for the files mmXMLSheetReader can not read, loads them in to itemsTable_
+    bool LoadDocument(const wxString& fileName, unsigned int itemsInLine);
     wxString encoding_;
 };
 
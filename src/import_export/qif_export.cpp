@@ -21,13 +21,17 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "util.h"
 #include "paths.h"
 #include "export.h"
+#include "columnar.h"
 #include "mmSimpleDialogs.h"
 #include "option.h"
+#include "phasetimer.h"
 #include "model/Model_Infotable.h"
 #include "model/Model_Account.h"
 #include "model/Model_Category.h"
 #include "model/Model_Attachment.h"
 #include "model/Model_CustomFieldData.h"
+#include <memory>
+#include <wx/stopwatch.h>
 
 wxIMPLEMENT_DYNAMIC_CLASS(mmQIFExportDialog, wxDialog);
 
@@ -49,6 +53,7 @@ mmQIFExportDialog::mmQIFExportDialog(wxWindow *parent, int type, int64 account_i
     case (QIF): type_name = _("Export as QIF file"); break;
     case (JSON): type_name = _("Export as JSON file"); break;
     case (CSV): type_name = _("Export as CSV file"); break;
+    case (COLUMNAR): type_name = _("Export as columnar file"); break;
     }
     Create(parent, type_name);
 
@@ -136,6 +141,7 @@ void mmQIFExportDialog::CreateControls()
     typeCheckBox->AppendString(_("CSV"));
     typeCheckBox->AppendString(_("JSON"));
     typeCheckBox->AppendString(_("QIF"));
+    typeCheckBox->AppendString(_("Columnar"));
     typeCheckBox->SetSelection(m_type);
     typeCheckBox->SetMinSize(min_size);
     flex_sizer->Add(type, g_flagsH);
@@ -338,6 +344,14 @@ void mmQIFExportDialog::OnFileSearch(wxCommandEvent& WXUNUSED(event))
         if (!fileName.IsEmpty())
             correctEmptyFileExt("csv", fileName);
         break;
+    case COLUMNAR:
+        fileName = wxFileSelector(_("Choose columnar data file to Export")
+            , wxEmptyString, fileName, wxEmptyString
+            , _("Columnar Files (*.mmcol)") + "|*.mmcol;*.MMCOL"
+            , wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+        if (!fileName.IsEmpty())
+            correctEmptyFileExt("mmcol", fileName);
+        break;
     }
 
     m_text_ctrl_->SetValue(fileName);
@@ -356,6 +370,8 @@ void mmQIFExportDialog::OnOk(wxCommandEvent& WXUNUSED(event))
         sErrorMsg =_("No Accounts selected for export");
     else if (dateToCheckBox_->IsChecked() && dateFromCheckBox_->IsChecked() && fromDateCtrl_->GetValue() > toDateCtrl_->GetValue())
         sErrorMsg =_("To Date less than From Date");
+    else if (m_type == COLUMNAR && !toFileCheckBox_->IsChecked())
+        sErrorMsg =_("A columnar file can only be written to a file");
     else
         bCorrect = true;
 
@@ -378,7 +394,7 @@ void mmQIFExportDialog::OnQuit(wxCloseEvent& WXUNUSED(event))
 void mmQIFExportDialog::OnChoiceType(wxCommandEvent& event)
 {
     m_type = event.GetInt();
-    if (m_type < CSV || m_type > QIF) m_type = QIF;
+    if (m_type < CSV || m_type > COLUMNAR) m_type = QIF;
 }
 
 void mmQIFExportDialog::OnCheckboxClick( wxCommandEvent& WXUNUSED(event) )
@@ -425,249 +441,114 @@ void mmQIFExportDialog::OnFileNameEntered(wxCommandEvent& event)
     this->GetEventHandler()->AddPendingEvent(evt);
 }
 
-void mmQIFExportDialog::mmExportQIF()
+// The export of the accounts and dates chosen in the dialog
+std::unique_ptr<mmTransactionsExport> mmQIFExportDialog::exporter(wxTextOutputStream* out) const
 {
-    bool write_to_file = toFileCheckBox_->IsChecked();
-    wxString fileName = m_text_ctrl_->GetValue();
-
-    bool exp_categ = cCategs_->IsChecked();
-    bool exp_transactions = (accountsCheckBox_->IsChecked() && selected_accounts_id_.size() > 0);
-
-    const wxString delimiter = Model_Infotable::instance().getString("DELIMITER", mmex::DEFDELIMTER);
-
-    wxString sErrorMsg;
-    size_t numRecords = 0, numCategories = 0;
-
     wxStringClientData* data_obj = static_cast<wxStringClientData*>(m_choiceDateFormat->GetClientObject(m_choiceDateFormat->GetSelection()));
     const wxString dateMask = data_obj->GetData();
+    const wxString delimiter = Model_Infotable::instance().getString("DELIMITER", mmex::DEFDELIMTER);
 
-    wxString buffer;
-    StringBuffer json_buffer;
-    PrettyWriter<StringBuffer> json_writer(json_buffer);
-    json_writer.StartObject();
-
-    //Export categories
-    if (m_type == QIF && exp_categ)
-    {
-        buffer << mmExportTransaction::getCategoriesQIF();
-        numCategories = Model_Category::instance().all().size();
-        sErrorMsg << _("Categories exported") << "\n";
-    }
-    else if (m_type == JSON)
-    {
-        if (exp_categ) {
-            mmExportTransaction::getCategoriesJSON(json_writer);
-            numCategories = Model_Category::instance().all().size();
-        }
-        else {
-            mmExportTransaction::getUsedCategoriesJSON(json_writer);
-        }
-        sErrorMsg << _("Categories exported") << "\n";
-    }
-
-    std::map<int64 /*account ID*/, wxString> allAccounts4Export;
-    wxArrayInt64 allPayees4Export;
-    const wxString RefType = Model_Attachment::REFTYPE_STR_TRANSACTION;
-    wxArrayInt64 allAttachments4Export;
-    wxArrayInt64 allCustomFields4Export;
-    wxArrayInt64 allTags4Export;
-    const auto transactions = Model_Checking::instance().find(
-        Model_Checking::STATUS(Model_Checking::STATUS_ID_VOID, NOT_EQUAL));
+    std::unique_ptr<mmTransactionsExport> exporter(new mmTransactionsExport(m_type
+        , selected_accounts_id_, dateMask, delimiter, out));
+    exporter->setDates(dateFromCheckBox_->IsChecked() ? fromDateCtrl_->GetValue() : wxInvalidDateTime
+        , dateToCheckBox_->IsChecked() ? toDateCtrl_->GetValue() : wxInvalidDateTime);
+    return exporter;
+}
 
-    if (exp_transactions && !transactions.empty())
+void mmQIFExportDialog::mmExportColumnar()
+{
+    const wxString fileName = m_text_ctrl_->GetValue();
+    mmColumnarExport columnar;
+    wxProgressDialog progressDlg(_("Please wait"), _("Exporting")
+        , 100, this, wxPD_APP_MODAL | wxPD_CAN_ABORT);
+    wxStopWatch sw;
+    long last_pulse = 0;
+
+    if (accountsCheckBox_->IsChecked() && !selected_accounts_id_.empty())
     {
-        json_writer.Key("transactions");
-        json_writer.StartArray();
-
-        /* Array to store QIF tarts for selected accounts */
-        std::map<int64 /*account ID*/, wxString> extraTransfers;
-
-        wxProgressDialog progressDlg(_("Please wait"), _("Exporting")
-            , 100, this, wxPD_APP_MODAL | wxPD_CAN_ABORT);
-
         const auto splits = Model_Splittransaction::instance().get_all();
         const auto tags = Model_Taglink::instance().get_all(Model_Attachment::REFTYPE_STR_TRANSACTION);
+        const Model_Checking::Split_Data_Set no_splits;
+        const Model_Checking::Taglink_Data_Set no_tags;
 
-        const wxString begin_date = fromDateCtrl_->GetValue().FormatISODate();
-        const wxString end_date = toDateCtrl_->GetValue().FormatISODate();
-
-        for (const auto& transaction : transactions)
+        auto transactions = exporter(nullptr)->selected(false);
+        Model_Checking::Data transaction;
+        while (transactions->next(transaction))
         {
-            if (!transaction.DELETEDTIME.IsEmpty()) continue;
-            wxString strDate = Model_Checking::TRANSDATE(transaction).FormatISODate();
-            //Filtering
-            if (dateFromCheckBox_->IsChecked() && strDate < begin_date)
-                continue;
-            if (dateToCheckBox_->IsChecked() && strDate > end_date)
-                continue;
-            if (!Model_Checking::is_transfer(transaction.TRANSCODE)
-                && (std::find(selected_accounts_id_.begin(), selected_accounts_id_.end(), transaction.ACCOUNTID) == selected_accounts_id_.end()))
-                continue;
-            if (Model_Checking::is_transfer(transaction.TRANSCODE)
-                && (std::find(selected_accounts_id_.begin(), selected_accounts_id_.end(), transaction.ACCOUNTID) == selected_accounts_id_.end())
-                && (std::find(selected_accounts_id_.begin(), selected_accounts_id_.end(), transaction.TOACCOUNTID) == selected_accounts_id_.end()))
-                continue;
-            //
-
-            // if Cancel clicked
-            if (!progressDlg.Pulse(wxString::Format(_("Exporting transaction %zu"), ++numRecords)))
-                break; // abort processing
-
-            bool is_reverce = false;
-            wxString trx_str;
-            Model_Checking::Full_Data full_tran(transaction, splits, tags);
-            int64 account_id = transaction.ACCOUNTID;
-
-            switch (m_type)
+            if (sw.Time() - last_pulse >= PROGRESS_INTERVAL)
             {
-            case JSON:
-                mmExportTransaction::getTransactionJSON(json_writer, full_tran);
-                allAccounts4Export[account_id] = "";
-                if (std::find(allPayees4Export.begin(), allPayees4Export.begin(), full_tran.PAYEEID) == allPayees4Export.end()
-                    && full_tran.TRANSCODE != Model_Checking::TYPE_STR_TRANSFER) {
-                    allPayees4Export.push_back(full_tran.PAYEEID);
-                }
-
-                if (!Model_Attachment::instance().FilterAttachments(RefType, full_tran.id()).empty()
-                    && std::find(allAttachments4Export.begin(), allAttachments4Export.end(), full_tran.TRANSID) == allAttachments4Export.end()) {
-                    allAttachments4Export.push_back(full_tran.TRANSID);
-                }
-
-                for (const auto & entry : Model_CustomFieldData::instance().find(Model_CustomFieldData::REFID(full_tran.id())))
-                {
-                    if (std::find(allCustomFields4Export.begin(), allCustomFields4Export.end(), entry.FIELDATADID) == allCustomFields4Export.end()) {
-                        allCustomFields4Export.push_back(entry.FIELDATADID);
-                    }
-                }
-
-                // store tags from the transaction
-                for (const auto& tag : full_tran.m_tags)
-                {
-                    if (std::find(allTags4Export.begin(), allTags4Export.end(), tag.TAGID) == allTags4Export.end())
-                        allTags4Export.push_back(tag.TAGID);
-                }
-                // store tags from the splits
-                for (const auto& split : full_tran.m_splits)
-                {
-                    for (const auto& taglink : Model_Taglink::instance().get(Model_Attachment::REFTYPE_STR_TRANSACTIONSPLIT, split.SPLITTRANSID))
-                    {
-                        if (std::find(allTags4Export.begin(), allTags4Export.end(), taglink.second) == allTags4Export.end())
-                            allTags4Export.push_back(taglink.second);
-                    }
-                }
-
-                break;
-
-            case QIF:
-
-                if (Model_Checking::is_transfer(transaction.TRANSCODE))
-                {
-                    if (std::find(selected_accounts_id_.begin(), selected_accounts_id_.end(), transaction.ACCOUNTID) == selected_accounts_id_.end()) {
-                        is_reverce = true;
-                        account_id = transaction.TOACCOUNTID;
-                    }
-
-                    if (transaction.TRANSAMOUNT != transaction.TOTRANSAMOUNT) {
-                        const auto trx2_str = mmExportTransaction::getTransactionQIF(full_tran, dateMask, !is_reverce);
-                        extraTransfers[is_reverce ? transaction.ACCOUNTID : transaction.TOACCOUNTID] += trx2_str;
-                    }
-                }
-
-                trx_str = mmExportTransaction::getTransactionQIF(full_tran, dateMask, is_reverce);
-                allAccounts4Export[account_id] += trx_str;
-                break;
-
-            case CSV:
-
-                if (Model_Checking::is_transfer(transaction.TRANSCODE))
-                {
-                    if (std::find(selected_accounts_id_.begin(), selected_accounts_id_.end(), transaction.ACCOUNTID) == selected_accounts_id_.end()) {
-                        is_reverce = true;
-                        account_id = transaction.TOACCOUNTID;
-                    }
-                    const auto trx2_str = mmExportTransaction::getTransactionCSV(full_tran, dateMask, !is_reverce);
-                    extraTransfers[is_reverce ? transaction.ACCOUNTID : transaction.TOACCOUNTID] += trx2_str;
-                }
-
-                trx_str = mmExportTransaction::getTransactionCSV(full_tran, dateMask, is_reverce);
-                allAccounts4Export[account_id] += trx_str;
-                break;
+                last_pulse = sw.Time();
+                if (!progressDlg.Pulse(wxString::Format(_("Exporting transaction %zu"), columnar.rows())))
+                    return;
             }
+            const auto s = splits.find(transaction.TRANSID);
+            const auto t = tags.find(transaction.TRANSID);
+            columnar.add(transaction
+                , s != splits.end() ? s->second : no_splits
+                , t != tags.end() ? t->second : no_tags);
         }
-        json_writer.EndArray();
+    }
 
-        switch (m_type)
-        {
-        case QIF:
-            //Export accounts
-            for (const auto &entry : allAccounts4Export) {
-                buffer << mmExportTransaction::getAccountHeaderQIF(entry.first);
-                buffer << entry.second;
-            }
+    if (!columnar.save(fileName))
+        return mmErrorDialogs::InvalidFile(m_text_ctrl_);
+    m_text_ctrl_->Clear();
 
-            //Append extra transters
-            for (const auto &entry : extraTransfers) {
-                buffer << mmExportTransaction::getAccountHeaderQIF(entry.first);
-                buffer << entry.second;
-            }
-            break;
-
-        case JSON:
-            mmExportTransaction::getAccountsJSON(json_writer, allAccounts4Export);
-            mmExportTransaction::getPayeesJSON(json_writer, allPayees4Export);
-            mmExportTransaction::getAttachmentsJSON(json_writer, allAttachments4Export);
-            mmExportTransaction::getCustomFieldsJSON(json_writer, allCustomFields4Export);
-            mmExportTransaction::getTagsJSON(json_writer, allTags4Export);
-            break;
-
-        case CSV:
-            buffer
-                << _("ID") << delimiter
-                << _("Date") << delimiter
-                << _("Status") << delimiter
-                << _("Type") << delimiter
-                << _("Account") << delimiter
-                << _("Payee") << delimiter
-                << _("Category") << delimiter
-                << _("Amount") << delimiter
-                << _("Currency") << delimiter
-                << _("Number") << delimiter
-                << _("Notes")
-                << "\n";
-
-            //Export accounts
-            for (const auto &entry : allAccounts4Export) {
-                buffer << entry.second;
-            }
+    wxMessageDialog msgDlg(this
+        , wxString::Format(_("Number of transactions exported: %zu \n"), columnar.rows())
+        , _("Export as columnar file"), wxOK | wxICON_INFORMATION);
+    msgDlg.ShowModal();
+}
 
-            //Append extra transters
-            for (const auto &entry : extraTransfers) {
-                buffer << entry.second;
-            }
-            break;
-        }
-    }
-    json_writer.EndObject();
+void mmQIFExportDialog::mmExportQIF()
+{
+    if (m_type == COLUMNAR)
+        return mmExportColumnar();
 
-    switch (m_type)
+    bool write_to_file = toFileCheckBox_->IsChecked();
+    wxString fileName = m_text_ctrl_->GetValue();
+
+    bool exp_categ = cCategs_->IsChecked();
+    bool exp_transactions = accountsCheckBox_->IsChecked();
+
+    // The output goes to the file in pieces as it is produced,
+    // so the whole export is never held in memory
+    std::unique_ptr<wxFileOutputStream> output;
+    std::unique_ptr<wxTextOutputStream> text;
+    if (write_to_file)
     {
-    case JSON:
-        buffer << wxString::FromUTF8(json_buffer.GetString()); break;
-    case QIF:
-        break;
+        output.reset(new wxFileOutputStream(fileName));
+        text.reset(new wxTextOutputStream(*output));
     }
 
+    std::unique_ptr<mmTransactionsExport> exporter = this->exporter(text.get());
+    wxProgressDialog progressDlg(_("Please wait"), _("Exporting")
+        , 100, this, wxPD_APP_MODAL | wxPD_CAN_ABORT);
+    wxStopWatch sw;
+    long last_pulse = 0;
+    // Repainting the dialog costs more than formatting a transaction, do it a few times per second
+    exporter->setProgress([&](size_t rows)
+    {
+        if (sw.Time() - last_pulse < PROGRESS_INTERVAL)
+            return true;
+        last_pulse = sw.Time();
+        // if Cancel clicked
+        return progressDlg.Pulse(wxString::Format(_("Exporting transaction %zu"), rows));
+    });
+
+    mmPhaseTimer timer("Export");
+    exporter->write(exp_categ, exp_transactions, timer);
+    const size_t numRecords = exporter->transactions();
+    const size_t numCategories = exporter->categories();
+
     if (write_to_file)
     {
-        wxFileOutputStream output(fileName);
-        wxTextOutputStream text(output);
-        text << buffer;
-        output.Close();
-        if (numCategories || numRecords || allAccounts4Export.size())
+        output->Close();
+        wxLogDebug("%s", timer.summary());
+        if (numCategories || numRecords || exporter->accounts())
             m_text_ctrl_->Clear();
     }
     else {
-        *log_field_ << buffer;
+        *log_field_ << exporter->text();
     }
 
     wxString msg = "";
@@ -675,7 +556,7 @@ void mmQIFExportDialog::mmExportQIF()
         msg += wxString::Format(_("Number of categories exported: %zu \n"), numCategories);
     }
     msg += wxString::Format(_("Number of transactions exported: %zu \n"), numRecords);
-    msg += wxString::Format(_("Number of accounts exported: %zu"), allAccounts4Export.size());
+    msg += wxString::Format(_("Number of accounts exported: %zu"), exporter->accounts());
 
     wxMessageDialog msgDlg(this, msg, _("Export as QIF file"), wxOK | wxICON_INFORMATION);
 
@@ -20,6 +20,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define QIF_EXPORT_H
 
 #include "defs.h"
+#include <memory>
+#include "export.h"
+#include "model/Model_Checking.h"
 
 class mmDatePickerCtrl;
 typedef wxLongLong int64;
@@ -31,7 +34,7 @@ class mmQIFExportDialog : public wxDialog
     wxDECLARE_EVENT_TABLE();
 
 public:
-    enum type { CSV = 0, JSON, QIF };
+    enum type { CSV = 0, JSON, QIF, COLUMNAR };
     mmQIFExportDialog() {}
     //virtual ~mmQIFExportDialog() {}
 
@@ -48,7 +51,13 @@ private:
 
     int m_type = type::CSV;
     int64 m_account_id = -1;
+    enum
+    {
+        PROGRESS_INTERVAL = 100     // ms
+    };
     void mmExportQIF();
+    void mmExportColumnar();
+    std::unique_ptr<mmTransactionsExport> exporter(wxTextOutputStream* out) const;
     void OnAccountsButton(wxCommandEvent& WXUNUSED(event));
     void OnCheckboxClick(wxCommandEvent& WXUNUSED(event));
     void OnChoiceType(wxCommandEvent& event);
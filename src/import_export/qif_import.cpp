@@ -17,7 +17,23 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 ********************************************************/
 
 #include "qif_import.h"
+#include "export.h"
+#include "payeematcher.h"
+#include "phasetimer.h"
+#include "util.h"
+#include "model/Model_Account.h"
+#include "model/Model_Attachment.h"
+#include "model/Model_Category.h"
+#include "model/Model_Currency.h"
+#include "model/Model_Infotable.h"
+#include "model/Model_Payee.h"
+#include "model/Model_Tag.h"
+#include <deque>
 #include <vector>
+#include <wx/regex.h>
+#include <wx/tokenzr.h>
+#include <wx/txtstrm.h>
+#include <wx/wfstream.h>
 
 bool mmQIFImport::isLineOK(const wxString& line)
 {
@@ -196,3 +212,842 @@ bool mmQIFImport::handle_qif_line(const QIF_Line& qif_line, QIF_Transaction& tra
     }
     return true;
 }
+
+size_t mmQIFImporter::scan(const wxString& file_name, const wxMBConv& conv, mmPhaseTimer& timer)
+{
+    size_t numLines = 0;
+    vQIF_trxs_.clear();
+    m_QIFaccounts.clear();
+    m_accountNameStr.clear();
+    m_QIFcategoryNames.clear();
+    m_QIFcategoryNames[_("Unknown")] = -1;
+    m_QIFpayeeNames.clear();
+    m_payee_names.clear();
+    m_payee_names.Add(_("Unknown"));
+    m_payee_index.clear();
+    m_payee_index[_("Unknown").Lower()] = 0;
+    m_dateMask.clear();
+    wxString catDelimiter = Model_Infotable::instance().getString("CATEG_DELIMITER", ":");
+
+    wxFileInputStream input(file_name);
+    wxTextInputStream text(input, "\x09", conv);
+
+    wxLongLong start = wxGetUTCTimeMillis();
+    wxLongLong last_pulse = 0;
+
+    wxString accName = "";
+    if (!m_fixedAccount.empty()) {
+        Model_Account::Data* acc = Model_Account::instance().get(m_fixedAccount);
+        if (acc) {
+            m_accountNameStr = acc->ACCOUNTNAME;
+        }
+    }
+
+    QIF_Entry trx;
+    int64 split_id = 0;
+    mmDates dParser;
+    std::map<wxString, int> comma({ {".", 0}, {",", 0} });
+    wxRegEx categDelimiterRegex(" ?: ?");
+    while (input.IsOk() && !input.Eof())
+    {
+        ++numLines;
+        timer.start("read");
+        const wxString lineStr = text.ReadLine();
+        timer.start("parse");
+        if (lineStr.IsEmpty())
+            continue;
+
+        if (numLines % 100 == 0)
+        {
+            const wxLongLong interval = wxGetUTCTimeMillis() - start;
+            // Repainting the progress costs more than reading the lines, do it a few times per second
+            if (interval - last_pulse >= 100)
+            {
+                last_pulse = interval;
+                if (!scanProgress(numLines, interval))
+                    break;
+            }
+        }
+        if (numLines <= 50)
+        {
+            log(wxString::Format(_("Line %zu \t %s\n"), numLines, lineStr).BeforeLast('\n'));
+            if (numLines == 50)
+                log("-------------------------------------- 8< --------------------------------------");
+        }
+
+        const qifLineType lineType = mmQIFImport::lineType(lineStr);
+        auto data = mmQIFImport::getLineData(lineStr);
+        if (lineType == EOTLT || input.Eof())
+        {
+            if (trx.has(AcctType))
+            {
+                if (trx[AcctType] == "Account") {
+                    accName = (!trx.has(TransNumber) ? "" : trx[TransNumber]);
+                    std::unordered_map <int, wxString> a;
+                    a[AccountType] = (trx.has(Description) ? trx.at(Description) : "");
+                    a[Description] = (trx.has(AccountType) ? trx.at(AccountType) : "");
+                    m_QIFaccounts[accName] = a;
+                    m_accountNameStr = accName;
+                }
+            }
+
+            if (trx[AcctType] != "Account" && completeTransaction(trx, m_accountNameStr)) {
+                vQIF_trxs_.push_back(std::move(trx));
+            }
+            trx.clear();
+            split_id = 0;
+            continue;
+        }
+
+        //Parse Categories
+        if (lineType == CategorySplit || lineType == Category)
+        {
+            if (data.empty())
+                data = _("Unknown");
+            categDelimiterRegex.Replace(&data, catDelimiter);
+            wxString catStr = data.BeforeFirst('/');
+            if (!catStr.IsEmpty())
+            {
+                if (catStr.Left(1) == "[" && catStr.Last() == ']')
+                    catStr = _("Transfer");
+                m_QIFcategoryNames[catStr] = -1;
+            }
+        }
+
+        //Parse date format
+        if (!m_userDefinedDateMask && lineType == Date && (data.Mid(0, 1) != "["))
+        {
+            dParser.doHandleStatistics(data);
+        }
+
+        //Parse numbers
+        if (lineType == Amount || lineType == AmountSplit)
+        {
+            comma["."] += data.Contains(".") ? data.find(".") + 1 : 0;
+            comma[","] += data.Contains(",") ? data.find(",") + 1 : 0;
+        }
+
+        if (lineType == CategorySplit)
+            split_id++;
+
+        if (lineType == AcctType)
+            trx[lineType] = data;
+        else
+        {
+            wxString prefix;
+            if (!trx[lineType].empty())
+                prefix = "\n";
+
+            if (lineType == MemoSplit)
+                data.Prepend(wxString::Format("%lld:", split_id));
+
+            trx[lineType] += prefix + data;
+        }
+
+    }
+
+    if (comma[","] > comma["."]) {
+        decimal_ = ",";
+    }
+    if (comma["."] > comma[","]) {
+        decimal_ = ".";
+    }
+
+    if (!m_userDefinedDateMask)
+    {
+        dParser.doFinalizeStatistics();
+        if (dParser.isDateFormatFound()) {
+            m_dateFormatStr = dParser.getDateFormat();
+            m_dateMask = dParser.getDateMask();
+        }
+    }
+
+    timer.stop();
+    timer.add_rows(vQIF_trxs_.size());
+    return numLines;
+}
+
+void mmQIFImporter::matchPayees(const mmPayeeMatcher* matcher)
+{
+    for (const auto& payee_name : m_payee_names)
+    {
+        // initialize
+        m_QIFpayeeNames[payee_name] = std::make_tuple(-1, "", "");
+        // perform pattern match
+        const mmPayeeMatcher::Rule* rule = matcher ? matcher->match(payee_name) : nullptr;
+        if (rule)
+        {
+            // save the target payee ID, name, and match details
+            m_QIFpayeeNames[payee_name] = std::make_tuple(rule->payee_id, rule->payee_name, rule->pattern);
+        }
+        else
+        {
+            Model_Payee::Data* payee = Model_Payee::instance().get(payee_name);
+            if (payee) {
+                m_QIFpayeeNames[payee_name] = std::make_tuple(payee->PAYEEID, payee->PAYEENAME, "");
+            }
+        }
+    }
+}
+
+size_t mmQIFImporter::import(mmPhaseTimer& timer)
+{
+    timer.start("resolve");
+    m_QIFtagIDs.clear();
+    m_splitDataSets.clear();
+    m_splitTaglinks.clear();
+    m_txnTaglinks.clear();
+    const int nTransactions = static_cast<int>(vQIF_trxs_.size());
+    importProgress(1, _("Importing Accounts"));
+    getOrCreateAccounts();
+    importProgress(1, _("Importing Payees"));
+    getOrCreatePayees();
+    importProgress(1, _("Importing Categories"));
+    getOrCreateCategories();
+
+    Model_Checking::Cache trx_data_set;
+    Model_Checking::Cache transfer_to_data_set;
+    Model_Checking::Cache transfer_from_data_set;
+    int count = 0;
+    const wxString& transferStr = Model_Checking::TYPE_STR_TRANSFER;
+
+    timer.start("convert");
+    for (const auto& entry : vQIF_trxs_)
+    {
+        if (count % 100 == 0 || count == nTransactions)
+        {
+            if (!importProgress(count
+                , wxString::Format(_("Importing transaction %1$i of %2$i"), count, nTransactions))) // if cancel clicked
+                break; // abort processing
+        }
+        //
+        Model_Checking::Data *trx = Model_Checking::instance().create();
+        wxString msg;
+        if (completeTransaction(entry, trx, msg))
+        {
+            wxString strDate = Model_Checking::TRANSDATE(trx).FormatISODate();
+            if (!m_fromDate.empty() && strDate < m_fromDate)
+                continue;
+            if (!m_toDate.empty() && strDate > m_toDate)
+                continue;
+
+            Model_Account::Data* account = Model_Account::instance().get(trx->ACCOUNTID);
+            Model_Account::Data* toAccount = Model_Account::instance().get(trx->TOACCOUNTID);
+
+            if ((trx->TRANSDATE < account->STATEMENTDATE && account->STATEMENTLOCKED.GetValue()) ||
+                (toAccount && (trx->TRANSDATE < toAccount->STATEMENTDATE && toAccount->STATEMENTLOCKED.GetValue())))
+                continue;
+
+            if (trx->TRANSDATE < account->INITIALDATE) {
+                account->INITIALDATE = trx->TRANSDATE;
+            }
+            if (toAccount && (trx->TRANSDATE < toAccount->INITIALDATE)) {
+                toAccount->INITIALDATE = trx->TRANSDATE;
+            }
+
+            // Save Transaction Tags
+            wxString tagStr = (entry.has(Category) ? entry.at(Category).AfterFirst('/') : "");
+            // Just cache the new taglinks since we don't know the TRANSID yet
+            Model_Taglink::Cache taglinks = createTaglinks(tagStr, Model_Attachment::REFTYPE_STR_TRANSACTION);
+
+            // transactions are split into three groups, then merged
+            // since txnIds are not yet created, we need to keep track of what tags go with each cached transaction.
+            if (trx->TRANSCODE == transferStr && trx->TOTRANSAMOUNT > 0.0)
+            {
+                // The "From" tags are stored with key <2, index of from transaction>
+                m_txnTaglinks[std::make_pair(2, transfer_from_data_set.size())] = taglinks;
+                transfer_from_data_set.push_back(trx);
+            }
+            else if (trx->TRANSCODE == transferStr && trx->TOTRANSAMOUNT <= 0.0)
+            {
+                // The "To" tags are stored with key <1, index of 'to' transaction>
+                m_txnTaglinks[std::make_pair(1, transfer_to_data_set.size())] = taglinks;
+                transfer_to_data_set.push_back(trx);
+            }
+            else
+            {
+                // The non-transfer tags are stored with key <0, index of transaction>
+                m_txnTaglinks[std::make_pair(0, trx_data_set.size())] = taglinks;
+                trx_data_set.push_back(trx);
+            }
+        }
+        else
+        {
+            log(wxString::Format(_("Error: %s"), msg));
+
+            wxString t = "";
+            for (const auto&i : entry)
+                t << i.second << "|";
+            t.RemoveLast(1);
+            log(wxString::Format("( %s )", t));
+        }
+        ++count;
+    }
+
+    importProgress(count, _("Importing Transfers"));
+    mergeTransferPair(transfer_to_data_set, transfer_from_data_set);
+    appendTransfers(trx_data_set, transfer_to_data_set);
+
+    //Search for duplicates, each existing transaction is matched by one imported only
+    mmDuplicateIndex duplicates;
+    for (auto &trx : trx_data_set)
+    {
+        if (duplicates.take(*trx))
+            trx->STATUS = Model_Checking::STATUS_KEY_DUPLICATE;
+    }
+    // At this point all transactions and tags have been merged into single sets.
+    // All of them are written in one savepoint, so SQLite syncs the file only once.
+    timer.start("insert");
+    Model_Checking::instance().Savepoint("QIF_IMPORT");
+    const int nTrxToSave = static_cast<int>(trx_data_set.size());
+    for (int i = 0; i < nTrxToSave; i++)
+    {
+        if (i % SAVE_BATCH_SIZE == 0)
+            importProgress(std::min(i, nTransactions)
+                , wxString::Format(_("Saving transaction %1$i of %2$i"), i, nTrxToSave));
+
+        // we need to know the transid for the taglink, so save the transaction first
+        int64 transid = Model_Checking::instance().save(trx_data_set[i]);
+        const auto taglinks = m_txnTaglinks.find(std::make_pair(0, i));
+        if (taglinks != m_txnTaglinks.end() && !taglinks->second.empty())
+        {
+            // apply that transid to all associated tags
+            for (const auto& taglink : taglinks->second)
+                taglink->REFID = transid;
+            // save the block of taglinks
+            Model_Taglink::instance().save(taglinks->second);
+        }
+    }
+    importProgress(count, _("Importing Split transactions"));
+    joinSplit(trx_data_set, m_splitDataSets);
+    saveSplit();
+    Model_Checking::instance().ReleaseSavepoint("QIF_IMPORT");
+    timer.stop();
+    timer.add_rows(trx_data_set.size());
+    return trx_data_set.size();
+}
+
+bool mmQIFImporter::completeTransaction(QIF_Entry& trx, const wxString& accName)
+{
+    if (!trx.has(Date))
+        return false;
+
+    bool isTransfer = false;
+
+    if (accName.empty()) {
+        trx[AccountName] = m_accountNameStr;
+    }
+    else {
+        trx[AccountName] = accName;
+    }
+
+
+    if (trx.has(CategorySplit))
+    {
+        //TODO:Dublicate code
+        wxStringTokenizer token(trx[CategorySplit], "\n");
+        while (token.HasMoreTokens())
+        {
+            wxString c = token.GetNextToken();
+            const wxString project = mmQIFImport::getFinancistoProject(c);
+            if (!project.empty())
+                trx[TransNumber] += project + "\n"; //TODO: trx number or notes
+        }
+    }
+
+    if (trx[Payee] == "Opening Balance") {
+        trx[Memo] += (trx[Memo].empty() ? "" : "\n") + trx[Payee];
+        trx[Category] = trx[Payee];
+    }
+
+    if (trx.has(Category))
+    {
+        wxString tags;
+        wxString categname = trx[Category].BeforeFirst('/', &tags);
+        if (categname.Left(1) == "[" && categname.Last() == ']')
+        {
+            wxString toAccName = categname.SubString(1, categname.length() - 2);
+
+            if (toAccName == m_accountNameStr)
+            {
+                trx[Category] = trx[Payee];
+                trx[Payee] = toAccName;
+            }
+            else
+            {
+                isTransfer = true;
+                trx[Category] = _("Transfer") + (!tags.IsEmpty() ? "/" + tags : "");
+                trx[TrxType] = Model_Checking::TYPE_STR_TRANSFER;
+                trx[ToAccountName] = toAccName;
+                trx[Memo] += (trx[Memo].empty() ? "" : "\n") + trx[Payee];
+                if (m_QIFaccounts.find(toAccName) == m_QIFaccounts.end())
+                {
+                    std::unordered_map<int, wxString> a;
+                    a[Description] = "[" + Model_Currency::GetBaseCurrency()->CURRENCY_SYMBOL + "]";
+                    a[AccountType] = (trx.has(Description) ? trx.at(Description) : "");
+                    m_QIFaccounts[toAccName] = a;
+                }
+            }
+        }
+    }
+
+    if (!isTransfer)
+    {
+        wxString payee_name = trx.has(Payee) ? trx[Payee] : "";
+        if (payee_name.empty() && trx[AcctType] != "Account" )
+        {
+            payee_name = trx.has(AccountName) ? trx[AccountName] : _("Unknown");
+            trx[Payee] = payee_name;
+        }
+
+        if (!payee_name.empty())
+        {
+            const auto it = m_payee_index.find(payee_name.Lower());
+            if (it == m_payee_index.end())
+            {
+                m_payee_index[payee_name.Lower()] = m_payee_names.size();
+                m_payee_names.Add(payee_name);
+            }
+            else
+                trx[Payee] = m_payee_names.Item(it->second);
+
+            if (payee_name == "Opening Balance")
+                m_QIFcategoryNames["Opening Balance"] = -1;
+
+        }
+    }
+
+    if (payeeIsNotes_) {
+        trx[Memo] += (trx[Memo].empty() ? "" : "\n") + trx[Payee];
+    }
+
+    wxString amtStr = (!trx.has(Amount) ? "" : trx[Amount]);
+    if (!isTransfer) {
+        if (amtStr.Mid(0, 1) == "-")
+            trx[TrxType] = Model_Checking::TYPE_STR_WITHDRAWAL;
+        else if (!amtStr.empty())
+            trx[TrxType] = Model_Checking::TYPE_STR_DEPOSIT;
+    }
+
+    return !amtStr.empty();
+}
+
+void mmQIFImporter::saveSplit()
+{
+    if (m_splitDataSets.empty()) return;
+
+    Model_Splittransaction::instance().Savepoint();
+    Model_Taglink::instance().Savepoint();
+    // Work through each group of splits 
+    for (int i = 0; i < static_cast<int>(m_splitDataSets.size()); i++)
+    {
+        // and each split in the group
+        for (int j = 0; j < static_cast<int>(m_splitDataSets[i].size()); j++)
+        {
+            // save the split
+            int64 splitTransID = Model_Splittransaction::instance().save(m_splitDataSets[i][j]);
+            // check if there are any taglinks for this split index in this group
+            if (!m_splitTaglinks[i][j].empty())
+            {
+                // apply the SPLITTRANSID as the REFID for all the cached taglinks
+                for (const auto& taglink : m_splitTaglinks[i][j])
+                    taglink->REFID = splitTransID;
+                // save cached taglinks
+                Model_Taglink::instance().save(m_splitTaglinks[i][j]);
+            }
+        }
+    }
+    Model_Splittransaction::instance().ReleaseSavepoint();
+    Model_Taglink::instance().ReleaseSavepoint();
+}
+Model_Taglink::Cache mmQIFImporter::createTaglinks(const wxString& tagStr, const wxString& reftype)
+{
+    Model_Taglink::Cache taglinks;
+    wxStringTokenizer tagTokens = wxStringTokenizer(tagStr, ":");
+    while (tagTokens.HasMoreTokens())
+    {
+        wxString tagname = tagTokens.GetNextToken().Trim(false).Trim();
+        // make tag names single-word
+        tagname.Replace(" ", "_");
+        auto tag_id = m_QIFtagIDs.find(tagname);
+        if (tag_id == m_QIFtagIDs.end())
+        {
+            Model_Tag::Data* tag = Model_Tag::instance().get(tagname);
+            if (!tag)
+            {
+                tag = Model_Tag::instance().create();
+                tag->TAGNAME = tagname;
+                tag->ACTIVE = 1;
+                tag->TAGID = Model_Tag::instance().save(tag);
+            }
+            tag_id = m_QIFtagIDs.insert(std::make_pair(tagname, tag->TAGID)).first;
+        }
+        Model_Taglink::Data* taglink = Model_Taglink::instance().create();
+        taglink->REFTYPE = reftype;
+        taglink->TAGID = tag_id->second;
+        taglinks.push_back(taglink);
+    }
+    return taglinks;
+}
+
+void mmQIFImporter::joinSplit(Model_Checking::Cache &destination
+    , std::vector<Model_Splittransaction::Cache> &target)
+{
+    if (target.empty()) // no splits in the file
+        return;
+
+    for (auto &item : destination)
+    {
+        if (item->CATEGID > 0) continue;
+        for (auto &split_item : target.at(-1 * item->CATEGID.GetValue()))
+            split_item->TRANSID = item->TRANSID;
+        item->CATEGID = -1;
+    }
+}
+
+void mmQIFImporter::appendTransfers(Model_Checking::Cache &destination, Model_Checking::Cache &target)
+{
+    // Here we are moving all the 'to' transfers into the normal transactions, so we also
+    // need to keep track of the new index for the taglinks
+    for (int i = 0; i < static_cast<int>(target.size()); i++)
+    {
+        m_txnTaglinks[std::make_pair(0, destination.size())] = m_txnTaglinks[std::make_pair(1, i)];
+        destination.push_back(target[i]);
+    }
+}
+
+bool mmQIFImporter::mergeTransferPair(Model_Checking::Cache& to, Model_Checking::Cache& from)
+{
+    if (to.empty() && from.empty()) return false; //Nothing to merge
+
+    // Index the 'from' transactions by the fields a pair has in common,
+    // each key keeps the indices in the file order
+    const auto pairKey = [](int64 account_id, int64 to_account_id, const Model_Checking::Data* t)
+    {
+        return wxString::Format("%lld\x1f%lld\x1f%s\x1f%s\x1f%s", account_id, to_account_id
+            , t->TRANSACTIONNUMBER, t->NOTES, t->TRANSDATE);
+    };
+    std::unordered_map<wxString, std::deque<int>> fromIndex;
+    for (int i = 0; i < static_cast<int>(from.size()); i++)
+        fromIndex[pairKey(from[i]->ACCOUNTID, from[i]->TOACCOUNTID, from[i])].push_back(i);
+
+    std::vector<bool> paired(from.size(), false);
+    for (auto& refTrxTo : to)
+    {
+        const auto it = fromIndex.find(pairKey(refTrxTo->TOACCOUNTID, refTrxTo->ACCOUNTID, refTrxTo));
+        if (it != fromIndex.end() && !it->second.empty())
+        {
+            const int i = it->second.front();
+            it->second.pop_front();
+            refTrxTo->TOTRANSAMOUNT = from[i]->TRANSAMOUNT;
+            // a match is found so drop the 'from' taglinks
+            paired[i] = true;
+            m_txnTaglinks.erase(std::make_pair(2, i));
+        }
+        else
+            refTrxTo->TOTRANSAMOUNT = refTrxTo->TRANSAMOUNT;
+    }
+
+    // now merge the unpaired 'from' transactions into the 'to' list
+    for (int i = 0; i < static_cast<int>(from.size()); i++)
+    {
+        if (paired[i]) continue;
+        std::swap(from[i]->ACCOUNTID, from[i]->TOACCOUNTID);
+        // also need to move the 'from' taglinks to the 'to' taglinks list, keeping track
+        // of the new transaction indices
+        m_txnTaglinks[std::make_pair(1, to.size())] = m_txnTaglinks[std::make_pair(2, i)];
+        to.push_back(from[i]);
+    }
+
+    return true;
+}
+
+bool mmQIFImporter::completeTransaction(/*in*/ const QIF_Entry& t
+    , /*out*/ Model_Checking::Data* trx, wxString& msg)
+{
+    trx->TRANSCODE = (t.has(TrxType) ? t.at(TrxType) : "");
+    if (trx->TRANSCODE.empty())
+    {
+        msg = _("Transaction code is missing");
+        return false;
+    }
+    bool transfer = Model_Checking::is_transfer(trx->TRANSCODE);
+
+    if (!transfer)
+    {
+        wxString payee_name = t.has(Payee) ? t.at(Payee) : "";
+        if (!payee_name.empty())
+        {
+            if (m_QIFpayeeNames.find(payee_name) != m_QIFpayeeNames.end()) {
+                trx->PAYEEID = std::get<0>(m_QIFpayeeNames[payee_name]);
+                // NOTES haven't been filled yet, so we can just direct assign match details if necessary
+                if (m_matchAddNotes && !std::get<2>(m_QIFpayeeNames[payee_name]).IsEmpty()) {
+                    trx->NOTES =  wxString::Format(_("%1$s matched by %2$s"), payee_name, std::get<2>(m_QIFpayeeNames[payee_name]));
+                }
+            } else trx->PAYEEID = -1;
+        }
+        else
+        {
+            trx->PAYEEID = -1;
+        }
+    }
+
+    if (trx->PAYEEID == -1 && !transfer)
+    {
+        msg = _("Transaction Payee is missing or incorrect");
+        return false;
+    }
+
+    wxString dateStr = (t.has(Date) ? t.at(Date) : "");
+    if (!m_dateFormatStr.Contains(" ")) dateStr.Replace(" ", "");
+    wxDateTime dtdt;
+    wxString::const_iterator end;
+    if (dtdt.ParseFormat(dateStr, m_dateFormatStr, &end))
+        trx->TRANSDATE = dtdt.FormatISOCombined();
+    else
+    {
+        log(_("Date format or date mask is incorrect"));
+        return false;
+    }
+
+    int64 accountID = -1;
+    wxString accountName = (t.has(AccountName) ? t.at(AccountName) : "");
+    if ((accountName.empty() || !m_fixedAccount.empty()) /*&& !transfer*/) {
+        accountName = m_accountNameStr;
+    }
+    accountID = (m_QIFaccountsID.find(accountName) != m_QIFaccountsID.end() ? m_QIFaccountsID.at(accountName) : -1);
+    if (accountID < 1)
+    {
+        msg = _("Transaction Account is incorrect");
+        return false;
+    }
+    trx->ACCOUNTID = accountID;
+    trx->TOACCOUNTID = (t.has(ToAccountName)
+        ? (m_QIFaccountsID.find(t.at(ToAccountName)) != m_QIFaccountsID.end()
+            ? m_QIFaccountsID[t.at(ToAccountName)] : -1) : -1);
+    if (trx->ACCOUNTID == trx->TOACCOUNTID && transfer)
+    {
+        msg = _("Transaction Account for transfer is incorrect");
+        return false;
+    }
+
+    trx->TRANSACTIONNUMBER = (t.has(TransNumber) ? t.at(TransNumber) : "");
+    trx->NOTES.Prepend(!trx->NOTES.IsEmpty() ? "\n" : "").Prepend(t.has(Memo) ? t.at(Memo) : ""); // add the actual NOTES before the payee match details
+    wxString status = Model_Checking::STATUS_KEY_NONE;
+    if (t.has(Status))
+    {
+        wxString s = t.at(Status);
+        if (s == "X" || s == "R")
+            status = Model_Checking::STATUS_KEY_RECONCILED;
+        /*else if (s == "*" || s == "c")
+        {
+            TODO: What does 'cleared' status mean?
+            status = "c";
+        }*/
+
+    }
+    trx->STATUS = status;
+
+    trx->COLOR = -1;
+    if (m_colorId > 0 && m_colorId < 8)
+        trx->COLOR = m_colorId;
+
+    const wxString value = mmTrimAmount(t.has(Amount) ? t.at(Amount) : "", decimal_, ".");
+    if (value.empty())
+    {
+        msg = _("Transaction Amount is incorrect");
+        return false;
+    }
+
+    double amt;
+    value.ToCDouble(&amt);
+
+    trx->TRANSAMOUNT = fabs(amt);
+    trx->TOTRANSAMOUNT = transfer ? amt : trx->TRANSAMOUNT;
+    wxString tagStr;
+    if (t.has(CategorySplit))
+    {
+        Model_Splittransaction::Cache split;       
+        wxStringTokenizer categToken(t.at(CategorySplit), "\n");
+        wxStringTokenizer amtToken((t.has(AmountSplit) ? t.at(AmountSplit) : ""), "\n");
+        wxString notes = t.has(MemoSplit) ? t.at(MemoSplit) : "";
+        int split_id = 1;
+
+        while (categToken.HasMoreTokens())
+        {
+            const wxString c = categToken.GetNextToken().BeforeFirst('/', &tagStr);
+            if (m_QIFcategoryNames.find(c) == m_QIFcategoryNames.end()) return false;
+            int64 categID = m_QIFcategoryNames[c];
+            if (categID <= 0)
+            {
+                msg = _("Transaction Category is incorrect");
+                return false;
+            }
+            Model_Splittransaction::Data* s = Model_Splittransaction::instance().create();
+            s->CATEGID = categID;
+
+            wxString amtSplit = amtToken.GetNextToken();
+            amtSplit = mmTrimAmount(amtSplit, decimal_, ".");
+            double amount;
+            amtSplit.ToCDouble(&amount);
+
+            wxString memo;
+            while (!notes.empty()) {
+                wxRegEx pattern(wxString::Format("^%d:(.*)", split_id), wxRE_NEWLINE);
+                if (pattern.Matches(notes))
+                {
+                    memo += (!memo.IsEmpty() ? "\n" : "" ) + pattern.GetMatch(notes, 1);
+                    pattern.ReplaceFirst(&notes, "");
+                    notes.Replace("\n", "", false);
+                }
+                else
+                    break;
+            }
+
+            s->SPLITTRANSAMOUNT = (Model_Checking::is_deposit(trx) ? amount : -amount);
+            s->TRANSID = trx->TRANSID;
+            s->NOTES = memo;
+            split.push_back(s);
+            // Save split tags
+            if (!tagStr.IsEmpty())
+            {
+                Model_Taglink::Cache splitTaglinks = createTaglinks(tagStr, Model_Attachment::REFTYPE_STR_TRANSACTIONSPLIT);
+                // Here we keep track of which block of splits and which split in the block
+                // each group of taglinks is associated with. Once we save the splits we can
+                // record the SPLITTRANSID on the taglink
+                m_splitTaglinks[m_splitDataSets.size()][split_id - 1] = splitTaglinks;
+            }
+            split_id++;
+        }
+        trx->CATEGID = -1 * static_cast<int>(m_splitDataSets.size());
+        m_splitDataSets.push_back(split);
+    }
+    else
+    {
+        wxString categStr = (t.has(Category) ? t.at(Category).BeforeFirst('/') : "");
+        if (categStr.empty())
+        {
+            Model_Payee::Data* payee = Model_Payee::instance().get(trx->PAYEEID);
+            if (payee)
+            {
+                trx->CATEGID = payee->CATEGID;
+            }
+            categStr = Model_Category::full_name(trx->CATEGID, ":");
+
+            if (categStr.empty())
+            {
+                trx->CATEGID = (m_QIFcategoryNames[_("Unknown")]);
+            }
+        }
+        else
+        {
+            trx->CATEGID = (m_QIFcategoryNames[categStr]);
+        }
+
+    }
+    return true;
+}
+
+int64 mmQIFImporter::getOrCreateAccounts()
+{
+    m_QIFaccountsID.clear();
+
+    for (auto &item : m_QIFaccounts)
+    {
+        int64 accountID = -1;
+        Model_Account::Data* acc = m_byAccountNumber
+            ? Model_Account::instance().getByAccNum(item.first)
+            : Model_Account::instance().get(item.first);
+
+        if (!acc)
+        {
+            Model_Account::Data *account = Model_Account::instance().create();
+
+            account->FAVORITEACCT = "TRUE";
+            account->STATUS = Model_Account::STATUS_STR_OPEN;
+
+            const auto type = item.second.find(AccountType) != item.second.end() ? item.second.at(AccountType) : "";
+            account->ACCOUNTTYPE = mmExportTransaction::mm_acc_type(type);
+            //Model_Account::TYPE_STR_CHECKING;
+            account->ACCOUNTNAME = item.first;
+            account->INITIALBAL = 0;
+            account->INITIALDATE = wxDate::Today().FormatISODate();
+
+            account->CURRENCYID = Model_Currency::GetBaseCurrency()->CURRENCYID;
+            const wxString c = (item.second.find(Description) == item.second.end() ? "" : item.second.at(Description));
+            for (const auto& curr : Model_Currency::instance().all())
+            {
+                if (wxString::Format("[%s]", curr.CURRENCY_SYMBOL) == c) {
+                    account->CURRENCYID = curr.CURRENCYID;
+                    break;
+                }
+            }
+
+            accountID = Model_Account::instance().save(account);
+            log(wxString::Format(_("Added account: %s"), item.first));
+        }
+        else
+            accountID = acc->ACCOUNTID;
+
+        m_QIFaccountsID[item.first] = accountID;
+    }
+
+    Model_Account::Data* acc = Model_Account::instance().get(m_accountNameStr);
+    if (acc) {
+        m_QIFaccountsID[m_accountNameStr] = acc->ACCOUNTID;
+    }
+
+    return m_QIFaccountsID.size();
+}
+
+void mmQIFImporter::getOrCreatePayees()
+{
+    Model_Payee::instance().Savepoint();
+    
+    for (const auto& item : m_payee_names)
+    {
+        // check if this payee exists
+        if (m_QIFpayeeNames.find(item) != m_QIFpayeeNames.end() && std::get<0>(m_QIFpayeeNames[item]) != -1) continue;
+
+        // the payee doesn't exist or match a pattern, so create one
+        Model_Payee::Data* p = Model_Payee::instance().create();
+        p->PAYEENAME = item;
+        p->ACTIVE = 1;
+        p->CATEGID = -1;
+        log(wxString::Format(_("Added payee: %s"), item));
+        m_QIFpayeeNames[item] = std::make_tuple(Model_Payee::instance().save(p), p->PAYEENAME, "");
+        
+    }
+
+    Model_Payee::instance().ReleaseSavepoint();
+}
+
+void mmQIFImporter::getOrCreateCategories()
+{
+    wxArrayString temp;
+    for (const auto &item : m_QIFcategoryNames)
+    {
+        wxString categStr;
+        wxStringTokenizer token(item.first, ":");
+        int64 parentID = -1;
+        while(token.HasMoreTokens()){
+            categStr = token.GetNextToken().Trim(false).Trim();
+            Model_Category::Data* c = Model_Category::instance().get(categStr, parentID);
+            if (temp.Index(categStr + wxString::Format(":%lld", parentID)) == wxNOT_FOUND) {
+
+                if (!c)
+                {
+                    c = Model_Category::instance().create();
+                    c->CATEGNAME = categStr;
+                    c->ACTIVE = 1;
+                    c->PARENTID = parentID;
+                    Model_Category::instance().save(c);
+                }
+                temp.Add(categStr + wxString::Format(":%lld", parentID));
+            }
+            parentID = c->CATEGID;
+
+        }
+        m_QIFcategoryNames[item.first] = parentID;
+    }
+}
@@ -20,8 +20,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define QIF_IMPORT_H
 
 #include "defs.h"
+#include "model/Model_Checking.h"
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
+class mmPayeeMatcher;
+class mmPhaseTimer;
+
 // http://en.wikipedia.org/wiki/QIF
 // http://linuxfinances.info/info/financeformats.html
 // https://metacpan.org/pod/Finance::QIF
@@ -135,4 +143,119 @@ public:
     bool handle_qif_record(const QIF_Record & qif_record, QIF_Transaction& tran);
     bool handle_qif_line(const QIF_Line& qif_line, QIF_Transaction& tran);
 };
+
+// The lines of a QIF paragraph by their type. A paragraph has only a few of
+// them, so they are kept in a small vector instead of a map.
+class QIF_Entry
+{
+public:
+    typedef std::vector<std::pair<int, wxString>> Fields;
+
+    bool has(int type) const { return find(type) != fields_.end(); }
+    // The value of a line that is present
+    const wxString& at(int type) const;
+    // The value of a line, added empty when missing
+    wxString& operator[](int type);
+
+    Fields::const_iterator begin() const { return fields_.begin(); }
+    Fields::const_iterator end() const { return fields_.end(); }
+    void clear() { fields_.clear(); }
+
+private:
+    Fields::const_iterator find(int type) const;
+    Fields fields_;
+};
+
+inline QIF_Entry::Fields::const_iterator QIF_Entry::find(int type) const
+{
+    return std::find_if(fields_.begin(), fields_.end()
+        , [type](const std::pair<int, wxString>& f) { return f.first == type; });
+}
+
+inline const wxString& QIF_Entry::at(int type) const
+{
+    static const wxString empty;
+    const auto it = find(type);
+    wxASSERT(it != fields_.end());
+    return it != fields_.end() ? it->second : empty;
+}
+
+inline wxString& QIF_Entry::operator[](int type)
+{
+    for (auto& f : fields_)
+        if (f.first == type) return f.second;
+    fields_.push_back(std::make_pair(type, wxString()));
+    return fields_.back().second;
+}
+
+/**
+* The QIF import without the dialog. scan() reads the paragraphs of a file and
+* collects the accounts, payees and categories they name, import() creates
+* the missing ones and saves the transactions. mmQIFImportDialog shows what
+* was scanned and sets the options in between; the log and the progress go to
+* the virtual functions, which do nothing here.
+*/
+class mmQIFImporter
+{
+public:
+    mmQIFImporter() {}
+    virtual ~mmQIFImporter() {}
+
+    /** Read the file, return the number of lines read */
+    size_t scan(const wxString& file_name, const wxMBConv& conv, mmPhaseTimer& timer);
+    /** Match the payee names of the file with the patterns of the payees or the payees of the same name */
+    void matchPayees(const mmPayeeMatcher* matcher);
+    /** Create the missing accounts, payees and categories and save the transactions, return how many were saved */
+    size_t import(mmPhaseTimer& timer);
+
+    size_t scanned() const { return vQIF_trxs_.size(); }
+
+protected:
+    virtual void log(const wxString& WXUNUSED(msg)) {}
+    /** Called a few times per second while scanning, false stops the scan */
+    virtual bool scanProgress(size_t WXUNUSED(lines), wxLongLong WXUNUSED(ms)) { return true; }
+    /** Called while importing with a value up to the number of scanned transactions, false stops the import */
+    virtual bool importProgress(int WXUNUSED(value), const wxString& WXUNUSED(msg)) { return true; }
+
+    int64 getOrCreateAccounts();
+    void getOrCreatePayees();
+    void getOrCreateCategories();
+    bool completeTransaction(QIF_Entry& trx, const wxString& accName);
+    bool completeTransaction(/*in*/ const QIF_Entry& t, /*out*/ Model_Checking::Data* trx, wxString& msg);
+    bool mergeTransferPair(Model_Checking::Cache& to, Model_Checking::Cache& from);
+    void appendTransfers(Model_Checking::Cache& destination, Model_Checking::Cache& target);
+    void joinSplit(Model_Checking::Cache& destination, std::vector<Model_Splittransaction::Cache>& target);
+    void saveSplit();
+    Model_Taglink::Cache createTaglinks(const wxString& tagStr, const wxString& reftype);
+
+    // QIF paragraphs represented like maps type = data
+    std::vector<QIF_Entry> vQIF_trxs_;
+    std::unordered_map<wxString, std::unordered_map<int, wxString>> m_QIFaccounts;
+    std::unordered_map<wxString, int64> m_QIFaccountsID;
+    std::unordered_map<wxString, std::tuple<int64, wxString, wxString>> m_QIFpayeeNames;
+    wxArrayString m_payee_names;
+    std::unordered_map<wxString, size_t> m_payee_index; // lower case name, index in m_payee_names
+    std::unordered_map<wxString, int64> m_QIFtagIDs;
+    std::unordered_map<wxString, int64> m_QIFcategoryNames;
+    std::vector<Model_Splittransaction::Cache> m_splitDataSets;
+    std::map<int, std::map<int, Model_Taglink::Cache>> m_splitTaglinks;
+    std::map<std::pair<int, int>, Model_Taglink::Cache> m_txnTaglinks;
+
+    wxString m_accountNameStr;
+    wxString m_dateFormatStr;
+    wxString m_dateMask; // the human readable m_dateFormatStr found by the scan
+    wxString decimal_ = ".";
+    bool m_userDefinedDateMask = false;
+    bool payeeIsNotes_ = false; //Include payee field in notes
+
+    // The options of the import
+    wxString m_fixedAccount;        // the account all transactions go to, empty for the accounts of the file
+    bool m_byAccountNumber = false; // the accounts of the file are account numbers
+    bool m_matchAddNotes = false;   // add the matched payee pattern to the notes
+    int m_colorId = -1;
+    wxString m_fromDate, m_toDate;  // ISO dates of the transactions to import, empty for no limit
+
+    enum { SAVE_BATCH_SIZE = 1000 }; // transactions saved between progress updates
+};
+
 #endif
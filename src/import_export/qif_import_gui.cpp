@@ -30,6 +30,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "webapp.h"
 #include "option.h"
 #include "payeedialog.h"
+#include "phasetimer.h"
 #include "categdialog.h"
 
 #include "model/Model_Setting.h"
@@ -385,159 +386,32 @@ void mmQIFImportDialog::fillControls()
 
 bool mmQIFImportDialog::mmReadQIFFile()
 {
-    size_t numLines = 0;
-    vQIF_trxs_.clear();
-    m_QIFaccounts.clear();
-    m_accountNameStr.clear();
-    m_QIFcategoryNames.clear();
-    m_QIFcategoryNames[_("Unknown")] = -1;
-    m_QIFpayeeNames.clear();
-    m_payee_names.clear();
-    m_payee_names.Add(_("Unknown"));
-    wxString catDelimiter = Model_Infotable::instance().getString("CATEG_DELIMITER", ":");
-
-    wxFileInputStream input(m_FileNameStr);
+    setOptions();
     wxConvAuto conv = g_encoding.at(m_choiceEncoding->GetSelection()).first;
-    wxTextInputStream text(input, "\x09", conv);
 
     wxProgressDialog progressDlg(_("Please wait"), _("Scanning")
         , 0, this, wxPD_APP_MODAL | wxPD_CAN_ABORT);
+    m_progress = &progressDlg;
 
     wxLongLong start = wxGetUTCTimeMillis();
-    wxLongLong interval = wxGetUTCTimeMillis() - start;
-
-    wxString accName = "";
-    if (accountCheckBox_->IsChecked()) {
-        accName = accountDropDown_->GetStringSelection();
-        Model_Account::Data* acc = Model_Account::instance().get(accName);
-        if (acc) {
-            m_accountNameStr = acc->ACCOUNTNAME;
-        }
-    }
-
-    std::unordered_map <int, wxString> trx;
-    int64 split_id = 0;
-    wxSharedPtr<mmDates> dParser(new mmDates);
-    std::map<wxString, int> comma({ {".", 0}, {",", 0} });
-    while (input.IsOk() && !input.Eof())
-    {
-        ++numLines;
-        const wxString lineStr = text.ReadLine();
-        if (lineStr.IsEmpty())
-            continue;
-
-        if (numLines % 100 == 0)
-        {
-            interval = wxGetUTCTimeMillis() - start;
-            if (!progressDlg.Pulse(wxString::Format(_("Reading line %zu, %lld ms")
-                , numLines, interval)))
-                break;
-        }
-        if (numLines <= 50)
-        {
-            *log_field_ << wxString::Format(_("Line %zu \t %s\n"), numLines, lineStr);
-            if (numLines == 50)
-                *log_field_ << "-------------------------------------- 8< --------------------------------------\n";
-        }
-
-        const qifLineType lineType = mmQIFImport::lineType(lineStr);
-        auto data = mmQIFImport::getLineData(lineStr);
-        if (lineType == EOTLT || input.Eof())
-        {
-            if (trx.find(AcctType) != trx.end())
-            {
-                if (trx[AcctType] == "Account") {
-                    accName = (trx.find(TransNumber) == trx.end() ? "" : trx[TransNumber]);
-                    std::unordered_map <int, wxString> a;
-                    a[AccountType] = (trx.find(Description) != trx.end() ? trx.at(Description) : "");
-                    a[Description] = (trx.find(AccountType) != trx.end() ? trx.at(AccountType) : "");
-                    m_QIFaccounts[accName] = a;
-                    m_accountNameStr = accName;
-                }
-            }
-
-            if (trx[AcctType] != "Account" && completeTransaction(trx, m_accountNameStr)) {
-                vQIF_trxs_.push_back(trx);
-            }
-            trx.clear();
-            split_id = 0;
-            continue;
-        }
-
-        //Parse Categories
-        if (lineType == CategorySplit || lineType == Category)
-        {
-            if (data.empty())
-                data = _("Unknown");
-            wxRegEx regex(" ?: ?");
-            regex.Replace(&data, catDelimiter);
-            wxString catStr = data.BeforeFirst('/');
-            if (!catStr.IsEmpty())
-            {
-                if (catStr.Left(1) == "[" && catStr.Last() == ']')
-                    catStr = _("Transfer");
-                m_QIFcategoryNames[catStr] = -1;
-            }
-        }
-
-        //Parse date format
-        if (!m_userDefinedDateMask && lineType == Date && (data.Mid(0, 1) != "["))
-        {
-            dParser->doHandleStatistics(data);
-        }
-
-        //Parse numbers
-        if (lineType == Amount || lineType == AmountSplit)
-        {
-            comma["."] += data.Contains(".") ? data.find(".") + 1 : 0;
-            comma[","] += data.Contains(",") ? data.find(",") + 1 : 0;
-        }
-
-        if (lineType == CategorySplit)
-            split_id++;
-
-        if (lineType == AcctType)
-            trx[lineType] = data;
-        else
-        {
-            wxString prefix;
-            if (!trx[lineType].empty())
-                prefix = "\n";
-
-            if (lineType == MemoSplit)
-                data.Prepend(wxString::Format("%lld:", split_id));
-            
-            trx[lineType] += prefix + data;
-        }
-
-    }
+    mmPhaseTimer timer("QIF scan");
+    const size_t numLines = scan(m_FileNameStr, conv, timer);
     log_field_->ScrollLines(log_field_->GetNumberOfLines());
 
-    if (comma[","] > comma["."]) {
-        m_choiceDecimalSeparator->SetDecimalChar(",");
-    }
-    if (comma["."] > comma[","]) {
-        m_choiceDecimalSeparator->SetDecimalChar(".");
-    }
-
-    if (!m_userDefinedDateMask)
-    {
-        dParser->doFinalizeStatistics();
-        if (dParser->isDateFormatFound()) {
-            m_dateFormatStr = dParser->getDateFormat();
-            const wxString date_mask = dParser->getDateMask();
-            choiceDateFormat_->SetStringSelection(date_mask);
-        }
-    }
+    m_choiceDecimalSeparator->SetDecimalChar(decimal_);
+    if (!m_dateMask.empty())
+        choiceDateFormat_->SetStringSelection(m_dateMask);
 
     fillControls();
 
+    m_progress = nullptr;
     progressDlg.Destroy();
 
-    interval = wxGetUTCTimeMillis() - start;
+    wxLongLong interval = wxGetUTCTimeMillis() - start;
     wxString sMsg = wxString::Format(_("Number of lines read from QIF file: %zu in %lld ms")
         , numLines, interval);
     *log_field_ << sMsg << "\n";
+    wxLogDebug("%s", timer.summary());
 
     if (!m_QIFaccounts.empty()) {
         sMsg = _("Accounts:");
@@ -556,108 +430,30 @@ bool mmQIFImportDialog::mmReadQIFFile()
     return true;
 }
 
-bool mmQIFImportDialog::completeTransaction(std::unordered_map<int, wxString> &trx, const wxString &accName)
+// The options of the controls the importer reads
+void mmQIFImportDialog::setOptions()
 {
-    if (trx.find(Date) == trx.end())
-        return false;
-
-    bool isTransfer = false;
-
-    if (accName.empty()) {
-        trx[AccountName] = m_accountNameStr;
-    }
-    else {
-        trx[AccountName] = accName;
-    }
-
-
-    if (trx.find(CategorySplit) != trx.end())
-    {
-        //TODO:Dublicate code
-        wxStringTokenizer token(trx[CategorySplit], "\n");
-        while (token.HasMoreTokens())
-        {
-            wxString c = token.GetNextToken();
-            const wxString project = qif_api->getFinancistoProject(c);
-            if (!project.empty())
-                trx[TransNumber] += project + "\n"; //TODO: trx number or notes
-        }
-    }
-
-    if (trx[Payee] == "Opening Balance") {
-        trx[Memo] += (trx[Memo].empty() ? "" : "\n") + trx[Payee];
-        trx[Category] = trx[Payee];
-    }
-
-    if (trx.find(Category) != trx.end())
-    {
-        wxString tags;
-        wxString categname = trx[Category].BeforeFirst('/', &tags);
-        if (categname.Left(1) == "[" && categname.Last() == ']')
-        {
-            wxString toAccName = categname.SubString(1, categname.length() - 2);
-
-            if (toAccName == m_accountNameStr)
-            {
-                trx[Category] = trx[Payee];
-                trx[Payee] = toAccName;
-            }
-            else
-            {
-                isTransfer = true;
-                trx[Category] = _("Transfer") + (!tags.IsEmpty() ? "/" + tags : "");
-                trx[TrxType] = Model_Checking::TYPE_STR_TRANSFER;
-                trx[ToAccountName] = toAccName;
-                trx[Memo] += (trx[Memo].empty() ? "" : "\n") + trx[Payee];
-                if (m_QIFaccounts.find(toAccName) == m_QIFaccounts.end())
-                {
-                    std::unordered_map<int, wxString> a;
-                    a[Description] = "[" + Model_Currency::GetBaseCurrency()->CURRENCY_SYMBOL + "]";
-                    a[AccountType] = (trx.find(Description) != trx.end() ? trx.at(Description) : "");
-                    m_QIFaccounts[toAccName] = a;
-                }
-            }
-        }
-    }
-
-    if (!isTransfer)
-    {
-        wxString payee_name = trx.find(Payee) != trx.end() ? trx[Payee] : "";
-        if (payee_name.empty() && trx[AcctType] != "Account" )
-        {
-            payee_name = trx.find(AccountName) != trx.end() ? trx[AccountName] : _("Unknown");
-            trx[Payee] = payee_name;
-        }
-
-        if (!payee_name.empty())
-        {
-            int i = m_payee_names.Index(payee_name, false);
-            if (i == wxNOT_FOUND)
-            {
-                m_payee_names.Add(payee_name);
-            }
-            else
-                trx[Payee] = m_payee_names.Item(i);
-
-            if (payee_name == "Opening Balance")
-                m_QIFcategoryNames["Opening Balance"] = -1;
-
-        }
-    }
+    m_fixedAccount = accountCheckBox_->IsChecked() ? accountDropDown_->GetStringSelection() : "";
+    m_byAccountNumber = accountNumberCheckBox_->IsChecked();
+    m_matchAddNotes = payeeMatchAddNotes_->IsChecked();
+    m_colorId = colorCheckBox_->IsChecked() ? mmColorBtn_->GetColorId() : -1;
+    m_fromDate = dateFromCheckBox_->IsChecked() ? fromDateCtrl_->GetValue().FormatISODate() : "";
+    m_toDate = dateToCheckBox_->IsChecked() ? toDateCtrl_->GetValue().FormatISODate() : "";
+}
 
-    if (payeeIsNotes_) {
-        trx[Memo] += (trx[Memo].empty() ? "" : "\n") + trx[Payee];
-    }
+void mmQIFImportDialog::log(const wxString& msg)
+{
+    *log_field_ << msg << "\n";
+}
 
-    wxString amtStr = (trx.find(Amount) == trx.end() ? "" : trx[Amount]);
-    if (!isTransfer) {
-        if (amtStr.Mid(0, 1) == "-")
-            trx[TrxType] = Model_Checking::TYPE_STR_WITHDRAWAL;
-        else if (!amtStr.empty())
-            trx[TrxType] = Model_Checking::TYPE_STR_DEPOSIT;
-    }
+bool mmQIFImportDialog::scanProgress(size_t lines, wxLongLong ms)
+{
+    return !m_progress || m_progress->Pulse(wxString::Format(_("Reading line %zu, %lld ms"), lines, ms));
+}
 
-    return !amtStr.empty();
+bool mmQIFImportDialog::importProgress(int value, const wxString& msg)
+{
+    return !m_progress || m_progress->Update(value, msg);
 }
 
 void mmQIFImportDialog::refreshTabs(int tabs)
@@ -674,7 +470,7 @@ void mmQIFImportDialog::refreshTabs(int tabs)
             data.push_back(wxVariant(wxString::Format("%i", num + 1)));
             data.push_back(
                 wxVariant(
-                    trx.find(AccountName) != trx.end()
+                    trx.has(AccountName)
                     && (trx.at(AccountName).empty() || accountCheckBox_->IsChecked())
                     ? m_accountNameStr
                     : ((accountNumberCheckBox_->IsChecked() && account)
@@ -684,7 +480,7 @@ void mmQIFImportDialog::refreshTabs(int tabs)
             );
 
             wxString dateStr = "";
-            if (trx.find(Date) != trx.end())
+            if (trx.has(Date))
             {
                 dateStr = trx.at(Date);
                 dateStr.Replace(" ", "");
@@ -697,17 +493,17 @@ void mmQIFImportDialog::refreshTabs(int tabs)
             }
 
             data.push_back(wxVariant(dateStr));
-            data.push_back(wxVariant(trx.find(TransNumber) != trx.end() ? trx.at(TransNumber) : ""));
-            const wxString type = (trx.find(TrxType) != trx.end() ? trx.at(TrxType) : "");
+            data.push_back(wxVariant(trx.has(TransNumber) ? trx.at(TransNumber) : ""));
+            const wxString type = (trx.has(TrxType) ? trx.at(TrxType) : "");
             if (type == Model_Checking::TYPE_STR_TRANSFER)
-                data.push_back(wxVariant(trx.find(ToAccountName) != trx.end() ? trx.at(ToAccountName) : ""));
+                data.push_back(wxVariant(trx.has(ToAccountName) ? trx.at(ToAccountName) : ""));
             else
-                data.push_back(wxVariant(trx.find(Payee) != trx.end() ? trx.at(Payee) : ""));
-            data.push_back(wxVariant(trx.find(TrxType) != trx.end() ? trx.at(TrxType) : ""));
+                data.push_back(wxVariant(trx.has(Payee) ? trx.at(Payee) : ""));
+            data.push_back(wxVariant(trx.has(TrxType) ? trx.at(TrxType) : ""));
 
             wxString category;
             wxString tags;
-            if (trx.find(CategorySplit) != trx.end()) {
+            if (trx.has(CategorySplit)) {
                 wxStringTokenizer tokenizer = wxStringTokenizer(trx.at(CategorySplit), "\n");
                 while (tokenizer.HasMoreTokens())
                 {
@@ -721,15 +517,15 @@ void mmQIFImportDialog::refreshTabs(int tabs)
             }
             else
             {
-                category = (trx.find(Category) != trx.end() ? trx.at(Category).BeforeFirst('/') : "");
+                category = (trx.has(Category) ? trx.at(Category).BeforeFirst('/') : "");
             }
-            wxString txnTags = trx.find(Category) != trx.end() ? trx.at(Category).AfterFirst('/') : "";
+            wxString txnTags = trx.has(Category) ? trx.at(Category).AfterFirst('/') : "";
             if (!txnTags.IsEmpty())
                 tags.Prepend(tags.IsEmpty() ? "" : "|").Prepend(txnTags);
             data.push_back(wxVariant(category));
             data.push_back(wxVariant(tags));
-            data.push_back(wxVariant(trx.find(Amount) != trx.end() ? trx.at(Amount) : ""));
-            data.push_back(wxVariant(trx.find(Memo) != trx.end() ? trx.at(Memo) : ""));
+            data.push_back(wxVariant(trx.has(Amount) ? trx.at(Amount) : ""));
+            data.push_back(wxVariant(trx.has(Memo) ? trx.at(Memo) : ""));
 
             dataListBox_->AppendItem(data, static_cast<wxUIntPtr>(num++));
         }
@@ -958,74 +754,20 @@ void mmQIFImportDialog::OnCheckboxClick(wxCommandEvent& event)
     refreshTabs(t);
 }
 
-void mmQIFImportDialog::compilePayeeRegEx() {
-
+void mmQIFImportDialog::compilePayeeRegEx()
+{
     // pre-compile all payee match strings if not already done
     if (payeeMatchCheckBox_->IsChecked() && !payeeRegExInitialized_)
     {
-        // only look at payees that have a match pattern set
-        Model_Payee::Data_Set payees = Model_Payee::instance().find(Model_Payee::PATTERN(wxEmptyString, NOT_EQUAL));
-        for (const auto& payee : payees)
-        {
-            Document json_doc;
-            if (json_doc.Parse(payee.PATTERN.utf8_str()).HasParseError()) {
-                continue;
-            }
-            int key = -1;
-            // loop over all keys in the pattern json data
-            for (const auto& member : json_doc.GetObject())
-            {
-                key++;
-                const auto pattern = wxString::FromUTF8(member.value.GetString());
-                // add the pattern string (for non-regex match, match notes, and the payee tab preview)
-                payeeMatchPatterns_[std::make_pair(payee.PAYEEID, payee.PAYEENAME)][key].first = pattern;
-                // complie the regex if necessary
-                if (pattern.StartsWith("regex:")) {
-                    payeeMatchPatterns_[std::make_pair(payee.PAYEEID, payee.PAYEENAME)][key].second
-                        .Compile(pattern.Right(pattern.length() - 6), wxRE_ICASE | wxRE_EXTENDED);
-                }
-            }
-        }
+        payeeMatcher_.load();
         payeeRegExInitialized_ = true;
     }
-
 }
-void mmQIFImportDialog::validatePayees() {
-    if (!payeeRegExInitialized_) compilePayeeRegEx();
 
-    for (const auto& payee_name : m_payee_names) {
-        bool payee_found = false;
-        // initialize
-        m_QIFpayeeNames[payee_name] = std::make_tuple(-1, "", "");
-        // perform pattern match
-        if (payeeMatchCheckBox_->IsChecked()) {
-            // loop over all the precompiled patterns
-            for (auto& payeeId : payeeMatchPatterns_) {
-                for (auto& pattern : payeeId.second) {
-                    bool match = false;
-                    // match against regex if the pattern begins with "regex:"
-                    if (pattern.second.first.StartsWith("regex:"))
-                        match = pattern.second.second.Matches(payee_name);
-                    else // use the normal wxString match for non-regex patterns
-                        match = payee_name.Lower().Matches(pattern.second.first.Lower());
-                    if (match)
-                    {
-                        payee_found = true;
-                        // save the target payee ID, name, and match details
-                        m_QIFpayeeNames[payee_name] = std::make_tuple(payeeId.first.first, payeeId.first.second, pattern.second.first);
-                        break;
-                    }
-                }
-                if (payee_found) break;
-            }
-        }
-        if (!payee_found) {
-            Model_Payee::Data* payee = Model_Payee::instance().get(payee_name);
-            if (payee) {
-                m_QIFpayeeNames[payee_name] = std::make_tuple(payee->PAYEEID, payee->PAYEENAME, "");
-            }
-        }
-    }
+void mmQIFImportDialog::validatePayees()
+{
+    if (!payeeRegExInitialized_) compilePayeeRegEx();
+    matchPayees(payeeMatchCheckBox_->IsChecked() ? &payeeMatcher_ : nullptr);
 }
 
 void mmQIFImportDialog::OnAccountChanged(wxCommandEvent& event)
@@ -1050,175 +792,22 @@ void mmQIFImportDialog::OnOk(wxCommandEvent& WXUNUSED(event))
         , wxYES_NO | wxNO_DEFAULT | wxICON_QUESTION);
     if (msgDlg.ShowModal() == wxID_YES)
     {
-        getOrCreateAccounts();
-        int nTransactions = vQIF_trxs_.size();
-        wxProgressDialog progressDlg(_("Please wait"), _("Importing")
-            , nTransactions + 1, this, wxPD_APP_MODAL | wxPD_CAN_ABORT | wxPD_AUTO_HIDE);
-        progressDlg.Update(1, _("Importing Accounts"));
-        bool is_webbapp_enabled = mmWebApp::MMEX_WebApp_UpdateAccount();
-
-        progressDlg.Update(1, _("Importing Payees"));
-        getOrCreatePayees();
-        if (is_webbapp_enabled)
-            is_webbapp_enabled = mmWebApp::MMEX_WebApp_UpdatePayee();
-        progressDlg.Update(1, _("Importing Categories"));
-        getOrCreateCategories();
-        if (is_webbapp_enabled)
-            mmWebApp::MMEX_WebApp_UpdateCategory();
-
-        Model_Checking::Cache trx_data_set;
-        Model_Checking::Cache transfer_to_data_set;
-        Model_Checking::Cache transfer_from_data_set;
-        int count = 0;
-        const wxString& transferStr = Model_Checking::TYPE_STR_TRANSFER;
-
-        const auto begin_date = toDateCtrl_->GetValue().FormatISODate();
-        const auto end_date = fromDateCtrl_->GetValue().FormatISODate();
-
         wxCommandEvent evt;
         OnDecimalChange(evt);
+        setOptions();
 
-        for (const auto& entry : vQIF_trxs_)
-        {
-            if (count % 100 == 0 || count == nTransactions)
-            {
-                if (!progressDlg.Update(count
-                    , wxString::Format(_("Importing transaction %1$i of %2$i"), count, nTransactions))) // if cancel clicked
-                    break; // abort processing
-            }
-            //
-            Model_Checking::Data *trx = Model_Checking::instance().create();
-            wxString msg;
-            if (completeTransaction(entry, trx, msg))
-            {
-                wxString strDate = Model_Checking::TRANSDATE(trx).FormatISODate();
-                if (dateFromCheckBox_->IsChecked() && strDate < begin_date)
-                    continue;
-                if (dateToCheckBox_->IsChecked() && strDate > end_date)
-                    continue;
-                
-                Model_Account::Data* account = Model_Account::instance().get(trx->ACCOUNTID);
-                Model_Account::Data* toAccount = Model_Account::instance().get(trx->TOACCOUNTID);
-
-                if ((trx->TRANSDATE < account->STATEMENTDATE && account->STATEMENTLOCKED.GetValue()) ||
-                    (toAccount && (trx->TRANSDATE < toAccount->STATEMENTDATE && toAccount->STATEMENTLOCKED.GetValue())))
-                    continue;
-
-                if (trx->TRANSDATE < account->INITIALDATE) {
-                    account->INITIALDATE = trx->TRANSDATE;
-                }
-                if (toAccount && (trx->TRANSDATE < toAccount->INITIALDATE)) {
-                    toAccount->INITIALDATE = trx->TRANSDATE;
-                }
-
-                // Save Transaction Tags
-                wxString tagStr = (entry.find(Category) != entry.end() ? entry.at(Category).AfterFirst('/') : "");
-                Model_Taglink::Cache taglinks;
-                if (!tagStr.IsEmpty())
-                {
-                    wxString reftype = Model_Attachment::REFTYPE_STR_TRANSACTION;
-                    wxStringTokenizer tagTokens = wxStringTokenizer(tagStr, ":");
-                    while (tagTokens.HasMoreTokens())
-                    {
-                        wxString tagname = tagTokens.GetNextToken().Trim(false).Trim();
-                        // make tag names single-word
-                        tagname.Replace(" ", "_");
-                        Model_Tag::Data* tag = Model_Tag::instance().get(tagname);
-                        if (!tag)
-                        {
-                            tag = Model_Tag::instance().create();
-                            tag->TAGNAME = tagname;
-                            tag->ACTIVE = 1;
-                            tag->TAGID = Model_Tag::instance().save(tag);
-                        }
-                        Model_Taglink::Data* taglink = Model_Taglink::instance().create();
-                        taglink->REFTYPE = reftype;
-                        taglink->TAGID = tag->TAGID;
-                        // Just cache the new taglink since we don't know the TRANSID yet
-                        taglinks.push_back(taglink);
-                    }
-                }
-
-                // transactions are split into three groups, then merged
-                // since txnIds are not yet created, we need to keep track of what tags go with each cached transaction.
-                if (trx->TRANSCODE == transferStr && trx->TOTRANSAMOUNT > 0.0)
-                {
-                    // The "From" tags are stored with key <2, index of from transaction>
-                    m_txnTaglinks[std::make_pair(2, transfer_from_data_set.size())] = taglinks;
-                    transfer_from_data_set.push_back(trx);
-                }
-                else if (trx->TRANSCODE == transferStr && trx->TOTRANSAMOUNT <= 0.0)
-                {
-                    // The "To" tags are stored with key <1, index of 'to' transaction>
-                    m_txnTaglinks[std::make_pair(1, transfer_to_data_set.size())] = taglinks;
-                    transfer_to_data_set.push_back(trx);
-                }
-                else
-                {
-                    // The non-transfer tags are stored with key <0, index of transaction>
-                    m_txnTaglinks[std::make_pair(0, trx_data_set.size())] = taglinks;
-                    trx_data_set.push_back(trx);
-                }
-            }
-            else
-            {
-                *log_field_ << wxString::Format(_("Error: %s"), msg);
-
-                wxString t = "";
-                for (const auto&i : entry)
-                    t << i.second << "|";
-                t.RemoveLast(1);
-                *log_field_ << wxString::Format("\n( %s )\n", t);
-            }
-            ++count;
-        }
-
-        progressDlg.Update(count, _("Importing Transfers"));
-        mergeTransferPair(transfer_to_data_set, transfer_from_data_set);
-        appendTransfers(trx_data_set, transfer_to_data_set);
+        wxProgressDialog progressDlg(_("Please wait"), _("Importing")
+            , static_cast<int>(vQIF_trxs_.size()) + 1, this, wxPD_APP_MODAL | wxPD_CAN_ABORT | wxPD_AUTO_HIDE);
+        m_progress = &progressDlg;
+        mmPhaseTimer timer("QIF import");
+        const size_t nImported = import(timer);
+        wxLogDebug("%s", timer.summary());
+        m_progress = nullptr;
+
+        if (mmWebApp::MMEX_WebApp_UpdateAccount() && mmWebApp::MMEX_WebApp_UpdatePayee())
+            mmWebApp::MMEX_WebApp_UpdateCategory();
 
-        //Search for duplicates for transfers
-        for (auto &trx : trx_data_set)
-        {
-            if (!Model_Checking::is_transfer(trx))
-                continue;
-            wxDate dt;
-            dt.ParseISODate(trx->TRANSDATE);
-            const auto data = Model_Checking::instance().find(
-                Model_Checking::TRANSDATE(dt)
-                , Model_Checking::ACCOUNTID(trx->ACCOUNTID)
-                , Model_Checking::TOACCOUNTID(trx->TOACCOUNTID)
-                , Model_Checking::NOTES(trx->NOTES)
-                , Model_Checking::TRANSACTIONNUMBER(trx->TRANSACTIONNUMBER)
-                , Model_Checking::TRANSCODE(Model_Checking::TYPE_ID_TRANSFER)
-                , Model_Checking::TRANSAMOUNT(trx->TRANSAMOUNT)
-            );
-            if (data.size() > 0)
-                trx->STATUS = Model_Checking::STATUS_KEY_DUPLICATE;
-        }
-        // At this point all transactions and tags have been merged into single sets
-        Model_Taglink::instance().Savepoint();
-        for (int i = 0; i < static_cast<int>(trx_data_set.size()); i++)
-        {
-            if (!m_txnTaglinks[std::make_pair(0, i)].empty())
-            {
-                // we need to know the transid for the taglink, so save the transaction first
-                int64 transid = Model_Checking::instance().save(trx_data_set[i]);
-                // apply that transid to all associated tags
-                for (const auto& taglink : m_txnTaglinks[std::make_pair(0, i)])
-                    taglink->REFID = transid;
-                // save the block of taglinks
-                Model_Taglink::instance().save(m_txnTaglinks[std::make_pair(0, i)]);
-            }
-        }
-        Model_Taglink::instance().ReleaseSavepoint();
-        Model_Checking::instance().save(trx_data_set);
-        progressDlg.Update(count, _("Importing Split transactions"));
-        joinSplit(trx_data_set, m_splitDataSets);
-        saveSplit();
-
-        sMsg = _("Import finished successfully") + "\n" + wxString::Format(_("Total Imported: %zu"), trx_data_set.size());
-        trx_data_set.clear();
+        sMsg = _("Import finished successfully") + "\n" + wxString::Format(_("Total Imported: %zu"), nImported);
         vQIF_trxs_.clear();
         btnOK_->Enable(false);
         progressDlg.Destroy();
@@ -1235,310 +824,6 @@ void mmQIFImportDialog::OnOk(wxCommandEvent& WXUNUSED(event))
     refreshTabs(ACC_TAB | PAYEE_TAB | CAT_TAB);
 }
 
-void mmQIFImportDialog::saveSplit()
-{
-    if (m_splitDataSets.empty()) return;
-
-    Model_Splittransaction::instance().Savepoint();
-    Model_Taglink::instance().Savepoint();
-    // Work through each group of splits 
-    for (int i = 0; i < static_cast<int>(m_splitDataSets.size()); i++)
-    {
-        // and each split in the group
-        for (int j = 0; j < static_cast<int>(m_splitDataSets[i].size()); j++)
-        {
-            // save the split
-            int64 splitTransID = Model_Splittransaction::instance().save(m_splitDataSets[i][j]);
-            // check if there are any taglinks for this split index in this group
-            if (!m_splitTaglinks[i][j].empty())
-            {
-                // apply the SPLITTRANSID as the REFID for all the cached taglinks
-                for (const auto& taglink : m_splitTaglinks[i][j])
-                    taglink->REFID = splitTransID;
-                // save cached taglinks
-                Model_Taglink::instance().save(m_splitTaglinks[i][j]);
-            }
-        }
-    }
-    Model_Splittransaction::instance().ReleaseSavepoint();
-    Model_Taglink::instance().ReleaseSavepoint();
-}
-void mmQIFImportDialog::joinSplit(Model_Checking::Cache &destination
-    , std::vector<Model_Splittransaction::Cache> &target)
-{
-    if (target.empty()) // no splits in the file
-        return;
-
-    for (auto &item : destination)
-    {
-        if (item->CATEGID > 0) continue;
-        for (auto &split_item : target.at(-1 * item->CATEGID.GetValue()))
-            split_item->TRANSID = item->TRANSID;
-        item->CATEGID = -1;
-    }
-}
-
-void mmQIFImportDialog::appendTransfers(Model_Checking::Cache &destination, Model_Checking::Cache &target)
-{
-    // Here we are moving all the 'to' transfers into the normal transactions, so we also
-    // need to keep track of the new index for the taglinks
-    for (int i = 0; i < static_cast<int>(target.size()); i++)
-    {
-        m_txnTaglinks[std::make_pair(0, destination.size())] = m_txnTaglinks[std::make_pair(1, i)];
-        destination.push_back(target[i]);
-    }
-}
-
-bool mmQIFImportDialog::mergeTransferPair(Model_Checking::Cache& to, Model_Checking::Cache& from)
-{
-    if (to.empty() && from.empty()) return false; //Nothing to merge
-
-    for (auto& refTrxTo : to)
-    {
-        int i = -1;
-        bool pair_found = false;
-        for (auto& refTrxFrom : from)
-        {
-            ++i;
-            if (refTrxTo->ACCOUNTID != refTrxFrom->TOACCOUNTID) continue;
-            if (refTrxTo->TOACCOUNTID != refTrxFrom->ACCOUNTID) continue;
-            if (refTrxTo->TRANSACTIONNUMBER != refTrxFrom->TRANSACTIONNUMBER) continue;
-            if (refTrxTo->NOTES != refTrxFrom->NOTES) continue;
-            if (refTrxTo->TRANSDATE != refTrxFrom->TRANSDATE) continue;
-            refTrxTo->TOTRANSAMOUNT = refTrxFrom->TRANSAMOUNT;
-            from.erase(from.begin() + i);
-            // a match is found so erase the 'from' taglinks
-            m_txnTaglinks.erase(std::make_pair(2, i));
-            pair_found = true;
-            break;
-        }
-
-        if (!pair_found)
-            refTrxTo->TOTRANSAMOUNT = refTrxTo->TRANSAMOUNT;
-    }
-
-    // now merge 'from' and 'to' transaction lists
-    for (int i = 0; i < static_cast<int>(from.size()); i++)
-    {
-        std::swap(from[i]->ACCOUNTID, from[i]->TOACCOUNTID);
-        // also need to move the 'from' taglinks to the 'to' taglinks list, keeping track
-        // of the new transaction indices
-        m_txnTaglinks[std::make_pair(1, to.size())] = m_txnTaglinks[std::make_pair(2, i)];
-        to.push_back(from[i]);
-    }
-
-    return true;
-}
-
-bool mmQIFImportDialog::completeTransaction(/*in*/ const std::unordered_map <int, wxString> &i
-    , /*out*/ Model_Checking::Data* trx, wxString& msg)
-{
-    auto t = i;
-    trx->TRANSCODE = (t.find(TrxType) != t.end() ? t[TrxType] : "");
-    if (trx->TRANSCODE.empty())
-    {
-        msg = _("Transaction code is missing");
-        return false;
-    }
-    bool transfer = Model_Checking::is_transfer(trx->TRANSCODE);
-
-    if (!transfer)
-    {
-        wxString payee_name = t.find(Payee) != t.end() ? t.at(Payee) : "";
-        if (!payee_name.empty())
-        {
-            if (m_QIFpayeeNames.find(payee_name) != m_QIFpayeeNames.end()) {
-                trx->PAYEEID = std::get<0>(m_QIFpayeeNames[payee_name]);
-                // NOTES haven't been filled yet, so we can just direct assign match details if necessary
-                if (payeeMatchAddNotes_->IsChecked() && !std::get<2>(m_QIFpayeeNames[payee_name]).IsEmpty()) {
-                    trx->NOTES =  wxString::Format(_("%1$s matched by %2$s"), payee_name, std::get<2>(m_QIFpayeeNames[payee_name]));
-                }
-            } else trx->PAYEEID = -1;
-        }
-        else
-        {
-            trx->PAYEEID = -1;
-        }
-    }
-
-    if (trx->PAYEEID == -1 && !transfer)
-    {
-        msg = _("Transaction Payee is missing or incorrect");
-        return false;
-    }
-
-    wxString dateStr = (t.find(Date) != t.end() ? t[Date] : "");
-    if (!m_dateFormatStr.Contains(" ")) dateStr.Replace(" ", "");
-    wxDateTime dtdt;
-    wxString::const_iterator end;
-    if (dtdt.ParseFormat(dateStr, m_dateFormatStr, &end))
-        trx->TRANSDATE = dtdt.FormatISOCombined();
-    else
-    {
-        *log_field_ << _("Date format or date mask is incorrect") << "\n";
-        return false;
-    }
-
-    int64 accountID = -1;
-    wxString accountName = (t.find(AccountName) != t.end() ? t[AccountName] : "");
-    if ((accountName.empty() || accountCheckBox_->IsChecked()) /*&& !transfer*/) {
-        accountName = m_accountNameStr;
-    }
-    accountID = (m_QIFaccountsID.find(accountName) != m_QIFaccountsID.end() ? m_QIFaccountsID.at(accountName) : -1);
-    if (accountID < 1)
-    {
-        msg = _("Transaction Account is incorrect");
-        return false;
-    }
-    trx->ACCOUNTID = accountID;
-    trx->TOACCOUNTID = (t.find(ToAccountName) != t.end()
-        ? (m_QIFaccountsID.find(t[ToAccountName]) != m_QIFaccountsID.end()
-            ? m_QIFaccountsID[t[ToAccountName]] : -1) : -1);
-    if (trx->ACCOUNTID == trx->TOACCOUNTID && transfer)
-    {
-        msg = _("Transaction Account for transfer is incorrect");
-        return false;
-    }
-
-    trx->TRANSACTIONNUMBER = (t.find(TransNumber) != t.end() ? t[TransNumber] : "");
-    trx->NOTES.Prepend(!trx->NOTES.IsEmpty() ? "\n" : "").Prepend(t.find(Memo) != t.end() ? t[Memo] : ""); // add the actual NOTES before the payee match details
-    wxString status = Model_Checking::STATUS_KEY_NONE;
-    if (t.find(Status) != t.end())
-    {
-        wxString s = t[Status];
-        if (s == "X" || s == "R")
-            status = Model_Checking::STATUS_KEY_RECONCILED;
-        /*else if (s == "*" || s == "c")
-        {
-            TODO: What does 'cleared' status mean?
-            status = "c";
-        }*/
-
-    }
-    trx->STATUS = status;
-
-    int color_id = mmColorBtn_->GetColorId();
-    trx->COLOR = -1;
-    if (colorCheckBox_->IsChecked() && color_id > 0 && color_id < 8)
-        trx->COLOR = color_id;
-
-    const wxString value = mmTrimAmount(t.find(Amount) != t.end() ? t[Amount] : "", decimal_, ".");
-    if (value.empty())
-    {
-        msg = _("Transaction Amount is incorrect");
-        return false;
-    }
-
-    double amt;
-    value.ToCDouble(&amt);
-
-    trx->TRANSAMOUNT = fabs(amt);
-    trx->TOTRANSAMOUNT = transfer ? amt : trx->TRANSAMOUNT;
-    wxString tagStr;
-    wxRegEx regex(" ?: ?");
-    if (t.find(CategorySplit) != t.end())
-    {
-        Model_Splittransaction::Cache split;       
-        wxStringTokenizer categToken(t[CategorySplit], "\n");
-        wxStringTokenizer amtToken((t.find(AmountSplit) != t.end() ? t[AmountSplit] : ""), "\n");
-        wxString notes = t.find(MemoSplit) != t.end() ? t[MemoSplit] : "";
-        int split_id = 1;
-
-        while (categToken.HasMoreTokens())
-        {
-            const wxString c = categToken.GetNextToken().BeforeFirst('/', &tagStr);
-            if (m_QIFcategoryNames.find(c) == m_QIFcategoryNames.end()) return false;
-            int64 categID = m_QIFcategoryNames[c];
-            if (categID <= 0)
-            {
-                msg = _("Transaction Category is incorrect");
-                return false;
-            }
-            Model_Splittransaction::Data* s = Model_Splittransaction::instance().create();
-            s->CATEGID = categID;
-
-            wxString amtSplit = amtToken.GetNextToken();
-            amtSplit = mmTrimAmount(amtSplit, decimal_, ".");
-            double amount;
-            amtSplit.ToCDouble(&amount);
-
-            wxString memo;
-            while (!notes.empty()) {
-                wxRegEx pattern(wxString::Format("^%d:(.*)", split_id), wxRE_NEWLINE);
-                if (pattern.Matches(notes))
-                {
-                    memo += (!memo.IsEmpty() ? "\n" : "" ) + pattern.GetMatch(notes, 1);
-                    pattern.ReplaceFirst(&notes, "");
-                    notes.Replace("\n", "", false);
-                }
-                else
-                    break;
-            }
-
-            s->SPLITTRANSAMOUNT = (Model_Checking::is_deposit(trx) ? amount : -amount);
-            s->TRANSID = trx->TRANSID;
-            s->NOTES = memo;
-            split.push_back(s);
-            // Save split tags
-            if (!tagStr.IsEmpty())
-            {
-                Model_Taglink::Cache splitTaglinks;
-                wxString reftype = Model_Attachment::REFTYPE_STR_TRANSACTIONSPLIT;
-                wxStringTokenizer tagTokens = wxStringTokenizer(tagStr, ":");
-                while (tagTokens.HasMoreTokens())
-                {
-                    wxString tagname = tagTokens.GetNextToken().Trim(false).Trim();
-                    // make tag names single-word
-                    tagname.Replace(" ", "_");
-                    Model_Tag::Data* tag = Model_Tag::instance().get(tagname);
-                    if (!tag)
-                    {
-                        tag = Model_Tag::instance().create();
-                        tag->TAGNAME = tagname;
-                        tag->ACTIVE = 1;
-                        tag->TAGID = Model_Tag::instance().save(tag);
-                    }
-                    Model_Taglink::Data* taglink = Model_Taglink::instance().create();
-                    taglink->REFTYPE = reftype;
-                    taglink->TAGID = tag->TAGID;
-                    splitTaglinks.push_back(taglink);
-                }
-                // Here we keep track of which block of splits and which split in the block
-                // each group of taglinks is associated with. Once we save the splits we can
-                // record the SPLITTRANSID on the taglink
-                m_splitTaglinks[m_splitDataSets.size()][split_id - 1] = splitTaglinks;
-            }
-            split_id++;
-        }
-        trx->CATEGID = -1 * static_cast<int>(m_splitDataSets.size());
-        m_splitDataSets.push_back(split);
-    }
-    else
-    {
-        wxString categStr = (t.find(Category) != t.end() ? t.at(Category).BeforeFirst('/') : "");
-        if (categStr.empty())
-        {
-            Model_Payee::Data* payee = Model_Payee::instance().get(trx->PAYEEID);
-            if (payee)
-            {
-                trx->CATEGID = payee->CATEGID;
-            }
-            categStr = Model_Category::full_name(trx->CATEGID, ":");
-
-            if (categStr.empty())
-            {
-                trx->CATEGID = (m_QIFcategoryNames[_("Unknown")]);
-            }
-        }
-        else
-        {
-            trx->CATEGID = (m_QIFcategoryNames[categStr]);
-        }
-
-    }
-    return true;
-}
-
 void mmQIFImportDialog::OnCancel(wxCommandEvent& WXUNUSED(event))
 {
     EndModal(wxID_CANCEL);
@@ -1549,112 +834,6 @@ void mmQIFImportDialog::OnQuit(wxCloseEvent& WXUNUSED(event))
     EndModal(wxID_CANCEL);
 }
 
-int64 mmQIFImportDialog::getOrCreateAccounts()
-{
-    m_QIFaccountsID.clear();
-
-    for (auto &item : m_QIFaccounts)
-    {
-        int64 accountID = -1;
-        Model_Account::Data* acc = (accountNumberCheckBox_->IsChecked())
-            ? Model_Account::instance().getByAccNum(item.first)
-            : Model_Account::instance().get(item.first);
-
-        if (!acc)
-        {
-            Model_Account::Data *account = Model_Account::instance().create();
-
-            account->FAVORITEACCT = "TRUE";
-            account->STATUS = Model_Account::STATUS_STR_OPEN;
-
-            const auto type = item.second.find(AccountType) != item.second.end() ? item.second.at(AccountType) : "";
-            account->ACCOUNTTYPE = mmExportTransaction::mm_acc_type(type);
-            //Model_Account::TYPE_STR_CHECKING;
-            account->ACCOUNTNAME = item.first;
-            account->INITIALBAL = 0;
-            account->INITIALDATE = wxDate::Today().FormatISODate();
-
-            account->CURRENCYID = Model_Currency::GetBaseCurrency()->CURRENCYID;
-            const wxString c = (item.second.find(Description) == item.second.end() ? "" : item.second.at(Description));
-            for (const auto& curr : Model_Currency::instance().all())
-            {
-                if (wxString::Format("[%s]", curr.CURRENCY_SYMBOL) == c) {
-                    account->CURRENCYID = curr.CURRENCYID;
-                    break;
-                }
-            }
-
-            accountID = Model_Account::instance().save(account);
-            wxString sMsg = wxString::Format(_("Added account: %s"), item.first);
-            *log_field_ << sMsg << "\n";
-        }
-        else
-            accountID = acc->ACCOUNTID;
-
-        m_QIFaccountsID[item.first] = accountID;
-    }
-
-    Model_Account::Data* acc = Model_Account::instance().get(m_accountNameStr);
-    if (acc) {
-        m_QIFaccountsID[m_accountNameStr] = acc->ACCOUNTID;
-    }
-
-    return m_QIFaccountsID.size();
-}
-
-void mmQIFImportDialog::getOrCreatePayees()
-{
-    Model_Payee::instance().Savepoint();
-    
-    for (const auto& item : m_payee_names)
-    {
-        // check if this payee exists
-        if (m_QIFpayeeNames.find(item) != m_QIFpayeeNames.end() && std::get<0>(m_QIFpayeeNames[item]) != -1) continue;
-
-        // the payee doesn't exist or match a pattern, so create one
-        Model_Payee::Data* p = Model_Payee::instance().create();
-        p->PAYEENAME = item;
-        p->ACTIVE = 1;
-        p->CATEGID = -1;
-        wxString sMsg = wxString::Format(_("Added payee: %s"), item);
-        log_field_->AppendText(wxString() << sMsg << "\n");
-        m_QIFpayeeNames[item] = std::make_tuple(Model_Payee::instance().save(p), p->PAYEENAME, "");
-        
-    }
-
-    Model_Payee::instance().ReleaseSavepoint();
-}
-
-void mmQIFImportDialog::getOrCreateCategories()
-{
-    wxArrayString temp;
-    for (const auto &item : m_QIFcategoryNames)
-    {
-        wxString categStr;
-        wxStringTokenizer token(item.first, ":");
-        int64 parentID = -1;
-        while(token.HasMoreTokens()){
-            categStr = token.GetNextToken().Trim(false).Trim();
-            Model_Category::Data* c = Model_Category::instance().get(categStr, parentID);
-            if (temp.Index(categStr + wxString::Format(":%lld", parentID)) == wxNOT_FOUND) {
-
-                if (!c)
-                {
-                    c = Model_Category::instance().create();
-                    c->CATEGNAME = categStr;
-                    c->ACTIVE = 1;
-                    c->PARENTID = parentID;
-                    Model_Category::instance().save(c);
-                }
-                temp.Add(categStr + wxString::Format(":%lld", parentID));
-            }
-            parentID = c->CATEGID;
-
-        }
-        m_QIFcategoryNames[item.first] = parentID;
-    }
-}
-
 int64 mmQIFImportDialog::get_last_imported_acc()
 {
     int64 accID = -1;
@@ -21,17 +21,20 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <wx/dialog.h>
 #include "Model_Checking.h"
 #include "mmSimpleDialogs.h"
+#include "payeematcher.h"
+#include "qif_import.h"
+#include <vector>
 
 class mmDatePickerCtrl;
 class wxDataViewListCtrl;
-class mmQIFImport;
+class wxProgressDialog;
 class wxButton;
 class wxTextCtrl;
 class wxChoice;
 class wxCheckBox;
 class wxComboBox;
 
-class mmQIFImportDialog : public wxDialog
+class mmQIFImportDialog : public wxDialog, protected mmQIFImporter
 {
     wxDECLARE_DYNAMIC_CLASS(mmQIFImportDialog);
     wxDECLARE_EVENT_TABLE();
@@ -49,7 +52,6 @@ public:
     int64 get_last_imported_acc();
 
 private:
-    mmQIFImport* qif_api = nullptr;
     void CreateControls();
     void fillControls();
     void OnFileSearch(wxCommandEvent& event);
@@ -66,34 +68,14 @@ private:
     void OnShowCategDialog(wxMouseEvent&);
     void save_file_name();
     bool mmReadQIFFile();
-    int64 getOrCreateAccounts();
-    void getOrCreatePayees();
-    void getOrCreateCategories();
-    bool completeTransaction(std::unordered_map<int, wxString>& trx, const wxString& accName);
-    bool completeTransaction(/*in*/ const std::unordered_map<int, wxString>& i, /*out*/ Model_Checking::Data* trx, wxString& msg);
-    bool mergeTransferPair(Model_Checking::Cache& to, Model_Checking::Cache& from);
-    void appendTransfers(Model_Checking::Cache& destination, Model_Checking::Cache& target);
-    void joinSplit(Model_Checking::Cache& destination, std::vector<Model_Splittransaction::Cache>& target);
-    void saveSplit();
     void refreshTabs(int tabs);
     void compilePayeeRegEx();
     void validatePayees();
+    void setOptions();
+    virtual void log(const wxString& msg);
+    virtual bool scanProgress(size_t lines, wxLongLong ms);
+    virtual bool importProgress(int value, const wxString& msg);
 
-    // QIF paragraphs represented like maps type = data
-    std::vector<std::unordered_map<int, wxString>> vQIF_trxs_;
-    std::unordered_map<wxString, std::unordered_map<int, wxString>> m_QIFaccounts;
-    std::unordered_map<wxString, int64> m_QIFaccountsID;
-    std::unordered_map<wxString, std::tuple<int64, wxString, wxString>> m_QIFpayeeNames;
-    wxArrayString m_payee_names;
-    std::unordered_map<wxString, int64> m_QIFcategoryNames;
-    std::vector<Model_Splittransaction::Cache> m_splitDataSets;
-    std::map<int, std::map<int, Model_Taglink::Cache>> m_splitTaglinks;
-    std::map<std::pair<int, int>, Model_Taglink::Cache> m_txnTaglinks;
-
-    wxString m_accountNameStr;
-    wxString m_dateFormatStr;
-    wxString decimal_;
-    bool m_userDefinedDateMask = false;
     int64 fromAccountID_ = -1;
     wxString m_FileNameStr;
     const wxDateTime m_today;
@@ -122,9 +104,9 @@ private:
     mmChoiceAmountMask* m_choiceDecimalSeparator = nullptr;
     wxCheckBox* colorCheckBox_ = nullptr;
     mmColorButton* mmColorBtn_ = nullptr;
+    wxProgressDialog* m_progress = nullptr; // of the scan or import running
 
-    bool payeeIsNotes_ = false; //Include payee field in notes
-    std::map<std::pair <int64, wxString>, std::map<int, std::pair<wxString, wxRegEx>> > payeeMatchPatterns_;
+    mmPayeeMatcher payeeMatcher_;
     bool payeeRegExInitialized_ = false;
 
     enum EColumn
@@ -22,13 +22,16 @@
 
 #include <algorithm>
 #include <cctype>
+#include <deque>
 #include <string>
 #include <memory>
 #include <regex>
+#include <set>
 
 #include <wx/xml/xml.h>
 #include <wx/spinctrl.h>
 #include <wx/display.h>
+#include <wx/thread.h>
 
 #include "univcsvdialog.h"
 
@@ -43,6 +46,7 @@
 #include "webapp.h"
 #include "parsers.h"
 #include "payeedialog.h"
+#include "phasetimer.h"
 #include "categdialog.h"
 
 #include "model/Model_Setting.h"
@@ -58,6 +62,91 @@ enum tab_id {
     CAT_TAB = 4,
 };
 
+namespace
+{
+    // Columns of the file holding the names to be matched, -1 when not mapped
+    struct NameColumns
+    {
+        int payee;
+        int category;
+        int subcategory;
+    };
+
+    // Payee and category names of a batch of rows, once each ignoring case,
+    // in the order they first appear. An empty name stands for a row without one.
+    struct RowNames
+    {
+        std::vector<wxString> payees;
+        std::vector<wxString> categories;
+    };
+
+    // Trims the names and drops the repeated ones, the only work of the preview done
+    // on worker threads. Uses nothing but its arguments, so batches can be scanned on any thread
+    void collectNames(const std::vector<std::vector<wxString>>& rows, const NameColumns& columns, RowNames& names)
+    {
+        std::set<wxString, caseInsensitiveComparator> payees, categories;
+        auto field = [](const std::vector<wxString>& fields, int col, wxString& value)
+        {
+            if (col < 0 || static_cast<size_t>(col) >= fields.size())
+                return false;
+            value = fields[col];
+            value.Trim().Trim(false);
+            return true;
+        };
+        auto addCategory = [&](const wxString& name)
+        {
+            if (categories.insert(name).second)
+                names.categories.push_back(name);
+        };
+
+        wxString payee, categ_name, subcat_name;
+        for (const auto& fields : rows)
+        {
+            if (field(fields, columns.payee, payee) && payees.insert(payee).second)
+                names.payees.push_back(payee);
+
+            categ_name.clear();
+            if (field(fields, columns.category, categ_name))
+            {
+                mmCSVImporter::normalizeCategoryDelimiter(categ_name);
+                addCategory(categ_name);
+            }
+
+            if (field(fields, columns.subcategory, subcat_name) && !subcat_name.IsEmpty())
+            {
+                subcat_name.Replace(":", "|");
+                categ_name.Append((!categ_name.IsEmpty() ? ":" : "") + subcat_name);
+                addCategory(categ_name);
+            }
+        }
+    }
+
+    // Collects the names of a batch on a worker thread
+    class NameScan : public wxThread
+    {
+    public:
+        NameScan(std::vector<std::vector<wxString>>& rows, const NameColumns& columns)
+            : wxThread(wxTHREAD_JOINABLE), m_columns(columns)
+        {
+            m_rows.swap(rows);
+        }
+        void collect() { collectNames(m_rows, m_columns, m_names); }
+        const RowNames& names() const { return m_names; }
+
+    protected:
+        virtual ExitCode Entry()
+        {
+            collect();
+            return nullptr;
+        }
+
+    private:
+        std::vector<std::vector<wxString>> m_rows;
+        const NameColumns m_columns;
+        RowNames m_names;
+    };
+}
+
 wxIMPLEMENT_DYNAMIC_CLASS(mmUnivCSVDialog, wxDialog);
 
 wxBEGIN_EVENT_TABLE(mmUnivCSVDialog, wxDialog)
@@ -95,10 +184,9 @@ mmUnivCSVDialog::mmUnivCSVDialog(
 ) :
     dialogType_(dialogType),
     m_account_id(account_id),
-    m_file_path(file_path),
-    decimal_(Model_Currency::GetBaseCurrency()->DECIMAL_POINT),
-    depositType_(Model_Checking::TYPE_STR_DEPOSIT)
+    m_file_path(file_path)
 {
+    decimal_ = Model_Currency::GetBaseCurrency()->DECIMAL_POINT;
     CSVFieldName_[UNIV_CSV_ID] = wxTRANSLATE("ID");
     CSVFieldName_[UNIV_CSV_DATE] = wxTRANSLATE("Date");
     CSVFieldName_[UNIV_CSV_STATUS] = wxTRANSLATE("Status");
@@ -1238,64 +1326,6 @@ void mmUnivCSVDialog::saveAccountPresets()
     );
 }
 
-bool mmUnivCSVDialog::validateData(tran_holder & holder, wxString& message)
-{
-    bool is_valid = true;
-    if (!holder.valid) {
-        is_valid = false;
-        if (!holder.Date.IsValid()) message << " " << _("Invalid Date.");
-        if (!holder.Amount) message << " " << _("Invalid Amount.");
-        if (holder.Type.Trim().IsEmpty()) message << " " << _("Type (withdrawal/deposit) unknown.");
-    }
-
-    // If we are importing any custom field data test for validity
-    if (!holder.customFieldData.empty())
-        for (auto& cfdata : holder.customFieldData)
-            is_valid &= validateCustomFieldData(cfdata.first, cfdata.second, message);
-
-    Model_Payee::Data* payee = Model_Payee::instance().get(holder.PayeeID);
-    if (!payee)
-    {
-        Model_Payee::Data* u = Model_Payee::instance().get(_("Unknown"));
-        if (!u) {
-            Model_Payee::Data *p = Model_Payee::instance().create();
-            p->PAYEENAME = _("Unknown");
-            p->ACTIVE = 1;
-            p->CATEGID = -1;
-            holder.PayeeID = Model_Payee::instance().save(p);
-            const wxString& sMsg = wxString::Format(_("Added payee: %s"), p->PAYEENAME);
-            log_field_->AppendText(wxString() << sMsg << "\n");
-        }
-        else {
-            holder.PayeeID = u->PAYEEID;
-        }
-    }
-    else
-    {
-        if (holder.CategoryID < 0) {
-            holder.CategoryID = payee->CATEGID;
-        }
-    }
-
-    if (holder.CategoryID == -1) //The category name is missing in SCV file and not assigned for the payee
-    {
-        Model_Category::Data* categ = Model_Category::instance().get(_("Unknown"), int64(-1));
-        if (categ) {
-            holder.CategoryID = categ->CATEGID;
-        }
-        else
-        {
-            Model_Category::Data *c = Model_Category::instance().create();
-            c->CATEGNAME = _("Unknown");
-            c->ACTIVE = 1;
-            c->PARENTID = -1;
-            holder.CategoryID = Model_Category::instance().save(c);
-        }
-    }
-
-    return is_valid;
-}
-
 void mmUnivCSVDialog::OnImport(wxCommandEvent& WXUNUSED(event))
 {
     // date and amount are required
@@ -1310,8 +1340,6 @@ void mmUnivCSVDialog::OnImport(wxCommandEvent& WXUNUSED(event))
             + (!amountfields ? "\n" + _("Amount field or both Withdrawal and Deposit fields are required.") : "")
             , _("Import"), wxICON_WARNING);
 
-    bool is_canceled = false;
-    long nImportedLines = 0;
     const wxString acctName = m_choice_account_->GetStringSelection();
     Model_Account::Data* account = Model_Account::instance().get(acctName);
 
@@ -1329,7 +1357,7 @@ void mmUnivCSVDialog::OnImport(wxCommandEvent& WXUNUSED(event))
     // Open and parse file
     wxSharedPtr<ITransactionsFile> pParser(CreateFileHandler());
     if (!pParser) return; // is this possible?
-    if (!pParser->Load(fileName, m_list_ctrl_->GetColumnCount())) {
+    if (!pParser->Open(fileName, m_list_ctrl_->GetColumnCount())) {
         return;
     }
 
@@ -1338,14 +1366,13 @@ void mmUnivCSVDialog::OnImport(wxCommandEvent& WXUNUSED(event))
     logFile.SetExt("txt");
 
     wxFileOutputStream outputLog(logFile.GetFullPath());
-    wxTextOutputStream log(outputLog);
+    wxTextOutputStream logText(outputLog);
 
     /* date, payeename, amount(+/-), Number, status, category : subcategory, notes */
-    const long totalLines = pParser->GetLinesCount();
-    long firstRow = m_spinIgnoreFirstRows_->GetValue();
-    long lastRow = totalLines - m_spinIgnoreLastRows_->GetValue();
-    const long linesToImport = lastRow - firstRow;
-    long countEmptyLines = 0;
+    const long firstRow = m_spinIgnoreFirstRows_->GetValue();
+    const long ignoreLastRows = m_spinIgnoreLastRows_->GetValue();
+    // The lines are read while they are imported, the count of the preview only sizes the progress
+    const long progressRange = std::max(static_cast<long>(m_previewLines) - firstRow - ignoreLastRows, 1L);
     int color_id = colorCheckBox_->IsChecked() ? colorButton_->GetColorId() : -1;
     if (colorCheckBox_->IsChecked() && (color_id < 0 || color_id > 7) ) {
         return mmErrorDialogs::ToolTip4Object(colorButton_, _("Color"), _("Invalid value"), wxICON_ERROR);
@@ -1356,137 +1383,39 @@ void mmUnivCSVDialog::OnImport(wxCommandEvent& WXUNUSED(event))
     Model_CustomFieldData::instance().Savepoint("IMP");
 
     wxProgressDialog progressDlg(_("Universal CSV Import")
-        , wxEmptyString, linesToImport
+        , wxEmptyString, progressRange
         , nullptr, wxPD_AUTO_HIDE | wxPD_APP_MODAL | wxPD_SMOOTH | wxPD_CAN_ABORT
         | wxPD_ELAPSED_TIME | wxPD_REMAINING_TIME
     );
     progressDlg.Fit();
 
-    m_reverce_sign = m_choiceAmountFieldSign->GetCurrentSelection() == PositiveIsWithdrawal;
-    // A place to store all rejected rows to display after import
-    wxString rejectedRows;
-    wxString reftype = Model_Attachment::REFTYPE_STR_TRANSACTION;
-    for (long nLines = firstRow; nLines < lastRow; nLines++)
-    {
-        const wxString& progressMsg = wxString::Format(_("Transactions imported to account %s: %ld")
-            , "'" + acctName + "'", nImportedLines);
-        if (!progressDlg.Update(nLines - firstRow, progressMsg))
-        {
-            is_canceled = true;
-            break; // abort processing
-        }
-
-        unsigned int numTokens = pParser->GetItemsCount(nLines);
-        unsigned int blankTokenCount = 0;
-        tran_holder holder;
-        wxString rowString;
-        if (numTokens != 0)
-        {
-            for (size_t i = 0; i < csvFieldOrder_.size() && i < numTokens; ++i) {
-                wxString token = pParser->GetItem(nLines, i).Trim(false /*from left*/);
-                // Store the CSV row to display in case the row is rejected
-                rowString << inQuotes(token,",") << ((i < numTokens - 1) ? "," : "");
-                if (!token.IsEmpty())
-                    parseToken(csvFieldOrder_[i].first, token, holder);
-                else blankTokenCount++; // keep track of blank fields
-            }
-        }
-        // if the line had no field separators or all fields were blank (",,,,,")
-        if (numTokens == 0 || blankTokenCount == numTokens)
-        {
-            wxString msg = wxString::Format(_("Line %ld: Empty"), nLines + 1);
-            log << msg << endl;
-            *log_field_ << msg << "\n";
-            countEmptyLines++;
-            continue;
-        }
-
-        wxString message;
-        // validate data and store any error messages
-        if (!validateData(holder, message))
-        {
-            wxString msg = wxString::Format(_("Line %ld: Error:"), nLines + 1);
-            msg << " " << message;
-            log << msg << endl;
-            *log_field_ << msg << "\n";
-            // row was rejected so save it to rejectedRows
-            rejectedRows << rowString << "\n";
-            continue;
-        }
-
-        wxString trxDate = holder.Date.FormatISOCombined();
-        Model_Account::Data* account2 = Model_Account::instance().get(accountID_);
-        const Model_Account::Data* toAccount = Model_Account::instance().get(holder.ToAccountID);
-        if ((trxDate < account2->INITIALDATE) ||
-            (toAccount && (trxDate < toAccount->INITIALDATE)))
-        {
-            wxString msg = wxString::Format(_("Line %ld: %s"), nLines + 1,
-                _("The opening date for the account is later than the date of this transaction"));
-            log << msg << endl;
-            *log_field_ << msg << "\n";
-            // row was rejected so save it to rejectedRows
-            rejectedRows << rowString << "\n";
-            continue;
-        }
-
-        Model_Checking::Data *pTransaction = Model_Checking::instance().create();
-        pTransaction->TRANSDATE = trxDate;
-        pTransaction->ACCOUNTID = accountID_;
-        pTransaction->TOACCOUNTID = holder.ToAccountID;
-        pTransaction->PAYEEID = holder.PayeeID;
-        pTransaction->TRANSCODE = holder.Type;
-        pTransaction->TRANSAMOUNT = holder.Amount;
-        pTransaction->TOTRANSAMOUNT = holder.ToAmount;
-        pTransaction->CATEGID = holder.CategoryID;
-        pTransaction->STATUS = holder.Status;
-        pTransaction->TRANSACTIONNUMBER = holder.Number;
-        pTransaction->NOTES = holder.Notes;
-        if (payeeMatchAddNotes_->IsChecked() && !holder.PayeeMatchNotes.IsEmpty())
-            pTransaction->NOTES.Append((pTransaction->NOTES.IsEmpty() ? "" : "\n" ) + holder.PayeeMatchNotes);
-        pTransaction->COLOR = color_id;
-
-        Model_Checking::instance().save(pTransaction);
-
-        // save custom field data
-        if (!holder.customFieldData.empty())
-        {
-            for (const auto& field : holder.customFieldData)
-            {
-                Model_CustomFieldData::Data* cfdata = Model_CustomFieldData::instance().create();
-                cfdata->FIELDID = field.first;
-                cfdata->REFID = pTransaction->TRANSID;
-                cfdata->CONTENT = field.second;
-                Model_CustomFieldData::instance().save(cfdata);
-            }
-        }
-
-        // save tags
-        if (!holder.tagIDs.empty())
-        {
-            for (const auto& tag : holder.tagIDs)
-            {
-                Model_Taglink::Data* taglink = Model_Taglink::instance().create();
-                taglink->REFTYPE = reftype;
-                taglink->REFID = pTransaction->TRANSID;
-                taglink->TAGID = tag;
-                Model_Taglink::instance().save(taglink);
-            }
-        }
-
-        nImportedLines++;
-        wxString msg = wxString::Format(_("Line %ld: OK, imported."), nLines + 1);
-        log << msg << endl;
-        *log_field_ << msg << "\n";
-    }
+    m_amountFieldSign = m_choiceAmountFieldSign->GetCurrentSelection();
+    m_matchAddNotes = payeeMatchAddNotes_->IsChecked();
+    m_colorId = color_id;
+    m_progress = &progressDlg;
+    m_progressRange = progressRange;
+    m_log = &logText;
+    mmPhaseTimer timer("CSV import");
+    const Totals totals = importRows(*pParser, firstRow, ignoreLastRows, timer);
+    m_progress = nullptr;
+    m_log = nullptr;
+    wxLogDebug("%s", timer.summary());
+
+    const long totalLines = totals.lines;
+    const long countEmptyLines = totals.empty;
+    const long nImportedLines = totals.imported;
+    const wxString& rejectedRows = totals.rejectedRows;
+    bool is_canceled = totals.canceled;
+    const long linesToImport = std::max(totalLines - firstRow - ignoreLastRows, 0L);
 
     // If any rows were rejected, display CSV rows in the log field and log file
     // so that users can easily copy/paste errored records for reimport
     if (!rejectedRows.IsEmpty())
     {
         *log_field_ << "\n" << _("Rejected rows:") << "\n" << rejectedRows;
-        log << "\nRejected rows:\n" << rejectedRows;
+        logText << "\nRejected rows:\n" << rejectedRows;
     }
-    progressDlg.Update(linesToImport);
+    progressDlg.Update(progressRange);
 
     wxString msg = wxString::Format(_("Total Lines: %ld"), totalLines);
     msg << "\n";
@@ -1551,6 +1480,21 @@ void mmUnivCSVDialog::OnImport(wxCommandEvent& WXUNUSED(event))
     refreshTabs(PAYEE_TAB | CAT_TAB);
 }
 
+void mmUnivCSVDialog::log(const wxString& msg)
+{
+    if (m_log)
+        *m_log << msg << endl;
+    *log_field_ << msg << "\n";
+}
+
+bool mmUnivCSVDialog::importProgress(long line, long imported)
+{
+    const wxString acctName = m_choice_account_->GetStringSelection();
+    const wxString& progressMsg = wxString::Format(_("Transactions imported to account %s: %ld")
+        , "'" + acctName + "'", imported);
+    return !m_progress || m_progress->Update(std::min(line, m_progressRange - 1), progressMsg);
+}
+
 void mmUnivCSVDialog::OnExport(wxCommandEvent& WXUNUSED(event))
 {
     // date and amount are required
@@ -1756,7 +1700,9 @@ void mmUnivCSVDialog::update_preview()
     ++colCount;
 
     const int MAX_ROWS_IN_PREVIEW = 50;
+    const unsigned int MAX_ROWS_IN_IMPORT_PREVIEW = 1000;
     const int MAX_COLS = 30; // Not including line number col.
+    const size_t SCAN_BATCH_ROWS = 20000;
     int date_col = -1;
     int payee_col = -1;
     int cat_col = -1;
@@ -1793,98 +1739,144 @@ void mmUnivCSVDialog::update_preview()
 
         if (payee_col >= 0) compilePayeeRegEx();
 
-        // Open and parse file
-        std::unique_ptr <ITransactionsFile> pImporter(CreateFileHandler());
-        pImporter->Load(fileName, MAX_COLS);
-
-        unsigned int totalLines = pImporter->GetLinesCount();
-        unsigned int firstRow = m_spinIgnoreFirstRows_->GetValue();
-        unsigned int lastRow = totalLines - m_spinIgnoreLastRows_->GetValue();
+        const unsigned int firstRow = m_spinIgnoreFirstRows_->GetValue();
+        const size_t ignoreLastRows = m_spinIgnoreLastRows_->GetValue();
 
         std::unique_ptr<mmDates> dParser(new mmDates);
-        wxRegEx categDelimiterRegex(" ?: ?");
-        // Import- Add rows to preview
-        for (unsigned int row = 0; row < totalLines; row++)
+
+        // Import- Add a row to preview, the columns are added before for all the rows
+        auto addPreviewRow = [&](unsigned int row, const std::vector<wxString>& fields)
         {
-            unsigned int col = 0;
             wxString buf;
-            buf.Printf("%d", col);
+            buf.Printf("%d", 0);
             long itemIndex = m_list_ctrl_->InsertItem(row, buf, 0);
             buf.Printf("%d", row + 1);
-            m_list_ctrl_->SetItem(itemIndex, col, buf);
-            wxString categ_name;
-            wxString subcat_name;
-            // Cols
-            while (col < pImporter->GetItemsCount(row) && col + 1 <= MAX_COLS)
+            m_list_ctrl_->SetItem(itemIndex, 0, buf);
+            for (unsigned int col = 0; col < fields.size(); col++)
+                m_list_ctrl_->SetItem(itemIndex, col + 1, fields[col]);
+        };
+
+        // Add the names of a scanned batch, batches must come in the order of the file
+        std::set<wxString, caseInsensitiveComparator> payeeNames;
+        auto mergeNames = [&](const RowNames& names)
+        {
+            for (const auto& payee : names.payees)
             {
-                // Add a new column
-                if (col == colCount - 1)
-                {
-                    m_list_ctrl_->InsertColumn(colCount, getCSVFieldName(-1));
-                    colCount++;
-                }
-
-                auto content = pImporter->GetItem(row, col).Trim().Trim(false);
-                
-                // add payee names to list
-                if (row >= firstRow
-                    && row < lastRow
-                    && col == static_cast<unsigned>(payee_col))
-
-                {
-                    if (!content.IsEmpty())
-                    {
-                        if (m_payee_names.Index(content, false) == wxNOT_FOUND)
-                            m_payee_names.Add(content);
-                    } else if (m_payee_names.Index(_("Unknown"), false) == wxNOT_FOUND)
-                    {
-                        m_payee_names.Add(_("Unknown"));
-                        m_CSVpayeeNames[_("Unknown")] = std::make_tuple(-1, "", "");
-                    }
-                }
-
-                if (row >= firstRow
-                    && row < lastRow
-                    && col == static_cast<unsigned>(cat_col))
-                {
-                    if (!content.IsEmpty())
-                    {
-                        // Use the ":" category delimiter to put all imported names in a consistent format.
-                        categDelimiterRegex.Replace(&content, ":");
-                        m_CSVcategoryNames[content] = -1;
-                        categ_name = content;
-                    } else
-                        m_CSVcategoryNames[_("Unknown")] = -1;
-                }                    
-
-                if (row >= firstRow
-                    && row < lastRow
-                    && col == static_cast<unsigned>(subcat_col))
-                {
-                    subcat_name = content;
-                }
-
-                if (!m_userDefinedDateMask
-                    && row >= firstRow
-                    && row < lastRow
-                    && col == static_cast<unsigned>(date_col))
+                const wxString name = payee.IsEmpty() ? _("Unknown") : payee;
+                if (!payeeNames.insert(name).second)
+                    continue;
+                m_payee_names.Add(name);
+                if (payee.IsEmpty())
+                    m_CSVpayeeNames[name] = std::make_tuple(-1, "", "");
+            }
+            for (const auto& categ : names.categories)
+                m_CSVcategoryNames[categ.IsEmpty() ? _("Unknown") : categ] = -1;
+        };
+
+        // Only the trimming and the de-duplication of the payee and category names
+        // run in batches on worker threads while the file is read. The rest stays on
+        // this thread, one row after the other: the read of the file, the preview,
+        // the date statistics, which depend on the order of the rows, and the merge
+        // of the names in file order. The parse and the checks of the dates, amounts,
+        // payees and categories are not done here at all, they are done serially by
+        // mmCSVImporter::importRows() on import, which creates the missing payees,
+        // categories and tags in the database as it goes.
+        const NameColumns nameColumns = { payee_col, cat_col, subcat_col };
+        const size_t maxScans = static_cast<size_t>(std::max(wxThread::GetCPUCount(), 1));
+        std::deque<std::unique_ptr<NameScan>> scans;
+        std::vector<std::vector<wxString>> batch;
+        auto finishScan = [&]()
+        {
+            scans.front()->Wait();
+            mergeNames(scans.front()->names());
+            scans.pop_front();
+        };
+        auto scanBatch = [&]()
+        {
+            std::unique_ptr<NameScan> scan(new NameScan(batch, nameColumns));
+            batch.clear();
+            if (scan->Run() == wxTHREAD_NO_ERROR)
+            {
+                scans.push_back(std::move(scan));
+                if (scans.size() > maxScans)
+                    finishScan();
+                return;
+            }
+            // no thread, the earlier batches still go first
+            while (!scans.empty())
+                finishScan();
+            scan->collect();
+            mergeNames(scan->names());
+        };
+
+        // Only the first rows are shown, the names are collected from all the rows to be imported.
+        // Whether a row is one of the ignored last ones is known once that many rows follow it.
+        std::deque<std::vector<wxString>> tailRows;
+        unsigned int totalLines = 0;
+        auto addRow = [&](const std::vector<wxString>& fields)
+        {
+            // The import takes as many items of a line as there are columns, rows past the shown ones count as well
+            while (colCount <= fields.size())
+            {
+                m_list_ctrl_->InsertColumn(colCount, getCSVFieldName(-1));
+                colCount++;
+            }
+            if (totalLines < MAX_ROWS_IN_IMPORT_PREVIEW)
+            {
+                std::vector<wxString> shown = fields;
+                for (auto& content : shown)
+                    content.Trim().Trim(false);
+                if (cat_col >= 0 && static_cast<unsigned>(cat_col) < shown.size())
+                    normalizeCategoryDelimiter(shown[cat_col]);
+                addPreviewRow(totalLines, shown);
+            }
+            if (totalLines >= firstRow)
+            {
+                tailRows.push_back(fields);
+                if (tailRows.size() > ignoreLastRows)
                 {
-                    dParser->doHandleStatistics(content);
+                    std::vector<wxString>& row = tailRows.front();
+                    if (!m_userDefinedDateMask && date_col >= 0 && static_cast<unsigned>(date_col) < row.size())
+                        dParser->doHandleStatistics(wxString(row[date_col]).Trim().Trim(false));
+                    batch.push_back(std::vector<wxString>());
+                    batch.back().swap(row);
+                    tailRows.pop_front();
+                    if (batch.size() >= SCAN_BATCH_ROWS)
+                        scanBatch();
                 }
-
-                ++col;
-                m_list_ctrl_->SetItem(itemIndex, col, content);
             }
+            totalLines++;
+        };
 
-            if (!subcat_name.IsEmpty())
+        // Open and parse file
+        std::vector<wxString> fields;
+        std::unique_ptr <ITransactionsFile> pImporter(CreateFileHandler());
+        if (pImporter->Open(fileName, MAX_COLS))
+        {
+            while (pImporter->NextLine())
             {
-                subcat_name.Replace(":", "|");
-                categ_name.Append((!categ_name.IsEmpty() ? ":" : "") + subcat_name);
-                m_CSVcategoryNames[categ_name] = -1;
+                fields.resize(pImporter->GetItemsCount());
+                for (unsigned int col = 0; col < fields.size(); col++)
+                    fields[col] = pImporter->GetItem(col);
+                addRow(fields);
             }
         }
+        if (scans.empty())
+        {
+            RowNames names;
+            collectNames(batch, nameColumns, names);
+            mergeNames(names);
+        }
+        else
+        {
+            if (!batch.empty())
+                scanBatch();
+            while (!scans.empty())
+                finishScan();
+        }
+        m_previewLines = totalLines;
 
-        m_spinIgnoreLastRows_->SetRange(m_spinIgnoreLastRows_->GetMin(), m_list_ctrl_->GetItemCount());
+        m_spinIgnoreLastRows_->SetRange(m_spinIgnoreLastRows_->GetMin(), m_previewLines);
         UpdateListItemBackground();
 
         if (!m_userDefinedDateMask)
@@ -2312,70 +2304,20 @@ void mmUnivCSVDialog::OnDecimalChange(wxCommandEvent& event)
     event.Skip();
 }
 
-void mmUnivCSVDialog::compilePayeeRegEx() {
+void mmUnivCSVDialog::compilePayeeRegEx()
+{
     // pre-compile all payee match strings if not already done
-    if (payeeMatchCheckBox_->IsChecked() && !payeeRegExInitialized_) {
-        payeeMatchPatterns_.clear();
-        // only look at payees that have a match pattern set
-        Model_Payee::Data_Set payees = Model_Payee::instance().find(Model_Payee::PATTERN(wxEmptyString, NOT_EQUAL));
-        for (const auto& payee : payees) {
-            Document json_doc;
-            if (json_doc.Parse(payee.PATTERN.utf8_str()).HasParseError()) {
-                continue;
-            }
-            int key = -1;
-            // loop over all keys in the pattern json data
-            for (const auto& member : json_doc.GetObject()) {
-                key++;
-                wxString pattern = member.value.GetString();
-                // add the pattern string (for non-regex match, match notes, and the payee tab preview)
-                payeeMatchPatterns_[std::make_pair(payee.PAYEEID, payee.PAYEENAME)][key].first = pattern;
-                // complie the regex if necessary
-                if (pattern.StartsWith("regex:")) {
-                    payeeMatchPatterns_[std::make_pair(payee.PAYEEID, payee.PAYEENAME)][key].second.Compile(pattern.Right(pattern.length() - 6), wxRE_ICASE | wxRE_EXTENDED);
-                }
-            }
-        }
+    if (payeeMatchCheckBox_->IsChecked() && !payeeRegExInitialized_)
+    {
+        payeeMatcher_.load();
         payeeRegExInitialized_ = true;
     }
 }
 
-void mmUnivCSVDialog::validatePayees() {
+void mmUnivCSVDialog::validatePayees()
+{
     if (!payeeRegExInitialized_) compilePayeeRegEx();
-
-    for (const auto& payee_name : m_payee_names) {
-        bool payee_found = false;
-        // initialize
-        m_CSVpayeeNames[payee_name] = std::make_tuple(-1, "", "");
-        // perform pattern match
-        if (payeeMatchCheckBox_->IsChecked()) {
-            // loop over all the precompiled patterns
-            for (const auto& payeeId : payeeMatchPatterns_) {
-                for (const auto& pattern : payeeId.second) {
-                    bool match = false;
-                    // match against regex if the pattern begins with "regex:"
-                    if (pattern.second.first.StartsWith("regex:"))
-                        match = pattern.second.second.Matches(payee_name);
-                    else // use the normal wxString match for non-regex patterns
-                        match = payee_name.Lower().Matches(pattern.second.first.Lower());
-                    if (match)
-                    {
-                        payee_found = true;
-                        // save the target payee ID, name, and match details
-                        m_CSVpayeeNames[payee_name] = std::make_tuple(payeeId.first.first, payeeId.first.second, pattern.second.first);
-                        break;
-                    }
-                }
-                if (payee_found) break;
-            }
-        }
-        if (!payee_found) {
-            Model_Payee::Data* payee = Model_Payee::instance().get(payee_name);
-            if (payee) {
-                m_CSVpayeeNames[payee_name] = std::make_tuple(payee->PAYEEID, payee->PAYEENAME, "");
-            }
-        }
-    }
+    matchPayees(m_payee_names, payeeMatchCheckBox_->IsChecked() ? &payeeMatcher_ : nullptr);
 }
 
 void mmUnivCSVDialog::validateCategories() {
@@ -2401,210 +2343,6 @@ void mmUnivCSVDialog::validateCategories() {
     }
 }
 
-void mmUnivCSVDialog::parseToken(int index, const wxString& orig_token, tran_holder& holder)
-{
-    if (orig_token.IsEmpty()) return;
-    wxString token = orig_token.Strip(wxString::leading).Strip(wxString::trailing);
-
-    double amount;
-
-    switch (index)
-    {
-    case UNIV_CSV_DATE:
-    {
-        wxDateTime dtdt;
-        if (mmParseDisplayStringToDate(dtdt, token, date_format_))
-            holder.Date = dtdt;
-        else
-            holder.valid = false;
-        break;
-    }
-    case UNIV_CSV_PAYEE:
-        if (m_CSVpayeeNames.find(token) != m_CSVpayeeNames.end() && std::get<0>(m_CSVpayeeNames[token]) != -1)
-        {
-            holder.PayeeID = std::get<0>(m_CSVpayeeNames[token]);
-            if (payeeMatchAddNotes_->IsChecked() && !std::get<2>(m_CSVpayeeNames[token]).IsEmpty())
-            {
-                holder.PayeeMatchNotes = wxString::Format(_("%1$s matched by %2$s"), token, std::get<2>(m_CSVpayeeNames[token]));
-            }
-        }
-        else
-        {
-            Model_Payee::Data* payee = Model_Payee::instance().create();
-            payee->PAYEENAME = token;
-            payee->ACTIVE = 1;
-            holder.PayeeID = Model_Payee::instance().save(payee);
-            m_CSVpayeeNames[token] = std::make_tuple(holder.PayeeID, token, wxEmptyString);
-        }
-        break;
-
-    case UNIV_CSV_AMOUNT:
-        mmTrimAmount(token, decimal_, ".").ToCDouble(&amount);
-
-        if (find_if(csvFieldOrder_.begin(), csvFieldOrder_.end(), [](const std::pair<int, int>& element) {return element.first == UNIV_CSV_TYPE; }) == csvFieldOrder_.end()) {
-            if ((amount > 0.0 && !m_reverce_sign) || (amount <= 0.0 && m_reverce_sign)) {
-                holder.Type = Model_Checking::TYPE_STR_DEPOSIT;
-            }
-        }
-
-        holder.Amount = fabs(amount);
-        break;
-
-    case UNIV_CSV_CATEGORY:
-    {
-        // Convert to standard delimiter for consistency
-        wxRegEx categDelimiterRegex(" ?: ?");
-        categDelimiterRegex.Replace(&token, ":");
-        // check if we already have this category
-        if (m_CSVcategoryNames.find(token) != m_CSVcategoryNames.end() && m_CSVcategoryNames[token] != -1)
-            holder.CategoryID = m_CSVcategoryNames[token];
-        else // create category and any missing parent categories
-        {
-            Model_Category::Data* category = nullptr;
-            int64 parentID = -1;
-            wxStringTokenizer tokenizer = wxStringTokenizer(token, ":");
-            while (tokenizer.HasMoreTokens())
-            {
-                wxString categname = tokenizer.GetNextToken().Trim().Trim(false);
-                category = Model_Category::instance().get(categname, parentID);
-                if (!category)
-                {
-                    category = Model_Category::instance().create();
-                    category->CATEGNAME = categname;
-                    category->PARENTID = parentID;
-                    category->ACTIVE = 1;
-                    Model_Category::instance().save(category);
-                }
-                parentID = category->CATEGID;
-            }
-
-            if (category)
-            {
-                holder.CategoryID = category->CATEGID;
-                m_CSVcategoryNames[token] = category->CATEGID;
-            }
-        }
-        break;
-    }
-    case UNIV_CSV_SUBCATEGORY:
-    {
-        if (holder.CategoryID == -1)
-            return;
-
-        token.Replace(":", "|");
-        wxString categname = Model_Category::full_name(holder.CategoryID);
-        categname.Append(":" + token);
-        if (m_CSVcategoryNames.find(categname) != m_CSVcategoryNames.end() && m_CSVcategoryNames[categname] != -1)
-            holder.CategoryID = m_CSVcategoryNames[categname];
-        else
-        {
-            Model_Category::Data* category = Model_Category::instance().create();
-            category->PARENTID = holder.CategoryID;
-            category->CATEGNAME = token;
-            category->ACTIVE = 1;
-            Model_Category::instance().save(category);
-
-            holder.CategoryID = category->CATEGID;
-            m_CSVcategoryNames[categname] = category->CATEGID;
-        }
-        break;
-    }
-    case UNIV_CSV_TAGS:
-    {
-        // split the tag string at space characters
-        wxStringTokenizer tokenizer = wxStringTokenizer(token, " ");
-        while (tokenizer.HasMoreTokens())
-        {
-            wxString tagname = tokenizer.GetNextToken();
-            // check for an existing tag
-            Model_Tag::Data* tag = Model_Tag::instance().get(tagname);
-            if (!tag)
-            {
-                // create a new tag if we didn't find one
-                tag = Model_Tag::instance().create();
-                tag->TAGNAME = tagname;
-                tag->ACTIVE = 1;
-                Model_Tag::instance().save(tag);
-            }
-            // add the tagID to the transaction if it isn't already there
-            if (std::find(holder.tagIDs.begin(), holder.tagIDs.end(), tag->TAGID) == holder.tagIDs.end())
-                holder.tagIDs.push_back(tag->TAGID);
-        }
-        break;
-    }
-    case UNIV_CSV_TRANSNUM:
-        holder.Number = token;
-        break;
-
-    case UNIV_CSV_NOTES:
-        token.Replace("\\n", "\n");
-        holder.Notes += (holder.Notes.IsEmpty() ? "" : "\n") + token;
-        break;
-
-    case UNIV_CSV_WITHDRAWAL:
-        if (token.IsEmpty())
-            return;
-
-        // do nothing if an amount has already been stored by a previous call #3168
-        if (holder.Amount != 0.0)
-            break;
-
-        if (!mmTrimAmount(token, decimal_, ".").ToCDouble(&amount))
-            break;
-
-        if (amount == 0.0)
-            break;
-
-        holder.Amount = fabs(amount);
-        holder.Type = Model_Checking::TYPE_STR_WITHDRAWAL;
-        break;
-
-    case UNIV_CSV_DEPOSIT:
-        if (token.IsEmpty())
-            return;
-
-        // do nothing if an amount has already been stored by a previous call #3168
-        if (holder.Amount != 0.0)
-            break;
-
-        if (!mmTrimAmount(token, decimal_, ".").ToCDouble(&amount))
-            break;
-
-        if (amount == 0.0)
-            break;
-
-        holder.Amount = fabs(amount);
-        holder.Type = Model_Checking::TYPE_STR_DEPOSIT;
-        break;
-
-        // A number of type options are supported to make amount positive 
-        // ('debit' seems odd but is there for backwards compatability!)
-    case UNIV_CSV_TYPE:
-        if (m_choiceAmountFieldSign->GetSelection() == DefindByType)
-        {
-            if (depositType_.CmpNoCase(token) == 0)
-            {
-                holder.Type = Model_Checking::TYPE_STR_DEPOSIT;
-                break;
-            }
-        }
-        else
-        {
-            for (const wxString entry : { "debit", "deposit", "+" }) {
-                if (entry.CmpNoCase(token) == 0) {
-                    holder.Type = Model_Checking::TYPE_STR_DEPOSIT;
-                    break;
-                }
-            }
-        }
-        break;
-    default:
-        if (index > UNIV_CSV_LAST) // custom fields
-            holder.customFieldData[index - UNIV_CSV_LAST] = token;
-        break;
-    }
-}
-
 void mmUnivCSVDialog::OnButtonClear(wxCommandEvent& WXUNUSED(event))
 {
     log_field_->Clear();
@@ -2714,7 +2452,7 @@ void mmUnivCSVDialog::OnSpinCtrlIgnoreRows(wxSpinEvent& WXUNUSED(event))
 void mmUnivCSVDialog::UpdateListItemBackground()
 {
     int firstRow = m_spinIgnoreFirstRows_->GetValue();
-    int lastRow = m_list_ctrl_->GetItemCount() - m_spinIgnoreLastRows_->GetValue() - 1;
+    int lastRow = (IsImporter() ? static_cast<int>(m_previewLines) : m_list_ctrl_->GetItemCount()) - m_spinIgnoreLastRows_->GetValue() - 1;
     for (int row = 0; row < m_list_ctrl_->GetItemCount(); row++)
     {
         wxColour color = row >= firstRow && row <= lastRow ? m_list_ctrl_->GetBackgroundColour() : *wxLIGHT_GREY;
@@ -2780,143 +2518,3 @@ void mmUnivCSVDialog::OnMenuSelected(wxCommandEvent&)
     colorButton_->Enable(false);
     colorCheckBox_->SetValue(false);
 }
-
-/* Validates the specified string matches the parameters of the target Custom Field.
-Cleanses the value and reformats as needed for DB storage
-*/
-bool mmUnivCSVDialog::validateCustomFieldData(int64 fieldId, wxString& value, wxString& message)
-{
-    bool is_valid = true;
-    long int_val;
-    int index;
-    double double_val;
-    wxDate date;
-    wxDateTime time;
-    wxArrayString choices;
-    wxStringTokenizer tokenizer;
-
-    // Set up valid boolean values
-    const wxString bool_true[] = { "True", "T", "1", "Y" };
-    const wxArrayString bool_true_array(4, bool_true);
-    const wxString bool_false[] = { "False", "F", "0", "N", ""};
-    const wxArrayString bool_false_array(4, bool_false);
-
-    if (!value.IsEmpty())
-    {
-        const Model_CustomField::Data* data = Model_CustomField::instance().get(fieldId);
-        wxString type_string = Model_CustomField::TYPE_STR[Model_CustomField::type_id(data)];
-        switch (Model_CustomField::type_id(data))
-        {
-            // Check if string can be read as an integer. Will fail if passed a double.
-        case Model_CustomField::TYPE_ID_INTEGER:
-            value = cleanseNumberString(value, true);
-            if (!value.ToCLong(&int_val))
-            {
-                message << " " << wxString::Format(_("Value %1$s for custom field '%2$s' is not type %3$s."), value, data->DESCRIPTION, type_string);
-                is_valid = false;
-            }
-            else value = wxString::Format("%i", int_val);
-            break;
-
-            // Check if string can be read as a double
-        case Model_CustomField::TYPE_ID_DECIMAL:
-            value = cleanseNumberString(value, true);
-            if (!value.ToCDouble(&double_val))
-            {
-                message << " " << wxString::Format(_("Value %1$s for custom field '%2$s' is not type %3$s."), value, data->DESCRIPTION, type_string);
-                is_valid = false;
-            }
-            else
-            {
-                // round to required precision
-                int precision = Model_CustomField::getDigitScale(data->PROPERTIES);
-                value = wxString::Format("%.*f", precision, double_val);
-            }
-            break;
-
-            // Check if string can be interpreted as "True" or "False" (case insensitive)    
-        case Model_CustomField::TYPE_ID_BOOLEAN:
-            if (bool_true_array.Index(value, false) == wxNOT_FOUND)
-                if (bool_false_array.Index(value, false) == wxNOT_FOUND)
-                {
-                    message << " " << wxString::Format(_("Value %1$s for custom field '%2$s' is not type %3$s."), value, data->DESCRIPTION, type_string);
-                    is_valid = false;
-                }
-                else value = "FALSE";
-            else value = "TRUE";
-            break;
-
-            // Check if string is a valid choice (case insensitive)
-        case Model_CustomField::TYPE_ID_SINGLECHOICE:
-            choices = Model_CustomField::getChoices(data->PROPERTIES);
-            index = choices.Index(value, false);
-            if (index == wxNOT_FOUND)
-            {
-                message << " " << wxString::Format(_("Value %1$s for %2$s custom field '%3$s' is not a valid selection."), value, type_string, data->DESCRIPTION);
-                is_valid = false;
-            }
-            else value = choices[index];
-            break;
-
-            // Check if all of the ';' delimited strings are valid choices (case insensitive)
-        case Model_CustomField::TYPE_ID_MULTICHOICE:
-            choices = Model_CustomField::getChoices(data->PROPERTIES);
-            tokenizer = wxStringTokenizer(value, ";");
-            value.Clear();
-            while (tokenizer.HasMoreTokens())
-            {
-                wxString token = tokenizer.GetNextToken();
-                index = choices.Index(token, false);
-                if (index != wxNOT_FOUND)
-                {
-                    value.Append(choices[index]);
-                    if (tokenizer.HasMoreTokens()) value.Append(";");
-                }
-                else {
-                    message << " " << wxString::Format(_("Value %1$s for %2$s custom field '%3$s' is not a valid selection."), token, type_string, data->DESCRIPTION);
-                    is_valid = false;
-                }
-            }
-            break;
-
-            // Parse the date using the user specified format. Convert to ISO date
-        case Model_CustomField::TYPE_ID_DATE:
-            if (!mmParseDisplayStringToDate(date, value, date_format_))
-            {
-                message << " " << wxString::Format(_("Value %1$s for custom field '%2$s' is not type %3$s."), value, data->DESCRIPTION, type_string) <<
-                    " " << wxString::Format(_("Confirm format matches selection %s."), date_format_);
-                is_valid = false;
-            }
-            else value = date.FormatISODate();
-            break;
-
-            // Parse the time. Convert to ISO Format
-        case Model_CustomField::TYPE_ID_TIME:
-            if (!time.ParseTime(value))
-            {
-                message << " " << wxString::Format(_("Value %1$s for custom field '%2$s' is not type %3$s."), value, data->DESCRIPTION, type_string);
-                is_valid = false;
-            }
-            else value = time.FormatISOTime();
-            break;
-
-        default: break;
-        }
-
-        // if regex check is enabled, perform regex validation
-        const wxString regExStr = Model_CustomField::getRegEx(data->PROPERTIES);
-        if (!regExStr.empty())
-        {
-            wxRegEx regEx(regExStr, wxRE_EXTENDED);
-
-            if (!regEx.Matches(value))
-            {
-                message << " " << wxString::Format(_("Value %1$s does not match regex %2$s for custom field '%3$s'."), value, regExStr, data->DESCRIPTION);
-                is_valid = false;
-            }
-        }
-
-    }
-
-    return is_valid;
-}
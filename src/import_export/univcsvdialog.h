@@ -25,6 +25,8 @@
 #include <wx/dataview.h>
 #include "Model_Checking.h"
 #include "mmSimpleDialogs.h"
+#include "payeematcher.h"
+#include "csv_import.h"
 class wxSpinCtrl;
 class wxSpinEvent;
 class wxListBox;
@@ -33,6 +35,8 @@ class wxChoice;
 class wxTextCtrl;
 class wxStaticBox;
 class wxCheckBox;
+class wxProgressDialog;
+class wxTextOutputStream;
 
 #define ID_MYDIALOG8 10040
 #define SYMBOL_UNIVCSVDIALOG_STYLE wxCAPTION|wxRESIZE_BORDER|wxSYSTEM_MENU|wxCLOSE_BOX
@@ -71,7 +75,7 @@ class wxCheckBox;
 
 class ITransactionsFile;
 
-class mmUnivCSVDialog: public wxDialog
+class mmUnivCSVDialog: public wxDialog, protected mmCSVImporter
 {
     wxDECLARE_DYNAMIC_CLASS(mmUnivCSVDialog);
     wxDECLARE_EVENT_TABLE();
@@ -104,54 +108,12 @@ public:
 private:
     wxButton* bImport_ = nullptr;
 
-    enum EUnivCvs
-    {
-        UNIV_CSV_ID = 0,
-        UNIV_CSV_DATE,
-        UNIV_CSV_STATUS,
-        UNIV_CSV_TYPE,
-        UNIV_CSV_ACCOUNT,
-        UNIV_CSV_PAYEE,
-        UNIV_CSV_AMOUNT,
-        UNIV_CSV_CURRENCY,
-        UNIV_CSV_CATEGORY,
-        UNIV_CSV_SUBCATEGORY,
-        UNIV_CSV_TAGS,
-        UNIV_CSV_TRANSNUM,
-        UNIV_CSV_NOTES,
-        UNIV_CSV_DONTCARE,
-        UNIV_CSV_WITHDRAWAL,
-        UNIV_CSV_DEPOSIT,
-        UNIV_CSV_BALANCE,
-        UNIV_CSV_LAST
-    };
-
-private:
-    struct tran_holder
-    {
-        wxDateTime Date;
-        wxString Type = Model_Checking::TYPE_STR_WITHDRAWAL;
-        wxString Status = "";
-        int64 ToAccountID = -1;
-        double ToAmount = 0.0;
-        int64 PayeeID = -1;
-        int64 CategoryID = -1;
-        wxArrayInt64 tagIDs;
-        double Amount = 0.0;
-        wxString Number;
-        wxString Notes;
-        bool valid = true;
-        wxString PayeeMatchNotes;
-        std::map<int, wxString> customFieldData;
-    };
 private:
     EDialogType dialogType_ = EDialogType::DIALOG_TYPE_IMPORT_CSV;
     int64 m_account_id = -1;
     wxString m_file_path;
     wxString delimit_ = ",";
-    wxString decimal_;
 
-    std::vector < std::pair <int, int>> csvFieldOrder_;
     wxListBox* csvFieldCandicate_ = nullptr;
     wxListBox* csvListBox_ = nullptr;
 
@@ -171,31 +133,28 @@ private:
 private:
     wxChoice* choiceDateFormat_ = nullptr;
     wxChoice* m_choiceEncoding = nullptr;
-    wxString date_format_;
     mmColorButton* colorButton_ = nullptr;
     wxCheckBox* colorCheckBox_ = nullptr;
     wxCheckBox* m_checkbox_preset_default = nullptr;
 
     wxChoice* m_choiceAmountFieldSign = nullptr;
     mmChoiceAmountMask* m_choiceDecimalSeparator = nullptr;
-    enum amountFieldSignValues { PositiveIsDeposit, PositiveIsWithdrawal, DefindByType };
     wxCheckBox* m_checkBoxExportTitles = nullptr;
 
-    int64 accountID_ = -1;
     bool importSuccessful_ = false;
     bool m_userDefinedDateMask = false;
     int m_object_in_focus = wxID_ANY;
-    bool m_reverce_sign = false;
-    wxString depositType_;
-    std::map <wxString, std::tuple<int64, wxString, wxString>, caseInsensitiveComparator> m_CSVpayeeNames;
     wxArrayString m_payee_names;
-    std::map <wxString, int64, caseInsensitiveComparator> m_CSVcategoryNames;
-    std::map<std::pair <int64, wxString>, std::map<int, std::pair<wxString, wxRegEx>> > payeeMatchPatterns_;
+    unsigned int m_previewLines = 0; // rows of the file, the preview only lists the first ones
+    mmPayeeMatcher payeeMatcher_;
     bool payeeRegExInitialized_ = false;
     wxCheckBox* payeeMatchCheckBox_ = nullptr;
     wxCheckBox* payeeMatchAddNotes_ = nullptr;
     wxDataViewListCtrl* payeeListBox_ = nullptr;
     wxDataViewListCtrl* categoryListBox_ = nullptr;
+    wxProgressDialog* m_progress = nullptr; // of the import running
+    long m_progressRange = 1;
+    wxTextOutputStream* m_log = nullptr;    // the log file of the import running
     std::map<wxString, wxString> m_preset_id;
     std::map<int64, wxString> m_acct_default_preset;
 
@@ -210,13 +169,11 @@ private:
     /// Creates the controls and sizers
     void CreateControls();
     void OnAdd(wxCommandEvent& event);
-    bool validateData(tran_holder & holder, wxString& message);
     void OnImport(wxCommandEvent& event);
     void OnExport(wxCommandEvent& event);
     void OnRemove(wxCommandEvent& event);
     bool isIndexPresent(int index) const;
     const wxString getCSVFieldName(int index) const;
-    void parseToken(int index, const wxString& token, tran_holder& holder);
     void OnSettingsSave(wxCommandEvent& event);
     void OnMoveUp(wxCommandEvent& event);
     void OnMoveDown(wxCommandEvent& event);
@@ -238,7 +195,8 @@ private:
     void OnShowPayeeDialog(wxMouseEvent&);
     void OnShowCategDialog(wxMouseEvent&);
     void saveAccountPresets();
-    bool validateCustomFieldData(int64 fieldId, wxString& value, wxString& log_message);
+    virtual void log(const wxString& msg);
+    virtual bool importProgress(long line, long imported);
 private:
     void OnLoad();
     void UpdateListItemBackground();
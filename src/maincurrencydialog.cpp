@@ -695,28 +695,18 @@ void mmMainCurrencyDialog::OnHistoryUpdate(wxCommandEvent& WXUNUSED(event))
     bool isFound = !historical_rates.empty();
     if (isFound)
     {
-        Model_CurrencyHistory::instance().Savepoint();
         if (isCheckDate)
         {
-            for (const auto entry : DatesList)
+            std::map<wxDateTime, double> used_rates;
+            for (const auto& entry : DatesList)
             {
-                wxLogDebug("%s %s", entry.first.FormatISODate(), entry.first.FormatISOTime());
-                if (historical_rates.find(entry.first) != historical_rates.end())
-                {
-                    const wxDate date = entry.first;
-                    wxLogDebug("%s", date.FormatISODate());
-                    Model_CurrencyHistory::instance().addUpdate(m_currency_id, date, historical_rates[date], Model_CurrencyHistory::ONLINE);
-                }
-            }
-        }
-        else
-        {
-            for (auto &entry : historical_rates)
-            {
-                Model_CurrencyHistory::instance().addUpdate(m_currency_id, entry.first, entry.second, Model_CurrencyHistory::ONLINE);
+                const auto rate = historical_rates.find(entry.first);
+                if (rate != historical_rates.end())
+                    used_rates.insert(*rate);
             }
+            historical_rates.swap(used_rates);
         }
-        Model_CurrencyHistory::instance().ReleaseSavepoint();
+        Model_CurrencyHistory::instance().addUpdate(m_currency_id, historical_rates, Model_CurrencyHistory::ONLINE);
 
         fillControls();
         ShowCurrencyHistory();
@@ -25,6 +25,7 @@
 #include "platfdep.h"
 #include "util.h"
 #include "daterange2.h"
+#include "dbupgrade.h"
 
 #include "model/Model_Setting.h"
 #include "model/Model_Usage.h"
@@ -468,12 +469,16 @@ int mmGUIApp::OnExit()
     usage->JSONCONTENT = rj;
     Model_Usage::instance().save(usage);
 
+    // A backup taken on closing the database may still be written
+    dbUpgrade::WaitForBackup();
+
     if (m_setting_db) {
         m_setting_db->Close();
         m_setting_db->ShutdownSQLite();
     }
 
     /* CURL Cleanup */
+    http_cleanup();
     curl_global_cleanup();
 
     // Delete mmex temp folder for current user
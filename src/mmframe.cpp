@@ -28,6 +28,7 @@
 #include "appstartdialog.h"
 #include "assetspanel.h"
 #include "attachmentdialog.h"
+#include "backupstore.h"
 #include "billsdepositsdialog.h"
 #include "billsdepositspanel.h"
 #include "budgetingpanel.h"
@@ -51,6 +52,7 @@
 #include "mmreportspanel.h"
 #include "mmSimpleDialogs.h"
 #include "mmHook.h"
+#include "modelwarmup.h"
 #include "optiondialog.h"
 #include "payeedialog.h"
 #include "relocatecategorydialog.h"
@@ -71,7 +73,9 @@
 
 #include "reports/allreport.h"
 #include "reports/bugreport.h"
+#include "reports/reportpool.h"
 
+#include "import_export/columnar.h"
 #include "import_export/qif_export.h"
 #include "import_export/qif_import_gui.h"
 #include "import_export/univcsvdialog.h"
@@ -96,10 +100,12 @@ EVT_MENU(MENU_EXPORT_XML, mmGUIFrame::OnExportToXML)
 EVT_MENU(MENU_EXPORT_QIF, mmGUIFrame::OnExportToQIF)
 EVT_MENU(MENU_EXPORT_JSON, mmGUIFrame::OnExportToJSON)
 EVT_MENU(MENU_EXPORT_MMEX, mmGUIFrame::OnExportToMMEX)
+EVT_MENU(MENU_EXPORT_COLUMNAR, mmGUIFrame::OnExportToColumnar)
 EVT_MENU(MENU_IMPORT_QIF, mmGUIFrame::OnImportQIF)
 EVT_MENU(MENU_IMPORT_UNIVCSV, mmGUIFrame::OnImportUniversalCSV)
 EVT_MENU(MENU_IMPORT_XML, mmGUIFrame::OnImportXML)
 EVT_MENU(MENU_IMPORT_WEBAPP, mmGUIFrame::OnImportWebApp)
+EVT_MENU(MENU_IMPORT_COLUMNAR, mmGUIFrame::OnImportColumnar)
 EVT_MENU(wxID_EXIT, mmGUIFrame::OnQuit)
 EVT_MENU(MENU_NEWACCT, mmGUIFrame::OnNewAccount)
 EVT_MENU(MENU_HOMEPAGE, mmGUIFrame::OnAccountList)
@@ -128,6 +134,7 @@ EVT_MENU(MENU_CONVERT_ENC_DB, mmGUIFrame::OnConvertEncryptedDB)
 EVT_MENU(MENU_CHANGE_ENCRYPT_PASSWORD, mmGUIFrame::OnChangeEncryptPassword)
 EVT_MENU(MENU_DB_VACUUM, mmGUIFrame::OnVacuumDB)
 EVT_MENU(MENU_DB_DEBUG, mmGUIFrame::OnDebugDB)
+EVT_MENU(MENU_DB_RESTORE_STORE, mmGUIFrame::OnRestoreBackupStore)
 
 EVT_MENU(MENU_ASSETS, mmGUIFrame::OnAssets)
 EVT_MENU(MENU_CURRENCY, mmGUIFrame::OnCurrency)
@@ -391,7 +398,9 @@ void mmGUIFrame::cleanup()
         dbUpgrade::BackupDB(
             m_filename,
             dbUpgrade::BACKUPTYPE::CLOSE,
-            Model_Setting::instance().getInt("MAX_BACKUP_FILES", 4)
+            Model_Setting::instance().getInt("MAX_BACKUP_FILES", 4),
+            0,
+            m_password
         );
     }
 }
@@ -405,6 +414,8 @@ void mmGUIFrame::ShutdownDatabase()
         if (!db_lockInPlace)
             Model_Infotable::instance().setBool("ISUSED", false);
     }
+    mmModelWarmUp::instance().stop();
+    mmReportPool::instance().detach();
     m_db->SetCommitHook(nullptr);
     m_db->Close();
     m_db.reset();
@@ -715,6 +726,7 @@ void mmGUIFrame::menuEnableItems(bool enable)
 
     menuBar_->FindItem(MENU_DB_VACUUM)->Enable(enable);
     menuBar_->FindItem(MENU_DB_DEBUG)->Enable(enable);
+    menuBar_->FindItem(MENU_DB_RESTORE_STORE)->Enable(enable);
 
     toolBar_->EnableTool(MENU_NEWACCT, enable);
     toolBar_->EnableTool(MENU_HOMEPAGE, enable);
@@ -805,9 +817,11 @@ void mmGUIFrame::DoRecreateNavTreeControl(bool home_page)
 {
     m_nav_tree_ctrl->SetEvtHandlerEnabled(false);
     if (home_page) {
+        startupPhase("home page");
         createHomePage();
     }
 
+    startupPhase("navigation");
     DoWindowsFreezeThaw(m_nav_tree_ctrl);
     resetNavTreeControl();
 
@@ -1048,6 +1062,12 @@ void mmGUIFrame::DoRecreateNavTreeControl(bool home_page)
 #endif
 
     DoWindowsFreezeThaw(m_nav_tree_ctrl);
+
+    // The window is usable once the events queued meanwhile, e.g. paint, are handled
+    if (m_startup_timer) {
+        startupPhase("first paint");
+        CallAfter(&mmGUIFrame::startupFinished);
+    }
 }
 
 void mmGUIFrame::loadNavigationTreeItemsStatusFromJson()
@@ -1715,6 +1735,7 @@ void mmGUIFrame::createMenu()
     importMenu->Append(MENU_IMPORT_XML, _u("&XML File…"), _("Import from XML file (Excel format)"));
     importMenu->AppendSeparator();
     importMenu->Append(MENU_IMPORT_QIF, _u("&QIF File…"), _("Import from QIF file"));
+    importMenu->Append(MENU_IMPORT_COLUMNAR, _u("C&olumnar File…"), _("Import from MMEX columnar file"));
     importMenu->AppendSeparator();
     importMenu->Append(MENU_IMPORT_WEBAPP, _u("&WebApp…"), _("Import from the WebApp"));
 
@@ -1726,6 +1747,7 @@ void mmGUIFrame::createMenu()
     exportMenu->Append(MENU_EXPORT_MMEX, _u("&MMEX CSV File…"), _("Export as fixed CSV file"));
     exportMenu->Append(MENU_EXPORT_JSON, _u("&JSON File…"), _("Export as JSON file"));
     exportMenu->Append(MENU_EXPORT_QIF, _u("&QIF File…"), _("Export as QIF file"));
+    exportMenu->Append(MENU_EXPORT_COLUMNAR, _u("C&olumnar File…"), _("Export as MMEX columnar file"));
     exportMenu->AppendSeparator();
     exportMenu->Append(MENU_EXPORT_HTML, _u("&HTML File…"), _("Export as HTML file"));
 
@@ -2025,10 +2047,14 @@ void mmGUIFrame::createMenu()
     wxMenuItem* menuItemCheckDB = new wxMenuItem(menuTools, MENU_DB_DEBUG
         , _u("Database Check and De&bug…")
         , _("Generate database report or fix errors"));
+    wxMenuItem* menuItemRestoreStore = new wxMenuItem(menuTools, MENU_DB_RESTORE_STORE
+        , _u("&Restore from Backup Store…")
+        , _("Save a backup kept in the backup store as a database file"));
     menuDatabase->Append(menuItemConvertDB);
     menuDatabase->Append(menuItemChangeEncryptPassword);
     menuDatabase->Append(menuItemVacuumDB);
     menuDatabase->Append(menuItemCheckDB);
+    menuDatabase->Append(menuItemRestoreStore);
     menuTools->AppendSubMenu(menuDatabase, _("&Database")
         , _("Database management"));
     menuItemChangeEncryptPassword->Enable(false);
@@ -2205,31 +2231,29 @@ void mmGUIFrame::CreateToolBar()
 }
 //----------------------------------------------------------------------------
 
-void mmGUIFrame::InitializeModelTables()
-{
-    m_all_models.push_back(&Model_Infotable::instance(m_db.get()));
-    m_all_models.push_back(&Model_Asset::instance(m_db.get()));
-    m_all_models.push_back(&Model_Stock::instance(m_db.get()));
-    m_all_models.push_back(&Model_StockHistory::instance(m_db.get()));
-    m_all_models.push_back(&Model_Account::instance(m_db.get()));
-    m_all_models.push_back(&Model_Payee::instance(m_db.get()));
-    m_all_models.push_back(&Model_Checking::instance(m_db.get()));
-    m_all_models.push_back(&Model_Currency::instance(m_db.get()));
-    m_all_models.push_back(&Model_CurrencyHistory::instance(m_db.get()));
-    m_all_models.push_back(&Model_Budgetyear::instance(m_db.get()));
-    m_all_models.push_back(&Model_Category::instance(m_db.get()));
-    m_all_models.push_back(&Model_Billsdeposits::instance(m_db.get()));
-    m_all_models.push_back(&Model_Splittransaction::instance(m_db.get()));
-    m_all_models.push_back(&Model_Budgetsplittransaction::instance(m_db.get()));
-    m_all_models.push_back(&Model_Budget::instance(m_db.get()));
-    m_all_models.push_back(&Model_Report::instance(m_db.get()));
-    m_all_models.push_back(&Model_Attachment::instance(m_db.get()));
-    m_all_models.push_back(&Model_CustomFieldData::instance(m_db.get()));
-    m_all_models.push_back(&Model_CustomField::instance(m_db.get()));
-    m_all_models.push_back(&Model_Tag::instance(m_db.get()));
-    m_all_models.push_back(&Model_Taglink::instance(m_db.get()));
-    m_all_models.push_back(&Model_Translink::instance(m_db.get()));
-    m_all_models.push_back(&Model_Shareinfo::instance(m_db.get()));
+void mmGUIFrame::InitializeModelTables(bool lazy)
+{
+    m_all_models = mmAttachModels(m_db.get(), lazy);
+
+    // A different database is attached, pages of the previous one are stale
+    mmReportCache::instance().clear();
+}
+
+void mmGUIFrame::startupPhase(const char* phase)
+{
+    if (m_startup_timer)
+        m_startup_timer->start(phase);
+}
+
+void mmGUIFrame::startupFinished()
+{
+    if (!m_startup_timer)
+        return;
+    wxLogDebug("%s", m_startup_timer->summary());
+    m_startup_timer.reset();
+
+    // The tables the first screen did not need are read now
+    mmModelWarmUp::instance().start(m_filename, m_password);
 }
 
 bool mmGUIFrame::createDataStore(const wxString& fileName, const wxString& pwd, bool openingNew)
@@ -2243,7 +2267,9 @@ bool mmGUIFrame::createDataStore(const wxString& fileName, const wxString& pwd,
             dbUpgrade::BackupDB(
                 m_filename,
                 dbUpgrade::BACKUPTYPE::CLOSE,
-                Model_Setting::instance().getInt("MAX_BACKUP_FILES", 4)
+                Model_Setting::instance().getInt("MAX_BACKUP_FILES", 4),
+                0,
+                m_password
             );
             Option::instance().setDatabaseUpdated(false);
         }
@@ -2272,12 +2298,18 @@ bool mmGUIFrame::createDataStore(const wxString& fileName, const wxString& pwd,
         && wxFileName::FileExists(fileName)
         && passwordCheckPassed
     ) {
+        // Time to interactive, from here to startupFinished()
+        m_startup_timer.reset(new mmPhaseTimer("Startup"));
+        startupPhase("open");
+
         /* Do a backup before opening */
         if (Model_Setting::instance().getBool("BACKUPDB", false)) {
             dbUpgrade::BackupDB(
                 fileName,
                 dbUpgrade::BACKUPTYPE::START,
-                Model_Setting::instance().getInt("MAX_BACKUP_FILES", 4)
+                Model_Setting::instance().getInt("MAX_BACKUP_FILES", 4),
+                0,
+                password
             );
         }
 
@@ -2297,7 +2329,7 @@ bool mmGUIFrame::createDataStore(const wxString& fileName, const wxString& pwd,
             ShutdownDatabase();
             m_db = mmDBWrapper::Open(fileName, password, true);
             //DB backup is handled inside UpgradeDB
-            if (!dbUpgrade::UpgradeDB(m_db.get(), fileName)) {
+            if (!dbUpgrade::UpgradeDB(m_db.get(), fileName, password)) {
                 int response = wxMessageBox(_("Have MMEX support provided a debug/patch file?"), _("MMEX upgrade"), wxYES_NO);
                 if (response == wxYES) {
                     // upgrade failure turns CorruptRdOnly flag back on, so reopen again in debug mode
@@ -2310,7 +2342,9 @@ bool mmGUIFrame::createDataStore(const wxString& fileName, const wxString& pwd,
             }
         }
 
-        InitializeModelTables();
+        startupPhase("models");
+        InitializeModelTables(Model_Setting::instance().getBool("LAZY_STARTUP", true));
+        mmReportPool::instance().attach(fileName, password);
 
         wxString UID = Model_Infotable::instance().getString("UID", wxEmptyString);
         if (UID.IsEmpty()) {
@@ -2379,6 +2413,7 @@ bool mmGUIFrame::createDataStore(const wxString& fileName, const wxString& pwd,
         m_password = password;
         dbUpgrade::InitializeVersion(m_db.get());
         InitializeModelTables();
+        mmReportPool::instance().attach(fileName, password);
 
         mmNewDatabaseWizard* wizard = new mmNewDatabaseWizard(this);
         wizard->CenterOnParent();
@@ -2433,6 +2468,7 @@ void mmGUIFrame::SetDataBaseParameters(const wxString& fileName)
     if (m_db) {
         m_filename = fileName;
         /* Set InfoTable Options into memory */
+        startupPhase("options");
         Option::instance().load();
     }
     else {
@@ -2464,8 +2500,10 @@ bool mmGUIFrame::openFile(const wxString& fileName, bool openingNew, const wxStr
                     "\n\n" +
                     _("Do you want to open the database?")
                     , _("MMEX Instance Check"), wxYES_NO | wxNO_DEFAULT | wxICON_WARNING);
-                if (response == wxNO)
+                if (response == wxNO) {
+                    m_startup_timer.reset();
                     return false;
+                }
             }
         }
 
@@ -2473,8 +2511,10 @@ bool mmGUIFrame::openFile(const wxString& fileName, bool openingNew, const wxStr
         db_lockInPlace = false;
         autoRepeatTransactionsTimer_.Start(REPEAT_TRANS_DELAY_TIME, wxTIMER_ONE_SHOT);
     }
-    else
+    else {
+        m_startup_timer.reset();
         return false;
+    }
 
     return true;
 }
@@ -2576,7 +2616,7 @@ void mmGUIFrame::OnConvertEncryptedDB(wxCommandEvent& /*event*/)
     cipher.SetLegacy(true);
 
     db.Open(fileName, cipher, password);
-    db.ReKey(cipher, wxEmptyString);
+    mmDBWrapper::ReKey(&db, cipher, wxEmptyString);
     db.Close();
 
     mmErrorDialogs::MessageError(this, _("Converted database!"), _("MMEX message"));
@@ -2614,7 +2654,9 @@ void mmGUIFrame::OnChangeEncryptPassword(wxCommandEvent& /*event*/)
                     cipher.InitializeVersionDefault(4);
                     cipher.SetLegacy(true);
 
-                    m_db->ReKey(cipher, confirm_password);
+                    mmDBWrapper::ReKey(m_db.get(), cipher, confirm_password);
+                    mmDBWrapper::SetProfile(m_db.get(), Model_Setting::instance().getInt("DB_PROFILE", mmDBWrapper::PROFILE_SAFE));
+                    m_password = confirm_password;
                     wxMessageBox(_("Password change completed"), password_change_heading);
                 }
                 else {
@@ -2650,32 +2692,77 @@ void mmGUIFrame::OnVacuumDB(wxCommandEvent& /*event*/)
 }
 //----------------------------------------------------------------------------
 
+void mmGUIFrame::OnRestoreBackupStore(wxCommandEvent& /*event*/)
+{
+    const wxString heading = _("Restore from Backup Store");
+    mmBackupStore store(m_filename);
+    wxArrayString snapshots = store.snapshots();
+    if (snapshots.empty()) {
+        wxMessageBox(_("There are no backups in the backup store of this database."), heading);
+        return;
+    }
+
+    // newest first, names end with the date of the backup
+    snapshots.Sort(true);
+    wxSingleChoiceDialog choiceDlg(this, _("Choose a backup"), heading, snapshots);
+    if (choiceDlg.ShowModal() != wxID_OK)
+        return;
+
+    const wxFileName fn(m_filename);
+    wxFileDialog dlg(this,
+        _("Save database file as"),
+        fn.GetPath(),
+        choiceDlg.GetStringSelection() + "." + fn.GetExt(),
+        _("MMEX Database") + " (*.mmb)|*.mmb|" + _("Encrypted MMEX Database") + " (*.emb)|*.emb",
+        wxFD_SAVE | wxFD_OVERWRITE_PROMPT
+    );
+    dlg.SetFilterIndex(fn.GetExt().Lower() == "emb" ? 1 : 0);
+    if (dlg.ShowModal() != wxID_OK)
+        return;
+
+    if (wxFileName(dlg.GetPath()) == fn) {
+        wxMessageBox(_("Unable to restore over the open database"), heading, wxOK | wxICON_WARNING);
+        return;
+    }
+
+    wxBusyCursor wait;
+    if (store.restore(choiceDlg.GetStringSelection(), dlg.GetPath()))
+        wxMessageBox(wxString::Format(_("Backup restored to %s"), dlg.GetPath()), heading);
+    else
+        wxMessageBox(store.error(), heading, wxOK | wxICON_ERROR);
+}
+//----------------------------------------------------------------------------
+
 void mmGUIFrame::OnDebugDB(wxCommandEvent& /*event*/)
 {
     wxASSERT(m_db);
-    wxString resultMessage;
-    wxSQLite3Statement stmt = m_db->PrepareStatement("PRAGMA integrity_check;");
-    if (stmt.IsReadOnly()) {
-        try {
-            wxSQLite3ResultSet rs = stmt.ExecuteQuery();
-            int columnCount = rs.GetColumnCount();
-            while (rs.NextRow()) {
-                wxString strRow = "";
-                for (int i = 0; i < columnCount; ++i)
-                    strRow << rs.GetAsString(i);
-                resultMessage << strRow + wxTextFile::GetEOL();
-            }
-        }
-        catch (const wxSQLite3Exception& e) {
-            wxMessageBox(
-                _("Query error, please contact MMEX support!") + "\n\n" + e.GetMessage(),
-                _("MMEX debug error"),
-                wxOK | wxICON_ERROR
-            );
+    const wxString modes[] = { _("Quick check"), _("Full check of every table and index") };
+    wxSingleChoiceDialog modeDlg(this, _("Choose the database check to run"), _("Database Check")
+        , WXSIZEOF(modes), modes);
+    if (modeDlg.ShowModal() != wxID_OK)
+        return;
+
+    wxArrayString problems;
+    try {
+        if (dbCheck::checkDB(m_db.get(), modeDlg.GetSelection() == 1 ? dbCheck::FULL : dbCheck::QUICK, problems)
+            == mmReportPool::CANCELLED)
             return;
-        }
+    }
+    catch (const wxSQLite3Exception& e) {
+        wxMessageBox(
+            _("Query error, please contact MMEX support!") + "\n\n" + e.GetMessage(),
+            _("MMEX debug error"),
+            wxOK | wxICON_ERROR
+        );
+        return;
     }
 
+    wxString resultMessage;
+    for (const auto& problem : problems)
+        resultMessage << problem + wxTextFile::GetEOL();
+    if (resultMessage.IsEmpty())
+        resultMessage = "ok";
+
     if (!resultMessage.IsEmpty()) {
         wxTextEntryDialog checkDlg(this, _("Result of database integrity check:"), _("Database Check"), resultMessage.Trim(), wxOK | wxTE_MULTILINE);
         checkDlg.SetIcon(mmex::getProgramIcon());
@@ -2780,7 +2867,7 @@ void mmGUIFrame::OnSaveAs(wxCommandEvent& /*event*/)
         cipher.SetLegacy(true);
 
         dbx.Open(newFileName.GetFullPath(), cipher, m_password);
-        dbx.ReKey(cipher, new_password); // empty password resets encryption
+        mmDBWrapper::ReKey(&dbx, cipher, new_password); // empty password resets encryption
         dbx.Close();
     }
 
@@ -2818,6 +2905,11 @@ void mmGUIFrame::OnExportToMMEX(wxCommandEvent& /*event*/)
     mmQIFExportDialog dlg(this, mmQIFExportDialog::CSV, gotoAccountID_);
     dlg.ShowModal();
 }
+void mmGUIFrame::OnExportToColumnar(wxCommandEvent& /*event*/)
+{
+    mmQIFExportDialog dlg(this, mmQIFExportDialog::COLUMNAR, gotoAccountID_);
+    dlg.ShowModal();
+}
 //----------------------------------------------------------------------------
 
 void mmGUIFrame::OnImportQIF(wxCommandEvent& /*event*/)
@@ -2893,6 +2985,34 @@ void mmGUIFrame::OnImportWebApp(wxCommandEvent& /*event*/)
 }
 //----------------------------------------------------------------------------
 
+void mmGUIFrame::OnImportColumnar(wxCommandEvent& /*event*/)
+{
+    const wxString fileName = wxFileSelector(_("Choose columnar data file to Import")
+        , wxEmptyString, wxEmptyString, wxEmptyString
+        , _("Columnar Files (*.mmcol)") + "|*.mmcol;*.MMCOL"
+        , wxFD_OPEN | wxFD_FILE_MUST_EXIST, this);
+    if (fileName.IsEmpty())
+        return;
+
+    mmColumnarImport columnar;
+    if (!columnar.load(fileName)) {
+        wxMessageBox(columnar.error(), _("Columnar Import"), wxOK | wxICON_ERROR);
+        return;
+    }
+
+    wxBusyCursor wait;
+    size_t skipped = 0;
+    const size_t imported = columnar.import(skipped);
+    RefreshNavigationTree();
+    refreshPanelData();
+
+    wxString msg = wxString::Format(_("Number of transactions imported: %zu"), imported);
+    if (skipped > 0)
+        msg << "\n" << wxString::Format(_("Transactions skipped because their account does not exist: %zu"), skipped);
+    wxMessageBox(msg, _("Columnar Import"), wxOK | wxICON_INFORMATION);
+}
+//----------------------------------------------------------------------------
+
 void mmGUIFrame::OnQuit(wxCommandEvent& WXUNUSED(event))
 {
     Close(true);
@@ -2948,6 +3068,9 @@ void mmGUIFrame::refreshPanelData(wxCommandEvent& /*event*/)
 }
 void mmGUIFrame::refreshPanelData()
 {
+    // Settings may have changed, rendered reports can not be trusted anymore
+    mmReportCache::instance().clear();
+
     int id = panelCurrent_ ? panelCurrent_->GetId() : mmID_HOMEPAGE;
     wxLogDebug("Panel ID: %d", id);
 
@@ -27,6 +27,7 @@ Copyright (C) 2021, 2022, 2024 Mark Whalley (mark@ipx.co.uk)
 //----------------------------------------------------------------------------
 #include <wx/aui/aui.h>
 #include <wx/toolbar.h>
+#include <memory>
 #include <vector>
 #include "option.h"
 #include "constants.h"
@@ -34,6 +35,7 @@ Copyright (C) 2021, 2022, 2024 Mark Whalley (mark@ipx.co.uk)
 #include "paths.h"
 #include "model/Model_Account.h"
 #include "fusedtransaction.h"
+#include "phasetimer.h"
 
 //----------------------------------------------------------------------------
 class wxSQLite3Database;
@@ -111,6 +113,11 @@ private:
     /* There are 2 kinds of reports */
     bool activeReport_ = false;
 
+    /* Time to interactive of the database being opened, logged once the window is usable */
+    std::unique_ptr<mmPhaseTimer> m_startup_timer;
+    void startupPhase(const char* phase);
+    void startupFinished();
+
     /* Repeat Transactions automatic processing delay */
     wxTimer autoRepeatTransactionsTimer_;
     void OnAutoRepeatTransactionsTimer(wxTimerEvent& event);
@@ -143,7 +150,7 @@ private:
     void cleanupNavTreeControl(wxTreeItemId& item);
     wxSizer* cleanupHomePanel(bool new_sizer = true);
     bool openFile(const wxString& fileName, bool openingNew, const wxString &password = "");
-    void InitializeModelTables();
+    void InitializeModelTables(bool lazy = false);
     bool createDataStore(const wxString& fileName, const wxString &passwd, bool openingNew);
     void createMenu();
     void CreateToolBar();
@@ -191,17 +198,20 @@ private:
     void OnChangeEncryptPassword(wxCommandEvent& event);
     void OnVacuumDB(wxCommandEvent& event);
     void OnDebugDB(wxCommandEvent& event);
+    void OnRestoreBackupStore(wxCommandEvent& event);
     void OnSaveAs(wxCommandEvent& event);
     void OnExportToCSV(wxCommandEvent& event);
     void OnExportToXML(wxCommandEvent& event);
     void OnExportToQIF(wxCommandEvent& event);
     void OnExportToJSON(wxCommandEvent& event);
     void OnExportToMMEX(wxCommandEvent& event);
+    void OnExportToColumnar(wxCommandEvent& event);
     void OnExportToHtml(wxCommandEvent& event);
     void OnImportUniversalCSV(wxCommandEvent& event);
     void OnImportXML(wxCommandEvent& event);
     void OnImportQIF(wxCommandEvent& event);
     void OnImportWebApp(wxCommandEvent& event);
+    void OnImportColumnar(wxCommandEvent& event);
     void OnPrintPage(wxCommandEvent& WXUNUSED(event));
     void OnQuit(wxCommandEvent& event);
     void OnBillsDeposits(wxCommandEvent& event);
@@ -325,6 +335,7 @@ private:
         MENU_IMPORT_UNIVCSV,
         MENU_IMPORT_XML,
         MENU_IMPORT_WEBAPP,
+        MENU_IMPORT_COLUMNAR,
         MENU_ANNOUNCEMENTMAILING,
         MENU_FACEBOOK, // start range for OnSimpleURLOpen
         MENU_COMMUNITY,
@@ -346,6 +357,7 @@ private:
         MENU_EXPORT_XML,
         MENU_EXPORT_QIF,
         MENU_EXPORT_JSON,
+        MENU_EXPORT_COLUMNAR,
         MENU_SHOW_APPSTART,
         MENU_EXPORT_HTML,
         MENU_CURRENCY,
@@ -374,6 +386,7 @@ private:
         MENU_CHANGE_ENCRYPT_PASSWORD,
         MENU_DB_VACUUM,
         MENU_DB_DEBUG,
+        MENU_DB_RESTORE_STORE,
         MENU_ONLINE_UPD_CURRENCY_RATE,
         MENU_ACCOUNT_REALLOCATE,
         MENU_DIAGNOSTICS,
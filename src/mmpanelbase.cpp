@@ -399,7 +399,7 @@ mmPanelBase::~mmPanelBase()
 wxString mmPanelBase::BuildPage() const
 {
     mmReportsPanel* rp = wxDynamicCast(this, mmReportsPanel);
-    return rp ? rp->getPrintableBase()->getHTMLText() : "TBD";
+    return rp ? rp->getPrintableBase()->getStandaloneHTMLText() : "TBD";
 }
 
 void mmPanelBase::PrintPage()
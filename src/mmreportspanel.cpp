@@ -71,6 +71,17 @@ mmReportsPanel::~mmReportsPanel()
 
     m_all_date_ranges.clear();
     clearVFprintedFiles("rep");
+    mmHTMLBuilder::removeRowsFiles(m_rows_files);
+    mmHTMLBuilder::removeRowsFiles(mmHTMLBuilder::takeRowsFiles());
+}
+
+void mmReportsPanel::loadPage(const wxString& prefix, const wxString& html)
+{
+    browser_->LoadURL(getVFname4print(prefix, html));
+
+    // The row files of the page shown before are not read anymore
+    mmHTMLBuilder::removeRowsFiles(m_rows_files);
+    m_rows_files = mmHTMLBuilder::takeRowsFiles();
 }
 
 bool mmReportsPanel::Create(wxWindow *parent, wxWindowID winid
@@ -144,8 +155,7 @@ bool mmReportsPanel::saveReportText(bool initial)
 
     const auto time = wxDateTime::UNow();
 
-    const auto& name = getVFname4print("rep", rb_->getHTMLText());
-    browser_->LoadURL(name);
+    loadPage("rep", rb_->getCachedHTMLText());
 
     json_writer.Key("seconds");
     json_writer.Double((wxDateTime::UNow() - time).GetMilliseconds().ToDouble() / 1000);
@@ -605,8 +615,7 @@ void mmReportsPanel::OnNewWindow(wxWebViewEvent& evt)
         }
 
         const wxString report = rb_->m_filter.getHTML();
-        const auto name = getVFname4print("repdetail", report);
-        browser_->LoadURL(name);
+        loadPage("repdetail", report);
     }
     else if (uri.StartsWith("trxid:", &sData))
     {
@@ -664,8 +673,7 @@ void mmReportsPanel::OnNewWindow(wxWebViewEvent& evt)
                         saveReportText();
                     }
                 }
-                const auto name = getVFname4print("rep", getPrintableBase()->getHTMLText());
-                browser_->LoadURL(name);
+                loadPage("rep", getPrintableBase()->getCachedHTMLText());
             }
         }
     }
@@ -677,8 +685,7 @@ void mmReportsPanel::OnNewWindow(wxWebViewEvent& evt)
         if (Model_Attachment::REFTYPE_STR.Index(RefType) != wxNOT_FOUND && RefId > 0)
         {
             mmAttachmentManage::OpenAttachmentFromPanelIcon(m_frame, RefType, RefId);
-            const auto name = getVFname4print("rep", getPrintableBase()->getHTMLText());
-            browser_->LoadURL(name);
+            loadPage("rep", getPrintableBase()->getCachedHTMLText());
         }
     }
     else if (uri.StartsWith("budget:", &sData))
@@ -94,11 +94,14 @@ private:
     void OnForwardMonthsChangedSpin(wxSpinEvent& event);
     void OnForwardMonthsChangedText(wxCommandEvent& event);
     void OnShiftPressed(wxCommandEvent& event);
+    /** Show the page, the row files of its virtual tables live as long as it is shown */
+    void loadPage(const wxString& prefix, const wxString& html);
 
     bool cleanup_;
     bool cleanupmem_ = false;
     int m_shift = 0;
     wxString htmlreport_;
+    std::vector<wxString> m_rows_files;
 
 };
 
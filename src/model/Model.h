@@ -18,6 +18,7 @@ Copyright (C) 2018 Stefano Giorgio (stef145g)
  ********************************************************/
 #pragma once
 
+#include <map>
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
@@ -52,7 +53,7 @@ namespace std
 class ModelBase
 {
 public:
-    ModelBase() :db_(0) {};
+    ModelBase() :table_generation_(0), db_(0) {};
     virtual ~ModelBase() {};
     
 public:
@@ -77,6 +78,36 @@ public:
         this->db_->Rollback(name);
     }
 
+    /**
+    * Database generation counter. It is incremented on every save/remove
+    * through the models, so cached results derived from the data can be
+    * invalidated by comparing the generation they were built from.
+    */
+    static size_t generation()
+    {
+        return generation_ref();
+    }
+    /** Same as generation() but only counting changes of this table */
+    size_t table_generation() const
+    {
+        return table_generation_;
+    }
+
+protected:
+    void bump_generation()
+    {
+        ++table_generation_;
+        ++generation_ref();
+    }
+
+private:
+    static size_t& generation_ref()
+    {
+        static size_t generation = 0;
+        return generation;
+    }
+    size_t table_generation_;
+
 protected:
     static wxDateTime to_date(const wxString& str_date)
     {
@@ -94,6 +125,7 @@ public:
     virtual wxString  GetTableStatsAsJson() const = 0;
     virtual void show_statistics() const = 0;
     virtual void destroyCache() = 0;
+    virtual void ensure_table() = 0;
 
 protected:
     wxSQLite3Database* db_;
@@ -174,6 +206,8 @@ public:
     int64 save(typename DB_TABLE::Data* r)
     {
         r->save(this->db_);
+        bump_generation();
+        if (name_index_built_) index_name(*r);
         return r->id();
     }
 
@@ -209,17 +243,251 @@ public:
     /** Remove the Data record instance from memory and the database. */
     bool remove(int64 id)
     {
+        bump_generation();
+        forget_name(id);
         return this->remove(id, db_);
     }
 
+protected:
+    /**
+    Adds the dated values of one key, e.g. the rates of a currency, and updates the
+    ones already stored when replace is set and the value or type differs. Only the
+    first value of a day is taken. The stored rows of the date range are read in one
+    query and the rows written in one transaction, for the bulk addUpdate of the
+    history models. KEY, DATE, VALUE and TYPE are the columns, the member pointers
+    the fields of the last three.
+    * Return the number of rows written
+    */
+    template<class KEY, class DATE, class VALUE, class TYPE, class K>
+    size_t add_update_dated(const K& key, const std::map<wxDate, double>& values, int64 type, bool replace
+        , wxString DB_TABLE::Data::* date_field, double DB_TABLE::Data::* value_field, int64 DB_TABLE::Data::* type_field)
+    {
+        if (values.empty())
+            return 0;
+
+        std::map<wxString, typename DB_TABLE::Data> stored;
+        for (const auto& r : this->find(KEY(key)
+            , DATE(values.begin()->first.FormatISODate(), GREATER_OR_EQUAL)
+            , DATE(values.rbegin()->first.FormatISODate(), LESS_OR_EQUAL)))
+        {
+            stored[r.*date_field] = r;
+        }
+
+        const wxString save_point = this->name() + "_BULK";
+        std::vector<std::pair<int64, double>> updated;
+        size_t written = 0;
+        wxString last_date;
+        this->Savepoint(save_point);
+        try
+        {
+            wxSQLite3Statement insert = db_->PrepareStatement(wxString::Format("INSERT INTO %s(%s, %s, %s, %s, %s) VALUES(?, ?, ?, ?, ?)"
+                , this->name(), KEY::name(), DATE::name(), VALUE::name(), TYPE::name(), DB_TABLE::PRIMARY::name()));
+            wxSQLite3Statement update = db_->PrepareStatement(wxString::Format("UPDATE %s SET %s = ?, %s = ? WHERE %s = ?"
+                , this->name(), VALUE::name(), TYPE::name(), DB_TABLE::PRIMARY::name()));
+            for (const auto& value : values)
+            {
+                const wxString date = value.first.FormatISODate();
+                // keys are sorted, so times of the same day follow each other
+                if (date == last_date)
+                    continue;
+                last_date = date;
+                const auto it = stored.find(date);
+                if (it == stored.end())
+                {
+                    insert.Bind(1, key);
+                    insert.Bind(2, date);
+                    insert.Bind(3, value.second);
+                    insert.Bind(4, type);
+                    insert.Bind(5, this->newId());
+                    insert.ExecuteUpdate();
+                    insert.Reset();
+                }
+                else if (replace && (it->second.*value_field != value.second || it->second.*type_field != type))
+                {
+                    update.Bind(1, value.second);
+                    update.Bind(2, type);
+                    update.Bind(3, it->second.id());
+                    update.ExecuteUpdate();
+                    update.Reset();
+                    updated.push_back(std::make_pair(it->second.id(), value.second));
+                }
+                else
+                    continue;
+                written++;
+            }
+            insert.Finalize();
+            update.Finalize();
+            this->ReleaseSavepoint(save_point);
+        }
+        catch (const wxSQLite3Exception& e)
+        {
+            wxLogError("%s: Exception %s", this->name().utf8_str(), e.GetMessage().utf8_str());
+            this->Rollback(save_point);
+            this->ReleaseSavepoint(save_point);
+            return 0;
+        }
+
+        // Rows in memory are kept current, the inserted ones are read when asked for
+        for (const auto& row : updated)
+        {
+            const auto cached = this->index_by_id_.find(row.first);
+            if (cached == this->index_by_id_.end())
+                continue;
+            cached->second->*value_field = row.second;
+            cached->second->*type_field = type;
+        }
+        if (written > 0)
+            bump_generation();
+        return written;
+    }
+
+    /**
+    * The natural key of a row for find_id_by_key(), e.g. its lower case name.
+    * Models looking rows up by name override it, by default there is no index.
+    */
+    virtual wxString name_key(const typename DB_TABLE::Data& WXUNUSED(r)) const
+    {
+        return wxEmptyString;
+    }
+
+    /**
+    * Id of the row with the given natural key, -1 when there is none.
+    * The index is read from the table on the first lookup and then kept
+    * current by save() and remove(), so lookups do not query the database.
+    */
+    int64 find_id_by_key(const wxString& key)
+    {
+        if (!name_index_built_)
+        {
+            for (const auto& r : all())
+                index_name(r);
+            name_index_built_ = true;
+        }
+
+        // Several rows only happen for names differing in the case of non ASCII
+        // letters, which SQLite NOCASE keeps apart. Take the oldest one then.
+        int64 id = -1;
+        const auto range = name_index_.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (id == -1 || it->second < id)
+                id = it->second;
+        }
+        return id;
+    }
+
+    /** Drop the index, it is read again on the next lookup */
+    void reset_name_index()
+    {
+        name_index_.clear();
+        name_keys_.clear();
+        name_index_built_ = false;
+    }
+
+    /** Remove a row from the index, for models removing rows by themselves */
+    void forget_name(int64 id)
+    {
+        const auto key = name_keys_.find(id);
+        if (key == name_keys_.end())
+            return;
+
+        const auto range = name_index_.equal_range(key->second);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == id)
+            {
+                name_index_.erase(it);
+                break;
+            }
+        }
+        name_keys_.erase(key);
+    }
+
+private:
+    void index_name(const typename DB_TABLE::Data& r)
+    {
+        forget_name(r.id());
+        const wxString key = name_key(r);
+        if (key.empty())
+            return;
+        name_index_.insert(std::make_pair(key, r.id()));
+        name_keys_[r.id()] = key;
+    }
+
+    std::unordered_multimap<wxString, int64> name_index_;
+    std::map<int64, wxString> name_keys_;
+    bool name_index_built_ = false;
+
 public:
+    /** Read up to max_num rows into the cache with a single query */
     void preload(int max_num = 1000)
     {
-        int i = 0;
-        for (const auto & item : all())
+        this->ensure(this->db_);
+        try
+        {
+            wxSQLite3Statement stmt = this->db_->PrepareStatement(this->query() + " LIMIT ?");
+            stmt.Bind(1, max_num);
+            wxSQLite3ResultSet q = stmt.ExecuteQuery();
+            while (q.NextRow())
+            {
+                const int64 id = q.GetInt64(0);
+                if (this->index_by_id_.find(id) != this->index_by_id_.end())
+                    continue;
+                typename DB_TABLE::Data* entity = new typename DB_TABLE::Data(q, this);
+                this->cache_.push_back(entity);
+                this->index_by_id_.insert(std::make_pair(id, entity));
+            }
+            stmt.Finalize();
+        }
+        catch (const wxSQLite3Exception &e)
+        {
+            wxLogError("%s: Exception %s", this->name().utf8_str(), e.GetMessage().utf8_str());
+        }
+    }
+
+    /**
+    * Attach the database without reading it, for models the first screen
+    * does not need. The table is checked by the first all() or ensure_table().
+    */
+    void attach(wxSQLite3Database* db)
+    {
+        this->db_ = db;
+        this->reset_state();
+    }
+
+    /**
+    * Drop everything read from the attached database. Models keeping data
+    * derived from their rows override it to drop that too. The generation
+    * moves on, so results stamped with the previous one are stale.
+    */
+    virtual void reset_state()
+    {
+        this->destroyCache();
+        this->bump_generation();
+    }
+
+    void ensure_table()
+    {
+        this->ensure(this->db_);
+    }
+
+    /**
+    * Add rows read elsewhere, e.g. by mmModelWarmUp, to the cache. They are
+    * dropped when the table changed since generation, the table_generation()
+    * taken before they were read, as they may be outdated then.
+    * Rows already cached are kept, they may be more recent.
+    */
+    void adopt(const std::vector<typename DB_TABLE::Data>& rows, size_t generation)
+    {
+        if (generation != this->table_generation())
+            return;
+        for (const auto& r : rows)
         {
-            get(item.id());
-            if (++i >= max_num) break;
+            if (this->index_by_id_.find(r.id()) != this->index_by_id_.end())
+                continue;
+            typename DB_TABLE::Data* entity = new typename DB_TABLE::Data(r);
+            this->cache_.push_back(entity);
+            this->index_by_id_.insert(std::make_pair(r.id(), entity));
         }
     }
 
@@ -252,6 +520,7 @@ public:
     void destroyCache()
     {
         if (this->cache_.size() > 0) this->destroy_cache();
+        reset_name_index();
     }
 
     /** Show table statistics*/
@@ -73,6 +73,7 @@ Model_Account& Model_Account::instance(wxSQLite3Database* db)
     Model_Account& ins = Singleton<Model_Account>::instance();
     ins.db_ = db;
     ins.destroy_cache();
+    ins.reset_name_index();
     ins.ensure(db);
     ins.preload();
 
@@ -144,12 +145,18 @@ wxArrayString Model_Account::status_str_all()
 /** Get the Data record instance in memory. */
 Model_Account::Data* Model_Account::get(const wxString& name)
 {
-    Data* account = this->get_one(ACCOUNTNAME(name));
-    if (account) return account;
+    const int64 id = find_id_by_name(name);
+    return id == -1 ? nullptr : this->get(id);
+}
 
-    Data_Set items = this->find(ACCOUNTNAME(name));
-    if (!items.empty()) account = this->get(items[0].ACCOUNTID, this->db_);
-    return account;
+int64 Model_Account::find_id_by_name(const wxString& name)
+{
+    return find_id_by_key(name.Lower());
+}
+
+wxString Model_Account::name_key(const Data& r) const
+{
+    return r.ACCOUNTNAME.Lower();
 }
 
 /** Get the Data record instance in memory. */
@@ -196,6 +203,8 @@ bool Model_Account::remove(int64 id)
     }
     this->ReleaseSavepoint();
 
+    bump_generation();
+    forget_name(id);
     return this->remove(id, db_);
 }
 
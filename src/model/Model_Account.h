@@ -92,6 +92,8 @@ public:
 public:
     /** Return the Data record for the given account name */
     Data* get(const wxString& name);
+    /** Return the id of the account with the given name, -1 when there is none */
+    int64 find_id_by_name(const wxString& name);
   
     /** Return the Data record for the given account num */
     Data* getByAccNum(const wxString& num);   
@@ -148,6 +150,8 @@ public:
 
     const Data_Set FilterAccounts(const wxString& account_pattern, bool skip_closed = false);
 
+protected:
+    wxString name_key(const Data& r) const;
 };
 
 inline wxDateTime Model_Account::get_date_by_string(const wxString& date_str) { return Model::to_date(date_str); }
@@ -109,6 +109,7 @@ bool Model_Billsdeposits::remove(int64 id)
         Model_Budgetsplittransaction::instance().remove(item.SPLITTRANSID);
     // Delete tags for the scheduled transaction
     Model_Taglink::instance().DeleteAllTags(Model_Attachment::REFTYPE_STR_BILLSDEPOSIT, id);
+    bump_generation();
     return this->remove(id, db_);
 }
 
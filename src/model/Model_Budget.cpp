@@ -56,7 +56,7 @@ Model_Budget& Model_Budget::instance(wxSQLite3Database* db)
 {
     Model_Budget& ins = Singleton<Model_Budget>::instance();
     ins.db_ = db;
-    ins.destroy_cache();
+    ins.reset_state();
     ins.ensure(db);
 
     return ins;
@@ -68,6 +68,43 @@ Model_Budget& Model_Budget::instance()
     return Singleton<Model_Budget>::instance();
 }
 
+int64 Model_Budget::save(Data* r)
+{
+    const size_t generation = table_generation();
+    Model<DB_Table_BUDGETTABLE_V1>::save(r);
+    update_plans(r->BUDGETENTRYID, r->CATEGID, r->BUDGETYEARID, generation);
+    return r->id();
+}
+
+bool Model_Budget::remove(int64 id)
+{
+    const size_t generation = table_generation();
+    bool result = Model<DB_Table_BUDGETTABLE_V1>::remove(id);
+    update_plans(id, -1, -1, generation);
+    return result;
+}
+
+void Model_Budget::update_plans(int64 entry_id, int64 categ_id, int64 year_id, size_t generation)
+{
+    for (auto& plan : m_plans)
+        plan.second->update(entry_id, categ_id, year_id, generation);
+}
+
+void Model_Budget::reset_state()
+{
+    Model<DB_Table_BUDGETTABLE_V1>::reset_state();
+    m_plans.clear();
+}
+
+const mmBudgetPlan& Model_Budget::getBudgetPlan(const wxString& year)
+{
+    auto it = m_plans.find(year);
+    if (it == m_plans.end())
+        it = m_plans.insert(std::make_pair(year, wxSharedPtr<mmBudgetPlan>(new mmBudgetPlan(year)))).first;
+    it->second->refresh();
+    return *it->second;
+}
+
 wxArrayString Model_Budget::period_str_all()
 {
     wxArrayString period;
@@ -136,96 +173,27 @@ void Model_Budget::getBudgetStats(
     , mmDateRange* date_range
     , bool groupByMonth)
 {
-    //Initialization
-    //Set std::map with zeros
-    double value = 0;
-    const wxDateTime start_date(date_range->start_date());
+    const wxString year = wxString::Format("%i", date_range->start_date().GetYear());
+    const mmBudgetPlan& plan = instance().getBudgetPlan(year);
 
     for (const auto& category : Model_Category::instance().all())
     {
-        for (int month = 0; month < 12; month++) {
-            budgetStats[category.CATEGID][month] = value;
-        }
-    }
-
-    //Calculations
-    std::map<int64, double> monthlyBudgetValue;
-    std::map<int64, double> yearlyBudgetValue;
-    std::map<int64, double> yearDeduction;
-    std::map<std::pair<int, int64>, bool> isBudgeted;
-    std::map<int64, int> budgetedMonths;
-    const wxString year = wxString::Format("%i", start_date.GetYear());
-    int64 budgetYearID = Model_Budgetyear::instance().Get(year);
-    for (const auto& budget : instance().find(BUDGETYEARID(budgetYearID)))
-    {
-        // Determine the monhly budgeted amounts
-        monthlyBudgetValue[budget.CATEGID] = getEstimate(true, period_id(budget), budget.AMOUNT);
-        // Determine the yearly budgeted amounts
-        yearlyBudgetValue[budget.CATEGID] = getEstimate(false, period_id(budget), budget.AMOUNT);
-        // Store the yearly budget to use in reporting. Monthly budgets are stored in index 0-11, so use index 12 for year
-        budgetStats[budget.CATEGID][12] = yearlyBudgetValue[budget.CATEGID];
-    }
-    bool budgetOverride = Option::instance().getBudgetOverride();
-    bool budgetDeductMonthly = Option::instance().getBudgetDeductMonthly();
-    for (int month = 0; month < 12; month++)
-    {
-        const wxString budgetYearMonth = wxString::Format("%s-%02d", year, month + 1);
-        budgetYearID = Model_Budgetyear::instance().Get(budgetYearMonth);
-
-        //fill with amount from monthly budgets first
-        for (const auto& budget : instance().find(BUDGETYEARID(budgetYearID)))
+        auto& stats = budgetStats[category.CATEGID];
+        if (groupByMonth)
         {
-            std::pair<int, int64> month_categ = std::make_pair(month, budget.CATEGID);
-            if (!isBudgeted[month_categ])
-            {
-                isBudgeted[month_categ] = true;
-                budgetedMonths[budget.CATEGID]++;
-            }
-            budgetStats[budget.CATEGID][month] = getEstimate(true, period_id(budget), budget.AMOUNT);
-            yearDeduction[budget.CATEGID] += budgetStats[budget.CATEGID][month];
+            for (int month = 0; month < 12; month++)
+                stats[month] = plan.value(category.CATEGID, month);
+            // Monthly budgets are stored in index 0-11, so use index 12 for year
+            if (plan.has_yearly(category.CATEGID))
+                stats[12] = plan.value(category.CATEGID, 12);
         }
-    }
-    // Now go month by month and add the yearly budget
-    for (int month = 0; month < 12; month++)
-    {
-        // If user selected to deduct monthly budgeted amounts 
-        if (budgetDeductMonthly)
-            for (const auto& categoryBudget : yearlyBudgetValue)
-            {
-                if (yearDeduction[categoryBudget.first] / categoryBudget.second >= 1) continue;
-                //Deduct the monthly total from the yearly budget
-                double adjusted_amount = categoryBudget.second - yearDeduction[categoryBudget.first];
-                if (!budgetOverride)
-                    // If user doesn't override the budget, add 1/12 of the adjusted amount to every period
-                    budgetStats[categoryBudget.first][month] += adjusted_amount / 12;
-                else if (!isBudgeted[std::make_pair(month, categoryBudget.first)])
-                    // Otherwise if n months have a defined budget, add 1/(12-n) of the adjusted amount only to the (12-n) non-budgeted periods
-                    budgetStats[categoryBudget.first][month] = adjusted_amount / (12 - budgetedMonths[categoryBudget.first]);
-            }
         else
-            // If the user is not deducting the monthly budget from the yearly budget
-            for (const auto& categoryBudget : monthlyBudgetValue)
-            {
-                if (!budgetOverride)
-                    // If user doesn't override their budget, add 1/12 of the yearly amount to every period
-                    budgetStats[categoryBudget.first][month] += categoryBudget.second;
-                else if (!isBudgeted[std::make_pair(month, categoryBudget.first)])
-                    // Otherwise fill 1/12 of the yearly amount only in non-budgeted periods
-                    budgetStats[categoryBudget.first][month] = categoryBudget.second;
-            }
-    }
-    if (!groupByMonth)
-    {
-        std::map<int64, std::map<int,double> > yearlyBudgetStats;
-        for (const auto& category : Model_Category::instance().all()) {
-            yearlyBudgetStats[category.CATEGID][0] = 0.0;
+        {
+            double total = 0.0;
+            for (int month = 0; month < 12; month++)
+                total += plan.value(category.CATEGID, month);
+            stats[0] = total;
         }
-
-        for (const auto& cat : budgetStats)
-            for(int month = 0; month < 12; month++)
-                yearlyBudgetStats[cat.first][0] += budgetStats[cat.first][month];
-
-        budgetStats = yearlyBudgetStats;
     }
 }
 
@@ -278,3 +246,205 @@ double Model_Budget::getEstimate(bool is_monthly, const PERIOD_ID period, const
     if (is_monthly) estimated = estimated / 12;
     return estimated;
 }
+
+//----------------------------------------------------------------------------
+
+mmBudgetPlan::mmBudgetPlan(const wxString& year)
+    : m_year(year)
+{
+    std::fill(m_month_ids, m_month_ids + 12, -1);
+}
+
+double mmBudgetPlan::value(int64 categ_id, int month) const
+{
+    const auto it = m_rows.find(categ_id);
+    if (it == m_rows.end() || month < 0 || month > 12) return 0.0;
+    return it->second.values[month];
+}
+
+bool mmBudgetPlan::has_yearly(int64 categ_id) const
+{
+    const auto it = m_rows.find(categ_id);
+    return it != m_rows.end() && it->second.yearly;
+}
+
+const std::vector<int64> mmBudgetPlan::categories() const
+{
+    std::vector<int64> list;
+    for (const auto& row : m_rows)
+        list.push_back(row.first);
+    return list;
+}
+
+bool mmBudgetPlan::has_year(int64 year_id) const
+{
+    return year_id > -1
+        && (year_id == m_year_id || std::find(m_month_ids, m_month_ids + 12, year_id) != m_month_ids + 12);
+}
+
+void mmBudgetPlan::load(const Model_Budget::Data& budget)
+{
+    Row& row = m_rows[budget.CATEGID];
+    m_entry_categ[budget.BUDGETENTRYID] = budget.CATEGID;
+    const Model_Budget::PERIOD_ID period = Model_Budget::period_id(budget);
+
+    if (budget.BUDGETYEARID == m_year_id)
+    {
+        row.yearly = true;
+        row.year_monthly = Model_Budget::getEstimate(true, period, budget.AMOUNT);
+        row.year_amount = Model_Budget::getEstimate(false, period, budget.AMOUNT);
+        return;
+    }
+
+    for (int month = 0; month < 12; month++)
+    {
+        if (budget.BUDGETYEARID != m_month_ids[month]) continue;
+        row.budgeted[month] = true;
+        row.month_amount[month] = Model_Budget::getEstimate(true, period, budget.AMOUNT);
+        row.deduction += row.month_amount[month];
+    }
+}
+
+void mmBudgetPlan::compute(Row& row) const
+{
+    int budgeted_months = 0;
+    for (int month = 0; month < 12; month++)
+    {
+        row.values[month] = row.budgeted[month] ? row.month_amount[month] : 0.0;
+        if (row.budgeted[month]) budgeted_months++;
+    }
+    row.values[12] = row.yearly ? row.year_amount : 0.0;
+    if (!row.yearly) return;
+
+    // Now go month by month and add the yearly budget
+    for (int month = 0; month < 12; month++)
+    {
+        // If user selected to deduct monthly budgeted amounts
+        if (m_deduct_monthly)
+        {
+            if (row.deduction / row.year_amount >= 1) continue;
+            //Deduct the monthly total from the yearly budget
+            double adjusted_amount = row.year_amount - row.deduction;
+            if (!m_override)
+                // If user doesn't override the budget, add 1/12 of the adjusted amount to every period
+                row.values[month] += adjusted_amount / 12;
+            else if (!row.budgeted[month])
+                // Otherwise if n months have a defined budget, add 1/(12-n) of the adjusted amount only to the (12-n) non-budgeted periods
+                row.values[month] = adjusted_amount / (12 - budgeted_months);
+        }
+        else
+        {
+            if (!m_override)
+                // If user doesn't override their budget, add 1/12 of the yearly amount to every period
+                row.values[month] += row.year_monthly;
+            else if (!row.budgeted[month])
+                // Otherwise fill 1/12 of the yearly amount only in non-budgeted periods
+                row.values[month] = row.year_monthly;
+        }
+    }
+}
+
+void mmBudgetPlan::reload(int64 categ_id)
+{
+    m_rows.erase(categ_id);
+    for (auto it = m_entry_categ.begin(); it != m_entry_categ.end();)
+    {
+        if (it->second == categ_id)
+            it = m_entry_categ.erase(it);
+        else
+            ++it;
+    }
+
+    for (const auto& budget : Model_Budget::instance().find(Model_Budget::CATEGID(categ_id)))
+    {
+        if (has_year(budget.BUDGETYEARID))
+            load(budget);
+    }
+    const auto it = m_rows.find(categ_id);
+    if (it != m_rows.end()) compute(it->second);
+}
+
+void mmBudgetPlan::build()
+{
+    m_rows.clear();
+    m_entry_categ.clear();
+
+    // One pass over the budget years instead of a lookup per period
+    m_year_id = -1;
+    std::fill(m_month_ids, m_month_ids + 12, -1);
+    for (const auto& record : Model_Budgetyear::instance().all())
+    {
+        const wxString& name = record.BUDGETYEARNAME;
+        if (name == m_year)
+            m_year_id = record.BUDGETYEARID;
+        else if (name.length() == 7 && name.StartsWith(m_year + "-"))
+        {
+            long month = 0;
+            if (name.Mid(5).ToLong(&month) && month >= 1 && month <= 12)
+                m_month_ids[month - 1] = record.BUDGETYEARID;
+        }
+    }
+
+    if (m_year_id > -1)
+    {
+        for (const auto& budget : Model_Budget::instance().find(Model_Budget::BUDGETYEARID(m_year_id)))
+            load(budget);
+    }
+    for (int month = 0; month < 12; month++)
+    {
+        if (m_month_ids[month] < 0) continue;
+        for (const auto& budget : Model_Budget::instance().find(Model_Budget::BUDGETYEARID(m_month_ids[month])))
+            load(budget);
+    }
+
+    for (auto& row : m_rows)
+        compute(row.second);
+}
+
+void mmBudgetPlan::refresh()
+{
+    const bool budget_override = Option::instance().getBudgetOverride();
+    const bool deduct_monthly = Option::instance().getBudgetDeductMonthly();
+
+    // Budget years added or renamed, or entries saved past Model_Budget::save
+    if (m_year_generation != Model_Budgetyear::instance().table_generation()
+        || m_generation != Model_Budget::instance().table_generation()
+        || !m_built)
+    {
+        m_built = true;
+        m_year_generation = Model_Budgetyear::instance().table_generation();
+        m_generation = Model_Budget::instance().table_generation();
+        m_override = budget_override;
+        m_deduct_monthly = deduct_monthly;
+        build();
+        return;
+    }
+
+    // Option changes only need the rules to be applied again
+    if (budget_override != m_override || deduct_monthly != m_deduct_monthly)
+    {
+        m_override = budget_override;
+        m_deduct_monthly = deduct_monthly;
+        for (auto& row : m_rows)
+            compute(row.second);
+    }
+}
+
+void mmBudgetPlan::update(int64 entry_id, int64 categ_id, int64 year_id, size_t generation)
+{
+    if (!m_built || m_generation != generation
+        || m_year_generation != Model_Budgetyear::instance().table_generation())
+        return;
+
+    // The entry may have been moved from another category or year
+    int64 old_categ_id = -1;
+    const auto it = m_entry_categ.find(entry_id);
+    if (it != m_entry_categ.end())
+    {
+        old_categ_id = it->second;
+        reload(old_categ_id);
+    }
+    if (has_year(year_id) && categ_id != old_categ_id)
+        reload(categ_id);
+    m_generation = Model_Budget::instance().table_generation();
+}
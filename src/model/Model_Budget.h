@@ -24,10 +24,15 @@
 #include "db/DB_Table_Budgettable_V1.h"
 #include "reports/mmDateRange.h"
 #include <float.h>
+#include <wx/sharedptr.h>
 
+class mmBudgetPlan;
 class Model_Budget : public Model<DB_Table_BUDGETTABLE_V1>
 {
 public:
+    using Model<DB_Table_BUDGETTABLE_V1>::save;
+    using Model<DB_Table_BUDGETTABLE_V1>::remove;
+
     Model_Budget();
     ~Model_Budget();
 
@@ -46,6 +51,13 @@ public:
     */
     static Model_Budget& instance();
 
+public:
+    /** Save the entry and reload its category in the budget plans */
+    int64 save(Data* r);
+    bool remove(int64 id);
+    /** Also drop the budget plans */
+    virtual void reset_state();
+
 public:
     enum PERIOD_ID
     {
@@ -82,6 +94,68 @@ public:
         , bool groupByMonth);
     static void copyBudgetYear(int64 newYearID, int64 baseYearID);
     static double getEstimate(bool is_monthly, const PERIOD_ID period, const double amount);
+    /** Return the materialised plan of the budget year, e.g. "2024" */
+    const mmBudgetPlan& getBudgetPlan(const wxString& year);
+
+private:
+    void update_plans(int64 entry_id, int64 categ_id, int64 year_id, size_t generation);
+    std::map<wxString, wxSharedPtr<mmBudgetPlan>> m_plans;
+};
+
+/**
+* Materialised budget of one year: the estimate of every category for
+* each month (index 0-11) and for the year (index 12) with the budget
+* override and deduct monthly options applied.
+* An entry saved or removed through Model_Budget only reloads the rows
+* of its categories; changes made past it are caught by the table
+* generations and build the whole plan again.
+*/
+class mmBudgetPlan
+{
+public:
+    explicit mmBudgetPlan(const wxString& year);
+
+    double value(int64 categ_id, int month) const;
+    bool has_yearly(int64 categ_id) const;
+    const std::vector<int64> categories() const;
+
+    /** Bring the plan up to date with the budget table and the options */
+    void refresh();
+    /**
+    * Reload the categories of the entry after it was written, the old one when
+    * it moved. Only done when the plan was current at the table generation of
+    * before the write, otherwise it is left to be built again by refresh().
+    */
+    void update(int64 entry_id, int64 categ_id, int64 year_id, size_t generation);
+
+private:
+    struct Row
+    {
+        bool yearly = false;
+        double year_amount = 0.0;   // yearly entry, whole year
+        double year_monthly = 0.0;  // yearly entry, one month
+        bool budgeted[12] = {};
+        double month_amount[12] = {};
+        double deduction = 0.0;     // sum of the monthly entries
+        double values[13] = {};
+    };
+
+    void build();
+    void load(const Model_Budget::Data& budget);
+    void compute(Row& row) const;
+    void reload(int64 categ_id);
+    bool has_year(int64 year_id) const;
+
+    wxString m_year;
+    int64 m_year_id = -1;
+    int64 m_month_ids[12];
+    bool m_override = false;
+    bool m_deduct_monthly = false;
+    bool m_built = false;
+    size_t m_generation = 0;
+    size_t m_year_generation = 0;
+    std::map<int64, Row> m_rows;
+    std::map<int64, int64> m_entry_categ; // category of the entries of the plan
 };
 
 #endif // 
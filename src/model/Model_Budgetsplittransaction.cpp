@@ -62,6 +62,7 @@ bool Model_Budgetsplittransaction::remove(int64 id)
 {
     // Delete all tags for the split before removing it
     Model_Taglink::instance().DeleteAllTags(Model_Attachment::REFTYPE_STR_BILLSDEPOSITSPLIT, id);
+    bump_generation();
     return this->remove(id, db_);
 }
 
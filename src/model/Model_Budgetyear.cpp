@@ -52,6 +52,7 @@ bool Model_Budgetyear::remove(int64 id)
 {
     for (const Model_Budget::Data& d : Model_Budget::instance().find(Model_Budget::BUDGETYEARID(id)))
         Model_Budget::instance().remove(d.BUDGETENTRYID);
+    bump_generation();
     return this->remove(id, db_);
 }
 
@@ -71,6 +72,7 @@ void Model_Budgetyear::Set(int64 year_id, const wxString& value)
         info->BUDGETYEARNAME = value;
         info->save(this->db_);
     }
+    bump_generation();
 }
 
 int64 Model_Budgetyear::Add(const wxString& value)
@@ -81,6 +83,7 @@ int64 Model_Budgetyear::Add(const wxString& value)
         Data* e = this->create();
         e->BUDGETYEARNAME = value;
         e->save(this->db_);
+        bump_generation();
         year_id = e->id();
     }
     return year_id;
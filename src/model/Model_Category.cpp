@@ -22,6 +22,7 @@
 #include "Model_Billsdeposits.h"
 #include "Model_Account.h"
 #include "Model_CurrencyHistory.h"
+#include "Model_Translink.h"
 #include "reports/mmDateRange.h"
 #include "option.h"
 #include <tuple>
@@ -43,7 +44,7 @@ Model_Category& Model_Category::instance(wxSQLite3Database* db)
     Model_Category& ins = Singleton<Model_Category>::instance();
     ins.db_ = db;
     ins.ensure(db);
-    ins.destroy_cache();
+    ins.reset_state();
     ins.preload();
 
     return ins;
@@ -55,6 +56,12 @@ Model_Category& Model_Category::instance()
     return Singleton<Model_Category>::instance();
 }
 
+void Model_Category::reset_state()
+{
+    Model<DB_Table_CATEGORY_V1>::reset_state();
+    m_cubes.clear();
+}
+
 const wxArrayString Model_Category::FilterCategory(const wxString& category_pattern)
 {
     wxArrayString categories;
@@ -87,12 +94,19 @@ Model_Category::Data* Model_Category::get(const wxString& name, const wxString&
 
 Model_Category::Data* Model_Category::get(const wxString& name, const int64 parentid)
 {
-    Data* category = this->get_one(CATEGNAME(name), PARENTID(parentid));
-    if (category) return category;
+    const int64 id = find_id_by_name(name, parentid);
+    return id == -1 ? nullptr : this->get(id);
+}
 
-    Data_Set items = this->find(CATEGNAME(name), PARENTID(parentid));
-    if (!items.empty()) category = this->get(items[0].CATEGID, this->db_);
-    return category;
+int64 Model_Category::find_id_by_name(const wxString& name, int64 parentid)
+{
+    return find_id_by_key(wxString::Format("%lld:", parentid) + name.Lower());
+}
+
+// The names are unique among the subcategories of a category
+wxString Model_Category::name_key(const Data& r) const
+{
+    return wxString::Format("%lld:", r.PARENTID) + r.CATEGNAME.Lower();
 }
 
 const std::map<wxString, int64> Model_Category::all_categories(bool excludeHidden)
@@ -270,87 +284,239 @@ void Model_Category::getCategoryStats(
     , bool WXUNUSED(ignoreFuture) //TODO: deprecated
     , bool group_by_month
     , std::map<int64, double> *budgetAmt
-    , bool fin_months)
+    , bool WXUNUSED(fin_months)
+    , bool rollup)
 {
-    //Initialization
-    //Set std::map with zerros
-    const auto& allcategories = instance().all();
-    double value = 0;
-    int columns = group_by_month ? 12 : 1;
-    const wxDateTime start_date(date_range->start_date());
-
-    std::vector<std::pair<wxDateTime, int>> monthMap;
-    for (int m = 0; m < columns; m++)
+    getCategoryCube(date_range, group_by_month)->slice(categoryStats, accountArray, budgetAmt, rollup);
+}
+
+wxSharedPtr<mmCategoryCube> Model_Category::getCategoryCube(const mmDateRange* date_range, bool group_by_month)
+{
+    // Every table the cube is derived from only grows its generation
+    const size_t generation = Model_Checking::instance().table_generation()
+        + Model_Splittransaction::instance().table_generation()
+        + Model_Account::instance().table_generation()
+        + Model_Currency::instance().table_generation()
+        + Model_Translink::instance().table_generation()
+        + instance().table_generation();
+
+    // The rates are relative to the base currency and may come from the history
+    const wxString key = wxString::Format("%s|%s|%d|%d|%lld|%zu|%zu"
+        , date_range->start_date().FormatISOCombined()
+        , date_range->end_date().FormatISOCombined()
+        , group_by_month ? 12 : 1
+        , Option::instance().getUseCurrencyHistory() ? 1 : 0
+        , Option::instance().getBaseCurrencyID().GetValue()
+        , Model_CurrencyHistory::instance().table_generation()
+        , generation);
+
+    auto& cubes = instance().m_cubes;
+    for (auto it = cubes.begin(); it != cubes.end(); ++it)
     {
-        const wxDateTime d = start_date.Add(wxDateSpan::Months(m));
-        monthMap.push_back(std::make_pair(d,m));
+        if (it->first != key) continue;
+        std::rotate(cubes.begin(), it, it + 1);
+        return cubes.front().second;
     }
-    std::reverse(monthMap.begin(), monthMap.end());
 
-    for (const auto& category : allcategories)
+    wxSharedPtr<mmCategoryCube> cube(new mmCategoryCube(date_range->start_date()
+        , date_range->end_date(), group_by_month ? 12 : 1));
+    cubes.insert(cubes.begin(), std::make_pair(key, cube));
+    size_t bytes = 0;
+    for (auto it = cubes.begin(); it != cubes.end(); ++it)
     {
-        for (int m = 0; m < columns; m++)
+        bytes += it->second->bytes();
+        if (bytes > CUBES_MAX_BYTES && it != cubes.begin())
         {
-            int month = group_by_month ? m : 0;
-            categoryStats[category.CATEGID][month] = value;
+            cubes.erase(it, cubes.end());
+            break;
         }
     }
-    //Calculations
+
+    return cube;
+}
+
+//----------------------------------------------------------------------------
+
+mmCategoryCube::mmCategoryCube(const wxDateTime& start_date, const wxDateTime& end_date, int periods)
+    : m_periods(periods)
+{
+    build(start_date, end_date);
+}
+
+int mmCategoryCube::period(const wxDateTime& start_date, const wxDateTime& date) const
+{
+    if (m_periods == 1) return 0;
+
+    // Month number since start, one less if the day of the month is not reached yet
+    int p = (date.GetYear() - start_date.GetYear()) * 12 + (date.GetMonth() - start_date.GetMonth());
+    if (p > 0 && date < start_date.Add(wxDateSpan::Months(p)))
+        --p;
+    return std::max(0, std::min(p, m_periods - 1));
+}
+
+void mmCategoryCube::build(const wxDateTime& start_date, const wxDateTime& end_date)
+{
+    for (const auto& category : Model_Category::instance().all())
+    {
+        m_categ_index[category.CATEGID] = m_categories.size();
+        m_categories.push_back(category.CATEGID);
+    }
+    m_parents.assign(m_categories.size(), std::string::npos);
+    for (const auto& category : Model_Category::instance().all())
+    {
+        const auto parent_it = m_categ_index.find(category.PARENTID);
+        if (parent_it != m_categ_index.end() && category.PARENTID != category.CATEGID)
+            m_parents[m_categ_index[category.CATEGID]] = parent_it->second;
+    }
+    for (const auto& account : Model_Account::instance().all())
+    {
+        m_account_index[account.ACCOUNTID] = m_accounts.size();
+        m_accounts.push_back(account.ACCOUNTID);
+    }
+    m_values.assign(m_categories.size() * m_periods * m_accounts.size() * LAYER_MAX, 0.0);
+
+    // Rates only change per day, avoid the queries of getDayRate for every transaction
+    std::map<std::pair<int64, wxString>, double> rates;
     auto splits = Model_Splittransaction::instance().get_all();
     for (const auto& transaction : Model_Checking::instance().find(
         Model_Checking::STATUS(Model_Checking::STATUS_ID_VOID, NOT_EQUAL)
-        , Model_Checking::TRANSDATE(date_range->start_date(), GREATER_OR_EQUAL)
-        , Model_Checking::TRANSDATE(date_range->end_date().FormatISOCombined(), LESS_OR_EQUAL)))
+        , Model_Checking::TRANSDATE(start_date, GREATER_OR_EQUAL)
+        , Model_Checking::TRANSDATE(end_date.FormatISOCombined(), LESS_OR_EQUAL)))
     {
         if (!transaction.DELETEDTIME.IsEmpty()) continue;
 
-        if (accountArray)
-        {
-            const auto account = Model_Account::instance().get(transaction.ACCOUNTID);
-            if (wxNOT_FOUND == accountArray->Index(account->ACCOUNTNAME)) {
-                continue;
-            }
-        }
-
-        const double convRate = Model_CurrencyHistory::getDayRate(
-            Model_Account::instance().get(transaction.ACCOUNTID)->CURRENCYID, transaction.TRANSDATE);
-        wxDateTime d = Model_Checking::TRANSDATE(transaction);
+        const auto account_it = m_account_index.find(transaction.ACCOUNTID);
+        if (account_it == m_account_index.end()) continue;
+        const size_t account = account_it->second;
 
-        int month = 0;
-        if (group_by_month)
-        {
-            auto it = std::find_if(monthMap.begin(), monthMap.end()
-                , [d](std::pair<wxDateTime, int> date){return d >= date.first;});
-            month = it->second;
-        }
+        const int64 currency_id = Model_Account::instance().get(transaction.ACCOUNTID)->CURRENCYID;
+        const auto rate_key = std::make_pair(currency_id, transaction.TRANSDATE.Left(10));
+        auto rate_it = rates.find(rate_key);
+        if (rate_it == rates.end())
+            rate_it = rates.insert(std::make_pair(rate_key
+                , Model_CurrencyHistory::getDayRate(currency_id, transaction.TRANSDATE))).first;
+        const double convRate = rate_it->second;
 
-        int64 categID = transaction.CATEGID;
+        const int month = period(start_date, Model_Checking::TRANSDATE(transaction));
+        const bool is_transfer = Model_Checking::type_id(transaction) == Model_Checking::TYPE_ID_TRANSFER;
 
-        if (categID > -1)
+        if (transaction.CATEGID > -1)
         {
-            if (Model_Checking::type_id(transaction) != Model_Checking::TYPE_ID_TRANSFER)
+            const auto categ_it = m_categ_index.find(transaction.CATEGID);
+            if (categ_it == m_categ_index.end()) continue;
+            const size_t cell = offset(categ_it->second, month, account);
+
+            if (!is_transfer)
             {
                 // Do not include asset or stock transfers in income expense calculations.
                 if (Model_Checking::foreignTransactionAsTransfer(transaction))
                     continue;
-                categoryStats[categID][month] += Model_Checking::account_flow(transaction, transaction.ACCOUNTID) * convRate;
+                m_values[cell + LAYER_FLOW] += Model_Checking::account_flow(transaction, transaction.ACCOUNTID) * convRate;
             }
-            else if (budgetAmt != 0)
+            else
             {
-                double amt = transaction.TRANSAMOUNT * convRate;
-                if ((*budgetAmt)[categID] < 0)
-                    categoryStats[categID][month] -= amt;
-                else
-                    categoryStats[categID][month] += amt;
+                m_values[cell + LAYER_TRANSFER] += transaction.TRANSAMOUNT * convRate;
             }
         }
         else
         {
+            const double sign = (Model_Checking::type_id(transaction) == Model_Checking::TYPE_ID_WITHDRAWAL) ? -1 : 1;
             for (const auto& entry : splits[transaction.id()])
             {
-                categoryStats[entry.CATEGID][month] += entry.SPLITTRANSAMOUNT
-                    * convRate * ((Model_Checking::type_id(transaction) == Model_Checking::TYPE_ID_WITHDRAWAL) ? -1 : 1);
+                const auto categ_it = m_categ_index.find(entry.CATEGID);
+                if (categ_it == m_categ_index.end()) continue;
+                m_values[offset(categ_it->second, month, account) + LAYER_FLOW] += entry.SPLITTRANSAMOUNT * convRate * sign;
+            }
+        }
+    }
+}
+
+const std::vector<bool> mmCategoryCube::account_mask(const wxSharedPtr<wxArrayString>& accountArray) const
+{
+    std::vector<bool> mask(m_accounts.size(), true);
+    if (accountArray)
+    {
+        for (size_t a = 0; a < m_accounts.size(); a++)
+        {
+            const Model_Account::Data* account = Model_Account::instance().get(m_accounts[a]);
+            mask[a] = account && wxNOT_FOUND != accountArray->Index(account->ACCOUNTNAME);
+        }
+    }
+    return mask;
+}
+
+double mmCategoryCube::own_value(size_t categ, int period, const std::vector<bool>& accounts
+    , const std::map<int64, double>* budgetAmt) const
+{
+    // Transfers only count for budgets, against the sign of the budgeted amount
+    double transfer_sign = 0.0;
+    if (budgetAmt)
+    {
+        const auto budget_it = budgetAmt->find(m_categories[categ]);
+        transfer_sign = (budget_it != budgetAmt->end() && budget_it->second < 0) ? -1.0 : 1.0;
+    }
+
+    const double* cell = &m_values[offset(categ, period, 0)];
+    double flow = 0.0, transfer = 0.0;
+    for (size_t a = 0; a < m_accounts.size(); a++, cell += LAYER_MAX)
+    {
+        if (!accounts[a]) continue;
+        flow += cell[LAYER_FLOW];
+        transfer += cell[LAYER_TRANSFER];
+    }
+    return flow + transfer_sign * transfer;
+}
+
+double mmCategoryCube::value(int64 categ_id, int period, const std::vector<bool>& accounts
+    , const std::map<int64, double>* budgetAmt, bool rollup) const
+{
+    const auto categ_it = m_categ_index.find(categ_id);
+    if (categ_it == m_categ_index.end() || period < 0 || period >= m_periods)
+        return 0.0;
+    if (!rollup)
+        return own_value(categ_it->second, period, accounts, budgetAmt);
+
+    // Each subcategory keeps the transfer sign of its own budget
+    double total = 0.0;
+    for (size_t c = 0; c < m_categories.size(); c++)
+    {
+        size_t ancestor = c;
+        for (int depth = 0; ancestor != categ_it->second && ancestor != std::string::npos && depth < 32; depth++)
+            ancestor = m_parents[ancestor];
+        if (ancestor == categ_it->second)
+            total += own_value(c, period, accounts, budgetAmt);
+    }
+    return total;
+}
+
+void mmCategoryCube::slice(std::map<int64, std::map<int, double>>& categoryStats
+    , const wxSharedPtr<wxArrayString>& accountArray
+    , const std::map<int64, double>* budgetAmt, bool rollup) const
+{
+    const std::vector<bool> mask = account_mask(accountArray);
+    std::vector<double> totals(m_categories.size() * m_periods, 0.0);
+    for (size_t c = 0; c < m_categories.size(); c++)
+    {
+        for (int m = 0; m < m_periods; m++)
+        {
+            const double own = own_value(c, m, mask, budgetAmt);
+            totals[c * m_periods + m] += own;
+            if (!rollup) continue;
+
+            // Add the category row to all of its parents
+            size_t parent = m_parents[c];
+            for (int depth = 0; parent != std::string::npos && depth < 32; depth++)
+            {
+                totals[parent * m_periods + m] += own;
+                parent = m_parents[parent];
             }
         }
     }
+
+    for (size_t c = 0; c < m_categories.size(); c++)
+    {
+        auto& periods = categoryStats[m_categories[c]];
+        for (int m = 0; m < m_periods; m++)
+            periods[m] = totals[c * m_periods + m];
+    }
 }
@@ -25,6 +25,7 @@
 #include "db/DB_Table_Category_V1.h"
 
 class mmDateRange;
+class mmCategoryCube;
 class Model_Category : public Model<DB_Table_CATEGORY_V1>
 {
 public:
@@ -56,10 +57,14 @@ public:
     * Note: Assigning the address to a local variable can destroy the instance.
     */
     static Model_Category& instance();
+    /** Also drop the aggregation cubes */
+    virtual void reset_state();
 
 public:
     /** Return the Data record for the given category name */
     Data* get(const wxString& name, const int64 parentid);
+    /** Return the id of the category with the given name and parent, -1 when there is none */
+    int64 find_id_by_name(const wxString& name, int64 parentid);
     Data* get(const wxString& name, const wxString& parentname);
 
     const wxArrayString FilterCategory(const wxString& category_pattern);
@@ -79,9 +84,69 @@ public:
         , mmDateRange* date_range, bool ignoreFuture
         , bool group_by_month = true
         , std::map<int64, double >*budgetAmt = nullptr
-        , bool fin_months = false);
+        , bool fin_months = false
+        , bool rollup = false);
+    /** Return the shared aggregation cube for the date range, rebuilt only when transactions changed */
+    static wxSharedPtr<mmCategoryCube> getCategoryCube(const mmDateRange* date_range, bool group_by_month = true);
     static const wxString full_name(const Data* category);
 
+protected:
+    wxString name_key(const Data& r) const;
+
+private:
+    std::vector<std::pair<wxString, wxSharedPtr<mmCategoryCube>>> m_cubes; // most recently used first
+    /** Memory the cached cubes may take together, the most recent one is always kept */
+    static const size_t CUBES_MAX_BYTES = 64 * 1024 * 1024;
 };
 
+/**
+* Dense category x period x account aggregation of the transactions
+* of a date range in base currency, built in one pass.
+* Transfers are kept in a layer of their own since their sign depends
+* on the budget of the category they are sliced for.
+*/
+class mmCategoryCube
+{
+public:
+    mmCategoryCube(const wxDateTime& start_date, const wxDateTime& end_date, int periods);
+
+    int periods() const;
+    /** Memory taken by the values */
+    size_t bytes() const;
+    /** Return the mask of cube accounts matching the account names, all accounts for null */
+    const std::vector<bool> account_mask(const wxSharedPtr<wxArrayString>& accountArray) const;
+    /** Value of the category, with the values of all its subcategories added for rollup */
+    double value(int64 categ_id, int period, const std::vector<bool>& accounts
+        , const std::map<int64, double>* budgetAmt = nullptr, bool rollup = false) const;
+    /** Fill the classic categoryStats structure with values of all categories,
+    * each parent also holding the values of its subcategories for rollup */
+    void slice(std::map<int64, std::map<int, double>>& categoryStats
+        , const wxSharedPtr<wxArrayString>& accountArray
+        , const std::map<int64, double>* budgetAmt = nullptr, bool rollup = false) const;
+
+private:
+    enum LAYER { LAYER_FLOW = 0, LAYER_TRANSFER, LAYER_MAX };
+
+    void build(const wxDateTime& start_date, const wxDateTime& end_date);
+    size_t offset(size_t categ, int period, size_t account) const;
+    int period(const wxDateTime& start_date, const wxDateTime& date) const;
+    double own_value(size_t categ, int period, const std::vector<bool>& accounts
+        , const std::map<int64, double>* budgetAmt) const;
+
+    int m_periods;
+    std::vector<int64> m_categories;
+    std::vector<int64> m_accounts;
+    std::unordered_map<int64, size_t> m_categ_index;
+    std::unordered_map<int64, size_t> m_account_index;
+    std::vector<size_t> m_parents; // cube index of the parent category, npos for top level
+    std::vector<double> m_values; // [category][period][account][layer]
+};
+
+inline int mmCategoryCube::periods() const { return m_periods; }
+inline size_t mmCategoryCube::bytes() const { return m_values.size() * sizeof(double); }
+inline size_t mmCategoryCube::offset(size_t categ, int period, size_t account) const
+{
+    return ((categ * m_periods + period) * m_accounts.size() + account) * LAYER_MAX;
+}
+
 #endif //
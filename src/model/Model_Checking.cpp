@@ -22,6 +22,8 @@
 #include "Model_Account.h"
 #include "Model_Payee.h"
 #include "Model_Category.h"
+#include <cmath>
+#include <cstdlib>
 #include <queue>
 #include "Model_Tag.h"
 #include "Model_Translink.h"
@@ -142,6 +144,7 @@ bool Model_Checking::remove(int64 id)
     // remove all custom fields for the transaction
     Model_CustomFieldData::DeleteAllData(RefType, id);
     Model_Taglink::instance().DeleteAllTags(RefType, id);
+    bump_generation();
     return this->remove(id, db_);
 }
 
@@ -151,6 +154,7 @@ int64 Model_Checking::save(Data* r)
     if (!oldData || (!oldData->equals(r) && oldData->DELETEDTIME.IsEmpty() && r->DELETEDTIME.IsEmpty()))
         r->LASTUPDATEDTIME = wxDateTime::Now().ToUTC().FormatISOCombined();
     this->save(r, db_);
+    bump_generation();
     return r->TRANSID;
 }
 
@@ -745,3 +749,116 @@ void Model_Checking::updateTimestamp(int64 id)
         this->save(r, db_);
     }
 }
+
+Model_Checking::Cursor::Cursor(const wxString& where, const wxString& order_by)
+{
+    Model_Checking& model = Model_Checking::instance();
+    wxString sql = model.query();
+    if (!where.empty()) sql += " WHERE " + where;
+    if (!order_by.empty()) sql += " ORDER BY " + order_by;
+    try
+    {
+        stmt_ = model.db_->PrepareStatement(sql);
+        q_ = stmt_.ExecuteQuery();
+        ok_ = true;
+    }
+    catch (const wxSQLite3Exception& e)
+    {
+        wxLogError("%s: Exception %s", model.name().utf8_str(), e.GetMessage().utf8_str());
+    }
+}
+
+bool Model_Checking::Cursor::next(Data& r)
+{
+    if (!ok_)
+        return false;
+    try
+    {
+        if (q_.NextRow())
+        {
+            r = Data(q_);
+            return true;
+        }
+    }
+    catch (const wxSQLite3Exception& e)
+    {
+        wxLogError("%s: Exception %s", Model_Checking::instance().name().utf8_str(), e.GetMessage().utf8_str());
+    }
+    ok_ = false;
+    q_.Finalize();
+    return false;
+}
+
+void mmDuplicateIndex::clear()
+{
+    m_accounts.clear();
+    m_index.clear();
+}
+
+void mmDuplicateIndex::load(int64 account_id)
+{
+    for (const auto& r : Model_Checking::instance().find(Model_Checking::ACCOUNTID(account_id)))
+    {
+        if (!r.DELETEDTIME.IsEmpty())
+            continue;
+        m_index[key(r)].push_back({ mmDayNumber(r.TRANSDATE), false });
+    }
+}
+
+bool mmDuplicateIndex::take(const Model_Checking::Data& r)
+{
+    if (m_accounts.insert(r.ACCOUNTID.GetValue()).second)
+        load(r.ACCOUNTID);
+
+    const auto it = m_index.find(key(r));
+    if (it == m_index.end())
+        return false;
+
+    // the nearest one in the window which is not matched yet
+    const int day = mmDayNumber(r.TRANSDATE);
+    Existing* nearest = nullptr;
+    for (auto& e : it->second)
+    {
+        if (e.taken || std::abs(e.day - day) > m_window)
+            continue;
+        if (!nearest || std::abs(e.day - day) < std::abs(nearest->day - day))
+            nearest = &e;
+    }
+    if (!nearest)
+        return false;
+
+    nearest->taken = true;
+    return true;
+}
+
+wxString mmDuplicateIndex::key(const Model_Checking::Data& r)
+{
+    wxString who;
+    if (Model_Checking::is_transfer(&r))
+        who = wxString::Format("T%lld", r.TOACCOUNTID);
+    else if (r.PAYEEID > 0)
+        who = wxString::Format("P%lld", r.PAYEEID);
+    else
+    {
+        // the notes, ignoring the letter case and the runs of white space
+        who = "N";
+        bool space = false;
+        for (const auto& c : r.NOTES.Lower().Trim().Trim(false))
+        {
+            if (wxIsspace(c))
+            {
+                if (!space) who += ' ';
+                space = true;
+            }
+            else
+            {
+                who += c;
+                space = false;
+            }
+        }
+    }
+
+    const long long cents = std::llround(r.TRANSAMOUNT * 100);
+    return wxString::Format("%lld|%s|%lld|%s", r.ACCOUNTID, r.TRANSCODE, cents, who);
+}
+
@@ -19,6 +19,7 @@
 #ifndef MODEL_CHECKING_H
 #define MODEL_CHECKING_H
 
+#include <set>
 #include "Model.h"
 #include "db/DB_Table_Checkingaccount_V1.h"
 #include "Model_Splittransaction.h"
@@ -255,6 +256,58 @@ public:
     static void putDataToTransaction(Data *r, const Data &data);
     static bool foreignTransaction(const Data& data);
     static bool foreignTransactionAsTransfer(const Data& data);
+
+public:
+    /**
+    * Reads the transactions one row at a time instead of building a Data_Set.
+    * The condition and the ordering are SQL on the columns of the table,
+    * either of them may be empty.
+    */
+    class Cursor
+    {
+    public:
+        Cursor(const wxString& where, const wxString& order_by);
+        bool next(Data& r);
+
+    private:
+        wxSQLite3Statement stmt_;
+        wxSQLite3ResultSet q_;
+        bool ok_ = false;
+    };
+};
+
+/**
+* Finds the transactions of an import that already exist. The transactions
+* of an account are read once, on its first use, and hashed by type, amount
+* and payee (the other account for transfers, the notes when there is no
+* payee). A row matches an existing transaction of the same key dated up to
+* window days apart, and every existing transaction matches one row only.
+* The index is a snapshot: rows saved during the import are not added, so
+* identical rows of a file are not taken for duplicates of each other.
+*/
+class mmDuplicateIndex
+{
+public:
+    explicit mmDuplicateIndex(int window = DEFAULT_WINDOW) : m_window(window) {}
+
+    /** True when an unmatched existing transaction looks like this one, it is matched then */
+    bool take(const Model_Checking::Data& r);
+    void clear();
+
+    enum { DEFAULT_WINDOW = 3 }; // days
+
+private:
+    struct Existing
+    {
+        int day;
+        bool taken;
+    };
+    void load(int64 account_id);
+    static wxString key(const Model_Checking::Data& r);
+
+    int m_window;
+    std::set<wxLongLong_t> m_accounts;
+    std::unordered_map<wxString, std::vector<Existing>> m_index;
 };
 
 inline bool Model_Checking::Full_Data::has_split() const { return !this->m_splits.empty(); }
@@ -211,6 +211,7 @@ bool Model_Currency::remove(int64 id)
     for (const auto& r : Model_CurrencyHistory::instance().find(Model_CurrencyHistory::CURRENCYID(id)))
         Model_CurrencyHistory::instance().remove(r.id());
     this->ReleaseSavepoint();
+    bump_generation();
     return this->remove(id, db_);
 }
 
@@ -83,6 +83,12 @@ int64 Model_CurrencyHistory::addUpdate(const int64 currencyID, const wxDate& dat
     return save(currHist);
 }
 
+size_t Model_CurrencyHistory::addUpdate(const int64 currencyID, const std::map<wxDate, double>& rates, UPDTYPE type, bool replace)
+{
+    return add_update_dated<CURRENCYID, DB_Table_CURRENCYHISTORY_V1::CURRDATE, CURRVALUE, CURRUPDTYPE>(currencyID, rates, int64(type), replace
+        , &Data::CURRDATE, &Data::CURRVALUE, &Data::CURRUPDTYPE);
+}
+
 /** Return the rate for a specific currency in a specific day*/
 double Model_CurrencyHistory::getDayRate(int64 currencyID, const wxString& DateISO)
 {
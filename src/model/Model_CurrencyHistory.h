@@ -56,6 +56,13 @@ public:
     /** Adds or updates an element in currency history */
     int64 addUpdate(const int64 currencyID, const wxDate& date, double price, UPDTYPE type);
 
+    /**
+    Adds the rates of a currency, and updates the ones already stored when replace is set.
+    The stored dates are read in one query and the rows written in one transaction.
+    * Return the number of rows written
+    */
+    size_t addUpdate(const int64 currencyID, const std::map<wxDate, double>& rates, UPDTYPE type, bool replace = true);
+
     /** Return the rate for a specific currency in a specific day*/
     static double getDayRate(int64 currencyID, const wxString& DateISO);
     static double getDayRate(int64 currencyID, const wxDate& Date = wxDate::Today());
@@ -39,6 +39,7 @@ Model_Payee& Model_Payee::instance(wxSQLite3Database* db)
     Model_Payee& ins = Singleton<Model_Payee>::instance();
     ins.db_ = db;
     ins.destroy_cache();
+    ins.reset_name_index();
     ins.ensure(db);
     ins.preload();
 
@@ -64,12 +65,18 @@ const Model_Payee::Data_Set Model_Payee::FilterPayees(const wxString& payee_patt
 
 Model_Payee::Data* Model_Payee::get(const wxString& name)
 {
-    Data* payee = this->get_one(PAYEENAME(name));
-    if (payee) return payee;
+    const int64 id = find_id_by_name(name);
+    return id == -1 ? nullptr : this->get(id);
+}
 
-    Data_Set items = this->find(PAYEENAME(name));
-    if (!items.empty()) payee = this->get(items[0].PAYEEID, this->db_);
-    return payee;
+int64 Model_Payee::find_id_by_name(const wxString& name)
+{
+    return find_id_by_key(name.Lower());
+}
+
+wxString Model_Payee::name_key(const Data& r) const
+{
+    return r.PAYEENAME.Lower();
 }
 
 wxString Model_Payee::get_payee_name(int64 payee_id)
@@ -84,6 +91,8 @@ wxString Model_Payee::get_payee_name(int64 payee_id)
 bool Model_Payee::remove(int64 id)
 {
     if (is_used(id)) return false;
+    bump_generation();
+    forget_name(id);
     return this->remove(id, db_);
 }
 
@@ -56,6 +56,8 @@ public:
     * Returns 0 when payee not found.
     */
     Data* get(const wxString& name);
+    /** Return the id of the payee with the given name, -1 when there is none */
+    int64 find_id_by_name(const wxString& name);
     static wxString get_payee_name(int64 payee_id);
 
     bool remove(int64 id);
@@ -71,6 +73,9 @@ public:
     static bool is_used(int64 id);
     static bool is_used(const Data* record);
     static bool is_used(const Data& record);
+
+protected:
+    wxString name_key(const Data& r) const;
 };
 
 #endif // 
@@ -54,6 +54,7 @@ bool Model_Splittransaction::remove(int64 id)
 {
     // Delete all tags for the split before removing it
     Model_Taglink::instance().DeleteAllTags(Model_Attachment::REFTYPE_STR_TRANSACTIONSPLIT, id);
+    bump_generation();
     return this->remove(id, db_);
 }
 
@@ -109,6 +109,7 @@ bool Model_Stock::remove(int64 id)
         this->ReleaseSavepoint();
     }
 
+    bump_generation();
     return this->remove(id, db_);
 }
 
@@ -86,3 +86,9 @@ int64 Model_StockHistory::addUpdate(const wxString& symbol, const wxDate& date,
 
     return save(stockHist);
 }
+
+size_t Model_StockHistory::addUpdate(const wxString& symbol, const std::map<wxDate, double>& prices, UPDTYPE type, bool replace)
+{
+    return add_update_dated<SYMBOL, DB_Table_STOCKHISTORY_V1::DATE, VALUE, DB_Table_STOCKHISTORY_V1::UPDTYPE>(symbol, prices, int64(type), replace
+        , &Data::DATE, &Data::VALUE, &Data::UPDTYPE);
+}
@@ -56,6 +56,14 @@ public:
     Adds or updates an element in stock history
     */
     int64 addUpdate(const wxString& symbol, const wxDate& date, double price, UPDTYPE type);
+
+    /**
+    Adds the prices of a symbol, and updates the ones already stored when replace is set.
+    The stored dates are read in one query and the rows written in one transaction.
+    Unlike the single addUpdate, the current price of the stock is left alone.
+    * Return the number of rows written
+    */
+    size_t addUpdate(const wxString& symbol, const std::map<wxDate, double>& prices, UPDTYPE type, bool replace = true);
 };
 
 #endif // 
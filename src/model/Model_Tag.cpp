@@ -39,6 +39,7 @@ Model_Tag& Model_Tag::instance(wxSQLite3Database* db)
     Model_Tag& ins = Singleton<Model_Tag>::instance();
     ins.db_ = db;
     ins.destroy_cache();
+    ins.reset_name_index();
     ins.ensure(db);
 
     return ins;
@@ -52,12 +53,18 @@ Model_Tag& Model_Tag::instance()
 
 Model_Tag::Data* Model_Tag::get(const wxString& name)
 {
-    Data* tag = this->get_one(TAGNAME(name));
-    if (tag) return tag;
+    const int64 id = find_id_by_name(name);
+    return id == -1 ? nullptr : this->get(id);
+}
 
-    Data_Set items = this->find(TAGNAME(name));
-    if (!items.empty()) tag = this->get(items[0].TAGID, this->db_);
-    return tag;
+int64 Model_Tag::find_id_by_name(const wxString& name)
+{
+    return find_id_by_key(name.Lower());
+}
+
+wxString Model_Tag::name_key(const Data& r) const
+{
+    return r.TAGNAME.Lower();
 }
 
 int Model_Tag::is_used(int64 id)
@@ -50,9 +50,14 @@ public:
     * Returns 0 when tag not found.
     */
     Data* get(const wxString& name);
+    /** Return the id of the tag with the given name, -1 when there is none */
+    int64 find_id_by_name(const wxString& name);
 
     /* Returns 0 if not used, 1 if used, and -1 if used only in deleted transactions */
     int is_used(int64 id);
+
+protected:
+    wxString name_key(const Data& r) const;
 };
 
 #endif // 
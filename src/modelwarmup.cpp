@@ -0,0 +1,183 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#include "modelwarmup.h"
+#include "dbwrapper.h"
+#include "model/allmodel.h"
+#include <wx/app.h>
+#include <wx/thread.h>
+
+class mmModelWarmUp::Worker : public wxThread
+{
+public:
+    Worker(mmModelWarmUp* warm_up, const std::vector<wxSharedPtr<Job>>& jobs
+        , const wxString& path, const wxString& password, int session)
+        : wxThread(wxTHREAD_JOINABLE)
+        , m_warm_up(warm_up), m_jobs(jobs)
+        , m_path(path), m_password(password), m_session(session)
+    {}
+
+protected:
+    virtual ExitCode Entry();
+
+private:
+    mmModelWarmUp* m_warm_up;
+    std::vector<wxSharedPtr<Job>> m_jobs;
+    wxString m_path;
+    wxString m_password;
+    int m_session;
+};
+
+wxThread::ExitCode mmModelWarmUp::Worker::Entry()
+{
+    wxSharedPtr<wxSQLite3Database> db = mmDBWrapper::OpenReadOnly(m_path, m_password);
+    for (const auto& job : m_jobs)
+    {
+        if (m_warm_up->m_stop)
+            break;
+
+        if (db)
+        {
+            try
+            {
+                job->read(db.get(), m_warm_up->m_stop);
+            }
+            catch (const wxSQLite3Exception& e)
+            {
+                wxLogDebug("mmModelWarmUp: %s", e.GetMessage());
+            }
+        }
+
+        // handed over even without rows, the table is still to be checked
+        mmModelWarmUp* warm_up = m_warm_up;
+        const int session = m_session;
+        wxTheApp->CallAfter([warm_up, job, session]() { warm_up->adopt(job, session); });
+    }
+    return nullptr;
+}
+
+mmModelWarmUp& mmModelWarmUp::instance()
+{
+    return Singleton<mmModelWarmUp>::instance();
+}
+
+void mmModelWarmUp::start(const wxString& path, const wxString& password)
+{
+    std::vector<wxSharedPtr<Job>> jobs;
+    jobs.swap(m_jobs);
+    stop();
+
+    bool read = false;
+    for (const auto& job : jobs)
+        read = read || !job->empty();
+    if (read)
+    {
+        m_worker = new Worker(this, jobs, path, password, m_session);
+        if (m_worker->Run() == wxTHREAD_NO_ERROR)
+            return;
+        delete m_worker;
+        m_worker = nullptr;
+    }
+
+    // nothing to read in the background, only the tables to check
+    for (const auto& job : jobs)
+        job->adopt();
+}
+
+void mmModelWarmUp::stop()
+{
+    m_jobs.clear();
+    // rows already posted by the worker are for the database closed now
+    m_session++;
+    if (!m_worker)
+        return;
+
+    m_stop = true;
+    m_worker->Wait();
+    delete m_worker;
+    m_worker = nullptr;
+    m_stop = false;
+}
+
+void mmModelWarmUp::adopt(const wxSharedPtr<Job>& job, int session)
+{
+    if (session == m_session)
+        job->adopt();
+}
+
+namespace
+{
+    // Rows of a lazily attached table read in the background at most
+    const int WARM_UP_ROWS = 10000;
+
+    template<class MODEL>
+    ModelBase* attachLazily(MODEL& model, wxSQLite3Database* db, int warm_up_rows)
+    {
+        model.attach(db);
+        mmModelWarmUp::instance().add(model, warm_up_rows);
+        return &model;
+    }
+}
+
+std::vector<ModelBase*> mmAttachModels(wxSQLite3Database* db, bool lazy)
+{
+    mmModelWarmUp::instance().stop();
+    std::vector<ModelBase*> models;
+
+    // Tables read by the options, the home page and the navigation tree
+    models.push_back(&Model_Infotable::instance(db));
+    models.push_back(&Model_Asset::instance(db));
+    models.push_back(&Model_Stock::instance(db));
+    models.push_back(&Model_Account::instance(db));
+    models.push_back(&Model_Payee::instance(db));
+    models.push_back(&Model_Checking::instance(db));
+    models.push_back(&Model_Currency::instance(db));
+    models.push_back(&Model_Budgetyear::instance(db));
+    models.push_back(&Model_Category::instance(db));
+    models.push_back(&Model_Billsdeposits::instance(db));
+    models.push_back(&Model_Splittransaction::instance(db));
+    models.push_back(&Model_Report::instance(db));
+    models.push_back(&Model_Tag::instance(db));
+
+    if (lazy) {
+        // Checked and warmed up by mmModelWarmUp once the window is usable,
+        // until then they read the database on demand
+        models.push_back(attachLazily(Model_CurrencyHistory::instance(), db, WARM_UP_ROWS));
+        models.push_back(attachLazily(Model_StockHistory::instance(), db, WARM_UP_ROWS));
+        models.push_back(attachLazily(Model_Attachment::instance(), db, WARM_UP_ROWS));
+        models.push_back(attachLazily(Model_Taglink::instance(), db, 1000));
+        models.push_back(attachLazily(Model_Budgetsplittransaction::instance(), db, 0));
+        models.push_back(attachLazily(Model_Budget::instance(), db, 0));
+        models.push_back(attachLazily(Model_CustomFieldData::instance(), db, 0));
+        models.push_back(attachLazily(Model_CustomField::instance(), db, 0));
+        models.push_back(attachLazily(Model_Translink::instance(), db, 0));
+        models.push_back(attachLazily(Model_Shareinfo::instance(), db, 0));
+    }
+    else {
+        models.push_back(&Model_CurrencyHistory::instance(db));
+        models.push_back(&Model_StockHistory::instance(db));
+        models.push_back(&Model_Attachment::instance(db));
+        models.push_back(&Model_Taglink::instance(db));
+        models.push_back(&Model_Budgetsplittransaction::instance(db));
+        models.push_back(&Model_Budget::instance(db));
+        models.push_back(&Model_CustomFieldData::instance(db));
+        models.push_back(&Model_CustomField::instance(db));
+        models.push_back(&Model_Translink::instance(db));
+        models.push_back(&Model_Shareinfo::instance(db));
+    }
+
+    return models;
+}
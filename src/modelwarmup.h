@@ -0,0 +1,133 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#ifndef MM_EX_MODELWARMUP_H_
+#define MM_EX_MODELWARMUP_H_
+
+#include <atomic>
+#include <vector>
+#include <wx/sharedptr.h>
+#include <wx/string.h>
+#include "model/Model.h"
+
+class wxSQLite3Database;
+
+/**
+* Fills the caches of models attached lazily with Model<>::attach() once the
+* first screen is shown. The rows are read on a worker thread with its own
+* read only connection, then handed to the models on the GUI thread, which
+* also checks their tables. The models themselves are only used on the GUI
+* thread, they are not thread safe.
+*
+*   mmModelWarmUp::instance().add(Model_CurrencyHistory::instance(), 10000);
+*   mmModelWarmUp::instance().start(fileName, password);
+*/
+class mmModelWarmUp
+{
+public:
+    static mmModelWarmUp& instance();
+
+    /** Queue a model, up to max_rows of its rows are read. With 0 its table is only checked. */
+    template<class MODEL>
+    void add(MODEL& model, int max_rows);
+
+    /** Start reading the queued tables of the database file */
+    void start(const wxString& path, const wxString& password);
+    /** Stop the worker and drop the rows not handed to the models yet */
+    void stop();
+
+private:
+    class Job
+    {
+    public:
+        virtual ~Job() {}
+        /** Worker thread: read the rows through db, returning early when stop is set */
+        virtual void read(wxSQLite3Database* db, const std::atomic<bool>& stop) = 0;
+        /** GUI thread: check the table and hand the rows to the model */
+        virtual void adopt() = 0;
+        /** No rows to read, only the table to check */
+        virtual bool empty() const = 0;
+    };
+
+    template<class MODEL>
+    class TableJob;
+
+    class Worker;
+    friend class Worker;
+
+    void adopt(const wxSharedPtr<Job>& job, int session);
+
+    std::vector<wxSharedPtr<Job>> m_jobs;
+    Worker* m_worker = nullptr;
+    std::atomic<bool> m_stop{ false };
+    int m_session = 0;
+};
+
+template<class MODEL>
+class mmModelWarmUp::TableJob : public mmModelWarmUp::Job
+{
+public:
+    /** Taken before the read, the rows are dropped if the table changes meanwhile */
+    TableJob(MODEL& model, int max_rows)
+        : m_model(model)
+        , m_query(model.query())
+        , m_generation(model.table_generation())
+        , m_max_rows(max_rows)
+    {}
+
+    virtual void read(wxSQLite3Database* db, const std::atomic<bool>& stop)
+    {
+        if (m_max_rows <= 0)
+            return;
+        wxSQLite3Statement stmt = db->PrepareStatement(m_query + " LIMIT ?");
+        stmt.Bind(1, m_max_rows);
+        wxSQLite3ResultSet q = stmt.ExecuteQuery();
+        // the model is only passed as the owner of the rows, it is not used here
+        while (!stop && q.NextRow())
+            m_rows.push_back(typename MODEL::Data(q, &m_model));
+        stmt.Finalize();
+    }
+
+    virtual void adopt()
+    {
+        m_model.ensure_table();
+        m_model.adopt(m_rows, m_generation);
+    }
+
+    virtual bool empty() const { return m_max_rows <= 0; }
+
+private:
+    MODEL& m_model;
+    wxString m_query;
+    size_t m_generation;
+    int m_max_rows;
+    std::vector<typename MODEL::Data> m_rows;
+};
+
+template<class MODEL>
+void mmModelWarmUp::add(MODEL& model, int max_rows)
+{
+    m_jobs.push_back(wxSharedPtr<Job>(new TableJob<MODEL>(model, max_rows)));
+}
+
+/**
+* Attach every model to db, checking the tables of the ones the first screen
+* reads. With lazy the others are only attached and queued for the warm-up,
+* started with mmModelWarmUp::start() once the window is usable.
+*/
+std::vector<ModelBase*> mmAttachModels(wxSQLite3Database* db, bool lazy);
+
+#endif // MM_EX_MODELWARMUP_H_
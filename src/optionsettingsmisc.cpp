@@ -18,6 +18,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 ********************************************************/
 
 #include "optionsettingsmisc.h"
+#include "dbwrapper.h"
 #include "option.h"
 #include "util.h"
 
@@ -200,6 +201,13 @@ void OptionSettingsMisc::Create()
         "create or update the backup database: dbFile_update_YYYY-MM-DD.bak"));
     databaseStaticBoxSizer->Add(databaseUpdateCheckBox, g_flagsV);
 
+    wxCheckBox* databaseStoreCheckBox = new wxCheckBox(misc_panel, ID_DIALOG_OPTIONS_CHK_BACKUP_STORE
+        , _("Keep backups in a backup store"), wxDefaultPosition, wxDefaultSize, wxCHK_2STATE);
+    databaseStoreCheckBox->SetValue(GetIniDatabaseCheckboxValue("BACKUPDB_STORE", false));
+    databaseStoreCheckBox->SetToolTip(_("Save the backups in the folder dbFile.store,\n"
+        "where the parts of the database that did not change are only stored once"));
+    databaseStaticBoxSizer->Add(databaseStoreCheckBox, g_flagsV);
+
     int max = Model_Setting::instance().getInt("MAX_BACKUP_FILES", 4);
     m_max_files = new wxSpinCtrl(misc_panel, wxID_ANY
         , wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, 999, max);
@@ -221,6 +229,29 @@ void OptionSettingsMisc::Create()
     flex_sizer3->Add(m_deleted_trans_retain_days, g_flagsBorder1H);
     databaseStaticBoxSizer->Add(flex_sizer3);
 
+    m_db_profile = new wxChoice(misc_panel, wxID_ANY);
+    m_db_profile->Append(_("Safe"));
+    m_db_profile->Append(_("Performance"));
+    m_db_profile->SetSelection(Model_Setting::instance().getInt("DB_PROFILE", mmDBWrapper::PROFILE_SAFE)
+        == mmDBWrapper::PROFILE_PERFORMANCE ? 1 : 0);
+    mmToolTip(m_db_profile, _("Safe: the database file can be copied or synchronized at any time.\n"
+        "Performance: faster saves and reports, changes are kept in a log file next to the database until it is closed.\n"
+        "Applied when a database is opened."));
+    wxFlexGridSizer* flex_sizer4 = new wxFlexGridSizer(0, 2, 0, 0);
+    flex_sizer4->Add(new wxStaticText(misc_panel, wxID_STATIC, _("Database profile")), g_flagsH);
+    flex_sizer4->Add(m_db_profile, g_flagsBorder1H);
+    databaseStaticBoxSizer->Add(flex_sizer4);
+
+    m_lazy_startup = new wxCheckBox(misc_panel, wxID_ANY
+        , _("Show the database before all its data is loaded"), wxDefaultPosition, wxDefaultSize, wxCHK_2STATE);
+    m_lazy_startup->SetValue(Model_Setting::instance().getBool("LAZY_STARTUP", true));
+    mmToolTip(m_lazy_startup, _("Currency and stock price histories, attachments and other data not needed by the dashboard
+"
+        "are loaded in the background once the database is shown.
+"
+        "Applied when a database is opened."));
+    databaseStaticBoxSizer->Add(m_lazy_startup, g_flagsV);
+
     //CSV Import
     const wxString delimiter = Model_Infotable::instance().getString("DELIMITER", mmex::DEFDELIMTER);
 
@@ -300,8 +331,14 @@ bool OptionSettingsMisc::SaveSettings()
     wxCheckBox* itemCheckBoxUpdate = static_cast<wxCheckBox*>(FindWindow(ID_DIALOG_OPTIONS_CHK_BACKUP_UPDATE));
     Model_Setting::instance().setBool("BACKUPDB_UPDATE", itemCheckBoxUpdate->GetValue());
 
+    wxCheckBox* itemCheckBoxStore = static_cast<wxCheckBox*>(FindWindow(ID_DIALOG_OPTIONS_CHK_BACKUP_STORE));
+    Model_Setting::instance().setBool("BACKUPDB_STORE", itemCheckBoxStore->GetValue());
+
     Model_Setting::instance().setInt("MAX_BACKUP_FILES", m_max_files->GetValue());
     Model_Setting::instance().setInt("DELETED_TRANS_RETAIN_DAYS", m_deleted_trans_retain_days->GetValue());
+    Model_Setting::instance().setInt("DB_PROFILE", m_db_profile->GetSelection() == 1
+        ? mmDBWrapper::PROFILE_PERFORMANCE : mmDBWrapper::PROFILE_SAFE);
+    Model_Setting::instance().setBool("LAZY_STARTUP", m_lazy_startup->IsChecked());
     Model_Setting::instance().setBool("REFRESH_STOCK_QUOTES_ON_OPEN", m_refresh_quotes_on_open->IsChecked());
 
     wxTextCtrl* st = static_cast<wxTextCtrl*>(FindWindow(ID_DIALOG_OPTIONS_TEXTCTRL_DELIMITER4));
@@ -48,6 +48,8 @@ private:
 
 private:
     wxSpinCtrl* m_max_files = nullptr;
+    wxChoice* m_db_profile = nullptr;
+    wxCheckBox* m_lazy_startup = nullptr;
     wxSpinCtrl* m_deleted_trans_retain_days = nullptr;
     wxSpinCtrl* m_share_precision = nullptr;
     wxCheckBox* m_refresh_quotes_on_open = nullptr;
@@ -58,6 +60,7 @@ private:
         ID_DIALOG_OPTIONS_TEXTCTRL_DELIMITER4 = wxID_HIGHEST + 10,
         ID_DIALOG_OPTIONS_CHK_BACKUP,
         ID_DIALOG_OPTIONS_CHK_BACKUP_UPDATE,
+        ID_DIALOG_OPTIONS_CHK_BACKUP_STORE,
         ID_DIALOG_OPTIONS_TEXTCTRL_STOCKURL,
         ID_DIALOG_OPTIONS_ASSET_COMPOUNDING,
         ID_DIALOG_OPTIONS_BULK_ENTER,
@@ -153,9 +153,17 @@ void OptionSettingsNet::Create()
     m_network_timeout->SetValue(nTimeout);
     mmToolTip(m_network_timeout, _("Specify a network communication timeout value to use."));
 
+    int nConnections = Model_Setting::instance().getInt("NETWORKCONNECTIONS", 6);
+    m_network_connections = new wxSpinCtrl(network_panel, wxID_ANY,
+        wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, 32, nConnections);
+    m_network_connections->SetValue(nConnections);
+    mmToolTip(m_network_connections, _("Specify how many downloads, such as currency rates, may run at the same time."));
+
     wxFlexGridSizer* flex_sizer5 = new wxFlexGridSizer(0, 2, 0, 0);
     flex_sizer5->Add(new wxStaticText(network_panel, wxID_STATIC, _("Seconds")), g_flagsH);
     flex_sizer5->Add(m_network_timeout, g_flagsH);
+    flex_sizer5->Add(new wxStaticText(network_panel, wxID_STATIC, _("Parallel downloads")), g_flagsH);
+    flex_sizer5->Add(m_network_connections, g_flagsH);
 
     timeoutStaticBoxSizer->Add(flex_sizer5, g_flagsV);
 
@@ -218,6 +226,7 @@ bool OptionSettingsNet::SaveSettings()
     Option::instance().setCheckNews(m_check_news->GetValue());
 
     Model_Setting::instance().setInt("NETWORKTIMEOUT", m_network_timeout->GetValue());
+    Model_Setting::instance().setInt("NETWORKCONNECTIONS", m_network_connections->GetValue());
 
     Model_Setting::instance().setBool("UPDATECHECK", m_check_update->GetValue());
     Model_Setting::instance().setInt("UPDATESOURCE", m_update_source->GetSelection());
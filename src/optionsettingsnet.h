@@ -50,6 +50,7 @@ private:
 
 private:
     wxSpinCtrl* m_network_timeout = nullptr;
+    wxSpinCtrl* m_network_connections = nullptr;
     wxCheckBox* m_send_data = nullptr;
     wxCheckBox* m_webserver_checkbox = nullptr;
     wxSpinCtrl* m_webserver_port = nullptr;
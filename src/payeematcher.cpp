@@ -0,0 +1,258 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#include "payeematcher.h"
+#include <algorithm>
+#include <cctype>
+#include <deque>
+
+void mmPayeeMatcher::clear()
+{
+    m_rules.clear();
+    m_nodes.clear();
+    m_unfiltered.clear();
+}
+
+void mmPayeeMatcher::load()
+{
+    clear();
+
+    // only look at payees that have a match pattern set
+    Model_Payee::Data_Set payees = Model_Payee::instance().find(Model_Payee::PATTERN(wxEmptyString, NOT_EQUAL));
+    std::stable_sort(payees.begin(), payees.end()
+        , [](const Model_Payee::Data& x, const Model_Payee::Data& y) { return x.PAYEEID < y.PAYEEID; });
+
+    for (const auto& payee : payees)
+    {
+        Document json_doc;
+        if (json_doc.Parse(payee.PATTERN.utf8_str()).HasParseError() || !json_doc.IsObject())
+            continue;
+
+        // the members are kept in the order they were entered
+        for (const auto& member : json_doc.GetObject())
+        {
+            if (member.value.IsString())
+                addRule(payee.PAYEEID, payee.PAYEENAME, wxString::FromUTF8(member.value.GetString()));
+        }
+    }
+    build();
+}
+
+void mmPayeeMatcher::addRule(int64 payee_id, const wxString& payee_name, const wxString& pattern)
+{
+    Rule rule;
+    rule.payee_id = payee_id;
+    rule.payee_name = payee_name;
+    rule.pattern = pattern;
+
+    std::string literal;
+    if (pattern.StartsWith("regex:"))
+    {
+        const wxString expr = pattern.Mid(6);
+        rule.regex.reset(new wxRegEx(expr, wxRE_ICASE | wxRE_EXTENDED));
+        if (!rule.regex->IsValid())
+            return;
+        literal = regexLiteral(expr);
+    }
+    else
+    {
+        rule.wildcard = pattern.Lower();
+        literal = wildcardLiteral(rule.wildcard);
+    }
+
+    m_rules.push_back(std::move(rule));
+    if (literal.empty())
+        m_unfiltered.push_back(m_rules.size() - 1);
+    else
+        addLiteral(literal, m_rules.size() - 1);
+}
+
+// The longest run of characters every match must contain
+std::string mmPayeeMatcher::wildcardLiteral(const wxString& lower_pattern)
+{
+    wxString best, run;
+    for (const auto& c : lower_pattern)
+    {
+        if (c == '*' || c == '?')
+        {
+            if (run.length() > best.length()) best = run;
+            run.clear();
+        }
+        else
+            run += c;
+    }
+    if (run.length() > best.length()) best = run;
+    return std::string(best.utf8_str());
+}
+
+// The longest run of plain ASCII letters, digits and spaces outside of any
+// group, class or repetition. Expressions with alternatives have none.
+std::string mmPayeeMatcher::regexLiteral(const wxString& regex)
+{
+    if (regex.Contains("|"))
+        return "";
+
+    std::string best, run;
+    int depth = 0;
+    bool in_class = false;
+    size_t class_start = 0;
+    auto endRun = [&](bool drop_last)
+    {
+        if (drop_last && !run.empty())
+            run.erase(run.size() - 1);
+        if (run.size() > best.size())
+            best = run;
+        run.clear();
+    };
+
+    for (size_t i = 0; i < regex.length(); i++)
+    {
+        const wxUniChar c = regex[i];
+        if (in_class)
+        {
+            // a ']' right after the opening '[' or '[^' is part of the class
+            if (c == ']' && i > class_start && !(i == class_start + 1 && regex[class_start] == '^'))
+                in_class = false;
+            continue;
+        }
+
+        const bool plain = c.IsAscii() && (isalnum(static_cast<int>(c.GetValue())) || c == ' ');
+        if (plain && depth == 0)
+        {
+            run += static_cast<char>(tolower(static_cast<int>(c.GetValue())));
+            continue;
+        }
+
+        // the character before a '?', '*' or '{' is optional
+        endRun(c == '?' || c == '*' || c == '{');
+        if (c == '\\')
+            i++;
+        else if (c == '[')
+        {
+            in_class = true;
+            class_start = i + 1;
+        }
+        else if (c == '(')
+            depth++;
+        else if (c == ')' && depth > 0)
+            depth--;
+    }
+    endRun(false);
+    return best;
+}
+
+void mmPayeeMatcher::addLiteral(const std::string& literal, size_t rule)
+{
+    if (m_nodes.empty())
+        m_nodes.push_back(Node());
+
+    int node = 0;
+    for (const char ch : literal)
+    {
+        const unsigned char c = static_cast<unsigned char>(ch);
+        auto& next = m_nodes[node].next;
+        auto it = std::lower_bound(next.begin(), next.end(), std::make_pair(c, 0));
+        if (it != next.end() && it->first == c)
+        {
+            node = it->second;
+            continue;
+        }
+        const int child = static_cast<int>(m_nodes.size());
+        next.insert(it, std::make_pair(c, child));
+        m_nodes.push_back(Node());
+        node = child;
+    }
+    m_nodes[node].rules.push_back(rule);
+}
+
+int mmPayeeMatcher::step(int node, unsigned char c) const
+{
+    for (;;)
+    {
+        const auto& next = m_nodes[node].next;
+        const auto it = std::lower_bound(next.begin(), next.end(), std::make_pair(c, 0));
+        if (it != next.end() && it->first == c)
+            return it->second;
+        if (node == 0)
+            return 0;
+        node = m_nodes[node].fail;
+    }
+}
+
+void mmPayeeMatcher::build()
+{
+    if (m_nodes.empty())
+        return;
+
+    // breadth first, so the fail node of a node is always done before it
+    std::deque<int> queue;
+    for (const auto& edge : m_nodes[0].next)
+        queue.push_back(edge.second);
+
+    while (!queue.empty())
+    {
+        const int node = queue.front();
+        queue.pop_front();
+        for (const auto& edge : m_nodes[node].next)
+        {
+            const int child = edge.second;
+            const int fail = step(m_nodes[node].fail, edge.first);
+            m_nodes[child].fail = fail;
+            m_nodes[child].output_link = m_nodes[fail].rules.empty() ? m_nodes[fail].output_link : fail;
+            queue.push_back(child);
+        }
+    }
+}
+
+bool mmPayeeMatcher::matches(const Rule& rule, const wxString& name, const wxString& lower_name) const
+{
+    if (rule.regex)
+        return rule.regex->Matches(name);
+    return lower_name.Matches(rule.wildcard);
+}
+
+const mmPayeeMatcher::Rule* mmPayeeMatcher::match(const wxString& name) const
+{
+    if (m_rules.empty())
+        return nullptr;
+
+    const wxString lower_name = name.Lower();
+    std::vector<size_t> candidates(m_unfiltered);
+    if (!m_nodes.empty())
+    {
+        const std::string text(lower_name.utf8_str());
+        int node = 0;
+        for (const char ch : text)
+        {
+            node = step(node, static_cast<unsigned char>(ch));
+            for (int out = m_nodes[node].rules.empty() ? m_nodes[node].output_link : node
+                ; out >= 0; out = m_nodes[out].output_link)
+            {
+                candidates.insert(candidates.end(), m_nodes[out].rules.begin(), m_nodes[out].rules.end());
+            }
+        }
+    }
+
+    // the rules are in priority order
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    for (const auto i : candidates)
+    {
+        if (matches(m_rules[i], name, lower_name))
+            return &m_rules[i];
+    }
+    return nullptr;
+}
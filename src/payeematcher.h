@@ -0,0 +1,82 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#ifndef MM_EX_PAYEEMATCHER_H_
+#define MM_EX_PAYEEMATCHER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <wx/regex.h>
+#include "model/Model_Payee.h"
+
+/**
+* Matches names against the match patterns of all the payees at once.
+*
+* A pattern is either a wildcard ('*', '?') compared case insensitively with
+* the whole name, or a case insensitive regular expression when it starts
+* with "regex:". The rules are ordered by payee id, then by their position
+* in the payee's pattern list; the first matching rule wins.
+*
+* The literal text a rule requires is fed to an Aho-Corasick automaton, so one
+* pass over a name finds the few rules that can match it. Only those, and the
+* rules without any required text, are then checked.
+*/
+class mmPayeeMatcher
+{
+public:
+    struct Rule
+    {
+        int64 payee_id;
+        wxString payee_name;
+        wxString pattern;       // as entered, including the "regex:" prefix
+        wxString wildcard;      // lower case wildcard pattern, empty for a regex
+        std::unique_ptr<wxRegEx> regex;
+    };
+
+    /** Compile the patterns of all the payees */
+    void load();
+    void clear();
+    bool empty() const { return m_rules.empty(); }
+
+    /** The rule with the highest priority matching the name, nullptr when none does */
+    const Rule* match(const wxString& name) const;
+
+private:
+    void addRule(int64 payee_id, const wxString& payee_name, const wxString& pattern);
+    void addLiteral(const std::string& literal, size_t rule);
+    void build();
+    bool matches(const Rule& rule, const wxString& name, const wxString& lower_name) const;
+
+    static std::string wildcardLiteral(const wxString& lower_pattern);
+    static std::string regexLiteral(const wxString& regex);
+
+    // Aho-Corasick automaton over the UTF-8 bytes of the lower case literals
+    struct Node
+    {
+        std::vector<std::pair<unsigned char, int>> next; // sorted by byte
+        int fail = 0;
+        int output_link = -1;       // nearest node on the fail chain with rules
+        std::vector<size_t> rules;  // rules whose literal ends here
+    };
+    int step(int node, unsigned char c) const;
+
+    std::vector<Rule> m_rules;
+    std::vector<Node> m_nodes;
+    std::vector<size_t> m_unfiltered; // rules without a required literal
+};
+
+#endif // MM_EX_PAYEEMATCHER_H_
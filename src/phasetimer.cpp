@@ -0,0 +1,75 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#include "phasetimer.h"
+#include <cstring>
+
+namespace
+{
+    double milliseconds(std::chrono::steady_clock::duration d)
+    {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+}
+
+mmPhaseTimer::mmPhaseTimer(const wxString& title)
+    : m_title(title)
+    , m_current(0)
+    , m_begin(clock::now())
+{
+}
+
+void mmPhaseTimer::start(const char* phase)
+{
+    stop();
+
+    // a handful of phases, a linear search is the fastest
+    m_current = 0;
+    while (m_current < m_phases.size() && strcmp(m_phases[m_current].first, phase) != 0)
+        m_current++;
+    if (m_current == m_phases.size())
+        m_phases.push_back(std::make_pair(phase, clock::duration::zero()));
+    m_since = clock::now();
+}
+
+void mmPhaseTimer::stop()
+{
+    if (m_current >= m_phases.size())
+        return;
+    m_phases[m_current].second += clock::now() - m_since;
+    m_current = m_phases.size();
+}
+
+wxString mmPhaseTimer::summary()
+{
+    stop();
+    const double total = milliseconds(clock::now() - m_begin);
+    // without rows, e.g. the startup, only the times are of interest
+    wxString s = m_rows > 0
+        ? wxString::Format("%s: %zu rows in %.0f ms", m_title, m_rows, total)
+        : wxString::Format("%s: %.0f ms", m_title, total);
+    if (m_rows > 0 && total > 0)
+        s << wxString::Format(", %.0f rows/s", m_rows * 1000.0 / total);
+
+    for (size_t i = 0; i < m_phases.size(); i++)
+    {
+        s << (i == 0 ? " (" : ", ")
+            << wxString::Format("%s %.0f ms", m_phases[i].first, milliseconds(m_phases[i].second));
+    }
+    if (!m_phases.empty())
+        s << ")";
+    return s;
+}
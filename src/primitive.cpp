@@ -133,6 +133,38 @@ bool mmParseISODate(const wxString& in, wxDateTime& out)
     return true;
 }
 
+int mmDayNumber(const wxString& iso_date)
+{
+    long y = 0, m = 0, d = 0;
+    if (iso_date.length() < 10
+        || !iso_date.Mid(0, 4).ToLong(&y)
+        || !iso_date.Mid(5, 2).ToLong(&m)
+        || !iso_date.Mid(8, 2).ToLong(&d))
+        return 0;
+
+    // civil calendar to days, in eras of 400 years starting on March 1
+    if (m <= 2) y--;
+    const long era = (y >= 0 ? y : y - 399) / 400;
+    const long yoe = y - era * 400;
+    const long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return static_cast<int>(era * 146097 + doe - 719468);
+}
+
+const wxString mmDayNumberISODate(long days)
+{
+    const long z = days + 719468;
+    const long era = (z >= 0 ? z : z - 146096) / 146097;
+    const long doe = z - era * 146097;
+    const long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const long mp = (5 * doy + 2) / 153;
+    const long d = doy - (153 * mp + 2) / 5 + 1;
+    const long m = mp + (mp < 10 ? 3 : -9);
+    const long y = yoe + era * 400 + (m <= 2 ? 1 : 0);
+    return wxString::Format("%04ld-%02ld-%02ld", y, m, d);
+}
+
 //----------------------------------------------------------------------------
 
 const wxColor* bestFontColour(const wxColour& background)
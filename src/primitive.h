@@ -94,6 +94,11 @@ inline wxString dateTimeISO(wxDateTime dateTime)
 
 bool mmParseISODate(const wxString& in_str, wxDateTime& out_date);
 
+// Days since 1970-01-01 of the "YYYY-MM-DD" date in the beginning of the string, 0 if it has none
+int mmDayNumber(const wxString& iso_date);
+// The "YYYY-MM-DD" date of a day number
+const wxString mmDayNumberISODate(long days);
+
 //----------------------------------------------------------------------------
 
 const wxColor* bestFontColour(const wxColour& background);
@@ -112,6 +112,12 @@ wxString mmReportBudgetCategorySummary::getHTMLText()
         , static_cast<wxSharedPtr<wxArrayString>>(nullptr)
         , &date_range, Option::instance().getIgnoreFutureTransactions()
         , false, (evaluateTransfer ? &budgetAmt : nullptr));
+    // The same cube with the subcategories added to their parents
+    std::map<int64, std::map<int, double> > categoryTotals;
+    Model_Category::instance().getCategoryStats(categoryTotals
+        , static_cast<wxSharedPtr<wxArrayString>>(nullptr)
+        , &date_range, Option::instance().getIgnoreFutureTransactions()
+        , false, (evaluateTransfer ? &budgetAmt : nullptr), false, true);
 
     std::map<int64, std::map<int, double> > budgetStats;
     Model_Budget::instance().getBudgetStats(budgetStats, &date_range, monthlyBudget);
@@ -197,7 +203,7 @@ wxString mmReportBudgetCategorySummary::getHTMLText()
             hb.endThead();
             hb.startTbody();
             {
-                std::map<int64, double> catTotalsEstimated, catTotalsActual;
+                std::map<int64, double> catTotalsEstimated;
                 std::map<int64, std::pair<int, wxString>> categLevel;
                 for (const auto& category : categs)
                 {
@@ -215,7 +221,6 @@ wxString mmReportBudgetCategorySummary::getHTMLText()
                     else
                         actIncome += actual;
 
-                    catTotalsActual[category.CATEGID] += actual;
                     catTotalsEstimated[category.CATEGID] += estimated;
 
                     if (amply)
@@ -250,11 +255,9 @@ wxString mmReportBudgetCategorySummary::getHTMLText()
 
                         //save totals for this subcategory
                         catTotalsEstimated[subcats[i].CATEGID] = estimated;
-                        catTotalsActual[subcats[i].CATEGID] = actual;
 
                         //update totals of the category
                         catTotalsEstimated[category.CATEGID] += estimated;
-                        catTotalsActual[category.CATEGID] += actual;
 
                         //walk up the hierarchy and update all the parent totals as well
                         int64 nextParent = subcats[i].PARENTID;
@@ -262,7 +265,6 @@ wxString mmReportBudgetCategorySummary::getHTMLText()
                             if (subcats[j - 1].CATEGID == nextParent) {
                                 categLevel[subcats[i].CATEGID].first++;
                                 catTotalsEstimated[subcats[j - 1].CATEGID] += estimated;
-                                catTotalsActual[subcats[j - 1].CATEGID] += actual;
                                 nextParent = subcats[j - 1].PARENTID;
                                 if (nextParent == category.CATEGID)
                                     break;
@@ -294,7 +296,7 @@ wxString mmReportBudgetCategorySummary::getHTMLText()
                                                 , subcats[index].CATEGID
                                                 , subcats[index].CATEGNAME));
                                             hb.addMoneyCell(catTotalsEstimated[subcats[index].CATEGID]);
-                                            hb.addMoneyCell(catTotalsActual[subcats[index].CATEGID]);
+                                            hb.addMoneyCell(categoryTotals[subcats[index].CATEGID][0]);
                                         }
                                         hb.endTableRow();
                                         totals_stack.pop_back();
@@ -311,7 +313,7 @@ wxString mmReportBudgetCategorySummary::getHTMLText()
                                             , subcats[index].CATEGID
                                             , subcats[index].CATEGNAME));
                                         hb.addMoneyCell(catTotalsEstimated[subcats[index].CATEGID]);
-                                        hb.addMoneyCell(catTotalsActual[subcats[index].CATEGID]);
+                                        hb.addMoneyCell(categoryTotals[subcats[index].CATEGID][0]);
                                     }
                                     hb.endTableRow();
                                     totals_stack.pop_back();
@@ -325,7 +327,7 @@ wxString mmReportBudgetCategorySummary::getHTMLText()
                             , category.CATEGID)
                             , category.CATEGNAME);
                         hb.addMoneyCell(catTotalsEstimated[category.CATEGID]);
-                        hb.addMoneyCell(catTotalsActual[category.CATEGID]);
+                        hb.addMoneyCell(categoryTotals[category.CATEGID][0]);
                     }
                     hb.endTableRow();
                 }
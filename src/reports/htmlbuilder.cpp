@@ -23,11 +23,15 @@
 #include "util.h"
 #include "option.h"
 #include "constants.h"
+#include "paths.h"
 #include "model/Model_Currency.h"
 #include "model/Model_Infotable.h"
 #include <iomanip>
 #include <ios>
 #include <float.h>
+#include <cstring>
+#include <wx/ffile.h>
+#include <wx/fs_mem.h>
 
 
 namespace tags
@@ -35,7 +39,7 @@ namespace tags
     static const char END_SIMPLE[] = R"(</body>)";
     static const char HTML_SIMPLE[] = R"(<body %s %s>)";
 
-    static const wxString END = R"(
+    static const char END[] = R"(
 </body>
 <script>
     $(".toggle").click(function() {
@@ -83,7 +87,7 @@ namespace tags
 </script>
 </html>
 )";
-    static const wxString HTML = R"(<!DOCTYPE html>
+    static const char HTML[] = R"(<!DOCTYPE html>
 <html><head>
 <meta http-equiv="Content-Type" content="text/html; charset=UTF-8">
 <title>%s - Report</title>
@@ -107,48 +111,150 @@ namespace tags
 </head>
 <body>
 )";
-    static const wxString DIV_CONTAINER = "<div class='%s'>\n";
-    static const wxString DIV_ROW = "<div class='row'>\n";
-    static const wxString DIV_COL8 = "<div class='col-xs-2'></div>\n<div class='col-xs-8'>\n"; //17_67%
-    static const wxString DIV_COL4 = "<div class='col-xs-4'></div>\n<div class='col-xs-4'>\n"; //33_33%
-    static const wxString DIV_COL3 = "<div class='col-xs-3'></div>\n<div class='col-xs-6'>\n"; //25_50%
-    static const wxString DIV_COL1 = "<div class='col-xs-1'></div>\n<div class='col-xs-10'>\n"; //8%
-    static const wxString DIV_END = "</div>\n";
-    static const wxString TABLE_START = "<table class='table table-bordered report-table'>\n";
-    static const wxString SORTTABLE_START = "<table class='sortable table report-table'>\n";
-    static const wxString TABLE_END = "</table>\n";
-    static const wxString THEAD_START = "<thead>\n";
-    static const wxString THEAD_END = "</thead>\n";
-    static const wxString TBODY_START = "<tbody>\n";
-    static const wxString TBODY_END = "</tbody>\n";
-    static const wxString TFOOT_START = "<tfoot>\n";
-    static const wxString TFOOT_END = "</tfoot>\n";
-    static const wxString TABLE_ROW = "<tr>\n";
-    static const wxString TABLE_ROW_EXTRA = "<tr %s>\n";
-    static const wxString TOTAL_TABLE_ROW = "<tr class='success'>\n";
-    static const wxString TABLE_ROW_END = "</tr>\n";
-    static const wxString TABLE_CELL = "<td%s>";
-    static const wxString MONEY_CELL = "<td class='money'>";
-    static const wxString TABLE_CELL_END = "</td>\n";
-    static const wxString TABLE_CELL_LINK = R"(<a href="%s" target="_blank">%s</a>)";
-    static const wxString TABLE_CELL_LINK_COLOR = R"(<a style="color: %s;" href="%s" target="_blank">%s</a>)";
-    static const wxString TABLE_HEADER = "<th%s>";
-    static const wxString HEADER = "<h%i>%s</h%i>";
-    static const wxString TABLE_HEADER_END = "</th>\n";
-    static const wxString LINK = "<a href=\"%s\">%s</a>\n";
-    static const wxString HOR_LINE = "<hr size=\"%i\">\n";
-    static const wxString IMAGE = "<img src=\"%s\" border=\"0\">\n";
-    static const wxString BR = "<br>\n";
-    static const wxString NBSP = "&nbsp;";
-    static const wxString CENTER = "<center>\n";
-    static const wxString CENTER_END = "</center>\n";
-    static const wxString TABLE_CELL_SPAN = "<td colspan=\"%i\" >";
-    static const wxString TABLE_CELL_RIGHT = "<td style='text-align: right'>";
-    static const wxString SPAN = "<span %s>%s";
-    static const wxString SPAN_END = "</span>\n";
+    static const char DIV_CONTAINER[] = "<div class='%s'>\n";
+    static const char DIV_ROW[] = "<div class='row'>\n";
+    static const char DIV_COL8[] = "<div class='col-xs-2'></div>\n<div class='col-xs-8'>\n"; //17_67%
+    static const char DIV_COL4[] = "<div class='col-xs-4'></div>\n<div class='col-xs-4'>\n"; //33_33%
+    static const char DIV_COL3[] = "<div class='col-xs-3'></div>\n<div class='col-xs-6'>\n"; //25_50%
+    static const char DIV_COL1[] = "<div class='col-xs-1'></div>\n<div class='col-xs-10'>\n"; //8%
+    static const char DIV_END[] = "</div>\n";
+    static const char TABLE_START[] = "<table class='table table-bordered report-table'>\n";
+    static const char SORTTABLE_START[] = "<table class='sortable table report-table'>\n";
+    static const char TABLE_END[] = "</table>\n";
+    static const char THEAD_START[] = "<thead>\n";
+    static const char THEAD_END[] = "</thead>\n";
+    static const char TBODY_START[] = "<tbody>\n";
+    static const char TBODY_END[] = "</tbody>\n";
+    static const char TFOOT_START[] = "<tfoot>\n";
+    static const char TFOOT_END[] = "</tfoot>\n";
+    static const char TABLE_ROW[] = "<tr>\n";
+    static const char TABLE_ROW_EXTRA[] = "<tr %s>\n";
+    static const char TOTAL_TABLE_ROW[] = "<tr class='success'>\n";
+    static const char TABLE_ROW_END[] = "</tr>\n";
+    static const char TABLE_CELL[] = "<td%s>";
+    static const char MONEY_CELL[] = "<td class='money'>";
+    static const char TABLE_CELL_END[] = "</td>\n";
+    static const char TABLE_CELL_LINK[] = R"(<a href="%s" target="_blank">%s</a>)";
+    static const char TABLE_CELL_LINK_COLOR[] = R"(<a style="color: %s;" href="%s" target="_blank">%s</a>)";
+    static const char TABLE_HEADER[] = "<th%s>";
+    static const char HEADER[] = "<h%i>%s</h%i>";
+    static const char TABLE_HEADER_END[] = "</th>\n";
+    static const char LINK[] = "<a href=\"%s\">%s</a>\n";
+    static const char HOR_LINE[] = "<hr size=\"%i\">\n";
+    static const char IMAGE[] = "<img src=\"%s\" border=\"0\">\n";
+    static const char BR[] = "<br>\n";
+    static const char NBSP[] = "&nbsp;";
+    static const char CENTER[] = "<center>\n";
+    static const char CENTER_END[] = "</center>\n";
+    static const char TABLE_CELL_SPAN[] = "<td colspan=\"%i\" >";
+    static const char TABLE_CELL_RIGHT[] = "<td style='text-align: right'>";
+    static const char SPAN[] = "<span %s>%s";
+    static const char SPAN_END[] = "</span>\n";
+    static const char VIRTUAL_TBODY[] = "<tbody id='%s'></tbody>\n";
+    // Loads the row files of a virtual tbody one after the other, each of them
+    // calls mmAddRows(), so the page is shown before all the rows are in the DOM.
+    // Money cells of the new rows get the same styling as END applies to the
+    // static ones.
+    static const char VIRTUAL_RENDERER[] = R"(<script>
+    var mmVirtualRows = {};
+    function mmLoadRows(id) {
+        var script = document.createElement('script');
+        script.src = 'memory:' + id + '_' + mmVirtualRows[id].loaded + '.js';
+        document.body.appendChild(script);
+    }
+    function mmRenderRows(id, chunks) {
+        mmVirtualRows[id] = { loaded: 0, chunks: chunks };
+        if (chunks > 0)
+            mmLoadRows(id);
+    }
+    function mmAddRows(id, rows) {
+        var tbody = document.getElementById(id);
+        var first = tbody.rows.length;
+        tbody.insertAdjacentHTML('beforeend', rows.join(''));
+        for (var r = first; r < tbody.rows.length; r++) {
+            var cells = tbody.rows[r].getElementsByClassName('money');
+            for (var i = 0; i < cells.length; i++) {
+                cells[i].style.textAlign = 'right';
+                if (cells[i].innerHTML.indexOf('-') > -1)
+                    cells[i].style.color = '#ff0000';
+            }
+        }
+        if (++mmVirtualRows[id].loaded < mmVirtualRows[id].chunks)
+            mmLoadRows(id);
+    }
+</script>
+)";
+}
+
+namespace
+{
+    // Row files of the virtual tbodies not yet taken by the page showing them
+    std::vector<wxString> g_rows_files;
+    size_t g_rows_serial = 0;
+
+    // Stored next to the page of getVFname4print(): a memory file on Windows and
+    // macOS, a file of the temporary folder elsewhere
+    void write_rows_file(const wxString& name, const std::string& data)
+    {
+#if defined(__WXMSW__) || defined(__WXMAC__)
+        wxMemoryFSHandler::AddFile(name, data.data(), data.size());
+#else
+        wxFFile file(mmex::getTempFolder() + name, "wb");
+        if (file.IsOpened())
+            file.Write(data.data(), data.size());
+#endif
+        g_rows_files.push_back(name);
+    }
+
+
+    // Append the UTF-8 text as a JSON string, safe to be placed in a <script> element
+    void json_escape(std::string& out, const std::string& text)
+    {
+        static const char hex[] = "0123456789abcdef";
+        out += '"';
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            const unsigned char c = static_cast<unsigned char>(text[i]);
+            switch (c)
+            {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '/':
+                // "</script>" must not appear inside of the script
+                if (i > 0 && text[i - 1] == '<') out += '\\';
+                out += '/';
+                break;
+            default:
+                if (c < 0x20)
+                {
+                    out += "\\u00";
+                    out += hex[c >> 4];
+                    out += hex[c & 0xF];
+                }
+                // U+2028 and U+2029 are line terminators for older javascript engines
+                else if (c == 0xE2 && i + 2 < text.size()
+                    && static_cast<unsigned char>(text[i + 1]) == 0x80
+                    && (static_cast<unsigned char>(text[i + 2]) & 0xFE) == 0xA8)
+                {
+                    out += (static_cast<unsigned char>(text[i + 2]) == 0xA8) ? "\\u2028" : "\\u2029";
+                    i += 2;
+                }
+                else
+                    out += static_cast<char>(c);
+            }
+        }
+        out += '"';
+    }
 }
 
 mmHTMLBuilder::mmHTMLBuilder()
+    : virtual_chunk_(0)
+    , virtual_rows_(0)
+    , virtual_chunks_(0)
+    , virtual_count_(0)
 {
     today_.date = wxDateTime::Now();
     today_.todays_date = wxString::Format(_("Report Generated %1$s %2$s")
@@ -162,15 +268,17 @@ void mmHTMLBuilder::init(bool simple, const wxString& extra_style)
     {
         wxString bg = mmThemeMetaString(meta::COLOR_HTMLPANEL_BACK);
         wxString fg = mmThemeMetaString(meta::COLOR_HTMLPANEL_FORE);
-        html_ += wxString::Format(tags::HTML_SIMPLE
+        append(wxString::Format(tags::HTML_SIMPLE
                     , bg.IsEmpty() ? "" : wxString::Format("bgcolor='%s';", bg)
-                    , fg.IsEmpty() ? "" : wxString::Format("text='%s';", fg));
+                    , fg.IsEmpty() ? "" : wxString::Format("text='%s';", fg)));
     } else
     {
-        html_ = wxString::Format(tags::HTML
+        clear();
+        html_.reserve(INITIAL_CAPACITY);
+        append(wxString::Format(tags::HTML
             , mmex::getProgramName()
             , wxString::Format("%d", Option::instance().getHtmlScale())
-            , extra_style);
+            , extra_style));
     }
 }
 
@@ -223,17 +331,17 @@ void mmHTMLBuilder::DisplayDateHeading(const wxDateTime& startDate, const wxDate
         wxASSERT(false);
 
     wxString t = wxString::Format(tags::HEADER, 4, sDate, 4);
-    this->html_.Replace("<TMPL_VAR DATE_HEADING>", t);
+    replace("<TMPL_VAR DATE_HEADING>", t);
 }
 
 void mmHTMLBuilder::DisplayFooter(const wxString& footer)
 {
-    this->html_.Replace("<TMPL_VAR FOOTER>", footer);
+    replace("<TMPL_VAR FOOTER>", footer);
 }
 
 void mmHTMLBuilder::addHeader(int level, const wxString& header)
 {
-    html_ += wxString::Format(tags::HEADER, level, header, level);
+    append(wxString::Format(tags::HEADER, level, header, level));
 }
 
 void mmHTMLBuilder::addReportCurrency()
@@ -265,29 +373,59 @@ void mmHTMLBuilder::addDateNow()
 
 void mmHTMLBuilder::startTable()
 {
-    html_ += tags::TABLE_START;
+    append(tags::TABLE_START);
 }
 void mmHTMLBuilder::startSortTable()
 {
-    html_ += tags::SORTTABLE_START;
+    append(tags::SORTTABLE_START);
 }
 void mmHTMLBuilder::startThead()
 {
-    html_ += tags::THEAD_START;
+    append(tags::THEAD_START);
 }
 void mmHTMLBuilder::startTbody()
 {
-    html_ += tags::TBODY_START;
+    append(tags::TBODY_START);
+}
+void mmHTMLBuilder::startVirtualTbody(size_t chunk)
+{
+    if (virtual_chunk_ > 0)
+        endTbody();
+    virtual_chunk_ = chunk > 0 ? chunk : 1;
+    virtual_rows_ = 0;
+    virtual_chunks_ = 0;
+    virtual_id_ = "vtbody" + std::to_string(++g_rows_serial);
+    row_.clear();
+    rows_json_.clear();
+}
+std::vector<wxString> mmHTMLBuilder::takeRowsFiles()
+{
+    std::vector<wxString> files;
+    files.swap(g_rows_files);
+    return files;
 }
+
+void mmHTMLBuilder::removeRowsFiles(const std::vector<wxString>& files)
+{
+    for (const auto& name : files)
+    {
+#if defined(__WXMSW__) || defined(__WXMAC__)
+        wxMemoryFSHandler::RemoveFile(name);
+#else
+        wxRemoveFile(mmex::getTempFolder() + name);
+#endif
+    }
+}
+
 void mmHTMLBuilder::startTfoot()
 {
-    html_ += tags::TFOOT_START;
+    append(tags::TFOOT_START);
 }
 
 void mmHTMLBuilder::addEmptyTableRow(int cols)
 {
     this->startTotalTableRow();
-    html_ += wxString::Format(tags::TABLE_CELL_SPAN, cols);
+    append(wxString::Format(tags::TABLE_CELL_SPAN, cols));
     this->endTableCell();
     this->endTableRow();
 }
@@ -296,8 +434,8 @@ void mmHTMLBuilder::addTotalRow(const wxString& caption
     , int cols, double value)
 {
     this->startTotalTableRow();
-    html_ += wxString::Format(tags::TABLE_CELL_SPAN, cols - 1);
-    html_ += caption;
+    append(wxString::Format(tags::TABLE_CELL_SPAN, cols - 1));
+    append(caption);
     this->endTableCell();
     this->addMoneyCell(value);
     this->endTableRow();
@@ -307,14 +445,14 @@ void mmHTMLBuilder::addTotalRow(const wxString& caption, int cols
     , const std::vector<wxString>& data)
 {
     this->startTotalTableRow();
-    html_ += wxString::Format(tags::TABLE_CELL_SPAN, cols - static_cast<int>(data.size()));
-    html_ += caption;
+    append(wxString::Format(tags::TABLE_CELL_SPAN, cols - static_cast<int>(data.size())));
+    append(caption);
 
     for (unsigned long idx = 0; idx < data.size(); idx++)
     {
         this->endTableCell();
-        html_ += tags::MONEY_CELL;
-        html_ += data[idx];
+        append(tags::MONEY_CELL);
+        append(data[idx]);
     }
     this->endTableCell();
     this->endTableRow();
@@ -340,13 +478,13 @@ void mmHTMLBuilder::addMoneyTotalRow(const wxString& caption, int cols, const st
 
 void mmHTMLBuilder::addTableHeaderCell(const wxString& value, const wxString& css_class, int cols)
 {
-    html_ += wxString::Format(tags::TABLE_HEADER //TABLE_HEADER = "<th%s>";
+    append(wxString::Format(tags::TABLE_HEADER //TABLE_HEADER = "<th%s>";
         , wxString::Format("%s%s"
             , css_class.empty() ? "" : wxString::Format(" class='%s'", css_class)
             , cols > 1 ? wxString::Format(" colspan='%i'", cols) : "")
-    );
-    html_ += value;
-    html_ += tags::TABLE_HEADER_END;
+    ));
+    append(value);
+    append(tags::TABLE_HEADER_END);
 }
 
 void mmHTMLBuilder::addCurrencyCell(double amount, const Model_Currency::Data* currency, int precision, bool isVoid)
@@ -357,8 +495,8 @@ void mmHTMLBuilder::addCurrencyCell(double amount, const Model_Currency::Data* c
     if (isVoid)
         s = wxString::Format("<s>%s</s>", s);
     const wxString f = wxString::Format(" class='money' sorttable_customkey = '%f' nowrap", amount);
-    html_ += wxString::Format(tags::TABLE_CELL, f);
-    html_ += s;
+    append(wxString::Format(tags::TABLE_CELL, f));
+    append(s);
     this->endTableCell();
 }
 
@@ -368,24 +506,25 @@ void mmHTMLBuilder::addMoneyCell(double amount, int precision)
         precision = Model_Currency::precision(Model_Currency::GetBaseCurrency());
     const wxString s = Model_Currency::toString(amount, Model_Currency::GetBaseCurrency(), precision);
     wxString f = wxString::Format(" class='money' sorttable_customkey = '%f' nowrap", amount);
-    html_ += wxString::Format(tags::TABLE_CELL, f);
-    html_ += (amount == -DBL_MAX) ? "" : s;     // If -DBL_MAX then just display empty string
+    append(wxString::Format(tags::TABLE_CELL, f));
+    if (amount != -DBL_MAX)     // If -DBL_MAX then just display empty string
+        append(s);
     this->endTableCell();
 }
 
 void mmHTMLBuilder::addTableCellDate(const wxString& iso_date)
 {
-    html_ += wxString::Format(tags::TABLE_CELL
-        , wxString::Format(" class='text-left' sorttable_customkey = '%s' nowrap", iso_date));
-    html_ += mmGetDateTimeForDisplay(iso_date);
+    append(wxString::Format(tags::TABLE_CELL
+        , wxString::Format(" class='text-left' sorttable_customkey = '%s' nowrap", iso_date)));
+    append(mmGetDateTimeForDisplay(iso_date));
     this->endTableCell();
 }
 
 void mmHTMLBuilder::addTableCell(const wxString& value, bool numeric, bool center)
 {
     const wxString align = (center ? " class='text-center'" : (numeric ? " class='text-right' nowrap" : " class='text-left'"));
-    html_ += wxString::Format(tags::TABLE_CELL, align);
-    html_ += value;
+    append(wxString::Format(tags::TABLE_CELL, align));
+    append(value);
     this->endTableCell();
 }
 
@@ -398,10 +537,10 @@ void mmHTMLBuilder::addEmptyTableCell(const int number)
 void mmHTMLBuilder::addColorMarker(const wxString& color, bool center)
 {
     const wxString align = center ? " class='text-center'" : " class='text-left'";
-    html_ += wxString::Format(tags::TABLE_CELL, align);
-    html_ += wxString::Format("<span style='font-family: serif; %s'>%s</span>"
+    append(wxString::Format(tags::TABLE_CELL, align));
+    append(wxString::Format("<span style='font-family: serif; %s'>%s</span>"
         , (color.empty() ? "": wxString::Format("color: %s", color))
-        , (color.empty() ? L" " : L"\u2588"));
+        , (color.empty() ? L" " : L"\u2588")));
     this->endTableCell();
 }
 
@@ -441,10 +580,10 @@ void mmHTMLBuilder::addTableCellMonth(int month, int year)
 {
     if (month >= 0 && month < 12) {
         wxString f = wxString::Format(" sorttable_customkey = '%i'", year * 100 + month);
-        html_ += wxString::Format(tags::TABLE_CELL, f);
+        append(wxString::Format(tags::TABLE_CELL, f));
         if (0 != year)
-            html_ += wxString::Format("%d ", year);
-        html_ += wxGetTranslation(wxDateTime::GetEnglishMonthName(static_cast<wxDateTime::Month>(month)));
+            append(wxString::Format("%d ", year));
+        append(wxGetTranslation(wxDateTime::GetEnglishMonthName(static_cast<wxDateTime::Month>(month))));
         this->endTableCell();
     }
     else
@@ -467,60 +606,76 @@ void mmHTMLBuilder::addTableRow(const wxString& label, double data)
 
 void mmHTMLBuilder::end(bool simple)
 {
-    html_ += simple ? tags::END_SIMPLE : tags::END;
+    append(simple ? tags::END_SIMPLE : tags::END);
 }
 void mmHTMLBuilder::addDivContainer(const wxString& style)
 {
-    html_ += wxString::Format(tags::DIV_CONTAINER, style);
+    append(wxString::Format(tags::DIV_CONTAINER, style));
 }
 void mmHTMLBuilder::addDivRow()
 {
-    html_ += tags::DIV_ROW;
+    append(tags::DIV_ROW);
 }
 void mmHTMLBuilder::addDivCol17_67()
 {
-    html_ += tags::DIV_COL8;
+    append(tags::DIV_COL8);
 }
 void mmHTMLBuilder::addDivCol25_50()
 {
-    html_ += tags::DIV_COL3;
+    append(tags::DIV_COL3);
 }
 void mmHTMLBuilder::addDivCol8_84()
 {
-    html_ += tags::DIV_COL1;
+    append(tags::DIV_COL1);
 }
 void mmHTMLBuilder::endDiv()
 {
-    html_ += tags::DIV_END;
+    append(tags::DIV_END);
 }
 void mmHTMLBuilder::endTable()
 {
-    html_ += tags::TABLE_END;
+    append(tags::TABLE_END);
 }
 void mmHTMLBuilder::endThead()
 {
-    html_ += tags::THEAD_END;
+    append(tags::THEAD_END);
 }
 void mmHTMLBuilder::endTbody()
 {
-    html_ += tags::TBODY_END;
+    if (virtual_chunk_ == 0)
+    {
+        append(tags::TBODY_END);
+        return;
+    }
+
+    flushVirtualRow();
+    flushVirtualChunk();
+    virtual_chunk_ = 0;
+
+    if (virtual_count_++ == 0)
+        append(tags::VIRTUAL_RENDERER);
+    const wxString id = virtual_id_;
+    append(wxString::Format(tags::VIRTUAL_TBODY, id));
+    append(wxString::Format("<script>mmRenderRows('%s', %zu);</script>\n", id, virtual_chunks_));
+
+    rows_json_.shrink_to_fit();
 }
 void mmHTMLBuilder::endTfoot()
 {
-    html_ += tags::TFOOT_END;
+    append(tags::TFOOT_END);
 }
 
 void mmHTMLBuilder::startTableRow()
 {
-    html_ += tags::TABLE_ROW;
+    append(tags::TABLE_ROW);
 }
 void mmHTMLBuilder::startTableRow(const wxString& classname)
 {
-    html_ += wxString::Format(tags::TABLE_ROW_EXTRA, wxString::Format("class='%s'", classname));
+    append(wxString::Format(tags::TABLE_ROW_EXTRA, wxString::Format("class='%s'", classname)));
 }
 void mmHTMLBuilder::startTableRowColor(const wxString& color)
 {
-    html_ += wxString::Format(tags::TABLE_ROW_EXTRA, wxString::Format("style='background-color:%s'", color));
+    append(wxString::Format(tags::TABLE_ROW_EXTRA, wxString::Format("style='background-color:%s'", color)));
 }
 
 void mmHTMLBuilder::startAltTableRow()
@@ -530,46 +685,92 @@ void mmHTMLBuilder::startAltTableRow()
 
 void mmHTMLBuilder::startTotalTableRow()
 {
-    html_ += tags::TOTAL_TABLE_ROW;
+    append(tags::TOTAL_TABLE_ROW);
 }
 
 void mmHTMLBuilder::endTableRow()
 {
-    html_ += tags::TABLE_ROW_END;
+    append(tags::TABLE_ROW_END);
+    if (virtual_chunk_ > 0)
+        flushVirtualRow();
+}
+
+void mmHTMLBuilder::flushVirtualRow()
+{
+    if (row_.empty())
+        return;
+    rows_json_ += (virtual_rows_++ > 0) ? ',' : '[';
+    json_escape(rows_json_, row_);
+    row_.clear();
+    if (virtual_rows_ >= virtual_chunk_)
+        flushVirtualChunk();
+}
+
+void mmHTMLBuilder::flushVirtualChunk()
+{
+    if (virtual_rows_ == 0)
+        return;
+    // The row data is already UTF-8, it is not passed through wxString again
+    std::string script = "mmAddRows('" + virtual_id_ + "', ";
+    script += rows_json_;
+    script += "]);\n";
+    write_rows_file(wxString::Format("%s_%zu.js", wxString(virtual_id_), virtual_chunks_++), script);
+    rows_json_.clear();
+    virtual_rows_ = 0;
+}
+
+void mmHTMLBuilder::append(const char* text)
+{
+    (virtual_chunk_ > 0 ? row_ : html_).append(text);
+}
+
+void mmHTMLBuilder::append(const wxString& text)
+{
+    const wxScopedCharBuffer buf = text.utf8_str();
+    (virtual_chunk_ > 0 ? row_ : html_).append(buf.data(), buf.length());
+}
+
+void mmHTMLBuilder::replace(const char* placeholder, const wxString& text)
+{
+    const size_t pos = html_.find(placeholder);
+    if (pos == std::string::npos)
+        return;
+    const wxScopedCharBuffer buf = text.utf8_str();
+    html_.replace(pos, strlen(placeholder), buf.data(), buf.length());
 }
 
 void mmHTMLBuilder::startSpan(const wxString& val, const wxString& style)
 {
-    html_ += wxString::Format(tags::SPAN, style, val);
+    append(wxString::Format(tags::SPAN, style, val));
 }
 
 void mmHTMLBuilder::endSpan()
 {
-    html_ += tags::SPAN_END;
+    append(tags::SPAN_END);
 }
 
 void mmHTMLBuilder::addText(const wxString& text)
 {
-    html_ += text;
+    append(text);
 }
 
 void mmHTMLBuilder::addLineBreak()
 {
-    html_ += tags::BR;
+    append(tags::BR);
 }
 
 void mmHTMLBuilder::addHorizontalLine(int size)
 {
-    html_ += wxString::Format(tags::HOR_LINE, size);
+    append(wxString::Format(tags::HOR_LINE, size));
 }
 
 void mmHTMLBuilder::startTableCell(const wxString& width)
 {
-    html_ += wxString::Format(tags::TABLE_CELL, width);
+    append(wxString::Format(tags::TABLE_CELL, width));
 }
 void mmHTMLBuilder::endTableCell()
 {
-    html_ += tags::TABLE_CELL_END;
+    append(tags::TABLE_CELL_END);
 }
 
 // Chart method (uses ApexChart.js)
@@ -785,7 +986,7 @@ void mmHTMLBuilder::addChart(const GraphData& gd)
 
 const wxString mmHTMLBuilder::getHTMLText() const
 {
-    return html_;
+    return wxString::FromUTF8(html_.data(), html_.size());
 }
 
 std::ostream& operator << (std::ostream& os, const wxDateTime& date)
@@ -23,6 +23,7 @@
 
 #include "defs.h"
 #include <vector>
+#include <string>
 #include "model/Model_Currency.h"
 #include "html_template.h"
 #include "util.h"
@@ -59,6 +60,10 @@ public:
     void clear()
     {
         html_.clear();
+        row_.clear();
+        rows_json_.clear();
+        virtual_chunk_ = 0;
+        virtual_count_ = 0;
     }
 
     /** Add an HTML header */
@@ -75,6 +80,18 @@ public:
     void startSortTable();
     void startThead();
     void startTbody();
+    /**
+    * Start a tbody whose rows are not part of the document. They are written
+    * in chunks of the given size to script files next to the page, which loads
+    * them once it is shown; only the open chunk is held in memory. The files
+    * belong to whoever shows the page: it takes them with takeRowsFiles() and
+    * removes them with removeRowsFiles() once the page is gone, so such a page
+    * must not be cached. Use it for tables with many rows; endTbody() closes it.
+    */
+    void startVirtualTbody(size_t chunk = 500);
+    /** Row files written since the last call, the caller has to remove them */
+    static std::vector<wxString> takeRowsFiles();
+    static void removeRowsFiles(const std::vector<wxString>& files);
     void startTfoot();
 
     /** Add a special row that will format total values */
@@ -147,7 +164,23 @@ public:
     void addChart(const GraphData& data);
 
 private:
-    wxString html_;
+    void append(const char* text);
+    void append(const wxString& text);
+    void replace(const char* placeholder, const wxString& text);
+    void flushVirtualRow();
+    void flushVirtualChunk();
+
+    enum { INITIAL_CAPACITY = 64 * 1024 };
+    // The document is kept UTF-8 encoded and converted only once by getHTMLText()
+    std::string html_;
+    // Open row and chunk of the open virtual tbody
+    std::string row_;
+    std::string rows_json_;
+    std::string virtual_id_;
+    size_t virtual_chunk_;
+    size_t virtual_rows_;
+    size_t virtual_chunks_;
+    size_t virtual_count_;
     struct today_
     {
         wxDateTime date;
@@ -24,11 +24,181 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "reports/htmlbuilder.h"
 #include "util.h"
 #include "reports/mmDateRange.h"
+#include "reports/reportpool.h"
 
 #include "model/Model_Account.h"
 #include "model/Model_Checking.h"
 #include "model/Model_CurrencyHistory.h"
 #include "model/Model_Category.h"
+#include "model/Model_Translink.h"
+#include <algorithm>
+
+namespace
+{
+    typedef std::map<int, std::pair<double, double>> IncomeExpensesStats; // year * 100 + month: income, expenses
+
+    // Income and expenses by month of one year of the report period
+    class IncomeExpensesTask : public mmReportTask
+    {
+    public:
+        IncomeExpensesTask(const wxString& from, const wxString& to, bool to_inclusive
+            , const std::map<int64, int64>& accounts, bool filtered, const mmReportRates& rates)
+            : m_from(from)
+            , m_to(to)
+            , m_to_inclusive(to_inclusive)
+            , m_accounts(accounts)
+            , m_filtered(filtered)
+            , m_rates(rates)
+        {
+        }
+        void Run(wxSQLite3Database* db);
+
+        IncomeExpensesStats m_stats;
+
+    private:
+        const wxString m_from;
+        const wxString m_to;
+        const bool m_to_inclusive;
+        const std::map<int64, int64>& m_accounts; // account: currency
+        const bool m_filtered; // only the transactions of m_accounts
+        const mmReportRates& m_rates;
+        const wxString m_void = Model_Checking::STATUS_KEY_VOID;
+        const wxString m_withdrawal = Model_Checking::TYPE_STR_WITHDRAWAL;
+        const wxString m_deposit = Model_Checking::TYPE_STR_DEPOSIT;
+    };
+
+    void IncomeExpensesTask::Run(wxSQLite3Database* db)
+    {
+        // Asset or stock transfers and deleted transactions are not income or expenses
+        wxSQLite3Statement stmt = db->PrepareStatement(wxString::Format(
+            "SELECT TRANSDATE, TRANSCODE, TRANSAMOUNT, ACCOUNTID FROM CHECKINGACCOUNT_V1"
+            " WHERE TRANSDATE >= ? AND TRANSDATE %s ? AND STATUS <> ? AND TRANSCODE IN (?, ?)"
+            " AND (DELETEDTIME IS NULL OR DELETEDTIME = '') AND NOT (TOACCOUNTID > 0 AND TOACCOUNTID = ?)"
+            , m_to_inclusive ? "<=" : "<"));
+        stmt.Bind(1, m_from);
+        stmt.Bind(2, m_to);
+        stmt.Bind(3, m_void);
+        stmt.Bind(4, m_deposit);
+        stmt.Bind(5, m_withdrawal);
+        stmt.Bind(6, static_cast<int>(Model_Translink::AS_TRANSFER));
+        wxSQLite3ResultSet rs = stmt.ExecuteQuery();
+
+        size_t rows = 0;
+        while (rs.NextRow())
+        {
+            if ((++rows & 0xFFF) == 0 && cancelled())
+                return;
+
+            const wxString date = rs.GetString(0);
+            double convRate = 1;
+            const auto account = m_accounts.find(rs.GetInt64(3));
+            if (account != m_accounts.end())
+                convRate = m_rates.rate(account->second, date);
+            else if (m_filtered)
+                continue;
+
+            long year = 0, month = 0;
+            date.Mid(0, 4).ToLong(&year);
+            date.Mid(5, 2).ToLong(&month);
+            auto& stats = m_stats[static_cast<int>(year * 100 + month - 1)];
+            if (rs.GetString(1) == m_deposit)
+                stats.first += rs.GetDouble(2) * convRate;
+            else
+                stats.second += rs.GetDouble(2) * convRate;
+        }
+    }
+
+    void collectFromModels(const mmDateRange* date_range, const wxSharedPtr<wxArrayString>& accountArray, IncomeExpensesStats& incomeExpensesStats)
+    {
+        for (const auto& transaction : Model_Checking::instance().find(
+            Model_Checking::TRANSDATE(date_range->start_date(), GREATER_OR_EQUAL)
+            , Model_Checking::TRANSDATE(date_range->end_date().FormatISOCombined(), LESS_OR_EQUAL)
+            , Model_Checking::STATUS(Model_Checking::STATUS_ID_VOID, NOT_EQUAL)))
+        {
+            // Do not include asset or stock transfers or deleted transactions in income expense calculations.
+            if (Model_Checking::foreignTransactionAsTransfer(transaction) || !transaction.DELETEDTIME.IsEmpty())
+                continue;
+
+            Model_Account::Data *account = Model_Account::instance().get(transaction.ACCOUNTID);
+            if (accountArray)
+            {
+                if (!account || wxNOT_FOUND == accountArray->Index(account->ACCOUNTNAME))
+                    continue;
+            }
+            double convRate = 1;
+            // We got this far, get the currency conversion rate for this account
+            if (account) convRate = Model_CurrencyHistory::getDayRate(Model_Account::currency(account)->CURRENCYID, transaction.TRANSDATE);
+            int year = Model_Checking::TRANSDATE(transaction).GetYear();
+
+            int idx = year * 100 + Model_Checking::TRANSDATE(transaction).GetMonth();
+
+            if (Model_Checking::type_id(transaction) == Model_Checking::TYPE_ID_DEPOSIT) {
+                incomeExpensesStats[idx].first += transaction.TRANSAMOUNT * convRate;
+            }
+            else if (Model_Checking::type_id(transaction) == Model_Checking::TYPE_ID_WITHDRAWAL) {
+                incomeExpensesStats[idx].second += transaction.TRANSAMOUNT * convRate;
+            }
+        }
+    }
+
+    /**
+    * Income and expenses of the period by month. The years are independent,
+    * each one is computed by a report worker. Returns false when cancelled.
+    */
+    bool collectIncomeExpenses(const mmDateRange* date_range, const wxSharedPtr<wxArrayString>& accountArray
+        , const wxString& title, IncomeExpensesStats& incomeExpensesStats)
+    {
+        // Everything the tasks need from the models is copied here, on the GUI thread
+        mmReportRates rates;
+        std::map<int64, int64> accounts;
+        for (const auto& account : Model_Account::instance().all())
+        {
+            if (accountArray && wxNOT_FOUND == accountArray->Index(account.ACCOUNTNAME))
+                continue;
+            const int64 currency_id = Model_Account::currency(account)->CURRENCYID;
+            accounts[account.ACCOUNTID] = currency_id;
+            rates.add(currency_id);
+        }
+
+        const wxDateTime start = date_range->start_date();
+        const wxDateTime end = date_range->end_date();
+        std::vector<wxSharedPtr<mmReportTask>> tasks;
+        std::vector<IncomeExpensesTask*> years;
+        // Older years of a long period go together into the first task
+        const int first_year = std::max(start.GetYear(), end.GetYear() - 15);
+        for (int year = first_year; year <= end.GetYear(); year++)
+        {
+            const wxString from = (year == first_year)
+                ? (start.FormatISOTime() == "00:00:00" ? start.FormatISODate() : start.FormatISOCombined())
+                : wxString::Format("%04d-01-01", year);
+            const bool last = (year == end.GetYear());
+            const wxString to = last ? end.FormatISOCombined() : wxString::Format("%04d-01-01", year + 1);
+            years.push_back(new IncomeExpensesTask(from, to, last, accounts, accountArray.get() != nullptr, rates));
+            tasks.push_back(wxSharedPtr<mmReportTask>(years.back()));
+        }
+
+        switch (mmReportPool::instance().run(tasks, title))
+        {
+        case mmReportPool::DONE:
+            for (const auto task : years)
+            {
+                for (const auto& stats : task->m_stats)
+                {
+                    incomeExpensesStats[stats.first].first += stats.second.first;
+                    incomeExpensesStats[stats.first].second += stats.second.second;
+                }
+            }
+            return true;
+        case mmReportPool::CANCELLED:
+            return false;
+        case mmReportPool::FAILED:
+            break;
+        }
+
+        collectFromModels(date_range, accountArray, incomeExpensesStats);
+        return true;
+    }
+}
 
 
 mmReportIncomeExpenses::mmReportIncomeExpenses()
@@ -44,30 +214,15 @@ mmReportIncomeExpenses::~mmReportIncomeExpenses()
 wxString mmReportIncomeExpenses::getHTMLText()
 {
     // Grab the data
+    IncomeExpensesStats incomeExpensesStats;
+    if (!collectIncomeExpenses(m_date_range, accountArray_, getReportTitle(), incomeExpensesStats))
+        return getCancelledHTMLText();
+
     std::pair<double, double> income_expenses_pair;
-    for (const auto& transaction : Model_Checking::instance().find(
-        Model_Checking::TRANSDATE(m_date_range->start_date(), GREATER_OR_EQUAL)
-        , Model_Checking::TRANSDATE(m_date_range->end_date().FormatISOCombined(), LESS_OR_EQUAL)
-        , Model_Checking::STATUS(Model_Checking::STATUS_ID_VOID, NOT_EQUAL)))
+    for (const auto& stats : incomeExpensesStats)
     {
-        // Do not include asset or stock transfers or deleted transactions in income expense calculations.
-        if (Model_Checking::foreignTransactionAsTransfer(transaction) || !transaction.DELETEDTIME.IsEmpty())
-            continue;
-
-        Model_Account::Data *account = Model_Account::instance().get(transaction.ACCOUNTID);
-        if (accountArray_)
-        {
-            if (!account || wxNOT_FOUND == accountArray_->Index(account->ACCOUNTNAME))
-                continue;
-        }
-        double convRate = 1;
-        // We got this far, get the currency conversion rate for this account
-        if (account) convRate = Model_CurrencyHistory::getDayRate(Model_Account::currency(account)->CURRENCYID,transaction.TRANSDATE);
-
-        if (Model_Checking::type_id(transaction) == Model_Checking::TYPE_ID_DEPOSIT)
-            income_expenses_pair.first += transaction.TRANSAMOUNT * convRate;
-        else if (Model_Checking::type_id(transaction) == Model_Checking::TYPE_ID_WITHDRAWAL)
-            income_expenses_pair.second += transaction.TRANSAMOUNT * convRate;
+        income_expenses_pair.first += stats.second.first;
+        income_expenses_pair.second += stats.second.second;
     }
 
     // Build the report
@@ -143,37 +298,9 @@ wxString mmReportIncomeExpensesMonthly::getHTMLText()
 {
     // Grab the data
     const wxDateTime start_date = m_date_range->start_date();
-    std::map<int, std::pair<double, double> > incomeExpensesStats;
-    //TODO: init all the map values with 0.0
-    for (const auto& transaction : Model_Checking::instance().find(
-        Model_Checking::TRANSDATE(start_date, GREATER_OR_EQUAL)
-        , Model_Checking::TRANSDATE(m_date_range->end_date().FormatISOCombined(), LESS_OR_EQUAL)
-        , Model_Checking::STATUS(Model_Checking::STATUS_ID_VOID, NOT_EQUAL)))
-    {
-        // Do not include asset or stock transfers or deleted transactions in income expense calculations.
-        if (Model_Checking::foreignTransactionAsTransfer(transaction) || !transaction.DELETEDTIME.IsEmpty())
-            continue;
-
-        Model_Account::Data *account = Model_Account::instance().get(transaction.ACCOUNTID);
-        if (accountArray_)
-        {
-            if (!account || wxNOT_FOUND == accountArray_->Index(account->ACCOUNTNAME))
-                continue;
-        }
-        double convRate = 1;
-        // We got this far, get the currency conversion rate for this account
-        if (account) convRate = Model_CurrencyHistory::getDayRate(Model_Account::currency(account)->CURRENCYID, transaction.TRANSDATE);
-        int year = Model_Checking::TRANSDATE(transaction).GetYear();
-
-        int idx = year * 100 + Model_Checking::TRANSDATE(transaction).GetMonth();
-
-        if (Model_Checking::type_id(transaction) == Model_Checking::TYPE_ID_DEPOSIT) {
-            incomeExpensesStats[idx].first += transaction.TRANSAMOUNT * convRate;
-        }
-        else if (Model_Checking::type_id(transaction) == Model_Checking::TYPE_ID_WITHDRAWAL) {
-            incomeExpensesStats[idx].second += transaction.TRANSAMOUNT * convRate;
-        }
-    }
+    IncomeExpensesStats incomeExpensesStats;
+    if (!collectIncomeExpenses(m_date_range, accountArray_, getReportTitle(), incomeExpensesStats))
+        return getCancelledHTMLText();
 
     // Build the report
     mmHTMLBuilder hb;
@@ -19,6 +19,7 @@
  ********************************************************/
 
 #include "reportbase.h"
+#include "htmlbuilder.h"
 #include "constants.h"
 #include "mmex.h"
 #include "mmSimpleDialogs.h"
@@ -266,6 +267,75 @@ void mmPrintableBase::setAccounts(int selection, const wxString& name)
     }
 }
 
+const wxString mmPrintableBase::getCacheKey() const
+{
+    // Custom reports run arbitrary SQL/Lua, usage statistics change on every view
+    if (m_id < 0 || m_id == MyUsage || m_id == BugReport)
+        return wxEmptyString;
+
+    wxString key = wxString::Format("%d|%lld|%d|%d|%d|%s"
+        , m_id, m_date_selection.GetValue(), m_account_selection
+        , m_chart_selection, m_forward_months
+        , wxDate::Today().FormatISODate());
+
+    if (m_date_range)
+    {
+        key << "|" << m_date_range->start_date().FormatISOCombined()
+            << "|" << m_date_range->end_date().FormatISOCombined();
+    }
+
+    key << "|";
+    if (accountArray_)
+    {
+        for (const auto& entry : *accountArray_)
+            key << entry << ";";
+    }
+    else
+        key << "*";
+
+    return key;
+}
+
+wxString mmPrintableBase::getCachedHTMLText()
+{
+    const wxString key = getCacheKey();
+    if (key.empty())
+        return getHTMLText();
+
+    wxString html;
+    if (!mmReportCache::instance().get(key, html))
+    {
+        m_cancelled = false;
+        m_uncached = false;
+        html = getHTMLText();
+        if (!m_cancelled && !m_uncached)
+            mmReportCache::instance().put(key, html);
+    }
+    return html;
+}
+
+wxString mmPrintableBase::getStandaloneHTMLText()
+{
+    m_inline_rows = true;
+    const wxString html = getHTMLText();
+    m_inline_rows = false;
+    return html;
+}
+
+const wxString mmPrintableBase::getCancelledHTMLText()
+{
+    m_cancelled = true;
+
+    mmHTMLBuilder hb;
+    hb.init();
+    hb.addReportHeader(getReportTitle());
+    hb.addDivContainer("shadow");
+    hb.addText(wxString::Format("<p>%s</p>", _("The report generation was cancelled.")));
+    hb.endDiv();
+    hb.end();
+    return hb.getHTMLText();
+}
+
 const wxString mmPrintableBase::getReportTitle(bool translate) const
 {
     wxString title = translate ? wxGetTranslation(m_title) : m_title;
@@ -277,6 +347,75 @@ const wxString mmPrintableBase::getReportTitle(bool translate) const
 }
 
 
+//----------------------------------------------------------------------
+
+mmReportCache& mmReportCache::instance()
+{
+    return Singleton<mmReportCache>::instance();
+}
+
+void mmReportCache::check_generation()
+{
+    if (m_generation != ModelBase::generation())
+    {
+        clear();
+        m_generation = ModelBase::generation();
+    }
+}
+
+bool mmReportCache::get(const wxString& key, wxString& html)
+{
+    check_generation();
+
+    const auto it = m_index.find(key);
+    if (it == m_index.end())
+    {
+        ++m_misses;
+        return false;
+    }
+
+    m_pages.splice(m_pages.begin(), m_pages, it->second);
+    html = it->second->second;
+    ++m_hits;
+    return true;
+}
+
+void mmReportCache::put(const wxString& key, const wxString& html)
+{
+    check_generation();
+
+    const auto it = m_index.find(key);
+    if (it != m_index.end())
+    {
+        m_size -= it->second->second.length() * sizeof(wxChar);
+        m_pages.erase(it->second);
+        m_index.erase(it);
+    }
+
+    m_pages.push_front(std::make_pair(key, html));
+    m_index[key] = m_pages.begin();
+    m_size += html.length() * sizeof(wxChar);
+    shrink();
+}
+
+void mmReportCache::shrink()
+{
+    while (m_pages.size() > 1 && (m_pages.size() > MAX_PAGES || m_size > MAX_SIZE))
+    {
+        const auto& last = m_pages.back();
+        m_size -= last.second.length() * sizeof(wxChar);
+        m_index.erase(last.first);
+        m_pages.pop_back();
+    }
+}
+
+void mmReportCache::clear()
+{
+    m_pages.clear();
+    m_index.clear();
+    m_size = 0;
+}
+
 //----------------------------------------------------------------------
 
 mmGeneralReport::mmGeneralReport(const Model_Report::Data* report)
@@ -25,6 +25,8 @@
 #include "mmDateRange.h"
 #include "option.h"
 #include "model/Model_Report.h"
+#include <list>
+#include <unordered_map>
 class wxString;
 class wxArrayString;
 //----------------------------------------------------------------------------
@@ -35,6 +37,9 @@ public:
     mmPrintableBase(const wxString& title);
     virtual ~mmPrintableBase();
     virtual wxString getHTMLText() = 0;
+    wxString getCachedHTMLText();
+    /** The page with all of its rows inline, for export and print */
+    wxString getStandaloneHTMLText();
     virtual void RefreshData() {}
     virtual const wxString getReportTitle(bool translate = true) const;
     virtual int report_parameters();
@@ -107,6 +112,16 @@ protected:
     wxSharedPtr<wxArrayString> accountArray_;
     wxSharedPtr<wxArrayString> selectedAccountArray_;
     bool m_only_active = false;
+    // Set by getHTMLText() when the user stopped the generation, the page is not cached then
+    bool m_cancelled = false;
+    // Set by getHTMLText() when the page refers to row files owned by the panel showing it
+    bool m_uncached = false;
+    // Set by getStandaloneHTMLText(), no row is written to a file of its own then
+    bool m_inline_rows = false;
+    const wxString getCancelledHTMLText();
+
+private:
+    const wxString getCacheKey() const;
 
 private:
     bool m_initial = true;
@@ -141,6 +156,46 @@ private:
     const Model_Report::Data* m_report;
 };
 
+/**
+* Rendered report pages keyed by report id and parameters.
+* The whole cache is dropped as soon as the database generation
+* differs from the one the pages were rendered from.
+*/
+class mmReportCache
+{
+public:
+    static mmReportCache& instance();
+
+    bool get(const wxString& key, wxString& html);
+    void put(const wxString& key, const wxString& html);
+    void clear();
+
+    size_t count() const;
+    size_t size() const;
+    size_t hits() const;
+    size_t misses() const;
+
+private:
+    void check_generation();
+    void shrink();
+
+    typedef std::list<std::pair<wxString, wxString>> Pages;
+    Pages m_pages; // most recently used first
+    std::unordered_map<wxString, Pages::iterator> m_index;
+    size_t m_generation = 0;
+    size_t m_size = 0;
+    size_t m_hits = 0;
+    size_t m_misses = 0;
+
+    static const size_t MAX_PAGES = 32;
+    static const size_t MAX_SIZE = 64 * 1024 * 1024;
+};
+
+inline size_t mmReportCache::count() const { return m_pages.size(); }
+inline size_t mmReportCache::size() const { return m_size; }
+inline size_t mmReportCache::hits() const { return m_hits; }
+inline size_t mmReportCache::misses() const { return m_misses; }
+
 #include "html_template.h"
 class mm_html_template: public html_template
 {
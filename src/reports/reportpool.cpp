@@ -0,0 +1,259 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#include "reportpool.h"
+#include "dbwrapper.h"
+#include "option.h"
+#include "primitive.h"
+#include "model/Model_Currency.h"
+#include "model/Model_CurrencyHistory.h"
+#include <wx/app.h>
+#include <wx/progdlg.h>
+#include <wx/stopwatch.h>
+#include <algorithm>
+
+void mmReportRates::add(int64 currency_id)
+{
+    if (m_rates.find(currency_id) != m_rates.end())
+        return;
+
+    Rates& rates = m_rates[currency_id];
+    const Model_Currency::Data* currency = Model_Currency::instance().get(currency_id);
+    if (currency_id == -1 || currency == Model_Currency::GetBaseCurrency())
+        return;
+    if (currency)
+        rates.base_rate = currency->BASECONVRATE;
+    if (!Option::instance().getUseCurrencyHistory())
+        return;
+
+    for (const auto& r : Model_CurrencyHistory::instance().find(Model_CurrencyHistory::CURRENCYID(currency_id)))
+        rates.history.push_back(std::make_pair(mmDayNumber(r.CURRDATE), r.CURRVALUE));
+    std::stable_sort(rates.history.begin(), rates.history.end()
+        , [](const std::pair<int, double>& x, const std::pair<int, double>& y) { return x.first < y.first; });
+}
+
+double mmReportRates::rate(int64 currency_id, const wxString& iso_date) const
+{
+    const auto it = m_rates.find(currency_id);
+    if (it == m_rates.end())
+    {
+        wxFAIL_MSG("currency was not added");
+        return 1.0;
+    }
+
+    const Rates& rates = it->second;
+    if (rates.history.empty())
+        return rates.base_rate;
+
+    // Rate of the day, otherwise the nearest one with preference to the past
+    const int day = mmDayNumber(iso_date);
+    auto next = std::lower_bound(rates.history.begin(), rates.history.end(), day
+        , [](const std::pair<int, double>& x, int d) { return x.first < d; });
+    if (next != rates.history.end() && next->first == day)
+    {
+        auto last = next;
+        while (last + 1 != rates.history.end() && (last + 1)->first == day)
+            ++last;
+        return last->second;
+    }
+    if (next == rates.history.begin())
+        return next->second;
+    const auto prev = next - 1;
+    if (next == rates.history.end() || day - prev->first <= next->first - day)
+        return prev->second;
+    return next->second;
+}
+
+//----------------------------------------------------------------------------
+
+class mmReportPool::Worker : public wxThread
+{
+public:
+    explicit Worker(mmReportPool* pool) : wxThread(wxTHREAD_JOINABLE), m_pool(pool) {}
+
+protected:
+    virtual ExitCode Entry();
+
+private:
+    mmReportPool* m_pool;
+};
+
+wxThread::ExitCode mmReportPool::Worker::Entry()
+{
+    // The connection lives as long as the worker, opened on the first task
+    wxSharedPtr<wxSQLite3Database> db;
+    wxSharedPtr<mmReportTask> task;
+    while (m_pool->next(task))
+    {
+        if (!db)
+            db = m_pool->connect();
+
+        bool ok = false;
+        if (db)
+        {
+            try
+            {
+                task->Run(db.get());
+                ok = true;
+            }
+            catch (const wxSQLite3Exception& e)
+            {
+                wxLogDebug("mmReportPool: %s", e.GetMessage());
+            }
+        }
+        task.reset();
+        m_pool->finished(ok);
+    }
+    return nullptr;
+}
+
+mmReportPool& mmReportPool::instance()
+{
+    return Singleton<mmReportPool>::instance();
+}
+
+void mmReportPool::attach(const wxString& path, const wxString& password)
+{
+    detach();
+    wxMutexLocker lock(m_mutex);
+    m_path = path;
+    m_password = password;
+}
+
+void mmReportPool::detach()
+{
+    m_mutex.Lock();
+    m_stop = true;
+    m_queue.clear();
+    m_path.clear();
+    m_password.clear();
+    m_work.Broadcast();
+    m_mutex.Unlock();
+
+    for (auto worker : m_workers)
+    {
+        worker->Wait();
+        delete worker;
+    }
+    m_workers.clear();
+    m_stop = false;
+}
+
+void mmReportPool::start()
+{
+    if (!m_workers.empty())
+        return;
+
+    int count = wxThread::GetCPUCount();
+    count = count < 1 ? 1 : (count > MAX_WORKERS ? MAX_WORKERS : count);
+    for (int i = 0; i < count; i++)
+    {
+        Worker* worker = new Worker(this);
+        if (worker->Run() != wxTHREAD_NO_ERROR)
+        {
+            delete worker;
+            break;
+        }
+        m_workers.push_back(worker);
+    }
+}
+
+bool mmReportPool::next(wxSharedPtr<mmReportTask>& task)
+{
+    wxMutexLocker lock(m_mutex);
+    while (m_queue.empty() && !m_stop)
+        m_work.Wait();
+    if (m_stop)
+        return false;
+
+    task = m_queue.front();
+    m_queue.pop_front();
+    return true;
+}
+
+void mmReportPool::finished(bool ok)
+{
+    wxMutexLocker lock(m_mutex);
+    m_pending--;
+    if (!ok) m_failed++;
+    m_done.Signal();
+}
+
+wxSharedPtr<wxSQLite3Database> mmReportPool::connect()
+{
+    wxString path, password;
+    {
+        wxMutexLocker lock(m_mutex);
+        path = m_path;
+        password = m_password;
+    }
+    return mmDBWrapper::OpenReadOnly(path, password);
+}
+
+mmReportPool::RESULT mmReportPool::run(const std::vector<wxSharedPtr<mmReportTask>>& tasks, const wxString& title, const wxString& message)
+{
+    if (tasks.empty())
+        return DONE;
+    if (m_path.empty() || !wxThread::IsMain())
+        return FAILED;
+    start();
+    if (m_workers.empty())
+        return FAILED;
+
+    m_cancel = false;
+    m_mutex.Lock();
+    m_pending = tasks.size();
+    m_failed = 0;
+    for (const auto& task : tasks)
+    {
+        task->m_cancel = &m_cancel;
+        m_queue.push_back(task);
+    }
+    m_work.Broadcast();
+
+    wxStopWatch sw;
+    wxProgressDialog* progress = nullptr;
+    while (m_pending > 0)
+    {
+        m_done.WaitTimeout(100);
+        if (m_cancel || m_pending == 0 || sw.Time() < PROGRESS_DELAY)
+            continue;
+
+        const int done = static_cast<int>(tasks.size() - m_pending);
+        m_mutex.Unlock();
+        if (!progress)
+        {
+            progress = new wxProgressDialog(title, message.empty() ? _("Generating report") : message
+                , static_cast<int>(tasks.size()), wxTheApp->GetTopWindow()
+                , wxPD_APP_MODAL | wxPD_CAN_ABORT | wxPD_AUTO_HIDE | wxPD_ELAPSED_TIME);
+        }
+        const bool go_on = progress->Update(done);
+        m_mutex.Lock();
+
+        if (!go_on)
+        {
+            // Queued tasks are dropped, the running ones stop at their next check
+            m_cancel = true;
+            m_pending -= m_queue.size();
+            m_queue.clear();
+        }
+    }
+    const RESULT result = m_cancel ? CANCELLED : (m_failed > 0 ? FAILED : DONE);
+    m_mutex.Unlock();
+
+    delete progress;
+    return result;
+}
@@ -0,0 +1,122 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#ifndef MM_EX_REPORTPOOL_H_
+#define MM_EX_REPORTPOOL_H_
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <vector>
+#include <wx/thread.h>
+#include <wx/sharedptr.h>
+#include "model/Model.h"
+
+class wxSQLite3Database;
+
+/**
+* A part of a report computed by a worker of mmReportPool.
+* Tasks must not use the Model<> singletons, they are not thread safe.
+* Everything is read through the connection passed to Run()
+* or from data copied into the task before it is queued.
+*/
+class mmReportTask
+{
+public:
+    virtual ~mmReportTask() {}
+    virtual void Run(wxSQLite3Database* db) = 0;
+
+protected:
+    /** Long running tasks should return early once the report is cancelled */
+    bool cancelled() const;
+
+private:
+    friend class mmReportPool;
+    const std::atomic<bool>* m_cancel = nullptr;
+};
+
+inline bool mmReportTask::cancelled() const { return m_cancel && m_cancel->load(); }
+
+/**
+* Rates to the base currency for a set of currencies, following the rules
+* of Model_CurrencyHistory::getDayRate(). Filled on the GUI thread, then
+* it can be read by any number of tasks.
+*/
+class mmReportRates
+{
+public:
+    void add(int64 currency_id);
+    double rate(int64 currency_id, const wxString& iso_date) const;
+
+private:
+    struct Rates
+    {
+        double base_rate = 1.0;
+        std::vector<std::pair<int, double>> history; // day number, rate; sorted by day
+    };
+    std::map<int64, Rates> m_rates;
+};
+
+/**
+* Runs report tasks on worker threads. Each worker has its own read only
+* connection to the database file, so the GUI connection is not shared.
+*/
+class mmReportPool
+{
+public:
+    enum RESULT { DONE = 0, CANCELLED, FAILED };
+
+    static mmReportPool& instance();
+
+    /** Set the database the workers read from, called when a database is opened */
+    void attach(const wxString& path, const wxString& password);
+    /** Stop the workers and close their connections */
+    void detach();
+
+    /**
+    * Run all the tasks and wait for them. A progress dialog allowing to cancel
+    * is shown when it takes longer than a moment. FAILED means the tasks could
+    * not be run here, so the caller should compute the data itself.
+    * The progress dialog shows message, "Generating report" when empty.
+    */
+    RESULT run(const std::vector<wxSharedPtr<mmReportTask>>& tasks, const wxString& title, const wxString& message = "");
+
+private:
+    class Worker;
+    friend class Worker;
+
+    void start();
+    bool next(wxSharedPtr<mmReportTask>& task);
+    void finished(bool ok);
+    wxSharedPtr<wxSQLite3Database> connect();
+
+    wxMutex m_mutex;
+    wxCondition m_work{ m_mutex };
+    wxCondition m_done{ m_mutex };
+    std::deque<wxSharedPtr<mmReportTask>> m_queue;
+    std::vector<Worker*> m_workers;
+    size_t m_pending = 0;
+    size_t m_failed = 0;
+    bool m_stop = false;
+    std::atomic<bool> m_cancel{ false };
+    wxString m_path;
+    wxString m_password;
+
+    static const int MAX_WORKERS = 4;
+    static const long PROGRESS_DELAY = 500; // ms
+};
+
+#endif // MM_EX_REPORTPOOL_H_
@@ -22,9 +22,71 @@
 #include "summary.h"
 #include "constants.h"
 #include "htmlbuilder.h"
+#include "reportpool.h"
 #include "model/allmodel.h"
 #include <algorithm>
 
+namespace
+{
+    // Balance of a checking account at the end of each report date
+    class BalanceSeriesTask : public mmReportTask
+    {
+    public:
+        BalanceSeriesTask(const Model_Account::Data& account, const std::vector<wxString>& dates)
+            : m_account_id(account.ACCOUNTID)
+            , m_initial_balance(account.INITIALBAL)
+            , m_dates(dates)
+        {
+        }
+        void Run(wxSQLite3Database* db);
+
+        const int64 m_account_id;
+        const double m_initial_balance;
+        const std::vector<wxString> m_dates; // ISO dates, ascending
+        std::vector<double> m_balances;
+
+    private:
+        const wxString m_void = Model_Checking::STATUS_KEY_VOID;
+        const wxString m_withdrawal = Model_Checking::TYPE_STR_WITHDRAWAL;
+        const wxString m_deposit = Model_Checking::TYPE_STR_DEPOSIT;
+        const wxString m_transfer = Model_Checking::TYPE_STR_TRANSFER;
+    };
+
+    void BalanceSeriesTask::Run(wxSQLite3Database* db)
+    {
+        wxSQLite3Statement stmt = db->PrepareStatement(
+            "SELECT TRANSDATE, TRANSCODE, TRANSAMOUNT, TOTRANSAMOUNT, ACCOUNTID FROM CHECKINGACCOUNT_V1"
+            " WHERE (ACCOUNTID = ? OR TOACCOUNTID = ?) AND STATUS <> ? AND (DELETEDTIME IS NULL OR DELETEDTIME = '')"
+            " ORDER BY TRANSDATE");
+        stmt.Bind(1, m_account_id);
+        stmt.Bind(2, m_account_id);
+        stmt.Bind(3, m_void);
+        wxSQLite3ResultSet rs = stmt.ExecuteQuery();
+
+        m_balances.reserve(m_dates.size());
+        double balance = m_initial_balance;
+        size_t rows = 0;
+        while (rs.NextRow())
+        {
+            if ((++rows & 0xFFF) == 0 && cancelled())
+                return;
+
+            // A transaction with time is after the report date of the same day
+            const wxString date = rs.GetString(0);
+            while (m_balances.size() < m_dates.size() && date > m_dates[m_balances.size()])
+                m_balances.push_back(balance);
+
+            const wxString code = rs.GetString(1);
+            if (rs.GetInt64(4) == m_account_id)
+                balance += (code == m_deposit ? 1 : -1) * rs.GetDouble(2);
+            else if (code == m_transfer)
+                balance += rs.GetDouble(3);
+        }
+        while (m_balances.size() < m_dates.size())
+            m_balances.push_back(balance);
+    }
+}
+
 mmHistoryItem::mmHistoryItem()
 {
     acctId = stockId = 0;
@@ -62,9 +124,13 @@ static bool sortFunction(const std::pair<wxDate, double> x, std::pair<wxDate, do
     return x.first >= y.first;
 }
 
-double mmReportSummaryByDate::getCheckingDailyBalanceAt(const Model_Account::Data* account, const wxDate& date)
+double mmReportSummaryByDate::getCheckingDailyBalanceAt(const Model_Account::Data* account, const wxDate& date, size_t date_idx)
 {
-    std::map<wxDate, double> balanceMap = accountsBalanceMap[account->ACCOUNTID];
+    const auto series = accountsBalanceSeries.find(account->ACCOUNTID);
+    if (series != accountsBalanceSeries.end())
+        return series->second[date_idx];
+
+    const std::map<wxDate, double>& balanceMap = accountsBalanceMap[account->ACCOUNTID];
 
     auto const& i = std::upper_bound(balanceMap.rbegin(), balanceMap.rend(), std::pair<wxDate, double>(date, 0), sortFunction);
     if (i != balanceMap.rend())
@@ -79,7 +145,7 @@ double mmReportSummaryByDate::getInvestingDailyBalanceAt(const Model_Account::Da
     return arHistory.getDailyBalanceAt(account, date);
 }
 
-double mmReportSummaryByDate::getDailyBalanceAt(const Model_Account::Data* account, const wxDate& date)
+double mmReportSummaryByDate::getDailyBalanceAt(const Model_Account::Data* account, const wxDate& date, size_t date_idx)
 {
     if (date.FormatISODate() < account->INITIALDATE)
         return 0.0;
@@ -90,7 +156,7 @@ double mmReportSummaryByDate::getDailyBalanceAt(const Model_Account::Data* accou
     }
     else
     {
-        return getCheckingDailyBalanceAt(account, date);
+        return getCheckingDailyBalanceAt(account, date, date_idx);
     }
 }
 
@@ -135,6 +201,8 @@ wxString mmReportSummaryByDate::getHTMLText()
 
     currencyDateRateCache.clear();
     arHistory.clear();
+    accountsBalanceMap.clear();
+    accountsBalanceSeries.clear();
 
     dateStart = wxDate::Today();
     // Calculate the report data
@@ -161,10 +229,6 @@ wxString mmReportSummaryByDate::getHTMLText()
                 arHistory.push_back(histItem);
             }
         }
-        else
-        {
-            accountsBalanceMap[account.ACCOUNTID] = createCheckingBalanceMap(account);
-        }
     }
 
     if (mode_ == MONTHLY)
@@ -194,9 +258,41 @@ wxString mmReportSummaryByDate::getHTMLText()
     }
     std::reverse(arDates.begin(), arDates.end());
 
+    // The series of the checking accounts are independent of each other, they are computed by the workers
+    std::vector<wxString> isoDates;
+    for (const auto& date : arDates)
+        isoDates.push_back(date.FormatISODate());
+    std::vector<wxSharedPtr<mmReportTask>> tasks;
+    std::vector<BalanceSeriesTask*> series;
+    for (const auto& account : Model_Account::instance().all())
+    {
+        if (Model_Account::type_id(account) == Model_Account::TYPE_ID_INVESTMENT)
+            continue;
+        series.push_back(new BalanceSeriesTask(account, isoDates));
+        tasks.push_back(wxSharedPtr<mmReportTask>(series.back()));
+    }
+
+    switch (mmReportPool::instance().run(tasks, name))
+    {
+    case mmReportPool::DONE:
+        for (const auto task : series)
+            accountsBalanceSeries[task->m_account_id] = task->m_balances;
+        break;
+    case mmReportPool::CANCELLED:
+        return getCancelledHTMLText();
+    case mmReportPool::FAILED:
+        for (const auto& account : Model_Account::instance().all())
+        {
+            if (Model_Account::type_id(account) != Model_Account::TYPE_ID_INVESTMENT)
+                accountsBalanceMap[account.ACCOUNTID] = createCheckingBalanceMap(account);
+        }
+        break;
+    }
+
 
-    for (const auto & end_date : arDates)
+    for (size_t date_idx = 0; date_idx < arDates.size(); date_idx++)
     {
+        const wxDate& end_date = arDates[date_idx];
         double total = 0.0;
         double assetBalance = 0;
         // prepare columns for report: date, cash, checking, CC, loan, term, asset, shares, partial total, investment, grand total
@@ -212,7 +308,7 @@ wxString mmReportSummaryByDate::getHTMLText()
 
         for (const auto& account : Model_Account::instance().all())
         {
-            balancePerDay[Model_Account::type_id(account)] += getDailyBalanceAt(&account, end_date) * getDayRate(account.CURRENCYID, end_date);
+            balancePerDay[Model_Account::type_id(account)] += getDailyBalanceAt(&account, end_date, date_idx) * getDayRate(account.CURRENCYID, end_date);
         }
 
         for (const auto& asset : Model_Asset::instance().all()) {
@@ -56,13 +56,15 @@ protected:
 private:
     int mode_;
     std::map<int64, std::map<wxDate, double>> accountsBalanceMap;
+    // Balances of the checking accounts at each report date, when computed by the report workers
+    std::map<int64, std::vector<double>> accountsBalanceSeries;
     mmHistoryData   arHistory;
     std::map<wxString, double> currencyDateRateCache;
 
     std::map<wxDate, double> createCheckingBalanceMap(const Model_Account::Data& account);
-    double getCheckingDailyBalanceAt(const Model_Account::Data* account, const wxDate& date);
+    double getCheckingDailyBalanceAt(const Model_Account::Data* account, const wxDate& date, size_t date_idx);
     double getInvestingDailyBalanceAt(const Model_Account::Data* account, const wxDate& date);
-    double getDailyBalanceAt(const Model_Account::Data* account, const wxDate& date);
+    double getDailyBalanceAt(const Model_Account::Data* account, const wxDate& date, size_t date_idx);
     double getDayRate(int64 currencyid, const wxDate& date);
 };
 
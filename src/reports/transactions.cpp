@@ -152,6 +152,12 @@ table {
         );
     }
 
+    // Large tables are delivered to the page in chunks instead of as one document
+    const bool virtual_rows = !m_inline_rows && std::count_if(trans_.begin(), trans_.end()
+        , [](const Model_Checking::Full_Data& t) { return t.DELETEDTIME.IsEmpty(); }) > VIRTUAL_ROWS_MIN;
+    m_uncached = virtual_rows;
+    const auto custom_fields_data = Model_CustomFieldData::instance().get_all(Model_Attachment::REFTYPE_ID_TRANSACTION);
+
     // Display the data for each row
     for (auto& transaction : trans_)
     {
@@ -253,7 +259,10 @@ table {
             }
             hb.endTableRow();
             hb.endThead();
-            hb.startTbody();
+            if (virtual_rows)
+                hb.startVirtualTbody();
+            else
+                hb.startTbody();
         }
         lastSortLabel = sortLabel;
 
@@ -269,7 +278,6 @@ table {
         bool is_time_used = Option::instance().UseTransDateTime();
         const wxString mask = is_time_used ? "%Y-%m-%dT%H:%M:%S" : "%Y-%m-%d";
 
-        auto custom_fields_data = Model_CustomFieldData::instance().get_all(Model_Attachment::REFTYPE_ID_TRANSACTION);
         while (noOfTrans--)
         {
             hb.startTableRow();
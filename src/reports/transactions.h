@@ -43,6 +43,8 @@ private:
 
     mmHTMLBuilder hb;
     int m_noOfCols;
+    // Row count above which the table rows are rendered incrementally
+    enum { VIRTUAL_ROWS_MIN = 1000 };
 };
 
 #endif // MM_EX_REPORTTRANSACT_H_
@@ -807,33 +807,16 @@ void mmStockDialog::OnHistoryDownloadButton(wxCommandEvent& /*event*/)
             history[time] = rate;
         }
 
-        const wxString today = wxDate::Today().FormatISODate();
-        Model_StockHistory::instance().Savepoint();
+        const wxDate today = wxDate::Today();
+        std::map<wxDate, double> prices;
         for (const auto& entry : history)
         {
-            float dPrice = entry.second;
-            const wxString date_str = wxDateTime(static_cast<time_t>(entry.first)).FormatISODate();
-            if (date_str == today) {
+            const wxDate date = wxDateTime(static_cast<time_t>(entry.first)).GetDateOnly();
+            if (date == today || entry.second <= 0)
                 continue;
-            }
-
-            if (Model_StockHistory::instance()
-                .find(
-                    Model_StockHistory::SYMBOL(m_stock->SYMBOL)
-                    , Model_StockHistory::DB_Table_STOCKHISTORY_V1::DATE(date_str)
-                ).empty()
-                && dPrice > 0
-                )
-            {
-                Model_StockHistory::Data* ndata = Model_StockHistory::instance().create();
-                ndata->SYMBOL = m_stock->SYMBOL;
-                ndata->DATE = date_str;
-                ndata->VALUE = dPrice;
-                ndata->UPDTYPE = Model_StockHistory::ONLINE;
-                Model_StockHistory::instance().save(ndata);
-            }
+            prices.insert(std::make_pair(date, entry.second));
         }
-        Model_StockHistory::instance().ReleaseSavepoint();
+        Model_StockHistory::instance().addUpdate(m_stock->SYMBOL, prices, Model_StockHistory::ONLINE, false);
         return ShowStockHistory();
     }
     mmErrorDialogs::MessageError(this, sOutput, _("Stock History Error"));
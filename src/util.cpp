@@ -24,6 +24,7 @@
 #pragma comment(lib,"wldap32.lib")
 #endif
 
+#include <algorithm>
 #include <map>
 #include <cwchar>
 #include <locale>
@@ -33,6 +34,7 @@
 #include <wx/sstream.h>
 #include <wx/xml/xml.h>
 #include <wx/fs_mem.h>
+#include <wx/thread.h>
 
 #include "build.h"
 #include "util.h"
@@ -346,98 +348,198 @@ const wxString mmGetTimeForDisplay(const wxString& datetime_iso)
     return (datetime_iso.Length() == 19) ? datetime_iso.Mid(11, 8) : wxString("00:00:00");
 }
 
-bool mmParseDisplayStringToDate(wxDateTime& date, const wxString& str_date, const wxString &sDateMask)
+namespace
 {
-    if (date_formats_regex().count(sDateMask) == 0)
-        return false;
 
-    wxString date_str = str_date;
-    wxString mask_str = sDateMask;
-
-    static std::unordered_map<wxString, wxDate> cache;
-    const auto it = cache.find(str_date);
-    if (it != cache.end())
+/*
+A mask of g_date_formats_map() compiled once into the fields to scan.
+Fields follow the patterns the masks were matched with so far: days and
+months take one or two digits (a leading zero or space allowed), %y one
+or two digits, %Y a year of 19xx or 20xx, %Mon a three letter month name,
+English or translated, and %w any three letters. A space in the mask
+matches any white space, other characters themselves. A digit must not
+follow the date. Parsing backtracks over the field widths, so masks
+without separators like %Y%m%d work, and does not allocate.
+*/
+class mmDateMask
+{
+public:
+    explicit mmDateMask(const wxString& mask);
+    bool ok() const { return m_ok; }
+    bool parse(const wxString& str, wxDateTime& date) const;
+
+private:
+    enum FIELD { DAY, MONTH, YEAR2, YEAR4, MONTH_NAME, WEEKDAY, SPACE, CHAR };
+    struct Field
     {
-        date = it->second;
-        return true;
-    }
-
-    wxString regex = date_formats_regex().at(mask_str);
-    wxRegEx pattern(regex);
-
-    if (pattern.Matches(str_date))
+        FIELD type;
+        wxUniChar c;
+    };
+    struct Value
     {
-        if (mask_str.Contains("%w")) {
-            mask_str.Replace("%w ", "");
-            regex = R"(^(\D*))";
-            pattern.Compile(regex);
-            pattern.ReplaceAll(&date_str, "");
-        }
+        int day, month, year;
+    };
+    bool scan(const wxString& str, size_t pos, size_t i, Value& value) const;
 
-        if (mask_str.Contains("Mon")) {
+    std::vector<Field> m_fields;
+    bool m_ok = true;
+};
 
-            static std::map<wxString, wxString> monCache;
-            if (monCache.empty())
-            {
-                int i = 1;
-                for (const auto& m : MONTHS_SHORT) {
-                    monCache[m] = wxString::Format("%02d", i);
-                    monCache[wxGetTranslation(m)] = wxString::Format("%02d", i);
-                    i++;
-                }
-            }
+struct MonthName
+{
+    wxString lower, upper;
+    int month;
+};
 
-            regex = R"([^\d\s\'\-]{3})";
-            pattern.Compile(regex);
-            wxString month;
-            if (pattern.Matches(date_str)) {
-                month = pattern.GetMatch(date_str);
+// English and translated short month names of three letters
+const std::vector<MonthName>& month_names()
+{
+    static const std::vector<MonthName> names = [] {
+        std::vector<MonthName> list;
+        for (int i = 0; i < 12; i++) {
+            for (const wxString& name : { MONTHS_SHORT[i], wxGetTranslation(MONTHS_SHORT[i]) }) {
+                if (name.length() == 3)
+                    list.push_back({ name.Lower(), name.Upper(), i + 1 });
             }
+        }
+        return list;
+    }();
+    return names;
+}
 
-            bool is_month_ok = false;
-            for (const auto& i : monCache)
-            {
-                if (month.CmpNoCase(i.first) == 0) {
-                    date_str.Replace(month, i.second);
-                    mask_str.Replace("%Mon", "%m");
-                    is_month_ok = true;
-                    break;
-                }
-            }
+bool is_digit(const wxUniChar& c) { return c >= '0' && c <= '9'; }
+int digit(const wxUniChar& c) { return static_cast<int>(c.GetValue() - '0'); }
+bool is_space(const wxUniChar& c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
 
-            if (!is_month_ok)
-                return false;
+mmDateMask::mmDateMask(const wxString& mask)
+{
+    for (size_t i = 0; i < mask.length(); i++)
+    {
+        if (mask[i] != '%') {
+            m_fields.push_back({ mask[i] == ' ' ? SPACE : CHAR, mask[i] });
+            continue;
+        }
+        if (mask.compare(i, 4, "%Mon") == 0) {
+            m_fields.push_back({ MONTH_NAME, ' ' });
+            i += 3;
+            continue;
+        }
+        const wxUniChar spec = i + 1 < mask.length() ? mask[++i] : wxUniChar(' ');
+        if (spec == 'd') m_fields.push_back({ DAY, spec });
+        else if (spec == 'm') m_fields.push_back({ MONTH, spec });
+        else if (spec == 'y') m_fields.push_back({ YEAR2, spec });
+        else if (spec == 'Y') m_fields.push_back({ YEAR4, spec });
+        else if (spec == 'w') m_fields.push_back({ WEEKDAY, spec });
+        else m_ok = false;
+    }
+}
 
-            wxRegEx pattern2(R"([^%dmyY])");
-            pattern2.ReplaceAll(&mask_str, " ");
-            if (date_formats_regex().find(mask_str) != date_formats_regex().end())
-                regex = date_formats_regex().at(mask_str);
-            else
-                return false;
+bool mmDateMask::scan(const wxString& str, size_t pos, size_t i, Value& value) const
+{
+    const size_t len = str.length();
+    if (i == m_fields.size())
+        return pos == len || !is_digit(str[pos]);
+    if (pos >= len)
+        return false;
 
-            wxRegEx pattern3(R"([^0-9])");
-            pattern3.ReplaceAll(&date_str, " ");
+    const Field& field = m_fields[i];
+    switch (field.type)
+    {
+    case DAY:
+    case MONTH:
+    case YEAR2:
+    {
+        const int max = field.type == DAY ? 31 : field.type == MONTH ? 12 : 99;
+        const int min = field.type == YEAR2 ? 0 : 1;
+        int& target = field.type == DAY ? value.day : field.type == MONTH ? value.month : value.year;
+        // two characters first, then one
+        if (pos + 1 < len && is_digit(str[pos + 1]) && (is_digit(str[pos]) || str[pos] == ' ')) {
+            target = (str[pos] == ' ' ? 0 : digit(str[pos]) * 10) + digit(str[pos + 1]);
+            if (target >= min && target <= max && scan(str, pos + 2, i + 1, value))
+                return true;
         }
-
-        pattern.Compile(regex);
-        if (pattern.Matches(date_str))
-        {
-            date_str = pattern.GetMatch(date_str);
-            date_str.Trim(false);
-            const auto& date_formats = g_date_formats_map();
-            const auto it2 = std::find_if(date_formats.begin(), date_formats.end(),
-                [&mask_str](const std::pair<wxString, wxString>& element) { return element.first == mask_str; });
-            if (!it2->second.Contains(" ")) {
-                date_str.Replace(" ", "");
+        if (!is_digit(str[pos]))
+            return false;
+        target = digit(str[pos]);
+        return target >= min && scan(str, pos + 1, i + 1, value);
+    }
+    case YEAR4:
+    {
+        if (pos + 4 > len)
+            return false;
+        for (size_t k = 0; k < 4; k++) {
+            if (!is_digit(str[pos + k]))
+                return false;
+        }
+        value.year = digit(str[pos]) * 1000 + digit(str[pos + 1]) * 100 + digit(str[pos + 2]) * 10 + digit(str[pos + 3]);
+        return value.year >= 1900 && value.year < 2100 && scan(str, pos + 4, i + 1, value);
+    }
+    case MONTH_NAME:
+    case WEEKDAY:
+    {
+        if (pos + 3 > len)
+            return false;
+        for (size_t k = 0; k < 3; k++) {
+            if (is_digit(str[pos + k]))
+                return false;
+        }
+        if (field.type == WEEKDAY)
+            return scan(str, pos + 3, i + 1, value);
+        for (const auto& name : month_names()) {
+            size_t k = 0;
+            while (k < 3 && (str[pos + k] == name.lower[k] || str[pos + k] == name.upper[k]))
+                k++;
+            if (k == 3) {
+                value.month = name.month;
+                return scan(str, pos + 3, i + 1, value);
             }
-
-            wxString::const_iterator end;
-            bool t = date.ParseFormat(date_str, mask_str, &end);
-            wxLogDebug("String:%s Mask:%s OK:%s ISO:%s Pattern:%s", str_date, sDateMask, wxString(t ? "true" : "false"), date.FormatISODate(), regex);
-            return t;
         }
+        return false;
+    }
+    case SPACE:
+        return is_space(str[pos]) && scan(str, pos + 1, i + 1, value);
+    default:
+        return str[pos] == field.c && scan(str, pos + 1, i + 1, value);
     }
-    return false;
+}
+
+bool mmDateMask::parse(const wxString& str, wxDateTime& date) const
+{
+    Value value = { 0, 0, 0 };
+    if (!m_ok || !scan(str, 0, 0, value))
+        return false;
+
+    for (const auto& field : m_fields) {
+        // the two digit years roll over like wxDateTime::ParseFormat()
+        if (field.type == YEAR2)
+            value.year += value.year > 30 ? 1900 : 2000;
+    }
+
+    const wxDateTime::Month month = static_cast<wxDateTime::Month>(wxDateTime::Jan + value.month - 1);
+    if (value.day > wxDateTime::GetNumberOfDays(month, value.year))
+        return false;
+    date.Set(static_cast<wxDateTime::wxDateTime_t>(value.day), month, value.year);
+    return true;
+}
+
+const std::map<wxString, mmDateMask>& date_masks()
+{
+    static const std::map<wxString, mmDateMask> masks = [] {
+        std::map<wxString, mmDateMask> list;
+        for (const auto& entry : g_date_formats_map())
+            list.insert(std::make_pair(entry.first, mmDateMask(entry.first)));
+        return list;
+    }();
+    return masks;
+}
+
+}
+
+bool mmParseDisplayStringToDate(wxDateTime& date, const wxString& str_date, const wxString &sDateMask)
+{
+    const auto& masks = date_masks();
+    const auto it = masks.find(sDateMask);
+    return it != masks.end() && it->second.parse(str_date, date);
 }
 
 const wxDateTime getUserDefinedFinancialYear(const bool prevDayRequired)
@@ -456,44 +558,6 @@ const wxDateTime getUserDefinedFinancialYear(const bool prevDayRequired)
     return financialYear;
 }
 
-const std::map<wxString, wxString> &date_formats_regex()
-{
-    static std::map<wxString, wxString> date_regex;
-
-    // If the map was already filled, return it.
-    if (!date_regex.empty())
-        return date_regex;
-
-    // First time this function is called, fill the map.
-    const wxString week = "([^0-9]{3})";
-    const wxString mon = "([^0-9]{3})";
-    const wxString dd = "((([0 ][1-9])|([1-2][0-9])|(3[0-1]))|([1-9]))";
-    const wxString mm = "((([0 ][1-9])|(1[0-2]))|([1-9]))";
-    const wxString yy = "(([ ][0-9])|([0-9]{1,2}))";
-    const wxString yyyy = "(((19)|([2]([0]{1})))([0-9]{2}))";
-    const wxString tail = "($|[^0-9])+";
-    const wxString head = "^";
-
-    for (const auto &entry : g_date_formats_map())
-    {
-        wxString regexp = entry.first;
-        regexp.Replace(".", R"([.])");
-        regexp.Replace("/", R"(\/)");
-        regexp.Replace(" ", R"(\s)");
-        regexp.Replace("%Mon", mon);
-        regexp.Replace("%w", week);
-        regexp.Replace("%d", dd);
-        regexp.Replace("%m", mm);
-        regexp.Replace("%Y", yyyy);
-        regexp.Replace("%y", yy);
-        regexp.Append(tail);
-        regexp.Prepend(head);
-        date_regex[entry.first] = regexp;
-    }
-
-    return date_regex;
-}
-
 bool comp(const std::pair<wxString, wxString>& a, const std::pair<wxString, wxString>& b)
 {
 
@@ -640,6 +704,8 @@ END_EVENT_TABLE()
 
 //--------------------------------------------------------------------
 
+static bool parseCoincapInfo(const wxString& symbol, const wxString& json_data, wxString& out_id, double& price_usd, wxString& output);
+
 bool getOnlineCurrencyRates(wxString& msg,const int64 curr_id, const bool used_only)
 {
     wxString base_currency_symbol;
@@ -679,25 +745,33 @@ bool getOnlineCurrencyRates(wxString& msg,const int64 curr_id, const bool used_o
 
     get_yahoo_prices(fiat, currency_data, base_currency_symbol, output, yahoo_price_type::FIAT);
 
-    // fallback to coincap if some currencies were not found
-    double usd_conv_rate = -1;
+    // fallback to coincap if some currencies were not found, all of them are searched at once
+    std::vector<wxString> coincap_symbols, coincap_urls;
     for (const auto & item : fiat)
     {
         if (currency_data.find(item.first) == currency_data.end() && !g_fiat_curr().Contains(item.first))
+        {
+            coincap_symbols.push_back(item.first);
+            coincap_urls.push_back(wxString::Format(mmex::weblink::CoinCapSearch, item.first));
+        }
+    }
+
+    // can't use coincap without USD, since all prices are in USD
+    const auto usd = coincap_symbols.empty() ? nullptr : Model_Currency::instance().GetCurrencyRecord("USD");
+    if (usd != nullptr)
+    {
+        std::vector<std::pair<CURLcode, wxString>> coincap_data;
+        http_get_data(coincap_urls, coincap_data);
+        for (size_t i = 0; i < coincap_symbols.size(); i++)
         {
             wxString coincap_id;
             wxString coincap_msg;
             double coincap_price_usd;
-            if (getCoincapInfoFromSymbol(item.first, coincap_id, coincap_price_usd, coincap_msg) && coincap_price_usd > 0) {
-                if (usd_conv_rate < 0) {
-                    auto usd = Model_Currency::instance().GetCurrencyRecord("USD");
-                    if (usd == nullptr) {
-                        break; // can't use coincap without USD, since all prices are in USD so give up
-                    }
-                    usd_conv_rate = usd->BASECONVRATE;
-                }
-
-                currency_data[item.first] = coincap_price_usd * usd_conv_rate;
+            if (coincap_data[i].first == CURLE_OK
+                && parseCoincapInfo(coincap_symbols[i], coincap_data[i].second, coincap_id, coincap_price_usd, coincap_msg)
+                && coincap_price_usd > 0)
+            {
+                currency_data[coincap_symbols[i]] = coincap_price_usd * usd->BASECONVRATE;
             }
         }
     }
@@ -753,13 +827,107 @@ bool getOnlineCurrencyRates(wxString& msg,const int64 curr_id, const bool used_o
 
 /* Currencies & stock prices */
 
+namespace
+{
+    // One quote of a Yahoo quote response
+    struct YahooQuote
+    {
+        std::string symbol;
+        std::string currency;
+        double price = 0.0;
+        bool has_price = false;
+    };
+
+    /* Reads the quotes of a Yahoo response in one pass, without building a document:
+       {"quoteResponse":{"result":[{"currency":"USD","regularMarketPrice":173.57,"symbol":"AAPL",...}],"error":null}}
+       {"finance":{"result":null,"error":{"code":"Bad Request","description":"Missing required query parameter=symbols"}}} */
+    class YahooQuoteHandler : public BaseReaderHandler<UTF8<>, YahooQuoteHandler>
+    {
+    public:
+        std::vector<YahooQuote> quotes;
+        std::string error;
+        bool has_result = false;
+
+        bool StartObject()
+        {
+            m_depth++;
+            if (m_in_result && m_depth == 4)
+                quotes.push_back(YahooQuote());
+            return true;
+        }
+        bool EndObject(SizeType)
+        {
+            m_depth--;
+            return true;
+        }
+        bool StartArray()
+        {
+            m_depth++;
+            if (m_depth == 3 && m_top == "quoteResponse" && m_section == "result")
+                m_in_result = has_result = true;
+            return true;
+        }
+        bool EndArray(SizeType)
+        {
+            if (m_depth == 3)
+                m_in_result = false;
+            m_depth--;
+            return true;
+        }
+        bool Key(const char* str, SizeType length, bool)
+        {
+            if (m_depth == 1)
+                m_top.assign(str, length);
+            else if (m_depth == 2)
+                m_section.assign(str, length);
+            m_key.assign(str, length);
+            return true;
+        }
+        bool String(const char* str, SizeType length, bool)
+        {
+            if (m_in_result && m_depth == 4 && !quotes.empty())
+            {
+                if (m_key == "symbol")
+                    quotes.back().symbol.assign(str, length);
+                else if (m_key == "currency")
+                    quotes.back().currency.assign(str, length);
+            }
+            else if (m_depth == 3 && m_top == "finance" && m_section == "error" && m_key == "description")
+                error.assign(str, length);
+            return true;
+        }
+        bool Double(double d)
+        {
+            if (m_in_result && m_depth == 4 && !quotes.empty() && m_key == "regularMarketPrice")
+            {
+                quotes.back().price = d;
+                quotes.back().has_price = true;
+            }
+            return true;
+        }
+        bool Int(int i) { return Double(i); }
+        bool Uint(unsigned u) { return Double(u); }
+        bool Int64(int64_t i) { return Double(static_cast<double>(i)); }
+        bool Uint64(uint64_t u) { return Double(static_cast<double>(u)); }
+
+    private:
+        int m_depth = 0;
+        bool m_in_result = false;
+        std::string m_top;     // key in the root object
+        std::string m_section; // key in the object below it
+        std::string m_key;
+    };
+}
+
 bool get_yahoo_prices(std::map<wxString, double>& symbols
     , std::map<wxString, double>& out
     , const wxString& base_currency_symbol
     , wxString& output
     , int type)
 {
-    double conversion_factor = 1.0;
+    // Compiled once, prices are only refreshed on the GUI thread
+    static const wxRegEx symbol_pattern(R"(^([\^-a-zA-Z0-9_@=\.]+)$)");
+
     wxString buffer;
 
     wxString base_curr_symbol = base_currency_symbol;
@@ -771,8 +939,7 @@ bool get_yahoo_prices(std::map<wxString, double>& symbols
 
     for (const auto& entry : symbols)
     {
-        wxRegEx pattern(R"(^([\^-a-zA-Z0-9_@=\.]+)$)");
-        if (!pattern.Matches(entry.first))
+        if (!symbol_pattern.Matches(entry.first))
             continue;
 
         if (type == yahoo_price_type::FIAT) {
@@ -800,112 +967,82 @@ bool get_yahoo_prices(std::map<wxString, double>& symbols
         return false;
     }
 
-    Document json_doc;
-    if (json_doc.Parse(json_data.utf8_str()).HasParseError()) {
+    return parse_yahoo_prices(json_data, out, base_currency_symbol, output, type);
+}
+
+bool parse_yahoo_prices(const wxString& json_data
+    , std::map<wxString, double>& out
+    , const wxString& base_currency_symbol
+    , wxString& output
+    , int type)
+{
+    static const wxRegEx fiat_pattern("^([A-Z]{3})[A-Z]{3}=X$");
+    static const wxRegEx crypto_pattern("^([A-Z]{3,})-[A-Z]{3}$");
+
+    double conversion_factor = 1.0;
+    YahooQuoteHandler response;
+    Reader reader;
+    const wxScopedCharBuffer json_utf8 = json_data.utf8_str();
+    StringStream json_stream(json_utf8.data());
+    if (!reader.Parse(json_stream, response)) {
         output = _("JSON Parse Error");
         return false;
     }
 
-    /*
-    {"finance":{"result":null,"error":{"code":"Bad Request","description":"Missing required query parameter=symbols"}}}
-    */
-
-    if (json_doc.HasMember("finance") && json_doc["finance"].IsObject()) {
-        Value e = json_doc["finance"].GetObject();
-        if (e.HasMember("error")) {
-            if (e["error"].IsObject()) {
-                Value err = e["error"].GetObject();
-                if (err.HasMember("description") && err["description"].IsString()) {
-                    output = wxString::FromUTF8(err["description"].GetString());
-                    return false;
-                }
-            }
-        }
+    if (!response.error.empty()) {
+        output = wxString::FromUTF8(response.error.c_str());
+        return false;
     }
 
-    /*{"quoteResponse":{"result":[{"currency":"USD","regularMarketPrice":173.57,"shortName":"Apple Inc.","regularMarketTime":1683316804,"symbol":"AAPL"}],"error":null}}*/
+    if (!response.has_result) {
+        output = _("JSON Parse Error");
+        return false;
+    }
 
-    if (json_doc.HasMember("quoteResponse") && json_doc["quoteResponse"].IsObject()) {
-        Value r = json_doc["quoteResponse"].GetObject();
-        if (r.HasMember("result") && r["result"].IsArray()) {
-            Value e = r["result"].GetArray();
+    if (response.quotes.empty()) {
+        output = _("Nothing to update");
+        return false;
+    }
 
-            if (e.Empty()) {
-                output = _("Nothing to update");
-                return false;
-            }
+    for (const auto& quote : response.quotes)
+    {
+        if (quote.symbol.empty())
+            continue;
+        wxString symbol = wxString::FromUTF8(quote.symbol.c_str());
 
-            if (type == yahoo_price_type::FIAT)
+        if (type == yahoo_price_type::FIAT)
+        {
+            double price = 0.0;
+            if (fiat_pattern.Matches(symbol))
             {
-                for (rapidjson::SizeType i = 0; i < e.Size(); i++)
-                {
-                    if (!e[i].IsObject()) continue;
-                    Value v = e[i].GetObject();
-
-                    if (!v.HasMember("symbol") || !v["symbol"].IsString())
-                        continue;
-                    auto currency_symbol = wxString::FromUTF8(v["symbol"].GetString());
-
-                    double price = 0.0;
-                    wxRegEx pattern("^([A-Z]{3})[A-Z]{3}=X$");
-                    if (pattern.Matches(currency_symbol))
-                    {
-                        if (!v.HasMember("regularMarketPrice") || !v["regularMarketPrice"].IsFloat())
-                            continue;
-                        price = v["regularMarketPrice"].GetFloat();
-                        currency_symbol = pattern.GetMatch(currency_symbol, 1);
-                    }
-                    wxRegEx crypto_pattern("^([A-Z]{3,})-[A-Z]{3}$");
-                    if (crypto_pattern.Matches(currency_symbol))
-                    {
-                        if (!v.HasMember("regularMarketPrice") || !v["regularMarketPrice"].IsFloat())
-                            continue;
-                        price = v["regularMarketPrice"].GetFloat();
-                        currency_symbol = crypto_pattern.GetMatch(currency_symbol, 1);
-                    }
-
-                    if (currency_symbol == base_currency_symbol)
-                        conversion_factor = price;
-                    else
-                        out[currency_symbol] = (price <= 0.0 ? 0.0 : price);
-
-                }
+                if (!quote.has_price)
+                    continue;
+                price = quote.price;
+                symbol = fiat_pattern.GetMatch(symbol, 1);
             }
-            else
+            if (crypto_pattern.Matches(symbol))
             {
-                for (rapidjson::SizeType i = 0; i < e.Size(); i++)
-                {
-                    if (!e[i].IsObject()) continue;
-                    Value v = e[i].GetObject();
-
-                    if (!v.HasMember("regularMarketPrice") || !v["regularMarketPrice"].IsFloat())
-                        continue;
-                    auto price = v["regularMarketPrice"].GetFloat();
-
-                    if (!v.HasMember("symbol") || !v["symbol"].IsString())
-                        continue;
-                    const auto symbol = wxString::FromUTF8(v["symbol"].GetString());
-
-                    if (!v.HasMember("currency") || !v["currency"].IsString())
-                        continue;
-                    const auto currency = wxString::FromUTF8(v["currency"].GetString());
-                    double k = currency == "GBp" ? 100 : 1;
-
-                    wxLogDebug("item: %u %s %f", i, symbol, price);
-                    out[symbol] = price <= 0 ? 0 : price / k;
-                }
+                if (!quote.has_price)
+                    continue;
+                price = quote.price;
+                symbol = crypto_pattern.GetMatch(symbol, 1);
             }
+
+            if (symbol == base_currency_symbol)
+                conversion_factor = price;
+            else
+                out[symbol] = (price <= 0.0 ? 0.0 : price);
         }
-        else {
-            output = _("JSON Parse Error");
-            return false;
+        else
+        {
+            if (!quote.has_price || quote.currency.empty())
+                continue;
+            double k = quote.currency == "GBp" ? 100 : 1;
+
+            wxLogDebug("item: %s %f", symbol, quote.price);
+            out[symbol] = quote.price <= 0 ? 0 : quote.price / k;
         }
     }
-    else
-    {
-        output = _("JSON Parse Error");
-        return false;
-    }
 
     for (auto& item : out)
     {
@@ -932,6 +1069,10 @@ bool getCoincapInfoFromSymbol(const wxString& symbol, wxString& out_id, double&
         return false;
     }
 
+    return parseCoincapInfo(symbol, json_data, out_id, price_usd, output);
+}
+
+static bool parseCoincapInfo(const wxString& symbol, const wxString& json_data, wxString& out_id, double& price_usd, wxString& output) {
     Document json_doc;
     if (json_doc.Parse(json_data.utf8_str()).HasParseError()) {
         output = _("JSON Parse Error");
@@ -1132,7 +1273,59 @@ static int log_libcurl_debug(CURL *handle,const curl_infotype type, char *data,c
 }
 #endif
 
+/* All transfers share one DNS cache and TLS session cache, so a request to a
+   host seen before skips the lookup and resumes the TLS session. Transfers may
+   run on other threads, hence the locks. The connection pool is not shared,
+   curl does not support using its connections from several threads. */
+namespace
+{
+    wxMutex g_curl_share_mutex;
+    wxMutex g_curl_share_locks[CURL_LOCK_DATA_LAST];
+    CURLSH* g_curl_share = nullptr;
+
+    void curlShareLock(CURL*, curl_lock_data data, curl_lock_access, void*)
+    {
+        g_curl_share_locks[data].Lock();
+    }
+
+    void curlShareUnlock(CURL*, curl_lock_data data, void*)
+    {
+        g_curl_share_locks[data].Unlock();
+    }
+}
+
+static CURLSH* curl_get_share()
+{
+    wxMutexLocker lock(g_curl_share_mutex);
+    if (!g_curl_share)
+    {
+        g_curl_share = curl_share_init();
+        if (g_curl_share)
+        {
+            curl_share_setopt(g_curl_share, CURLSHOPT_LOCKFUNC, curlShareLock);
+            curl_share_setopt(g_curl_share, CURLSHOPT_UNLOCKFUNC, curlShareUnlock);
+            curl_share_setopt(g_curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(g_curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+    }
+    return g_curl_share;
+}
+
+void http_cleanup()
+{
+    wxMutexLocker lock(g_curl_share_mutex);
+    if (g_curl_share)
+    {
+        curl_share_cleanup(g_curl_share);
+        g_curl_share = nullptr;
+    }
+}
+
 void curl_set_common_options(CURL* curl, const wxString& useragent = wxEmptyString) {
+    CURLSH* share = curl_get_share();
+    if (share)
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+
     wxString proxyName = Model_Setting::instance().getString("PROXYIP", "");
     if (!proxyName.IsEmpty())
     {
@@ -1191,6 +1384,96 @@ CURLcode http_get_data(const wxString& sSite, wxString& sOutput, const wxString&
     return err_code;
 }
 
+void http_get_data(const std::vector<wxString>& sites, std::vector<std::pair<CURLcode, wxString>>& outputs)
+{
+    outputs.assign(sites.size(), std::make_pair(CURLE_FAILED_INIT, wxString(curl_easy_strerror(CURLE_FAILED_INIT))));
+    if (sites.empty())
+        return;
+
+    CURLM* multi = curl_multi_init();
+    if (!multi)
+    {
+        for (size_t i = 0; i < sites.size(); i++)
+            outputs[i].first = http_get_data(sites[i], outputs[i].second);
+        return;
+    }
+
+    // At most this many transfers run at once, the next one starts when one is done
+    const size_t max_transfers = static_cast<size_t>(std::max(1, Model_Setting::instance().getInt("NETWORKCONNECTIONS", 6)));
+    std::vector<curlBuff> chunks(sites.size(), curlBuff{ nullptr, 0 });
+    std::map<CURL*, size_t> transfers;
+    size_t next = 0;
+
+    auto start = [&]()
+    {
+        while (next < sites.size() && transfers.size() < max_transfers)
+        {
+            const size_t i = next++;
+            CURL* curl = curl_easy_init();
+            if (!curl)
+                continue;
+            curl_set_common_options(curl);
+            curl_set_writedata_options(curl, chunks[i]);
+            curl_easy_setopt(curl, CURLOPT_URL, static_cast<const char*>(sites[i].mb_str()));
+            if (curl_multi_add_handle(multi, curl) != CURLM_OK)
+            {
+                curl_easy_cleanup(curl);
+                continue;
+            }
+            transfers[curl] = i;
+        }
+    };
+    auto finish = [&](CURL* curl, CURLcode err_code)
+    {
+        const size_t i = transfers[curl];
+        transfers.erase(curl);
+        curl_multi_remove_handle(multi, curl);
+        curl_easy_cleanup(curl);
+
+        outputs[i].first = err_code;
+        if (err_code == CURLE_OK)
+            outputs[i].second = wxString::FromUTF8(chunks[i].memory);
+        else {
+            outputs[i].second = curl_easy_strerror(err_code); //TODO: translation
+            wxLogDebug("http_get_data: URL = %s error = %s", sites[i], outputs[i].second);
+        }
+    };
+
+    start();
+    while (!transfers.empty())
+    {
+        int running = 0;
+        CURLMcode mc = curl_multi_perform(multi, &running);
+        if (mc == CURLM_OK && running > 0)
+            mc = curl_multi_wait(multi, nullptr, 0, 1000, nullptr);
+        if (mc != CURLM_OK)
+        {
+            wxLogDebug("http_get_data: %s", curl_multi_strerror(mc));
+            break;
+        }
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued))
+        {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+            // msg does not outlive the removal of its handle
+            CURL* curl = msg->easy_handle;
+            const CURLcode err_code = msg->data.result;
+            finish(curl, err_code);
+        }
+        start();
+    }
+
+    // Left over after a failure of the multi handle
+    while (!transfers.empty())
+        finish(transfers.begin()->first, CURLE_FAILED_INIT);
+
+    curl_multi_cleanup(multi);
+    for (auto& chunk : chunks)
+        free(chunk.memory);
+}
+
 CURLcode http_post_data(const wxString& sSite, const wxString& sData, const wxString& sContentType, wxString& sOutput)
 {
     CURL *curl = curl_easy_init();
@@ -97,6 +97,14 @@ bool get_yahoo_prices(
     wxString& output,
     int type
 );
+/** Read the prices of a Yahoo quote response, the second half of get_yahoo_prices() */
+bool parse_yahoo_prices(
+    const wxString& json_data,
+    std::map<wxString, double>& out,
+    const wxString& base_currency_symbol,
+    wxString& output,
+    int type
+);
 bool getCoincapInfoFromSymbol(const wxString& symbol, wxString& out_id, double& price_usd, wxString& output);
 bool getCoincapAssetHistory(
     const wxString& asset_id, wxDateTime begin_date,
@@ -118,7 +126,6 @@ const wxRect GetDefaultMonitorRect();
 //* Date Functions----------------------------------------------------------*//
 
 const wxDateTime getUserDefinedFinancialYear(bool prevDayRequired = false);
-const std::map<wxString, wxString> &date_formats_regex();
 const wxString mmGetDateTimeForDisplay(const wxString &datetime_iso, const wxString& format = Option::instance().getDateFormat());
 const wxString mmGetDateForDisplay(const wxString &datetime_iso, const wxString& format = Option::instance().getDateFormat());
 const wxString mmGetTimeForDisplay(const wxString& datetime_iso);
@@ -129,9 +136,14 @@ extern const std::map<int, std::pair<wxConvAuto, wxString> > g_encoding;
 //----------------------------------------------------------------------------
 
 CURLcode http_get_data(const wxString& site, wxString& output, const wxString& useragent = wxEmptyString);
+// Fetches all the pages at once, with at most NETWORKCONNECTIONS transfers running.
+// The outputs are in the order of the sites, a failed one holds its error message.
+void http_get_data(const std::vector<wxString>& sites, std::vector<std::pair<CURLcode, wxString>>& outputs);
 CURLcode http_post_data(const wxString& site, const wxString& data, const wxString& contentType, wxString& output);
 CURLcode http_download_file(const wxString& site, const wxString& path);
 CURLcode getYahooFinanceQuotes(const wxString& URL, wxString& json_data);
+// Releases the connections kept open between requests
+void http_cleanup();
 
 //----------------------------------------------------------------------------
 
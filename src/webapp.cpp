@@ -26,7 +26,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "model/Model_Account.h"
 #include "model/Model_Attachment.h"
 #include "model/Model_Category.h"
+#include "model/Model_Checking.h"
 #include "model/Model_Infotable.h"
+#include <functional>
 
 //Expected WebAppVersion
 const wxString WebAppParam::ApiExpectedVersion = "1.0.1";
@@ -165,8 +167,8 @@ bool mmWebApp::WebApp_DeleteAllAccount()
     return mmWebApp::returnResult(ErrorCode, outputMessage);
 }
 
-// Update Account on WebApp
-bool mmWebApp::WebApp_UpdateAccount()
+// JSON list of the accounts shown on WebApp
+const std::string mmWebApp::WebApp_AccountList()
 {
     StringBuffer json_buffer;
     PrettyWriter<StringBuffer> json_writer(json_buffer);
@@ -190,14 +192,13 @@ bool mmWebApp::WebApp_UpdateAccount()
     json_writer.EndArray();
     json_writer.EndObject();
 
-    mmWebApp::WebApp_DeleteAllAccount();
-    wxString update_account_url = mmWebApp::getServicesPageURL() + "&" + WebAppParam::ImportAccount + "=true";
-    wxString json_account_list = /*wxString::FromUTF8*/(json_buffer.GetString());
-    wxString output_message;
-
-    int error_code = mmWebApp::WebApp_SendJson(update_account_url, json_account_list, output_message);
+    return json_buffer.GetString();
+}
 
-    return mmWebApp::returnResult(error_code, output_message);
+// Update Account on WebApp
+bool mmWebApp::WebApp_UpdateAccount()
+{
+    return mmWebApp::WebApp_SendList(SYNC_ACCOUNT, mmWebApp::WebApp_AccountList());
 }
 
 //Delete all payee on WebApp
@@ -209,8 +210,8 @@ bool mmWebApp::WebApp_DeleteAllPayee()
     return mmWebApp::returnResult(ErrorCode, outputMessage);
 }
 
-//Update payee on WebApp
-bool mmWebApp::WebApp_UpdatePayee()
+// JSON list of the payees with their default category
+const std::string mmWebApp::WebApp_PayeeList()
 {
     StringBuffer json_buffer;
     PrettyWriter<StringBuffer> json_writer(json_buffer);
@@ -264,13 +265,13 @@ bool mmWebApp::WebApp_UpdatePayee()
     json_writer.EndArray();
     json_writer.EndObject();
 
-    mmWebApp::WebApp_DeleteAllPayee();
-    wxString update_payee_url = mmWebApp::getServicesPageURL() + "&" + WebAppParam::ImportPayee + "=true";
-    wxString json_payee_list = /*wxString::FromUTF8*/(json_buffer.GetString());
-    wxString output_message;
-    int error_code = mmWebApp::WebApp_SendJson(update_payee_url, json_payee_list, output_message);
+    return json_buffer.GetString();
+}
 
-    return mmWebApp::returnResult(error_code, output_message);
+//Update payee on WebApp
+bool mmWebApp::WebApp_UpdatePayee()
+{
+    return mmWebApp::WebApp_SendList(SYNC_PAYEE, mmWebApp::WebApp_PayeeList());
 }
 
 //Delete all category on WebApp
@@ -282,8 +283,8 @@ bool mmWebApp::WebApp_DeleteAllCategory()
     return mmWebApp::returnResult(ErrorCode, outputMessage);
 }
 
-//Update category on WebApp
-bool mmWebApp::WebApp_UpdateCategory()
+// JSON list of the categories, one item for each subcategory
+const std::string mmWebApp::WebApp_CategoryList()
 {
     StringBuffer json_buffer;
     PrettyWriter<StringBuffer> json_writer(json_buffer);
@@ -338,13 +339,83 @@ bool mmWebApp::WebApp_UpdateCategory()
     json_writer.EndArray();
     json_writer.EndObject();
 
-    mmWebApp::WebApp_DeleteAllCategory();
-    wxString update_category_url = mmWebApp::getServicesPageURL() + "&" + WebAppParam::ImportCategory + "=true";
-    wxString category_list = /*wxString::FromUTF8*/(json_buffer.GetString());
+    return json_buffer.GetString();
+}
+
+//Update category on WebApp
+bool mmWebApp::WebApp_UpdateCategory()
+{
+    return mmWebApp::WebApp_SendList(SYNC_CATEGORY, mmWebApp::WebApp_CategoryList());
+}
+
+/* The WebApp only replaces a whole list, so what was last sent of each list
+   is remembered with the page it went to. A list equal to it is not sent again,
+   most changes in MMEX do not touch the lists at all. This is a skip of the
+   whole list by its hash, not a delta: a list with any change is deleted on
+   WebApp and sent again with all its entries. */
+namespace
+{
+    struct SentList
+    {
+        wxString page;
+        size_t hash = 0;
+        size_t size = 0;
+    };
+    SentList g_sent_lists[mmWebApp::SYNC_MAX];
+}
+
+//Check if the list is the one last sent to this WebApp
+bool mmWebApp::WebApp_IsSent(SyncList List, const std::string& Json)
+{
+    const SentList& sent = g_sent_lists[List];
+    return sent.size == Json.size() && sent.hash == std::hash<std::string>()(Json)
+        && sent.page == mmWebApp::getServicesPageURL();
+}
+
+//Replace a list on WebApp
+bool mmWebApp::WebApp_SendList(SyncList List, const std::string& Json)
+{
+    wxString import_param;
+    switch (List)
+    {
+    case SYNC_ACCOUNT:
+        mmWebApp::WebApp_DeleteAllAccount();
+        import_param = WebAppParam::ImportAccount;
+        break;
+    case SYNC_PAYEE:
+        mmWebApp::WebApp_DeleteAllPayee();
+        import_param = WebAppParam::ImportPayee;
+        break;
+    default:
+        mmWebApp::WebApp_DeleteAllCategory();
+        import_param = WebAppParam::ImportCategory;
+        break;
+    }
+
+    wxString update_url = mmWebApp::getServicesPageURL() + "&" + import_param + "=true";
+    wxString json_list = /*wxString::FromUTF8*/(Json.c_str());
     wxString output_message;
-    int error_code = mmWebApp::WebApp_SendJson(update_category_url, category_list, output_message);
+    int error_code = mmWebApp::WebApp_SendJson(update_url, json_list, output_message);
 
-    return mmWebApp::returnResult(error_code, output_message);
+    // After a failure the list on WebApp is unknown, it is sent next time
+    SentList& sent = g_sent_lists[List];
+    sent = SentList();
+    if (!mmWebApp::returnResult(error_code, output_message))
+        return false;
+    sent.page = mmWebApp::getServicesPageURL();
+    sent.hash = std::hash<std::string>()(Json);
+    sent.size = Json.size();
+    return true;
+}
+
+//Send a list changed since it was last sent, all of it, or nothing when its hash is the same
+bool mmWebApp::WebApp_SyncList(SyncList List, const std::string& Json)
+{
+    if (mmWebApp::WebApp_IsSent(List, Json))
+        return true;
+    if (mmWebApp::WebApp_CheckGuid() && mmWebApp::WebApp_CheckApiVersion())
+        return mmWebApp::WebApp_SendList(List, Json);
+    return false;
 }
 
 //Download new transactions
@@ -581,7 +652,18 @@ int64 mmWebApp::MMEX_InsertNewTransaction(webtran_holder& WebAppTrans)
     desktopNewTransaction->FOLLOWUPID = -1;
     desktopNewTransaction->TOTRANSAMOUNT = WebAppTrans.Amount;
     desktopNewTransaction->COLOR = -1;
+
+    // The index is kept between the transactions of a download, and rebuilt
+    // once the transactions table was changed by anything else
+    static mmDuplicateIndex duplicates;
+    static size_t duplicates_generation = 0;
+    if (duplicates_generation != Model_Checking::instance().table_generation())
+        duplicates.clear();
+    if (duplicates.take(*desktopNewTransaction))
+        desktopNewTransaction->STATUS = Model_Checking::STATUS_KEY_DUPLICATE;
+
     DeskNewTrID = Model_Checking::instance().save(desktopNewTransaction);
+    duplicates_generation = Model_Checking::instance().table_generation();
 
     if (DeskNewTrID > 0)
     {
@@ -708,41 +790,20 @@ bool mmWebApp::WebApp_DownloadAttachment(wxString& AttachmentFileName, wxString&
 //Update account in MMEX
 bool mmWebApp::MMEX_WebApp_UpdateAccount()
 {
-    if (mmWebApp::WebApp_CheckEnabled())
-    {
-        if (mmWebApp::WebApp_CheckGuid() && mmWebApp::WebApp_CheckApiVersion())
-            return mmWebApp::WebApp_UpdateAccount();
-        else
-            return false;
-    }
-    else
-        return false;
+    return mmWebApp::WebApp_CheckEnabled()
+        && mmWebApp::WebApp_SyncList(SYNC_ACCOUNT, mmWebApp::WebApp_AccountList());
 }
 
 //Update payee in MMEX
 bool mmWebApp::MMEX_WebApp_UpdatePayee()
 {
-    if (mmWebApp::WebApp_CheckEnabled())
-    {
-        if (mmWebApp::WebApp_CheckGuid() && mmWebApp::WebApp_CheckApiVersion())
-            return mmWebApp::WebApp_UpdatePayee();
-        else
-            return false;
-    }
-    else
-        return false;
+    return mmWebApp::WebApp_CheckEnabled()
+        && mmWebApp::WebApp_SyncList(SYNC_PAYEE, mmWebApp::WebApp_PayeeList());
 }
 
 //Update category in MMEX
 bool mmWebApp::MMEX_WebApp_UpdateCategory()
 {
-    if (mmWebApp::WebApp_CheckEnabled())
-    {
-        if (mmWebApp::WebApp_CheckGuid() && mmWebApp::WebApp_CheckApiVersion())
-            return mmWebApp::WebApp_UpdateCategory();
-        else
-            return false;
-    }
-    else
-        return false;
+    return mmWebApp::WebApp_CheckEnabled()
+        && mmWebApp::WebApp_SyncList(SYNC_CATEGORY, mmWebApp::WebApp_CategoryList());
 }
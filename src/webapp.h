@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #ifndef MM_EX_WEBAPP_H_
 #define MM_EX_WEBAPP_H_
 
+#include <string>
 #include <vector>
 #include <wx/string.h>
 #include <wx/datetime.h>
@@ -60,6 +61,18 @@ class mmWebApp
     static bool WebApp_DeleteAllCategory();
     static wxString WebApp_DownloadOneAttachment(const wxString& AttachmentName, int64 DesktopTransactionID, int AttachmentNr, wxString& Error);
 
+public:
+    /** Lists kept on WebApp */
+    enum SyncList { SYNC_ACCOUNT = 0, SYNC_PAYEE, SYNC_CATEGORY, SYNC_MAX };
+
+private:
+    const static std::string WebApp_AccountList();
+    const static std::string WebApp_PayeeList();
+    const static std::string WebApp_CategoryList();
+    static bool WebApp_IsSent(SyncList List, const std::string& Json);
+    static bool WebApp_SendList(SyncList List, const std::string& Json);
+    static bool WebApp_SyncList(SyncList List, const std::string& Json);
+
 public:
     const static wxString getUrl();
     const static wxString getGuid();
@@ -115,6 +128,7 @@ public:
     static bool WebApp_DownloadAttachment(wxString& AttachmentFileName, wxString& Error);
 
     //FUNCTIONS CALLED IN MMEX TO UPDATE ON CHANGE
+    //A list is only sent when it differs from the one last sent in this session
     /** Update all payees on WebApp if enabled */
     static bool MMEX_WebApp_UpdatePayee();
 
@@ -0,0 +1,108 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* Columnar export against the JSON export of the same transactions: time to
+* write, file size and time to read the file back.
+*
+*   bench_columnar [transactions]
+*/
+
+#include "testing.h"
+#include "phasetimer.h"
+#include "import_export/columnar.h"
+#include "import_export/export.h"
+#include "model/allmodel.h"
+#include <cstdio>
+#include <wx/ffile.h>
+#include <wx/filename.h>
+
+int main(int argc, char* argv[])
+{
+    const int rows = static_cast<int>(mmTestArg(argc, argv, 1, 1000000));
+
+    mmTestEnvironment env;
+    mmTestData data;
+    data.addTransactions(data.addAccount("Checking"), rows, 500, 10);
+
+    const auto splits = Model_Splittransaction::instance().get_all();
+    const auto tags = Model_Taglink::instance().get_all(Model_Attachment::REFTYPE_STR_TRANSACTION);
+    const Model_Checking::Split_Data_Set no_splits;
+    const Model_Checking::Taglink_Data_Set no_tags;
+    const auto transactions = Model_Checking::instance().all(Model_Checking::COL_TRANSID);
+
+    mmPhaseTimer columnar_timer("Columnar");
+    columnar_timer.start("export");
+    mmColumnarExport exporter;
+    for (const auto& r : transactions)
+    {
+        const auto s = splits.find(r.TRANSID);
+        const auto t = tags.find(r.TRANSID);
+        exporter.add(r, s != splits.end() ? s->second : no_splits, t != tags.end() ? t->second : no_tags);
+    }
+    const wxString columnar_file = env.tempFile("bench_columnar.mmcol");
+    MM_CHECK(exporter.save(columnar_file));
+    columnar_timer.start("load");
+    mmColumnarImport importer;
+    MM_CHECK(importer.load(columnar_file));
+    MM_CHECK(importer.rows() == transactions.size());
+    columnar_timer.add_rows(transactions.size());
+    columnar_timer.stop();
+
+    // the same rows as mmQIFExportDialog writes them
+    mmPhaseTimer json_timer("JSON");
+    json_timer.start("export");
+    StringBuffer json_buffer;
+    {
+        PrettyWriter<StringBuffer> json_writer(json_buffer);
+        json_writer.StartObject();
+        json_writer.Key("TRANSACTIONS");
+        json_writer.StartArray();
+        for (const auto& r : transactions)
+        {
+            Model_Checking::Full_Data full_tran(r, splits, tags);
+            mmExportTransaction::getTransactionJSON(json_writer, full_tran);
+        }
+        json_writer.EndArray();
+        json_writer.EndObject();
+    }
+    const wxString json_file = env.tempFile("bench_columnar.json");
+    wxFFile out(json_file, "wb");
+    out.Write(json_buffer.GetString(), json_buffer.GetSize());
+    out.Close();
+    json_timer.start("load");
+    wxFFile in(json_file, "rb");
+    std::string text(static_cast<size_t>(in.Length()), '\0');
+    in.Read(&text[0], text.size());
+    Document json_doc;
+    json_doc.Parse(text.c_str());
+    MM_CHECK(!json_doc.HasParseError());
+    MM_CHECK(json_doc["TRANSACTIONS"].Size() == transactions.size());
+    json_timer.add_rows(transactions.size());
+    json_timer.stop();
+
+    const wxULongLong columnar_size = wxFileName::GetSize(columnar_file);
+    const wxULongLong json_size = wxFileName::GetSize(json_file);
+    MM_CHECK(columnar_size < json_size);
+
+    std::printf("%s\n", columnar_timer.summary().utf8_str().data());
+    std::printf("%s\n", json_timer.summary().utf8_str().data());
+    std::printf("file size: columnar %s bytes, JSON %s bytes\n"
+        , columnar_size.ToString().utf8_str().data(), json_size.ToString().utf8_str().data());
+    std::printf("peak RSS: %zu KiB\n", mmTestPeakRSS());
+
+    return mmTestResult();
+}
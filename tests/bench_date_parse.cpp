@@ -0,0 +1,231 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* mmParseDisplayStringToDate() against the wxRegEx parse it replaced, for
+* every mask of g_date_formats_map(). The compiled masks have to give the
+* dates the strings were written from, and the same dates as the regex parse
+* wherever it reads them. The speedup is reported, it is only checked when a
+* minimum is given.
+*
+*   bench_date_parse [dates per mask] [minimum speedup, 0 for none]
+*/
+
+#include "testing.h"
+#include "util.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <wx/regex.h>
+
+namespace
+{
+    using std::chrono::steady_clock;
+
+    // the patterns of the masks as the regex parse built them
+    const std::map<wxString, wxString>& regex_patterns()
+    {
+        static std::map<wxString, wxString> date_regex;
+        if (!date_regex.empty())
+            return date_regex;
+
+        const wxString week = "([^0-9]{3})";
+        const wxString mon = "([^0-9]{3})";
+        const wxString dd = "((([0 ][1-9])|([1-2][0-9])|(3[0-1]))|([1-9]))";
+        const wxString mm = "((([0 ][1-9])|(1[0-2]))|([1-9]))";
+        const wxString yy = "(([ ][0-9])|([0-9]{1,2}))";
+        const wxString yyyy = "(((19)|([2]([0]{1})))([0-9]{2}))";
+
+        for (const auto& entry : g_date_formats_map())
+        {
+            wxString regexp = entry.first;
+            regexp.Replace(".", R"([.])");
+            regexp.Replace("/", R"(\/)");
+            regexp.Replace(" ", R"(\s)");
+            regexp.Replace("%Mon", mon);
+            regexp.Replace("%w", week);
+            regexp.Replace("%d", dd);
+            regexp.Replace("%m", mm);
+            regexp.Replace("%Y", yyyy);
+            regexp.Replace("%y", yy);
+            date_regex[entry.first] = "^" + regexp + "($|[^0-9])+";
+        }
+        return date_regex;
+    }
+
+    // the parse before the masks were compiled, a wxRegEx built on each call
+    bool parse_regex(wxDateTime& date, const wxString& str_date, const wxString& sDateMask)
+    {
+        if (regex_patterns().count(sDateMask) == 0)
+            return false;
+
+        wxString date_str = str_date;
+        wxString mask_str = sDateMask;
+        wxString regex = regex_patterns().at(mask_str);
+        wxRegEx pattern(regex);
+        if (!pattern.Matches(str_date))
+            return false;
+
+        if (mask_str.Contains("%w")) {
+            mask_str.Replace("%w ", "");
+            pattern.Compile(R"(^(\D*))");
+            pattern.ReplaceAll(&date_str, "");
+        }
+
+        if (mask_str.Contains("Mon")) {
+            static std::map<wxString, wxString> monCache;
+            if (monCache.empty())
+            {
+                int i = 1;
+                for (const auto& m : MONTHS_SHORT) {
+                    monCache[m] = wxString::Format("%02d", i);
+                    monCache[wxGetTranslation(m)] = wxString::Format("%02d", i);
+                    i++;
+                }
+            }
+
+            pattern.Compile(R"([^\d\s\'\-]{3})");
+            wxString month;
+            if (pattern.Matches(date_str))
+                month = pattern.GetMatch(date_str);
+
+            bool is_month_ok = false;
+            for (const auto& i : monCache)
+            {
+                if (month.CmpNoCase(i.first) == 0) {
+                    date_str.Replace(month, i.second);
+                    mask_str.Replace("%Mon", "%m");
+                    is_month_ok = true;
+                    break;
+                }
+            }
+            if (!is_month_ok)
+                return false;
+
+            wxRegEx pattern2(R"([^%dmyY])");
+            pattern2.ReplaceAll(&mask_str, " ");
+            if (regex_patterns().find(mask_str) == regex_patterns().end())
+                return false;
+            regex = regex_patterns().at(mask_str);
+
+            wxRegEx pattern3(R"([^0-9])");
+            pattern3.ReplaceAll(&date_str, " ");
+        }
+
+        pattern.Compile(regex);
+        if (!pattern.Matches(date_str))
+            return false;
+
+        date_str = pattern.GetMatch(date_str);
+        date_str.Trim(false);
+        const auto& date_formats = g_date_formats_map();
+        const auto it = std::find_if(date_formats.begin(), date_formats.end(),
+            [&mask_str](const std::pair<wxString, wxString>& element) { return element.first == mask_str; });
+        if (it != date_formats.end() && !it->second.Contains(" "))
+            date_str.Replace(" ", "");
+
+        wxString::const_iterator end;
+        return date.ParseFormat(date_str, mask_str, &end);
+    }
+
+    // the date written with the mask, month and weekday names in English
+    wxString format(const wxDateTime& date, const wxString& mask)
+    {
+        wxString format_mask = mask;
+        format_mask.Replace("%Mon", MONTHS_SHORT[date.GetMonth()]);
+        format_mask.Replace("%w", wxDateTime::GetEnglishWeekDayName(date.GetWeekDay(), wxDateTime::Name_Abbr));
+        return date.Format(format_mask);
+    }
+
+    typedef bool (*parse_function)(wxDateTime&, const wxString&, const wxString&);
+
+    // seconds to parse the strings, the number of them giving their date
+    double run(parse_function parse, const std::vector<wxString>& strings
+        , const std::vector<wxDateTime>& dates, const wxString& mask, size_t& correct)
+    {
+        correct = 0;
+        const auto begin = steady_clock::now();
+        for (size_t i = 0; i < strings.size(); i++)
+        {
+            wxDateTime date;
+            if (parse(date, strings[i], mask) && date.IsSameDate(dates[i]))
+                correct++;
+        }
+        return std::chrono::duration<double>(steady_clock::now() - begin).count();
+    }
+
+    // the strings the regex parse reads as their date and the compiled masks do not
+    size_t disagreements(const std::vector<wxString>& strings, const std::vector<wxDateTime>& dates, const wxString& mask)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < strings.size(); i++)
+        {
+            wxDateTime regex_date, compiled_date;
+            if (!parse_regex(regex_date, strings[i], mask) || !regex_date.IsSameDate(dates[i]))
+                continue;
+            if (!mmParseDisplayStringToDate(compiled_date, strings[i], mask) || !compiled_date.IsSameDate(regex_date))
+                count++;
+        }
+        return count;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int count = static_cast<int>(mmTestArg(argc, argv, 1, 10000));
+    const long min_speedup = mmTestArg(argc, argv, 2, 0);
+
+    mmTestEnvironment env;
+
+    // 1990 to 2029, the two digit years are read back with the pivot at 30
+    std::vector<wxDateTime> dates;
+    const wxDateTime start(1, wxDateTime::Jan, 1990);
+    const int days = (wxDateTime(31, wxDateTime::Dec, 2029) - start).GetDays();
+    for (int i = 0; i < count; i++)
+        dates.push_back(start + wxDateSpan::Days(static_cast<int>((static_cast<long long>(i) * 7919) % days)));
+
+    double compiled_total = 0, regex_total = 0;
+    std::printf("%-16s %12s %12s %8s\n", "mask", "compiled ns", "regex ns", "speedup");
+    for (const auto& entry : g_date_formats_map())
+    {
+        const wxString& mask = entry.first;
+        std::vector<wxString> strings;
+        for (const auto& date : dates)
+            strings.push_back(format(date, mask));
+
+        size_t compiled_correct = 0, regex_correct = 0;
+        const double compiled = run(mmParseDisplayStringToDate, strings, dates, mask, compiled_correct);
+        const double regex = run(parse_regex, strings, dates, mask, regex_correct);
+        compiled_total += compiled;
+        regex_total += regex;
+
+        if (!MM_CHECK(compiled_correct == strings.size()))
+            std::fprintf(stderr, "%s: %zu of %zu dates\n", mask.utf8_str().data(), compiled_correct, strings.size());
+        const size_t differ = disagreements(strings, dates, mask);
+        if (!MM_CHECK(differ == 0))
+            std::fprintf(stderr, "%s: %zu dates read by the regex differ\n", mask.utf8_str().data(), differ);
+        std::printf("%-16s %12.0f %12.0f %7.1fx%s\n", mask.utf8_str().data()
+            , compiled * 1e9 / count, regex * 1e9 / count, regex / compiled
+            , regex_correct == strings.size() ? "" : " (regex misread some)");
+    }
+
+    const double speedup = regex_total / compiled_total;
+    std::printf("all %zu masks, %d dates each: %.1fx\n", g_date_formats_map().size(), count, speedup);
+    if (min_speedup > 0)
+        MM_CHECK(speedup >= min_speedup);
+
+    return mmTestResult();
+}
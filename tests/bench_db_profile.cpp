@@ -0,0 +1,114 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* The database profiles of mmDBWrapper::SetProfile() on plain and encrypted
+* files: a bulk import, the queries of the reports and single edits, each
+* saved on its own as the transaction dialog does.
+*
+*   bench_db_profile [transactions] [edits] [report rounds]
+*/
+
+#include "testing.h"
+#include "dbwrapper.h"
+#include "phasetimer.h"
+#include "model/allmodel.h"
+#include <cstdio>
+#include <wx/filename.h>
+
+namespace
+{
+    // the shape of the income and expense and the balance reports
+    const char* const REPORT_QUERIES[] = {
+        "SELECT substr(TRANSDATE, 1, 7), CATEGID, TRANSCODE, SUM(TRANSAMOUNT)"
+        " FROM CHECKINGACCOUNT_V1 WHERE DELETEDTIME IS NULL OR DELETEDTIME = ''"
+        " GROUP BY 1, 2, 3",
+        "SELECT t.PAYEEID, SUM(CASE WHEN t.TRANSCODE = 'Deposit' THEN t.TRANSAMOUNT ELSE -t.TRANSAMOUNT END)"
+        " FROM CHECKINGACCOUNT_V1 t WHERE t.TRANSDATE BETWEEN '2001-01-01' AND '2010-12-31'"
+        " GROUP BY t.PAYEEID",
+        "SELECT s.CATEGID, SUM(s.SPLITTRANSAMOUNT) FROM SPLITTRANSACTIONS_V1 s"
+        " JOIN CHECKINGACCOUNT_V1 t ON t.TRANSID = s.TRANSID GROUP BY s.CATEGID",
+    };
+
+    void run(mmTestEnvironment& env, bool encrypted, int profile
+        , int rows, int edits, int rounds)
+    {
+        const wxString name = wxString::Format("bench_db_profile_%s_%s.mmb"
+            , encrypted ? "encrypted" : "plain"
+            , profile == mmDBWrapper::PROFILE_PERFORMANCE ? "performance" : "safe");
+        const wxString path = mmTestTempPath(name);
+
+        // mmDBWrapper::Open applies the profile of the setting
+        Model_Setting::instance().setInt("DB_PROFILE", profile);
+        mmPhaseTimer timer(wxString::Format("%s, %s"
+            , encrypted ? "SQLCipher" : "plain"
+            , profile == mmDBWrapper::PROFILE_PERFORMANCE ? "performance" : "safe"));
+        timer.start("open");
+        env.open(path, encrypted ? "bench key" : "");
+        MM_CHECK(env.db()->IsEncrypted() == encrypted);
+
+        timer.start("import");
+        mmTestData data;
+        data.addTransactions(data.addAccount("Checking"), rows, 300, 10);
+
+        timer.start("reports");
+        int report_rows = 0;
+        for (int i = 0; i < rounds; i++)
+        {
+            for (const char* sql : REPORT_QUERIES)
+            {
+                wxSQLite3ResultSet q = env.db()->ExecuteQuery(sql);
+                while (q.NextRow())
+                    report_rows++;
+                q.Finalize();
+            }
+        }
+        MM_CHECK(report_rows > 0);
+
+        // each save its own transaction, synced as the profile says
+        timer.start("edits");
+        for (int i = 0; i < edits; i++)
+        {
+            Model_Checking::Data* trx = Model_Checking::instance().get(int64(1 + (i * 7919) % rows));
+            trx->NOTES = wxString::Format("Edit %d", i);
+            Model_Checking::instance().save(trx);
+        }
+        timer.stop();
+
+        wxSQLite3ResultSet mode = env.db()->ExecuteQuery("PRAGMA journal_mode");
+        const wxString journal = mode.Eof() ? "" : mode.GetAsString(0);
+        mode.Finalize();
+        std::printf("%s, journal %s, %s bytes\n", timer.summary().utf8_str().data()
+            , journal.utf8_str().data(), wxFileName::GetSize(path).ToString().utf8_str().data());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int rows = static_cast<int>(mmTestArg(argc, argv, 1, 200000));
+    const int edits = static_cast<int>(mmTestArg(argc, argv, 2, 1000));
+    const int rounds = static_cast<int>(mmTestArg(argc, argv, 3, 20));
+
+    mmTestEnvironment env;
+    for (bool encrypted : { false, true })
+    {
+        for (int profile : { mmDBWrapper::PROFILE_SAFE, mmDBWrapper::PROFILE_PERFORMANCE })
+            run(env, encrypted, profile, rows, edits, rounds);
+    }
+    std::printf("rows: %d, edits: %d, report rounds: %d\n", rows, edits, rounds);
+
+    return mmTestResult();
+}
@@ -0,0 +1,101 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* URLs of a stand-in server on the loopback interface fetched one after the
+* other with http_get_data(), and all of them at once through its multi
+* handle version, at most NETWORKCONNECTIONS transfers running together.
+* The server waits the delay before each reply, like a remote service does.
+*
+*   bench_http [urls] [delay ms]
+*/
+
+#include "testing.h"
+#include "phasetimer.h"
+#include "util.h"
+#include "model/Model_Setting.h"
+#include <cstdio>
+#include <string>
+#include <wx/utils.h>
+
+namespace
+{
+    // The path of the request, echoed as the body of the reply
+    std::string echo(const std::string& request)
+    {
+        const size_t begin = request.find(' ');
+        const size_t end = request.find(' ', begin + 1);
+        if (begin == std::string::npos || end == std::string::npos)
+            return "";
+        return request.substr(begin + 1, end - begin - 1);
+    }
+
+    // The number of replies echoing the path of their URL
+    size_t correct(const std::vector<wxString>& urls, const std::vector<std::pair<CURLcode, wxString>>& outputs)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < urls.size() && i < outputs.size(); i++)
+        {
+            if (outputs[i].first == CURLE_OK && urls[i].EndsWith(outputs[i].second))
+                count++;
+        }
+        return count;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int count = static_cast<int>(mmTestArg(argc, argv, 1, 60));
+    const int delay_ms = static_cast<int>(mmTestArg(argc, argv, 2, 50));
+
+    mmTestEnvironment env;
+    wxSetEnv("no_proxy", "127.0.0.1");
+    mmTestServer server(echo, delay_ms);
+    if (server.port() == 0)
+    {
+        std::printf("no stand-in server on this platform\n");
+        return 77; // skipped
+    }
+
+    std::vector<wxString> urls;
+    for (int i = 0; i < count; i++)
+        urls.push_back(server.url(wxString::Format("/quote/%d", i)));
+
+    std::vector<std::pair<CURLcode, wxString>> serial(urls.size());
+    mmPhaseTimer serial_timer("Serial");
+    serial_timer.start("fetch");
+    for (size_t i = 0; i < urls.size(); i++)
+        serial[i].first = http_get_data(urls[i], serial[i].second);
+    serial_timer.add_rows(urls.size());
+    serial_timer.stop();
+    MM_CHECK(correct(urls, serial) == urls.size());
+
+    std::vector<std::pair<CURLcode, wxString>> concurrent;
+    mmPhaseTimer multi_timer("Multi handle");
+    multi_timer.start("fetch");
+    http_get_data(urls, concurrent);
+    multi_timer.add_rows(urls.size());
+    multi_timer.stop();
+    MM_CHECK(correct(urls, concurrent) == urls.size());
+    MM_CHECK(server.requests() == 2 * urls.size());
+
+    std::printf("%d URLs, %d ms a reply, %d transfers at once\n", count, delay_ms
+        , Model_Setting::instance().getInt("NETWORKCONNECTIONS", 6));
+    std::printf("%s\n", serial_timer.summary().utf8_str().data());
+    std::printf("%s\n", multi_timer.summary().utf8_str().data());
+
+    return mmTestResult();
+}
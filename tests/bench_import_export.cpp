@@ -0,0 +1,270 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* Import and export throughput on generated QIF, CSV and XML files: the same
+* rows for the same arguments, written in each of the g_encoding encodings.
+* The files are imported into the database through the importers of the
+* dialogs (mmQIFImporter, mmCSVImporter with FileCSV and FileXML) and the
+* rows written back out through mmTransactionsExport, flushed to the file in
+* pieces as the export dialog does. Each part reports rows/s and its phase
+* times, peak RSS is reported at the end.
+*
+*   bench_import_export [rows] [split every n-th row] [payees]
+*/
+
+#include "testing.h"
+#include "phasetimer.h"
+#include "util.h"
+#include "import_export/csv_import.h"
+#include "import_export/export.h"
+#include "import_export/parsers.h"
+#include "import_export/qif_import.h"
+#include "model/allmodel.h"
+#include <cstdio>
+#include <memory>
+#include <wx/ffile.h>
+#include <wx/strconv.h>
+#include <wx/txtstrm.h>
+#include <wx/wfstream.h>
+
+namespace
+{
+    // The encodings of g_encoding, with a word each one can hold
+    struct Encoding
+    {
+        int key;
+        wxFontEncoding encoding;
+        const char* word; // UTF-8
+    };
+    const Encoding ENCODINGS[] = {
+        { 0, wxFONTENCODING_SYSTEM, "Shop" },
+        { 1, wxFONTENCODING_UTF8, "\xE2\x82\xAC\xE5\xBA\x97" },
+        { 2, wxFONTENCODING_CP1250, "Sklep \xC5\x82\xC3\xB3" },
+        { 3, wxFONTENCODING_CP1251, "\xD0\x9C\xD0\xB0\xD0\xB3" },
+        { 4, wxFONTENCODING_CP1252, "Caf\xC3\xA9" },
+        { 5, wxFONTENCODING_CP1253, "\xCE\xA9\xCE\xBC" },
+        { 6, wxFONTENCODING_CP1254, "Ma\xC4\x9Faza" },
+        { 7, wxFONTENCODING_CP1255, "\xD7\xA9\xD7\x95" },
+        { 8, wxFONTENCODING_CP1256, "\xD8\xB9\xD8\xB1" },
+        { 9, wxFONTENCODING_CP1257, "Parduotuv\xC4\x97" },
+    };
+
+    struct Corpus
+    {
+        int rows;
+        int split_every;
+        int payees;
+    };
+
+    void write_file(const wxString& file, const wxString& text, wxFontEncoding encoding)
+    {
+        wxCSConv conv(encoding);
+        const wxCharBuffer bytes = text.mb_str(conv);
+        wxFFile out(file, "wb");
+        out.Write(bytes.data(), bytes.length());
+    }
+
+    wxString payee_name(const Corpus& corpus, mmTestData& data, const Encoding& enc)
+    {
+        return wxString::Format("%s %u", wxString::FromUTF8(enc.word), data.next(static_cast<unsigned int>(corpus.payees)) + 1);
+    }
+
+    wxString qif_corpus(const Corpus& corpus, const Encoding& enc)
+    {
+        mmTestData data;
+        wxString text = "!Account\nNChecking\nTBank\n^\n!Type:Bank\n";
+        const wxDateTime start(1, wxDateTime::Jan, 2000);
+        for (int i = 0; i < corpus.rows; i++)
+        {
+            const unsigned int cents = 1 + data.next(100000);
+            text << "D" << (start + wxDateSpan::Days(i / 10)).Format("%m/%d/%Y") << "\n"
+                << "T-" << cents / 100 << "." << wxString::Format("%02u", cents % 100) << "\n"
+                << "P" << payee_name(corpus, data, enc) << "\n"
+                << "N" << i + 1 << "\n";
+            if (corpus.split_every > 0 && i % corpus.split_every == 0)
+            {
+                text << "LCategory " << data.next(50) << "\n";
+                for (int s = 0; s < 2; s++)
+                {
+                    const unsigned int part = s == 0 ? cents / 2 : cents - cents / 2;
+                    text << "SCategory " << data.next(50) << ":Sub " << s << "\n"
+                        << "$-" << part / 100 << "." << wxString::Format("%02u", part % 100) << "\n"
+                        << "EPart " << s << "\n";
+                }
+            }
+            else
+                text << "LCategory " << data.next(50) << ":Sub\n";
+            if (data.next(8) == 0)
+                text << "MNote " << data.next(1000) << "\n";
+            text << "^\n";
+        }
+        return text;
+    }
+
+    wxString csv_corpus(const Corpus& corpus, const Encoding& enc)
+    {
+        mmTestData data;
+        wxString text = "Date,Payee,Amount,Category,Notes\n";
+        const wxDateTime start(1, wxDateTime::Jan, 2000);
+        for (int i = 0; i < corpus.rows; i++)
+        {
+            const unsigned int cents = 1 + data.next(100000);
+            text << (start + wxDateSpan::Days(i / 10)).FormatISODate() << ","
+                << "\"" << payee_name(corpus, data, enc) << "\","
+                << "-" << cents / 100 << "." << wxString::Format("%02u", cents % 100) << ","
+                << "Category " << data.next(50) << ","
+                << "\"Note, " << data.next(1000) << "\"\n";
+        }
+        return text;
+    }
+
+    // mmQIFImportDialog without the dialog, the accounts, payees and categories of the file are created
+    class QIFImport : public mmQIFImporter
+    {
+    public:
+        size_t run(const wxString& file, const wxMBConv& conv, mmPhaseTimer& scan_timer, mmPhaseTimer& import_timer)
+        {
+            scan(file, conv, scan_timer);
+            matchPayees(nullptr);
+            return import(import_timer);
+        }
+        size_t transactions() const { return scanned(); }
+    };
+
+    // mmUnivCSVDialog without the dialog, the columns of csv_corpus() into one account
+    class TableImport : public mmCSVImporter
+    {
+    public:
+        explicit TableImport(int64 account_id)
+        {
+            accountID_ = account_id;
+            date_format_ = "%Y-%m-%d";
+            for (int field : { UNIV_CSV_DATE, UNIV_CSV_PAYEE, UNIV_CSV_AMOUNT, UNIV_CSV_CATEGORY, UNIV_CSV_NOTES })
+                csvFieldOrder_.push_back(std::make_pair(field, -1));
+        }
+        long run(ITransactionsFile& parser, const wxString& file, long firstRow
+            , const wxArrayString& payees, mmPhaseTimer& timer)
+        {
+            timer.start("open");
+            if (!parser.Open(file, static_cast<unsigned int>(csvFieldOrder_.size())))
+                return 0;
+            matchPayees(payees, nullptr);
+            // in one database transaction, as the dialog does
+            Model_Checking::instance().Begin();
+            const Totals totals = importRows(parser, firstRow, 0, timer);
+            Model_Checking::instance().Commit();
+            return totals.imported;
+        }
+    };
+
+    // every name payee_name() can give for the encoding
+    wxArrayString payee_names(const Corpus& corpus, const Encoding& enc)
+    {
+        wxArrayString names;
+        for (int i = 1; i <= corpus.payees; i++)
+            names.Add(wxString::Format("%s %d", wxString::FromUTF8(enc.word), i));
+        return names;
+    }
+
+    size_t export_file(int format, int64 account_id, const wxString& file, mmPhaseTimer& timer)
+    {
+        wxFileOutputStream output(file);
+        wxTextOutputStream text(output);
+        mmTransactionsExport exporter(format, { account_id }, "%Y-%m-%d", ",", &text);
+        MM_CHECK(exporter.write(false, true, timer));
+        timer.stop();
+        timer.add_rows(exporter.transactions());
+        return exporter.transactions();
+    }
+
+    void report(mmPhaseTimer& timer)
+    {
+        std::printf("%s\n", timer.summary().utf8_str().data());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Corpus corpus;
+    corpus.rows = static_cast<int>(mmTestArg(argc, argv, 1, 100000));
+    corpus.split_every = static_cast<int>(mmTestArg(argc, argv, 2, 10));
+    corpus.payees = static_cast<int>(mmTestArg(argc, argv, 3, 1000));
+    std::printf("%d rows, every %d-th split, %d payees\n", corpus.rows, corpus.split_every, corpus.payees);
+
+    mmTestEnvironment env;
+    const wxString qif_file = env.tempFile("bench_import.qif");
+    const wxString csv_file = env.tempFile("bench_import.csv");
+    const wxString xml_file = env.tempFile("bench_import.xml");
+
+    const size_t rows = static_cast<size_t>(corpus.rows);
+    mmTestData data;
+    const int64 csv_account = data.addAccount("CSV");
+    for (const auto& enc : ENCODINGS)
+    {
+        const auto& encoding = g_encoding.at(enc.key);
+        write_file(qif_file, qif_corpus(corpus, enc), enc.encoding);
+        mmPhaseTimer qif_scan(wxString::Format("QIF scan %s", encoding.second));
+        mmPhaseTimer qif_import(wxString::Format("QIF import %s", encoding.second));
+        QIFImport qif;
+        MM_CHECK(qif.run(qif_file, encoding.first, qif_scan, qif_import) == rows);
+        MM_CHECK(qif.transactions() == rows);
+        report(qif_scan);
+        report(qif_import);
+
+        write_file(csv_file, csv_corpus(corpus, enc), enc.encoding);
+        FileCSV csv(nullptr, encoding.first, ",");
+        mmPhaseTimer csv_timer(wxString::Format("CSV import %s", encoding.second));
+        TableImport table(csv_account);
+        MM_CHECK(table.run(csv, csv_file, 1, payee_names(corpus, enc), csv_timer) == corpus.rows);
+        report(csv_timer);
+    }
+
+    // XML spreadsheets are UTF-8, written by FileXML itself
+    {
+        FileXML writer(nullptr, "UTF-8");
+        mmTestData xml_data;
+        for (int i = 0; i < corpus.rows; i++)
+        {
+            writer.AddNewLine();
+            writer.AddNewItem(wxDateTime(1, wxDateTime::Jan, 2000).Add(wxDateSpan::Days(i / 10)).FormatISODate());
+            writer.AddNewItem(payee_name(corpus, xml_data, ENCODINGS[1]));
+            writer.AddNewItem(wxString::Format("-%u.%02u", xml_data.next(1000), xml_data.next(100)));
+            writer.AddNewItem(wxString::Format("Category %u", xml_data.next(50)));
+            writer.AddNewItem(wxString::Format("Note %u", xml_data.next(1000)));
+        }
+        MM_CHECK(writer.Save(xml_file));
+    }
+    FileXML xml(nullptr, "UTF-8");
+    mmPhaseTimer xml_timer("XML import");
+    TableImport table(csv_account);
+    MM_CHECK(table.run(xml, xml_file, 0, payee_names(corpus, ENCODINGS[1]), xml_timer) == corpus.rows);
+    report(xml_timer);
+
+    // Export of the same amount of transactions from the database
+    const int64 export_account = data.addAccount("Export");
+    data.addTransactions(export_account, corpus.rows, corpus.payees, corpus.split_every);
+    for (int format : { mmTransactionsExport::QIF, mmTransactionsExport::CSV })
+    {
+        const bool qif = format == mmTransactionsExport::QIF;
+        mmPhaseTimer timer(wxString::Format("%s export", qif ? "QIF" : "CSV"));
+        MM_CHECK(export_file(format, export_account, qif ? qif_file : csv_file, timer) == rows);
+        report(timer);
+    }
+
+    std::printf("peak RSS: %zu KiB\n", mmTestPeakRSS());
+    return mmTestResult();
+}
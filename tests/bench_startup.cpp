@@ -0,0 +1,140 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* Time to interactive of a large database, with the models attached eagerly
+* and lazily: the phases mmGUIFrame times on startup up to the home page and
+* the accounts of the navigation tree. The warm-up of the lazy models comes
+* after the first screen, it is not part of the time.
+*
+*   bench_startup [transactions] [rounds]
+*/
+
+#include "testing.h"
+#include "dbwrapper.h"
+#include "mmhomepage.h"
+#include "modelwarmup.h"
+#include "option.h"
+#include "phasetimer.h"
+#include "model/allmodel.h"
+#include <cstdio>
+
+namespace
+{
+    // the history and links the lazily attached models would read
+    void addLazyRows(int rows)
+    {
+        Model_Currency::Data* eur = Model_Currency::instance().GetCurrencyRecord("EUR");
+        std::map<wxDate, double> rates;
+        const wxDate start(1, wxDateTime::Jan, 2000);
+        for (int i = 0; i < rows / 100; i++)
+            rates[start + wxDateSpan::Days(i)] = 1.0 + (i % 50) / 100.0;
+        if (eur)
+            Model_CurrencyHistory::instance().addUpdate(eur->CURRENCYID, rates, Model_CurrencyHistory::ONLINE);
+
+        Model_Tag::Data* tag = Model_Tag::instance().create();
+        tag->TAGNAME = "startup";
+        tag->ACTIVE = 1;
+        Model_Tag::instance().save(tag);
+        Model_Taglink::Cache links;
+        for (int i = 1; i <= rows; i += 20)
+        {
+            Model_Taglink::Data* link = Model_Taglink::instance().create();
+            link->REFTYPE = Model_Attachment::REFTYPE_STR_TRANSACTION;
+            link->REFID = i;
+            link->TAGID = tag->TAGID;
+            links.push_back(link);
+        }
+        Model_Taglink::instance().save(links);
+    }
+
+    // what mmHomePagePanel::insertDataIntoTemplate() reads
+    void homePage()
+    {
+        double balance = 0.0, reconciled = 0.0;
+        htmlWidgetAccounts account_stats;
+        for (int type = Model_Account::TYPE_ID_CASH; type <= Model_Account::TYPE_ID_SHARES; type++)
+            account_stats.displayAccounts(balance, reconciled, type);
+        htmlWidgetStocks stocks_widget;
+        stocks_widget.getHTMLText();
+        htmlWidgetAssets assets;
+        assets.getHTMLText();
+        htmlWidgetIncomeVsExpenses income_vs_expenses;
+        income_vs_expenses.getHTMLText();
+        htmlWidgetBillsAndDeposits bills_and_deposits("Upcoming Transactions");
+        bills_and_deposits.getHTMLText();
+        htmlWidgetTop7Categories top_trx;
+        top_trx.getHTMLText();
+        htmlWidgetStatistics stat_widget;
+        stat_widget.getHTMLText();
+        htmlWidgetCurrency currency_rates;
+        currency_rates.getHtmlText();
+    }
+
+    wxString startup(const wxString& path, bool lazy)
+    {
+        mmPhaseTimer timer(lazy ? "Lazy startup" : "Eager startup");
+        timer.start("open");
+        wxSharedPtr<wxSQLite3Database> db = mmDBWrapper::Open(path);
+        timer.start("models");
+        const std::vector<ModelBase*> models = mmAttachModels(db.get(), lazy);
+        timer.start("options");
+        Option::instance().load();
+        timer.start("home page");
+        homePage();
+        timer.start("navigation");
+        const size_t accounts = Model_Account::instance().all(Model_Account::COL_ACCOUNTNAME).size();
+        timer.stop();
+        MM_CHECK(models.size() == 23);
+        MM_CHECK(accounts == 1);
+
+        // the queued warm-up is dropped, it is started by the frame only
+        mmModelWarmUp::instance().stop();
+        return timer.summary();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int rows = static_cast<int>(mmTestArg(argc, argv, 1, 1000000));
+    const int rounds = static_cast<int>(mmTestArg(argc, argv, 2, 3));
+
+    const wxString path = mmTestTempPath("bench_startup.mmb");
+    mmTestEnvironment env(path);
+    {
+        mmPhaseTimer timer("Database");
+        timer.start("transactions");
+        mmTestData data;
+        data.addTransactions(data.addAccount("Checking"), rows, 1000, 10);
+        timer.start("history and tags");
+        addLazyRows(rows);
+        timer.add_rows(rows);
+        timer.stop();
+        std::printf("%s\n", timer.summary().utf8_str().data());
+    }
+
+    // rounds of both, so neither is the only one with a cold page cache
+    for (int i = 0; i < rounds; i++)
+    {
+        for (bool lazy : { false, true })
+            std::printf("%s\n", startup(path, lazy).utf8_str().data());
+    }
+    std::printf("peak RSS: %zu KiB\n", mmTestPeakRSS());
+
+    // back on the connection of the environment before it closes
+    mmAttachModels(env.db(), false);
+    return mmTestResult();
+}
@@ -0,0 +1,234 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* Per symbol cost of reading Yahoo quote responses with parse_yahoo_prices(),
+* against the DOM parse with a wxRegEx compiled per quote it replaced. The
+* payloads are recorded responses, their quotes repeated under new symbols
+* to reach the larger sizes.
+*
+*   bench_yahoo_quotes [symbols] [rounds]
+*/
+
+#include "testing.h"
+#include "phasetimer.h"
+#include "util.h"
+#include <algorithm>
+#include <cstdio>
+#include <wx/math.h>
+#include <wx/regex.h>
+
+using namespace rapidjson;
+
+namespace
+{
+    // stock prices, one quoted in pence and one with an integer price
+    const char SHARES_RESPONSE[] =
+        R"({"quoteResponse":{"result":[)"
+        R"({"language":"en-US","region":"US","quoteType":"EQUITY","typeDisp":"Equity","quoteSourceName":"Nasdaq Real Time Price","triggerable":true,"customPriceAlertConfidence":"HIGH","currency":"USD","exchange":"NMS","shortName":"Apple Inc.","regularMarketPrice":173.57,"regularMarketTime":1683316804,"marketState":"CLOSED","symbol":"AAPL"},)"
+        R"({"language":"en-US","region":"US","quoteType":"EQUITY","typeDisp":"Equity","quoteSourceName":"Delayed Quote","triggerable":false,"customPriceAlertConfidence":"LOW","currency":"GBp","exchange":"LSE","shortName":"VODAFONE GROUP PLC","regularMarketPrice":97.24,"regularMarketTime":1683300875,"marketState":"CLOSED","symbol":"VOD.L"},)"
+        R"({"language":"en-US","region":"US","quoteType":"EQUITY","typeDisp":"Equity","quoteSourceName":"Delayed Quote","triggerable":false,"customPriceAlertConfidence":"LOW","currency":"EUR","exchange":"GER","shortName":"SAP SE","regularMarketPrice":122,"regularMarketTime":1683301390,"marketState":"CLOSED","symbol":"SAP.DE"})"
+        R"(],"error":null}})";
+
+    // currency and crypto currency rates of a USD base
+    const char FIAT_RESPONSE[] =
+        R"({"quoteResponse":{"result":[)"
+        R"({"language":"en-US","region":"US","quoteType":"CURRENCY","typeDisp":"Currency","quoteSourceName":"Delayed Quote","triggerable":true,"customPriceAlertConfidence":"HIGH","currency":"USD","exchange":"CCY","shortName":"EUR/USD","regularMarketPrice":1.1019,"regularMarketTime":1683323938,"marketState":"REGULAR","symbol":"EURUSD=X"},)"
+        R"({"language":"en-US","region":"US","quoteType":"CURRENCY","typeDisp":"Currency","quoteSourceName":"Delayed Quote","triggerable":true,"customPriceAlertConfidence":"HIGH","currency":"USD","exchange":"CCY","shortName":"GBP/USD","regularMarketPrice":1.2632,"regularMarketTime":1683323938,"marketState":"REGULAR","symbol":"GBPUSD=X"},)"
+        R"({"language":"en-US","region":"US","quoteType":"CRYPTOCURRENCY","typeDisp":"Cryptocurrency","quoteSourceName":"CoinMarketCap","triggerable":true,"customPriceAlertConfidence":"HIGH","currency":"USD","exchange":"CCC","shortName":"Bitcoin USD","regularMarketPrice":28950.5,"regularMarketTime":1683323880,"marketState":"REGULAR","symbol":"BTC-USD"})"
+        R"(],"error":null}})";
+
+    const char ERROR_RESPONSE[] =
+        R"({"finance":{"result":null,"error":{"code":"Bad Request","description":"Missing required query parameter=symbols"}}})";
+
+    /* The recorded quotes repeated until there are count of them, the copies
+       under new symbols: AAPL0001, VOD0001.L, EURUSD=X becomes AQAUSD=X, ... */
+    wxString grow(const char* response, int count, bool fiat)
+    {
+        const wxString text = wxString::FromUTF8(response);
+        const wxString head = text.BeforeFirst('[') + "[";
+        const wxString tail = "]" + text.AfterLast(']');
+
+        // the recorded quotes hold no nested objects
+        wxArrayString quotes;
+        for (size_t from = text.find('{', head.length()); from != wxString::npos; )
+        {
+            const size_t to = text.find('}', from);
+            quotes.Add(text.SubString(from, to));
+            from = text.find('{', to);
+        }
+
+        wxString result = head;
+        for (int i = 0; i < count; i++)
+        {
+            const int original = i % static_cast<int>(quotes.size());
+            const int copy = i / static_cast<int>(quotes.size());
+            wxString quote = quotes[original];
+            if (copy > 0)
+            {
+                // the symbol is the last member of the recorded quotes
+                const wxString symbol = quote.AfterLast(':').AfterFirst('"').BeforeFirst('"');
+                wxString renamed;
+                if (!fiat)
+                {
+                    renamed = wxString::Format("%s%04d", symbol.BeforeFirst('.'), copy);
+                    if (symbol.Contains("."))
+                        renamed += "." + symbol.AfterFirst('.');
+                }
+                else
+                {
+                    // still three capitals for the patterns, the middle one
+                    // apart from the recorded codes and between the originals
+                    const int n = copy - 1;
+                    renamed = wxString(wxUniChar('A' + n / 26)) + wxUniChar('Q' + original)
+                        + wxUniChar('A' + n % 26) + symbol.Mid(3);
+                }
+                quote.Replace("\"symbol\":\"" + symbol + "\"", "\"symbol\":\"" + renamed + "\"");
+            }
+            result += (i > 0 ? "," : "") + quote;
+        }
+        return result + tail;
+    }
+
+    // the parse before parse_yahoo_prices(), kept for reference
+    bool parse_dom(const wxString& json_data, std::map<wxString, double>& out
+        , const wxString& base_currency_symbol, wxString& output, int type)
+    {
+        Document json_doc;
+        if (json_doc.Parse(json_data.utf8_str()).HasParseError()) {
+            output = "JSON Parse Error";
+            return false;
+        }
+        if (json_doc.HasMember("finance") && json_doc["finance"].IsObject()) {
+            Value e = json_doc["finance"].GetObject();
+            if (e.HasMember("error") && e["error"].IsObject()) {
+                Value err = e["error"].GetObject();
+                if (err.HasMember("description") && err["description"].IsString()) {
+                    output = wxString::FromUTF8(err["description"].GetString());
+                    return false;
+                }
+            }
+        }
+        if (!json_doc.HasMember("quoteResponse") || !json_doc["quoteResponse"].IsObject())
+            return false;
+        Value r = json_doc["quoteResponse"].GetObject();
+        if (!r.HasMember("result") || !r["result"].IsArray())
+            return false;
+        Value e = r["result"].GetArray();
+
+        double conversion_factor = 1.0;
+        for (SizeType i = 0; i < e.Size(); i++)
+        {
+            if (!e[i].IsObject()) continue;
+            Value v = e[i].GetObject();
+            if (!v.HasMember("symbol") || !v["symbol"].IsString())
+                continue;
+            wxString symbol = wxString::FromUTF8(v["symbol"].GetString());
+            if (!v.HasMember("regularMarketPrice") || !v["regularMarketPrice"].IsNumber())
+                continue;
+            const double price = v["regularMarketPrice"].GetDouble();
+
+            if (type == yahoo_price_type::FIAT)
+            {
+                wxRegEx pattern("^([A-Z]{3})[A-Z]{3}=X$");
+                if (pattern.Matches(symbol))
+                    symbol = pattern.GetMatch(symbol, 1);
+                wxRegEx crypto_pattern("^([A-Z]{3,})-[A-Z]{3}$");
+                if (crypto_pattern.Matches(symbol))
+                    symbol = crypto_pattern.GetMatch(symbol, 1);
+                if (symbol == base_currency_symbol)
+                    conversion_factor = price;
+                else
+                    out[symbol] = (price <= 0.0 ? 0.0 : price);
+            }
+            else
+            {
+                if (!v.HasMember("currency") || !v["currency"].IsString())
+                    continue;
+                const double k = wxString(v["currency"].GetString()) == "GBp" ? 100 : 1;
+                out[symbol] = price <= 0 ? 0 : price / k;
+            }
+        }
+        for (auto& item : out)
+            item.second /= conversion_factor;
+        return true;
+    }
+
+    typedef bool (*parse_function)(const wxString&, std::map<wxString, double>&
+        , const wxString&, wxString&, int);
+
+    void run(mmPhaseTimer& timer, const char* phase, parse_function parse
+        , const wxString& payload, int symbols, int rounds, int type)
+    {
+        timer.start(phase);
+        for (int i = 0; i < rounds; i++)
+        {
+            std::map<wxString, double> out;
+            wxString output;
+            MM_CHECK(parse(payload, out, "USD", output, type));
+            MM_CHECK(out.size() == static_cast<size_t>(symbols));
+        }
+        timer.add_rows(static_cast<size_t>(symbols) * rounds);
+        timer.stop();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int symbols = static_cast<int>(mmTestArg(argc, argv, 1, 300));
+    const int rounds = static_cast<int>(mmTestArg(argc, argv, 2, 1000));
+
+    mmTestEnvironment env;
+
+    // the recorded payloads as they are
+    std::map<wxString, double> out;
+    wxString output;
+    MM_CHECK(parse_yahoo_prices(wxString::FromUTF8(SHARES_RESPONSE), out, "USD", output, yahoo_price_type::SHARES));
+    MM_CHECK(out.size() == 3);
+    MM_CHECK(wxIsSameDouble(out["AAPL"], 173.57));
+    MM_CHECK(wxIsSameDouble(out["VOD.L"], 0.9724));
+    MM_CHECK(wxIsSameDouble(out["SAP.DE"], 122.0));
+    out.clear();
+    MM_CHECK(parse_yahoo_prices(wxString::FromUTF8(FIAT_RESPONSE), out, "USD", output, yahoo_price_type::FIAT));
+    MM_CHECK(out.size() == 3);
+    MM_CHECK(wxIsSameDouble(out["EUR"], 1.1019));
+    MM_CHECK(wxIsSameDouble(out["BTC"], 28950.5));
+    out.clear();
+    MM_CHECK(!parse_yahoo_prices(wxString::FromUTF8(ERROR_RESPONSE), out, "USD", output, yahoo_price_type::SHARES));
+    MM_CHECK(output == "Missing required query parameter=symbols");
+    MM_CHECK(!parse_yahoo_prices("{\"quoteResponse\":", out, "USD", output, yahoo_price_type::SHARES));
+
+    // 26 * 26 copies of the three recorded rates at most
+    const int fiat_symbols = std::min(symbols, 3 * (1 + 26 * 26));
+    const wxString shares = grow(SHARES_RESPONSE, symbols, false);
+    const wxString fiat = grow(FIAT_RESPONSE, fiat_symbols, true);
+
+    mmPhaseTimer shares_timer("Shares, one pass");
+    run(shares_timer, "parse", parse_yahoo_prices, shares, symbols, rounds, yahoo_price_type::SHARES);
+    mmPhaseTimer shares_dom_timer("Shares, DOM");
+    run(shares_dom_timer, "parse", parse_dom, shares, symbols, rounds, yahoo_price_type::SHARES);
+    mmPhaseTimer fiat_timer("FIAT, one pass");
+    run(fiat_timer, "parse", parse_yahoo_prices, fiat, fiat_symbols, rounds, yahoo_price_type::FIAT);
+    mmPhaseTimer fiat_dom_timer("FIAT, DOM");
+    run(fiat_dom_timer, "parse", parse_dom, fiat, fiat_symbols, rounds, yahoo_price_type::FIAT);
+
+    std::printf("payload: %d shares in %zu bytes, %d rates in %zu bytes, %d rounds\n"
+        , symbols, shares.utf8_str().length(), fiat_symbols, fiat.utf8_str().length(), rounds);
+    for (mmPhaseTimer* timer : { &shares_timer, &shares_dom_timer, &fiat_timer, &fiat_dom_timer })
+        std::printf("%s\n", timer->summary().utf8_str().data());
+
+    return mmTestResult();
+}
@@ -0,0 +1,134 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* A snapshot of the backup store restores the database file byte for byte:
+* one added by mmBackupStore under a read transaction, one added by
+* dbUpgrade::BackupDB with the store on, and an older one after the file
+* changed. The snapshots share the chunks the changes left alone, removed
+* with the last snapshot using them.
+*
+*   test_backup_store [transactions]
+*/
+
+#include "testing.h"
+#include "backupstore.h"
+#include "dbupgrade.h"
+#include "dbwrapper.h"
+#include "model/allmodel.h"
+#include <vector>
+#include <wx/dir.h>
+#include <wx/ffile.h>
+#include <wx/filename.h>
+
+namespace
+{
+    std::vector<char> content(const wxString& fileName)
+    {
+        std::vector<char> bytes;
+        wxFFile file(fileName, "rb");
+        if (!file.IsOpened())
+            return bytes;
+        bytes.resize(static_cast<size_t>(file.Length()));
+        if (file.Read(bytes.data(), bytes.size()) != bytes.size())
+            bytes.clear();
+        return bytes;
+    }
+
+    // whether the snapshot restores the bytes, the restored file removed
+    bool restores(mmBackupStore& store, const wxString& name, const std::vector<char>& bytes, const wxString& fileName)
+    {
+        const bool ok = store.restore(name, fileName) && !bytes.empty() && content(fileName) == bytes;
+        wxRemoveFile(fileName);
+        return ok;
+    }
+
+    size_t chunks(const wxString& dbFileName)
+    {
+        wxArrayString files;
+        const wxString dir = dbFileName + ".store" + wxFileName::GetPathSeparator() + "chunks";
+        if (wxDirExists(dir))
+            wxDir::GetAllFiles(dir, &files, wxEmptyString, wxDIR_FILES | wxDIR_DIRS);
+        return files.size();
+    }
+
+    void removeStore(const wxString& dbFileName)
+    {
+        const wxString dir = dbFileName + ".store";
+        if (wxDirExists(dir))
+            wxFileName::Rmdir(dir, wxPATH_RMDIR_RECURSIVE);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int rows = static_cast<int>(mmTestArg(argc, argv, 1, 5000));
+
+    const wxString path = mmTestTempPath("test_backup_store.mmb");
+    removeStore(path);
+    mmTestEnvironment env(path);
+    mmTestData data;
+    const int64 account = data.addAccount("Checking");
+    data.addTransactions(account, rows, 100, 10);
+    const wxString restored = env.tempFile("test_backup_store_restored.mmb");
+
+    // added under a read transaction of a connection of its own
+    mmBackupStore store(path);
+    const std::vector<char> first = content(path);
+    {
+        wxSharedPtr<wxSQLite3Database> db = mmDBWrapper::OpenReadOnly(path);
+        if (!MM_CHECK(db))
+            return mmTestResult();
+        db->Begin();
+        db->ExecuteScalar("SELECT COUNT(*) FROM sqlite_master");
+        MM_CHECK(store.add(path, "first"));
+        db->Commit();
+        db->Close();
+    }
+    MM_CHECK(restores(store, "first", first, restored));
+    const size_t first_chunks = chunks(path);
+    MM_CHECK(first_chunks > 0);
+
+    // BackupDB with the store on adds the file as it is once the writes are done
+    data.addTransactions(account, rows / 10, 100);
+    const std::vector<char> second = content(path);
+    MM_CHECK(second != first);
+    const wxString name = wxString::Format("test_backup_store.mmb_start_%s", wxDateTime::Today().FormatISODate());
+    const wxString backup = env.tempFile(name + ".bak");
+    Model_Setting::instance().setBool("BACKUPDB_STORE", true);
+    dbUpgrade::BackupDB(path, dbUpgrade::BACKUPTYPE::START, 4);
+    dbUpgrade::WaitForBackup();
+    const wxArrayString names = store.snapshots();
+    MM_CHECK(names.size() == 2 && names[0] == "first" && names[1] == name);
+    MM_CHECK(restores(store, name, second, restored));
+    MM_CHECK(!wxFileExists(backup));
+
+    // the older snapshot is untouched, the new one only added the changed chunks
+    MM_CHECK(restores(store, "first", first, restored));
+    MM_CHECK(chunks(path) < 2 * first_chunks);
+
+    // and it is still whole once the newer one is removed
+    store.remove(wxArrayString(1, &name));
+    MM_CHECK(!restores(store, name, second, restored));
+    MM_CHECK(restores(store, "first", first, restored));
+    MM_CHECK(chunks(path) == first_chunks);
+    store.remove(wxArrayString(1, &names[0]));
+    MM_CHECK(chunks(path) == 0);
+
+    env.open(":memory:");
+    removeStore(path);
+    return mmTestResult();
+}
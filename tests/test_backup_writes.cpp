@@ -0,0 +1,87 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* A backup taken by dbUpgrade::BackupDB while the database is written is a
+* sound database holding a snapshot: every write is in it entirely or not
+* at all.
+*
+*   test_backup_writes [encrypted] [transactions] [writes]
+*/
+
+#include "testing.h"
+#include "dbupgrade.h"
+#include "dbwrapper.h"
+#include "model/allmodel.h"
+#include <cstdio>
+#include <wx/thread.h>
+
+int main(int argc, char* argv[])
+{
+    const bool encrypted = mmTestArg(argc, argv, 1, 0) != 0;
+    const int rows = static_cast<int>(mmTestArg(argc, argv, 2, 20000));
+    const int writes = static_cast<int>(mmTestArg(argc, argv, 3, 200));
+    const wxString key = encrypted ? "backup test" : "";
+
+    const wxString path = mmTestTempPath("test_backup_writes.mmb");
+    mmTestEnvironment env(path, key);
+    mmTestData data;
+    data.addTransactions(data.addAccount("Checking"), rows, 100, 10);
+
+    // each write adds a transaction and counts it in the same transaction
+    wxSQLite3Database* db = env.db();
+    db->ExecuteUpdate("CREATE TABLE TEST_WRITES (N INTEGER NOT NULL)");
+    db->ExecuteUpdate("INSERT INTO TEST_WRITES VALUES (0)");
+
+    // the name BackupDB gives the first backup of the day
+    const wxString backup = env.tempFile(wxString::Format("test_backup_writes.mmb_start_%s.bak"
+        , wxDateTime::Today().FormatISODate()));
+    dbUpgrade::BackupDB(path, dbUpgrade::BACKUPTYPE::START, 4, 0, key);
+
+    // the writes of the GUI thread, the backup steps go in between them
+    for (int i = 0; i < writes; i++)
+    {
+        db->Begin();
+        db->ExecuteUpdate("INSERT INTO CHECKINGACCOUNT_V1 (ACCOUNTID, PAYEEID, TRANSCODE, TRANSAMOUNT, STATUS, TRANSDATE)"
+            " SELECT ACCOUNTID, PAYEEID, TRANSCODE, TRANSAMOUNT, STATUS, TRANSDATE FROM CHECKINGACCOUNT_V1 WHERE TRANSID = 1");
+        db->ExecuteUpdate("UPDATE TEST_WRITES SET N = N + 1");
+        db->Commit();
+        wxMilliSleep(1);
+    }
+    dbUpgrade::WaitForBackup();
+    MM_CHECK(db->ExecuteScalar("SELECT COUNT(*) FROM CHECKINGACCOUNT_V1") == rows + writes);
+
+    MM_CHECK(wxFileExists(backup));
+    MM_CHECK(!wxFileExists(backup + ".tmp"));
+    wxSharedPtr<wxSQLite3Database> copy = mmDBWrapper::OpenReadOnly(backup, key);
+    if (!MM_CHECK(copy))
+        return mmTestResult();
+
+    wxSQLite3ResultSet check = copy->ExecuteQuery("PRAGMA integrity_check");
+    const wxString integrity = check.Eof() ? "" : check.GetAsString(0);
+    check.Finalize();
+    if (!MM_CHECK(integrity == "ok"))
+        std::fprintf(stderr, "integrity_check: %s\n", integrity.utf8_str().data());
+    MM_CHECK(copy->IsEncrypted() == encrypted);
+
+    const int copied = copy->ExecuteScalar("SELECT N FROM TEST_WRITES");
+    MM_CHECK(copied >= 0 && copied <= writes);
+    MM_CHECK(copy->ExecuteScalar("SELECT COUNT(*) FROM CHECKINGACCOUNT_V1") == rows + copied);
+    copy->Close();
+    std::printf("backup holds %d of the %d writes made while it ran\n", copied, writes);
+
+    return mmTestResult();
+}
@@ -0,0 +1,121 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* A budget entry saved or removed through Model_Budget only reloads its own
+* category in the cached plan of the year. The other categories are not
+* read again: an amount changed behind the model stays unseen until a write
+* past Model_Budget::save() builds the whole plan again.
+*
+*   test_budget_plan
+*/
+
+#include "testing.h"
+#include "model/allmodel.h"
+#include <cmath>
+
+namespace
+{
+    int64 addCategory(const wxString& name)
+    {
+        Model_Category::Data* category = Model_Category::instance().create();
+        category->CATEGNAME = name;
+        category->ACTIVE = 1;
+        category->PARENTID = -1;
+        return Model_Category::instance().save(category);
+    }
+
+    Model_Budget::Data* addEntry(int64 year_id, int64 categ_id, double amount)
+    {
+        Model_Budget::Data* entry = Model_Budget::instance().create();
+        entry->BUDGETYEARID = year_id;
+        entry->CATEGID = categ_id;
+        entry->PERIOD = Model_Budget::PERIOD_STR[Model_Budget::PERIOD_ID_MONTHLY];
+        entry->AMOUNT = amount;
+        entry->ACTIVE = 1;
+        Model_Budget::instance().save(entry);
+        return entry;
+    }
+
+    bool same(double a, double b)
+    {
+        return std::fabs(a - b) < 0.005;
+    }
+
+    // the amount of the category in the plan, written in the database past the model
+    void setBehind(wxSQLite3Database* db, const Model_Budget::Data* entry, double amount)
+    {
+        db->ExecuteUpdate(wxString::Format("UPDATE BUDGETTABLE_V1 SET AMOUNT = %f WHERE BUDGETENTRYID = %lld"
+            , amount, entry->BUDGETENTRYID.GetValue()));
+    }
+}
+
+int main()
+{
+    mmTestEnvironment env;
+    const int64 year_id = Model_Budgetyear::instance().Add("2024");
+    const int64 other_year_id = Model_Budgetyear::instance().Add("2025");
+    const int64 food = addCategory("Food");
+    const int64 rent = addCategory("Rent");
+    const int64 fuel = addCategory("Fuel");
+
+    Model_Budget::Data* food_entry = addEntry(year_id, food, -100);
+    Model_Budget::Data* rent_entry = addEntry(year_id, rent, -500);
+    addEntry(year_id, fuel, -50);
+
+    const mmBudgetPlan& plan = Model_Budget::instance().getBudgetPlan("2024");
+    MM_CHECK(same(plan.value(food, 0), -100));
+    MM_CHECK(same(plan.value(rent, 0), -500));
+    MM_CHECK(same(plan.value(food, 12), -1200));
+
+    // a saved entry reloads its category only
+    setBehind(env.db(), rent_entry, -900);
+    food_entry->AMOUNT = -200;
+    Model_Budget::instance().save(food_entry);
+    Model_Budget::instance().getBudgetPlan("2024");
+    MM_CHECK(same(plan.value(food, 0), -200));
+    MM_CHECK(same(plan.value(food, 12), -2400));
+    MM_CHECK(same(plan.value(rent, 0), -500));
+
+    // an entry of another year leaves the plan as it is
+    addEntry(other_year_id, food, -300);
+    Model_Budget::instance().getBudgetPlan("2024");
+    MM_CHECK(same(plan.value(food, 0), -200));
+    MM_CHECK(same(plan.value(rent, 0), -500));
+
+    // an entry moved to another category reloads both of them
+    food_entry->CATEGID = fuel;
+    Model_Budget::instance().save(food_entry);
+    Model_Budget::instance().getBudgetPlan("2024");
+    MM_CHECK(same(plan.value(food, 0), 0));
+    MM_CHECK(same(plan.value(fuel, 0), -250));
+    MM_CHECK(same(plan.value(rent, 0), -500));
+
+    // a removed entry reloads the category it was in
+    Model_Budget::instance().remove(food_entry->BUDGETENTRYID);
+    Model_Budget::instance().getBudgetPlan("2024");
+    MM_CHECK(same(plan.value(fuel, 0), -50));
+    MM_CHECK(same(plan.value(rent, 0), -500));
+
+    // a write past Model_Budget::save(), the saves of a list, builds the whole plan again
+    Model_Budget::Data_Set entries = Model_Budget::instance().find(Model_Budget::CATEGID(fuel));
+    Model_Budget::instance().save(entries);
+    Model_Budget::instance().getBudgetPlan("2024");
+    MM_CHECK(same(plan.value(rent, 0), -900));
+    MM_CHECK(same(plan.value(fuel, 0), -50));
+
+    return mmTestResult();
+}
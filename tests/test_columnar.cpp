@@ -0,0 +1,260 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* A columnar export read back with mmColumnarImport gives the same
+* transactions, transfers, splits and tags. A truncated file and a file
+* whose column lengths run past its end are refused.
+*/
+
+#include "testing.h"
+#include "import_export/columnar.h"
+#include "model/allmodel.h"
+#include <algorithm>
+#include <cstdio>
+#include <wx/file.h>
+
+namespace
+{
+    void addTags()
+    {
+        const wxString names[] = { "home", "work", "travel" };
+        std::vector<int64> tag_ids;
+        for (const auto& name : names)
+        {
+            Model_Tag::Data* tag = Model_Tag::instance().create();
+            tag->TAGNAME = name;
+            tag->ACTIVE = 1;
+            tag_ids.push_back(Model_Tag::instance().save(tag));
+        }
+
+        Model_Taglink::Cache links;
+        for (const auto& trx : Model_Checking::instance().all())
+        {
+            if (trx.TRANSID.GetValue() % 7 != 0)
+                continue;
+            Model_Taglink::Data* link = Model_Taglink::instance().create();
+            link->REFTYPE = Model_Attachment::REFTYPE_STR_TRANSACTION;
+            link->REFID = trx.TRANSID;
+            link->TAGID = tag_ids[trx.TRANSID.GetValue() % tag_ids.size()];
+            links.push_back(link);
+        }
+        Model_Taglink::instance().save(links);
+    }
+
+    // Everything the columnar file keeps of the transactions, ids aside
+    std::vector<wxString> describe()
+    {
+        const auto splits = Model_Splittransaction::instance().get_all();
+        const auto tags = Model_Taglink::instance().get_all(Model_Attachment::REFTYPE_STR_TRANSACTION);
+        std::vector<wxString> rows;
+        for (const auto& trx : Model_Checking::instance().all(Model_Checking::COL_TRANSID))
+        {
+            wxString row = wxString::Format("%s|%s|%s|%s|%s|%s|%s|%.2f|%.2f|%s|%s"
+                , trx.TRANSDATE.Left(10)
+                , Model_Account::get_account_name(trx.ACCOUNTID)
+                , trx.TOACCOUNTID > -1 ? Model_Account::get_account_name(trx.TOACCOUNTID) : wxString()
+                , Model_Payee::get_payee_name(trx.PAYEEID)
+                , Model_Category::full_name(trx.CATEGID)
+                , trx.TRANSCODE, trx.STATUS
+                , trx.TRANSAMOUNT, trx.TOTRANSAMOUNT
+                , trx.TRANSACTIONNUMBER, trx.NOTES);
+            const auto s = splits.find(trx.TRANSID);
+            if (s != splits.end())
+            {
+                for (const auto& split : s->second)
+                    row << wxString::Format("|split %s %.2f %s"
+                        , Model_Category::full_name(split.CATEGID), split.SPLITTRANSAMOUNT, split.NOTES);
+            }
+            const auto t = tags.find(trx.TRANSID);
+            if (t != tags.end())
+            {
+                for (const auto& link : t->second)
+                    row << "|tag " << Model_Tag::instance().get(link.TAGID)->TAGNAME;
+            }
+            rows.push_back(row);
+        }
+        return rows;
+    }
+
+    void addTransfer(int64 from, int64 to)
+    {
+        Model_Checking::Data* trx = Model_Checking::instance().create();
+        trx->ACCOUNTID = from;
+        trx->TOACCOUNTID = to;
+        trx->PAYEEID = -1;
+        trx->TRANSCODE = Model_Checking::TYPE_STR_TRANSFER;
+        trx->TRANSAMOUNT = 100.0;
+        trx->TOTRANSAMOUNT = 95.5;
+        trx->STATUS = Model_Checking::STATUS_KEY_RECONCILED;
+        trx->CATEGID = Model_Checking::instance().get(int64(1))->CATEGID;
+        trx->TRANSDATE = "2001-02-03";
+        trx->NOTES = "Savings";
+        trx->FOLLOWUPID = -1;
+        Model_Checking::instance().save(trx);
+    }
+
+    std::vector<unsigned char> readFile(const wxString& file)
+    {
+        wxFile in(file);
+        std::vector<unsigned char> bytes(static_cast<size_t>(in.Length()));
+        in.Read(bytes.data(), bytes.size());
+        return bytes;
+    }
+
+    // true when mmColumnarImport refuses the bytes, with a reason
+    bool refused(mmTestEnvironment& env, const std::vector<unsigned char>& bytes, size_t size)
+    {
+        const wxString file = env.tempFile("test_columnar_damaged.mmcol");
+        wxFile out(file, wxFile::write);
+        out.Write(bytes.data(), size);
+        out.Close();
+        mmColumnarImport importer;
+        return !importer.load(file) && !importer.error().empty() && importer.rows() == 0;
+    }
+
+    uint32_t u32(const std::vector<unsigned char>& bytes, size_t pos)
+    {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++)
+            v |= static_cast<uint32_t>(bytes[pos + i]) << (8 * i);
+        return v;
+    }
+
+    void setU32(std::vector<unsigned char>& bytes, size_t pos, uint32_t v)
+    {
+        for (int i = 0; i < 4; i++)
+            bytes[pos + i] = static_cast<unsigned char>(v >> (8 * i));
+    }
+
+    // position of the offsets of the number column, past the dictionaries
+    // and the fixed size columns of the rows
+    size_t numberOffsets(const std::vector<unsigned char>& bytes)
+    {
+        const uint32_t rows = u32(bytes, 12);
+        size_t pos = 16;
+        for (int dictionary = 0; dictionary < 4; dictionary++)
+        {
+            const uint32_t count = u32(bytes, pos);
+            pos += 4;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (dictionary == 2) pos += 4; // parent of the category
+                pos += 4 + u32(bytes, pos);
+            }
+        }
+        return pos + static_cast<size_t>(rows) * (8 + 4 * 4 + 1 + 1 + 4 + 8 + 8);
+    }
+}
+
+int main()
+{
+    mmTestEnvironment env;
+    mmTestData data;
+    const int64 checking = data.addAccount("Checking");
+    const int64 savings = data.addAccount("Savings");
+    data.addTransactions(checking, 2000, 50, 9);
+    addTransfer(checking, savings);
+    // names that need more than one byte in UTF-8
+    Model_Checking::Data* trx = Model_Checking::instance().get(int64(5));
+    trx->NOTES = wxString::FromUTF8("Caf\xC3\xA9 \xE2\x82\xAC 5\nsecond line");
+    Model_Checking::instance().save(trx);
+    addTags();
+
+    const std::vector<wxString> before = describe();
+    MM_CHECK(before.size() == 2001);
+
+    mmColumnarExport exporter;
+    const auto splits = Model_Splittransaction::instance().get_all();
+    const auto tags = Model_Taglink::instance().get_all(Model_Attachment::REFTYPE_STR_TRANSACTION);
+    const Model_Checking::Split_Data_Set no_splits;
+    const Model_Checking::Taglink_Data_Set no_tags;
+    for (const auto& r : Model_Checking::instance().all(Model_Checking::COL_TRANSID))
+    {
+        const auto s = splits.find(r.TRANSID);
+        const auto t = tags.find(r.TRANSID);
+        exporter.add(r, s != splits.end() ? s->second : no_splits, t != tags.end() ? t->second : no_tags);
+    }
+    const wxString file = env.tempFile("test_columnar.mmcol");
+    MM_CHECK(exporter.save(file));
+
+    // the accounts stay, payees, categories and tags are found by name again
+    env.db()->ExecuteUpdate("DELETE FROM CHECKINGACCOUNT_V1");
+    env.db()->ExecuteUpdate("DELETE FROM SPLITTRANSACTIONS_V1");
+    env.db()->ExecuteUpdate("DELETE FROM TAGLINK_V1");
+    Model_Checking::instance(env.db());
+    Model_Splittransaction::instance(env.db());
+    Model_Taglink::instance(env.db());
+    MM_CHECK(Model_Checking::instance().all().empty());
+
+    mmColumnarImport importer;
+    MM_CHECK(importer.load(file));
+    MM_CHECK(importer.rows() == before.size());
+    size_t skipped = 0;
+    MM_CHECK(importer.import(skipped) == before.size());
+    MM_CHECK(skipped == 0);
+
+    const std::vector<wxString> after = describe();
+    MM_CHECK(after.size() == before.size());
+    for (size_t i = 0; i < std::min(before.size(), after.size()); i++)
+    {
+        if (!MM_CHECK(before[i] == after[i]))
+        {
+            std::fprintf(stderr, "row %zu\n  %s\n  %s\n", i, before[i].utf8_str().data(), after[i].utf8_str().data());
+            break;
+        }
+    }
+
+    // a damaged file is refused
+    const std::vector<unsigned char> good = readFile(file);
+    MM_CHECK(!refused(env, good, good.size()));
+    std::vector<unsigned char> damaged = good;
+    damaged[6] = 'X';
+    MM_CHECK(refused(env, damaged, damaged.size()));
+
+    // cut anywhere, in the header, the dictionaries and the columns
+    for (const size_t size : { size_t(0), size_t(7), size_t(15), size_t(40)
+        , good.size() / 3, good.size() / 2, good.size() - 9, good.size() - 1 })
+    {
+        if (!MM_CHECK(refused(env, good, size)))
+            std::fprintf(stderr, "truncated to %zu of %zu bytes\n", size, good.size());
+    }
+
+    // lengths past the end of the file: rows, a dictionary, a strings column
+    damaged = good;
+    setU32(damaged, 12, 0x7FFFFFFF);
+    MM_CHECK(refused(env, damaged, damaged.size()));
+    damaged = good;
+    setU32(damaged, 16, 0xFFFFFFF0);
+    MM_CHECK(refused(env, damaged, damaged.size()));
+
+    const size_t offsets = numberOffsets(good);
+    const uint32_t rows = u32(good, 12);
+    MM_CHECK(u32(good, offsets) == 0);
+    damaged = good;
+    setU32(damaged, offsets + 4 * rows, 0xFFFFFF00);
+    MM_CHECK(refused(env, damaged, damaged.size()));
+    // an offset going back
+    damaged = good;
+    setU32(damaged, offsets + 4, u32(good, offsets + 8) + 1);
+    MM_CHECK(refused(env, damaged, damaged.size()));
+    // one row less than the columns hold
+    damaged = good;
+    setU32(damaged, 12, rows - 1);
+    MM_CHECK(refused(env, damaged, damaged.size()));
+
+    return mmTestResult();
+}
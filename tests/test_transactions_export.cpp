@@ -0,0 +1,93 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* The JSON and CSV exports of mmTransactionsExport, the code of the export
+* dialog. The transaction list and the CSV header are written when nothing
+* is selected as well: for an account without transactions, for no account
+* and for dates without transactions.
+*
+*   test_transactions_export
+*/
+
+#include "testing.h"
+#include "phasetimer.h"
+#include "import_export/export.h"
+#include "model/allmodel.h"
+
+namespace
+{
+    wxString run(int format, const wxArrayInt64& accounts, size_t& rows
+        , const wxDateTime& from = wxInvalidDateTime)
+    {
+        mmTransactionsExport exporter(format, accounts, "%Y-%m-%d", ",");
+        exporter.setDates(from, wxInvalidDateTime);
+        mmPhaseTimer timer("Export");
+        MM_CHECK(exporter.write(false, true, timer));
+        rows = exporter.transactions();
+        return exporter.text();
+    }
+
+    // the size of the transaction list, -1 when there is none
+    int json_transactions(const wxString& text)
+    {
+        Document json_doc;
+        if (json_doc.Parse(text.utf8_str()).HasParseError() || !json_doc.IsObject())
+            return -1;
+        const auto it = json_doc.FindMember("transactions");
+        if (it == json_doc.MemberEnd() || !it->value.IsArray())
+            return -1;
+        return static_cast<int>(it->value.Size());
+    }
+
+    wxString first_line(const wxString& text)
+    {
+        return text.BeforeFirst('\n');
+    }
+}
+
+int main()
+{
+    mmTestEnvironment env;
+    mmTestData data;
+    const int64 checking = data.addAccount("Checking");
+    const int64 empty = data.addAccount("Empty");
+    data.addTransactions(checking, 10, 3);
+    const wxDateTime after(1, wxDateTime::Jan, 2020);
+
+    size_t rows = 0;
+    MM_CHECK(json_transactions(run(mmTransactionsExport::JSON, { checking }, rows)) == 10);
+    MM_CHECK(rows == 10);
+
+    // the list is there and empty
+    MM_CHECK(json_transactions(run(mmTransactionsExport::JSON, { empty }, rows)) == 0);
+    MM_CHECK(rows == 0);
+    MM_CHECK(json_transactions(run(mmTransactionsExport::JSON, {}, rows)) == 0);
+    MM_CHECK(json_transactions(run(mmTransactionsExport::JSON, { checking }, rows, after)) == 0);
+    MM_CHECK(rows == 0);
+
+    // the header is the first line, rows or not
+    const wxString csv = run(mmTransactionsExport::CSV, { checking }, rows);
+    const wxString header = first_line(csv);
+    MM_CHECK(header.StartsWith(_("ID") + ","));
+    MM_CHECK(csv.Freq('\n') == 11);
+
+    MM_CHECK(run(mmTransactionsExport::CSV, { empty }, rows) == header + "\n" && rows == 0);
+    MM_CHECK(run(mmTransactionsExport::CSV, {}, rows) == header + "\n" && rows == 0);
+    MM_CHECK(run(mmTransactionsExport::CSV, { checking }, rows, after) == header + "\n" && rows == 0);
+
+    return mmTestResult();
+}
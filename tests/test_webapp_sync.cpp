@@ -0,0 +1,119 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+/*
+* WebApp list sync against a stand-in server on the loopback interface.
+* The sync skips a list by its hash: an unchanged list sends nothing, a
+* changed one is sent whole, once. A change of one payee sends the list of
+* all of them, what goes over the network grows with the list and not with
+* the transactions of the database.
+*
+*   test_webapp_sync [transactions]
+*/
+
+#include "testing.h"
+#include "webapp.h"
+#include "model/allmodel.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <wx/utils.h>
+
+namespace
+{
+    // Answers every request like services.php of WebApp API 1.0.1
+    std::string services(const std::string& request)
+    {
+        return request.find("check_api_version") != std::string::npos
+            ? "1.0.1" : "Operation has succeeded";
+    }
+
+    struct Sync
+    {
+        size_t requests;
+        size_t bytes;
+        size_t body_bytes;
+        double ms;
+    };
+
+    Sync sync_payees(mmTestServer& server)
+    {
+        server.reset();
+        const auto start = std::chrono::steady_clock::now();
+        MM_CHECK(mmWebApp::MMEX_WebApp_UpdatePayee());
+        const std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+        return { server.requests(), server.bytes(), server.bodyBytes(), ms.count() };
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int transactions = static_cast<int>(mmTestArg(argc, argv, 1, 20000));
+
+    mmTestEnvironment env;
+    wxSetEnv("no_proxy", "127.0.0.1");
+    mmTestServer server(services);
+    if (server.port() == 0)
+    {
+        std::printf("no stand-in server on this platform\n");
+        return 77; // skipped
+    }
+    Model_Infotable::instance().setString("WEBAPPURL", server.url(""));
+    Model_Infotable::instance().setString("WEBAPPGUID", "{STAND-IN}");
+
+    mmTestData data;
+    const int64 account = data.addAccount("Checking");
+    data.addPayees(200);
+
+    // the first sync sends the list, the next one nothing
+    const Sync first = sync_payees(server);
+    MM_CHECK(first.requests > 0);
+    MM_CHECK(first.body_bytes > 0);
+    const size_t payee_bytes = first.body_bytes / 200;
+    const Sync unchanged = sync_payees(server);
+    MM_CHECK(unchanged.requests == 0);
+
+    // one payee more: the list is sent again
+    data.addPayees(201);
+    const Sync small = sync_payees(server);
+    MM_CHECK(small.requests > 0);
+    // not a delta: the change is one payee, the list of all 201 goes
+    MM_CHECK(small.body_bytes > first.body_bytes);
+    MM_CHECK(small.body_bytes - first.body_bytes <= 2 * payee_bytes);
+
+    // the same change with many transactions in the database costs the same
+    data.addTransactions(account, transactions, 201);
+    MM_CHECK(sync_payees(server).requests == 0);
+    data.addPayees(202);
+    const Sync large = sync_payees(server);
+    MM_CHECK(large.requests == small.requests);
+    // the list is one payee longer, not longer by the transactions
+    MM_CHECK(large.body_bytes > small.body_bytes);
+    MM_CHECK(large.body_bytes - small.body_bytes <= 2 * payee_bytes);
+    MM_CHECK(large.bytes < small.bytes + small.bytes / 50);
+
+    std::printf("first sync: %zu requests, %zu bytes, %zu of body, %.1f ms\n"
+        , first.requests, first.bytes, first.body_bytes, first.ms);
+    std::printf("unchanged: %zu requests, %zu bytes, %zu of body, %.1f ms\n"
+        , unchanged.requests, unchanged.bytes, unchanged.body_bytes, unchanged.ms);
+    std::printf("one payee, 0 transactions: %zu requests, %zu bytes, %zu of body, %.1f ms\n"
+        , small.requests, small.bytes, small.body_bytes, small.ms);
+    std::printf("one payee, %d transactions: %zu requests, %zu bytes, %zu of body, %.1f ms\n"
+        , transactions, large.requests, large.bytes, large.body_bytes, large.ms);
+    std::printf("about %zu bytes a payee, a change of one sends %zu\n", payee_bytes, small.body_bytes);
+
+    return mmTestResult();
+}
@@ -0,0 +1,391 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#include "testing.h"
+#include "dbwrapper.h"
+#include "option.h"
+#include "paths.h"
+#include "model/allmodel.h"
+#include <chrono>
+#include <cstdio>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#if defined(__WXMSW__)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    int g_failures = 0;
+}
+
+bool mmTestCheck(bool ok, const char* expr, const char* file, int line)
+{
+    if (!ok)
+    {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+        g_failures++;
+    }
+    return ok;
+}
+
+int mmTestResult()
+{
+    if (g_failures > 0)
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+    return g_failures > 0 ? 1 : 0;
+}
+
+mmTestEnvironment::mmTestEnvironment(const wxString& path, const wxString& key)
+{
+    // errors go to stderr instead of message boxes
+    wxLog::SetActiveTarget(new wxLogStderr());
+
+    m_setting_db = mmDBWrapper::Open(":memory:");
+    Model_Setting::instance(m_setting_db.get());
+    Model_Usage::instance(m_setting_db.get());
+
+    open(path, key);
+}
+
+void mmTestEnvironment::open(const wxString& path, const wxString& key)
+{
+    if (m_db)
+        m_db->Close();
+
+    // a database in the temporary folder belongs to the test
+    if (path.StartsWith(mmex::getTempFolder()))
+    {
+        for (const auto& suffix : { "", "-journal", "-wal", "-shm" })
+            m_files.Add(path + suffix);
+    }
+    m_db = mmDBWrapper::Open(path, key);
+    Model_Infotable::instance(m_db.get());
+    Model_Asset::instance(m_db.get());
+    Model_Stock::instance(m_db.get());
+    Model_Account::instance(m_db.get());
+    Model_Payee::instance(m_db.get());
+    Model_Checking::instance(m_db.get());
+    Model_Currency::instance(m_db.get());
+    Model_Budgetyear::instance(m_db.get());
+    Model_Category::instance(m_db.get());
+    Model_Billsdeposits::instance(m_db.get());
+    Model_Splittransaction::instance(m_db.get());
+    Model_Report::instance(m_db.get());
+    Model_Tag::instance(m_db.get());
+    Model_CurrencyHistory::instance(m_db.get());
+    Model_StockHistory::instance(m_db.get());
+    Model_Attachment::instance(m_db.get());
+    Model_Taglink::instance(m_db.get());
+    Model_Budgetsplittransaction::instance(m_db.get());
+    Model_Budget::instance(m_db.get());
+    Model_CustomFieldData::instance(m_db.get());
+    Model_CustomField::instance(m_db.get());
+    Model_Translink::instance(m_db.get());
+    Model_Shareinfo::instance(m_db.get());
+
+    // Option::load() asks for a base currency when there is none
+    // the option may still hold the one of the previous database
+    if (Model_Infotable::instance().getInt64("BASECURRENCYID", -1) < 1)
+    {
+        Model_Currency::Data* usd = Model_Currency::instance().GetCurrencyRecord("USD");
+        if (usd)
+            Option::instance().setBaseCurrencyID(usd->CURRENCYID);
+    }
+    Option::instance().load();
+}
+
+mmTestEnvironment::~mmTestEnvironment()
+{
+    m_db.reset();
+    m_setting_db.reset();
+    for (const auto& file : m_files)
+    {
+        if (wxFileExists(file))
+            wxRemoveFile(file);
+    }
+}
+
+wxString mmTestEnvironment::tempFile(const wxString& name)
+{
+    const wxString file = mmTestTempPath(name);
+    m_files.Add(file);
+    return file;
+}
+
+wxString mmTestTempPath(const wxString& name)
+{
+    // the application creates the folder on start, the tests may come first
+    wxFileName::Mkdir(mmex::getTempFolder(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+    const wxString file = mmex::getTempFolder() + name;
+    if (wxFileExists(file))
+        wxRemoveFile(file);
+    return file;
+}
+
+long mmTestArg(int argc, char* argv[], int n, long def)
+{
+    long value = def;
+    if (n < argc && !wxString(argv[n]).ToLong(&value))
+        value = def;
+    return value;
+}
+
+size_t mmTestPeakRSS()
+{
+#if defined(__WXMSW__)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize / 1024;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#if defined(__WXMAC__)
+    return static_cast<size_t>(usage.ru_maxrss) / 1024; // bytes on macOS
+#else
+    return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+mmTestServer::mmTestServer(const Handler& handler, int delay_ms)
+    : m_handler(handler), m_delay_ms(delay_ms)
+{
+#if !defined(__WXMSW__)
+    m_socket = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if (m_socket < 0
+        || bind(m_socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || listen(m_socket, 64) != 0
+        || getsockname(m_socket, reinterpret_cast<sockaddr*>(&addr), &len) != 0)
+        return;
+    m_port = ntohs(addr.sin_port);
+    m_thread = std::thread([this]() { serve(); });
+#endif
+}
+
+mmTestServer::~mmTestServer()
+{
+#if !defined(__WXMSW__)
+    m_stop = true;
+    if (m_socket >= 0)
+    {
+        shutdown(m_socket, SHUT_RDWR);
+        close(m_socket);
+    }
+    if (m_thread.joinable())
+        m_thread.join();
+    for (auto& client : m_clients)
+        client.join();
+#endif
+}
+
+wxString mmTestServer::url(const wxString& path) const
+{
+    return wxString::Format("http://127.0.0.1:%d", m_port) + path;
+}
+
+void mmTestServer::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_requests = 0;
+    m_bytes = 0;
+    m_body_bytes = 0;
+}
+
+size_t mmTestServer::requests()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_requests;
+}
+
+size_t mmTestServer::bytes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+size_t mmTestServer::bodyBytes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_body_bytes;
+}
+
+void mmTestServer::serve()
+{
+#if !defined(__WXMSW__)
+    while (!m_stop)
+    {
+        const int client = accept(m_socket, nullptr, nullptr);
+        if (client < 0)
+            break;
+        // only this thread adds to them, the destructor joins them after it
+        m_clients.push_back(std::thread([this, client]() { reply(client); }));
+    }
+#endif
+}
+
+void mmTestServer::reply(int client)
+{
+#if !defined(__WXMSW__)
+    // header and body, the body as long as its Content-Length
+    std::string request;
+    size_t expected = std::string::npos, body_size = 0;
+    char buffer[16384];
+    while (request.size() < expected)
+    {
+        const ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+            break;
+        request.append(buffer, static_cast<size_t>(n));
+        const size_t header_end = request.find("\r\n\r\n");
+        if (expected == std::string::npos && header_end != std::string::npos)
+        {
+            // curl waits for it before sending a larger body
+            if (request.find("100-continue") < header_end)
+                send(client, "HTTP/1.1 100 Continue\r\n\r\n", 25, 0);
+            const size_t pos = request.find("Content-Length:");
+            if (pos != std::string::npos && pos < header_end)
+                body_size = std::stoul(request.substr(pos + 15));
+            expected = header_end + 4 + body_size;
+        }
+    }
+
+    {
+        // counted before the reply, the client reads the counts after it
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests++;
+        m_bytes += request.size();
+        m_body_bytes += body_size;
+    }
+
+    if (m_delay_ms > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_delay_ms));
+    const std::string body = m_handler(request);
+    const std::string reply = "HTTP/1.1 200 OK\r\nContent-Length: "
+        + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    send(client, reply.data(), reply.size(), 0);
+    close(client);
+#else
+    (void)client;
+#endif
+}
+
+unsigned int mmTestData::next(unsigned int limit)
+{
+    // a linear congruential generator, the same on every platform
+    m_state = m_state * 1103515245u + 12345u;
+    return limit > 0 ? (m_state >> 8) % limit : 0;
+}
+
+int64 mmTestData::addAccount(const wxString& name)
+{
+    Model_Account::Data* account = Model_Account::instance().create();
+    account->ACCOUNTNAME = name;
+    account->ACCOUNTTYPE = Model_Account::TYPE_STR_CHECKING;
+    account->STATUS = Model_Account::STATUS_STR_OPEN;
+    account->FAVORITEACCT = "TRUE";
+    account->INITIALBAL = 0;
+    account->INITIALDATE = "2000-01-01";
+    account->CURRENCYID = Option::instance().getBaseCurrencyID();
+    return Model_Account::instance().save(account);
+}
+
+void mmTestData::addPayees(int count)
+{
+    Model_Payee::instance().Savepoint();
+    for (int i = 1; i <= count; i++)
+    {
+        const wxString name = wxString::Format("Payee %d", i);
+        if (Model_Payee::instance().get(name))
+            continue;
+        Model_Category::Data* category = Model_Category::instance().create();
+        category->CATEGNAME = wxString::Format("Category %d", i);
+        category->ACTIVE = 1;
+        category->PARENTID = -1;
+        Model_Category::instance().save(category);
+
+        Model_Payee::Data* payee = Model_Payee::instance().create();
+        payee->PAYEENAME = name;
+        payee->CATEGID = category->CATEGID;
+        payee->ACTIVE = 1;
+        Model_Payee::instance().save(payee);
+    }
+    Model_Payee::instance().ReleaseSavepoint();
+}
+
+void mmTestData::addTransactions(int64 account_id, int rows, int payees, int split_every)
+{
+    addPayees(payees);
+    std::vector<int64> payee_ids, category_ids;
+    for (int i = 1; i <= payees; i++)
+    {
+        const Model_Payee::Data* payee = Model_Payee::instance().get(wxString::Format("Payee %d", i));
+        payee_ids.push_back(payee->PAYEEID);
+        category_ids.push_back(payee->CATEGID);
+    }
+
+    const wxDateTime start(1, wxDateTime::Jan, 2000);
+    Model_Checking::instance().Savepoint();
+    for (int i = 0; i < rows; i++)
+    {
+        const unsigned int p = next(static_cast<unsigned int>(payees));
+        Model_Checking::Data* trx = Model_Checking::instance().create();
+        trx->ACCOUNTID = account_id;
+        trx->TOACCOUNTID = -1;
+        trx->PAYEEID = payee_ids[p];
+        trx->TRANSCODE = next(4) == 0 ? Model_Checking::TYPE_STR_DEPOSIT : Model_Checking::TYPE_STR_WITHDRAWAL;
+        trx->TRANSAMOUNT = (1 + next(100000)) / 100.0;
+        trx->STATUS = Model_Checking::STATUS_KEY_NONE;
+        trx->TRANSACTIONNUMBER = wxString::Format("%d", i + 1);
+        trx->NOTES = next(8) == 0 ? wxString::Format("Note %u", next(1000)) : wxString();
+        trx->CATEGID = category_ids[p];
+        trx->TRANSDATE = (start + wxDateSpan::Days(i / 10)).FormatISODate();
+        trx->FOLLOWUPID = -1;
+        trx->TOTRANSAMOUNT = trx->TRANSAMOUNT;
+        Model_Checking::instance().save(trx);
+
+        if (split_every > 0 && i % split_every == 0)
+        {
+            const double first = trx->TRANSAMOUNT / 2;
+            const double amounts[2] = { first, trx->TRANSAMOUNT - first };
+            for (int s = 0; s < 2; s++)
+            {
+                Model_Splittransaction::Data* split = Model_Splittransaction::instance().create();
+                split->TRANSID = trx->TRANSID;
+                split->CATEGID = category_ids[(p + s) % payee_ids.size()];
+                split->SPLITTRANSAMOUNT = amounts[s];
+                Model_Splittransaction::instance().save(split);
+            }
+            trx->CATEGID = -1;
+            Model_Checking::instance().save(trx);
+        }
+    }
+    Model_Checking::instance().ReleaseSavepoint();
+}
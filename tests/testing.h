@@ -0,0 +1,156 @@
+/*******************************************************
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ ********************************************************/
+
+#ifndef MM_EX_TESTING_H_
+#define MM_EX_TESTING_H_
+
+#include <wx/init.h>
+#include <wx/sharedptr.h>
+#include <wx/string.h>
+#include "primitive.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class wxSQLite3Database;
+
+/**
+* Helpers of the headless tests and benchmarks. Each of them is a program of
+* its own run by CTest, returning mmTestResult() from main(). No window is
+* created, the models work on a database of their own.
+*
+*   int main(int argc, char* argv[])
+*   {
+*       mmTestEnvironment env;
+*       MM_CHECK(Model_Payee::instance().all().empty());
+*       return mmTestResult();
+*   }
+*/
+
+/** Check a condition, a failure is reported and makes the test fail */
+#define MM_CHECK(cond) mmTestCheck((cond), #cond, __FILE__, __LINE__)
+
+bool mmTestCheck(bool ok, const char* expr, const char* file, int line);
+/** Exit code of the test: 0, or 1 after a failed check */
+int mmTestResult();
+
+/**
+* Initializes wxWidgets without a display and attaches every model to the
+* database at path, opened with mmDBWrapper::Open(). The default is a new
+* database in memory, one at a mmTestTempPath() is removed with the
+* environment. The settings go to a database in memory of their own.
+*/
+class mmTestEnvironment
+{
+public:
+    explicit mmTestEnvironment(const wxString& path = ":memory:", const wxString& key = "");
+    ~mmTestEnvironment();
+
+    wxSQLite3Database* db() const { return m_db.get(); }
+    /** Close the database and attach the models to the one at path */
+    void open(const wxString& path, const wxString& key = "");
+
+    /** A new file name in the temporary folder, removed with the environment */
+    wxString tempFile(const wxString& name);
+
+private:
+    wxInitializer m_wx;
+    wxSharedPtr<wxSQLite3Database> m_db;
+    wxSharedPtr<wxSQLite3Database> m_setting_db;
+    wxArrayString m_files;
+};
+
+/** A file name in the temporary folder, with no file there yet */
+wxString mmTestTempPath(const wxString& name);
+/** Number argument n of the command line, e.g. the rows of a benchmark, or def */
+long mmTestArg(int argc, char* argv[], int n, long def);
+/** Peak resident memory of the process in KiB, 0 where unknown */
+size_t mmTestPeakRSS();
+
+/**
+* An HTTP server on the loopback interface, on a free port, standing in for
+* the web services in the tests of the network code. Every request gets the
+* body the handler returns for it, after the delay, on a thread of its own,
+* and its connection is closed. There is none on Windows, port() is 0.
+*/
+class mmTestServer
+{
+public:
+    /** The body of the reply to the request, its header and body */
+    typedef std::function<std::string(const std::string& request)> Handler;
+
+    explicit mmTestServer(const Handler& handler, int delay_ms = 0);
+    ~mmTestServer();
+
+    int port() const { return m_port; }
+    /** http://127.0.0.1:port followed by the path */
+    wxString url(const wxString& path = "/") const;
+
+    /** Start the counts of the requests again */
+    void reset();
+    size_t requests();
+    /** Bytes of the requests, header and body */
+    size_t bytes();
+    /** Bytes of the bodies of the requests */
+    size_t bodyBytes();
+
+private:
+    void serve();
+    void reply(int client);
+
+    Handler m_handler;
+    int m_delay_ms;
+    int m_socket = -1;
+    int m_port = 0;
+    std::atomic<bool> m_stop{ false };
+    std::thread m_thread;
+    std::vector<std::thread> m_clients;
+    std::mutex m_mutex;
+    size_t m_requests = 0;
+    size_t m_bytes = 0;
+    size_t m_body_bytes = 0;
+};
+
+/**
+* Deterministic test data: accounts, payees, categories and transactions
+* added through the models, the same ones for the same seed.
+*/
+class mmTestData
+{
+public:
+    explicit mmTestData(unsigned int seed = 1) : m_state(seed) {}
+
+    /** Add an account, returning its id */
+    int64 addAccount(const wxString& name);
+    /** Add payees "Payee 1" to "Payee count" with a category each, if missing */
+    void addPayees(int count);
+    /**
+    * Add rows transactions to the account in one transaction, every
+    * split_every-th of them split in two (0 for none), dated from 2000-01-01
+    */
+    void addTransactions(int64 account_id, int rows, int payees, int split_every = 0);
+
+    /** Next number of the sequence, below limit */
+    unsigned int next(unsigned int limit);
+
+private:
+    unsigned int m_state;
+};
+
+#endif // MM_EX_TESTING_H_